@@ -40,6 +40,7 @@
 #include "appenv.h"
 #include "app_procs.h"
 #include "batch.h"
+#include "bench.h"
 #include "brush.h"
 #include "brushlist.h"
 #include "color_transfer.h"
@@ -56,6 +57,7 @@
 #include "image_render.h"
 #include "interface.h"
 #include "internal_procs.h"
+#include "iostats_cmds.h"
 #include "layers_dialog.h"
 #include "levels.h"
 #include "menus.h"
@@ -200,6 +202,14 @@ gimp_init (int    gimp_argc,
 
   batch_init ();
 
+  if (bench_pending ())
+    {
+      bench_run ();
+      plug_in_kill ();
+      tile_swap_exit ();
+      exit (0);
+    }
+
   /* start server */
 #if 0
   server_start(serverPort, serverLog);
@@ -643,6 +653,7 @@ app_init (void)
   get_active_brush ();
   get_active_pattern ();
   paint_funcs_area_setup ();
+  iostats_dump_start ();
 
 }
 
@@ -682,6 +693,7 @@ app_exit_finish (void)
   file_temp_clear();
   pattern_select_dialog_free ();
   palette_free ();
+  iostats_dump_stop ();
   paint_funcs_area_free ();
   plug_in_kill ();
   procedural_db_free ();
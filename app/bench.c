@@ -0,0 +1,239 @@
+/* The GIMP -- an image manipulation program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*  --bench-xcf: load XCF files without a display and time the
+ *  compositing steps on them.  one tab separated line is printed
+ *  per step:
+ *
+ *    step file seconds peak-rss-kb tiles
+ *
+ *  where tiles counts the allocated portions of the projection,
+ *  shadow, layers, masks and channels after the step.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef WIN32
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+#include "appenv.h"
+#include "bench.h"
+#include "canvas.h"
+#include "channel.h"
+#include "convert.h"
+#include "drawable.h"
+#include "gimage.h"
+#include "layer.h"
+#include "procedural_db.h"
+#include "undo.h"
+
+/* undo steps replayed at most, in case a stack never empties */
+#define BENCH_MAX_UNDO 1000
+
+static GSList *bench_files = NULL;
+
+
+void
+bench_add_file (char *filename)
+{
+  bench_files = g_slist_append (bench_files, filename);
+}
+
+int
+bench_pending (void)
+{
+  return (bench_files != NULL);
+}
+
+static long
+bench_peak_rss (void)
+{
+#ifndef WIN32
+  struct rusage usage;
+
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+    return usage.ru_maxrss;
+#endif
+  return 0;
+}
+
+static int
+bench_canvas_tiles (Canvas *c)
+{
+  int x, y, w, h;
+  int n = 0;
+
+  if (!c)
+    return 0;
+
+  for (y = 0; y < canvas_height (c); y += h)
+    {
+      h = canvas_portion_height (c, 0, y);
+      if (h == 0)
+        break;
+      for (x = 0; x < canvas_width (c); x += w)
+        {
+          w = canvas_portion_width (c, x, y);
+          if (w == 0)
+            break;
+          if (canvas_portion_alloced (c, x, y))
+            n++;
+        }
+    }
+  return n;
+}
+
+static int
+bench_image_tiles (GImage *gimage)
+{
+  GSList *list;
+  int n;
+
+  n = bench_canvas_tiles (gimage->projection);
+  n += bench_canvas_tiles (gimage->shadow);
+
+  for (list = gimage->layers; list; list = g_slist_next (list))
+    {
+      Layer *layer = (Layer *) list->data;
+
+      n += bench_canvas_tiles (drawable_data (GIMP_DRAWABLE (layer)));
+      if (layer->mask)
+        n += bench_canvas_tiles (drawable_data (GIMP_DRAWABLE (layer->mask)));
+    }
+
+  for (list = gimage->channels; list; list = g_slist_next (list))
+    n += bench_canvas_tiles (drawable_data (GIMP_DRAWABLE (list->data)));
+
+  return n;
+}
+
+static void
+bench_report (char    *step,
+              char    *filename,
+              GTimer  *timer,
+              GImage  *gimage)
+{
+  printf ("%s\t%s\t%.6f\t%ld\t%d\n",
+          step, filename,
+          g_timer_elapsed (timer, NULL),
+          bench_peak_rss (),
+          gimage ? bench_image_tiles (gimage) : 0);
+  fflush (stdout);
+}
+
+static GImage *
+bench_load (char *filename)
+{
+  Argument *return_vals;
+  int nreturn_vals;
+  GImage *gimage = NULL;
+
+  return_vals = procedural_db_run_proc ("gimp_xcf_load",
+					&nreturn_vals,
+					PDB_INT32, 1,
+					PDB_STRING, filename,
+					PDB_STRING, filename,
+					PDB_END);
+
+  if (return_vals[0].value.pdb_int == PDB_SUCCESS)
+    gimage = gimage_get_ID (return_vals[1].value.pdb_int);
+
+  procedural_db_destroy_args (return_vals, nreturn_vals);
+  return gimage;
+}
+
+static void
+bench_file (char *filename)
+{
+  GTimer *timer = g_timer_new ();
+  GImage *gimage;
+  Precision precision;
+  int steps, i;
+
+  g_timer_start (timer);
+  gimage = bench_load (filename);
+  g_timer_stop (timer);
+  if (!gimage)
+    {
+      g_warning ("bench: could not load %s", filename);
+      g_timer_destroy (timer);
+      return;
+    }
+  bench_report ("load", filename, timer, gimage);
+
+  gimage_projection (gimage);
+  g_timer_start (timer);
+  gimage_construct (gimage, 0, 0, gimage->width, gimage->height);
+  g_timer_stop (timer);
+  bench_report ("construct", filename, timer, gimage);
+
+  precision = (tag_precision (gimage_tag (gimage)) == PRECISION_FLOAT)
+    ? PRECISION_U16 : PRECISION_FLOAT;
+  g_timer_start (timer);
+  convert_image_precision (gimage, precision);
+  g_timer_stop (timer);
+  bench_report ("convert-precision", filename, timer, gimage);
+
+  g_timer_start (timer);
+  gimage_construct (gimage, 0, 0, gimage->width, gimage->height);
+  g_timer_stop (timer);
+  bench_report ("construct-converted", filename, timer, gimage);
+
+  g_timer_start (timer);
+  gimage_scale (gimage, MAX (1, gimage->width / 2), MAX (1, gimage->height / 2));
+  g_timer_stop (timer);
+  bench_report ("scale", filename, timer, gimage);
+
+  g_timer_start (timer);
+  gimage_flatten (gimage);
+  g_timer_stop (timer);
+  bench_report ("flatten", filename, timer, gimage);
+
+  /* take every step back, then redo them all */
+  g_timer_start (timer);
+  for (steps = 0; steps < BENCH_MAX_UNDO && undo_pop (gimage); steps++)
+    ;
+  g_timer_stop (timer);
+  bench_report ("undo", filename, timer, gimage);
+
+  g_timer_start (timer);
+  for (i = 0; i < steps && undo_redo (gimage); i++)
+    ;
+  g_timer_stop (timer);
+  bench_report ("redo", filename, timer, gimage);
+
+  gimage_delete (gimage);
+  g_timer_destroy (timer);
+}
+
+void
+bench_run (void)
+{
+  GSList *list;
+
+  printf ("# step\tfile\tseconds\tpeak-rss-kb\ttiles\n");
+
+  for (list = bench_files; list; list = g_slist_next (list))
+    bench_file ((char *) list->data);
+
+  g_slist_free (bench_files);
+  bench_files = NULL;
+}
@@ -0,0 +1,12 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+
+/* headless timing of the compositing path on XCF files, see
+   the --bench-xcf command line option */
+void bench_add_file (char *filename);
+int  bench_pending  (void);
+void bench_run      (void);
+
+
+#endif /* __BENCH_H__ */
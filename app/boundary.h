@@ -36,6 +36,8 @@ typedef enum
   IgnoreBounds
 } BoundaryType;
 
+typedef struct BoundaryCache BoundaryCache;
+
 
 
 BoundSeg *  find_mask_boundary (Canvas *,
@@ -44,4 +46,11 @@ BoundSeg *  find_mask_boundary (Canvas *,
                                 int, int, int, int);
 BoundSeg *  sort_boundary (BoundSeg *, int, int *);
 
+BoundaryCache * boundary_cache_new  (void);
+void            boundary_cache_free (BoundaryCache *);
+BoundSeg *      boundary_cache_find (BoundaryCache *, Canvas *,
+                                     int *, BoundaryType,
+                                     int, int, int, int,
+                                     int, int, int, int);
+
 #endif  /*  __BOUNDARY_H__  */
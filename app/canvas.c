@@ -480,6 +480,49 @@ canvas_portion_unref  (
 }
 
 
+/* source of portion serials */
+static guint serial_counter = 0;
+
+guint
+canvas_serial_next (
+                    void
+                    )
+{
+  return ++serial_counter;
+}
+
+
+guint 
+canvas_portion_serial  (
+                        Canvas * c,
+                        int x,
+                        int y
+                        )
+{
+  if (c && c->rep)
+    {
+      switch (c->storage)
+        {
+        case STORAGE_TILED:
+          return tilebuf_portion_serial ((TileBuf *) c->rep, x, y);
+          break;
+        case STORAGE_FLAT:
+          return flatbuf_portion_serial ((FlatBuf *) c->rep, x, y);
+          break;
+#ifdef BUILD_SHM
+        case STORAGE_SHM:
+          return shmbuf_portion_serial ((ShmBuf *) c->rep, x, y);
+          break;
+#endif
+        default:
+          break;
+        }
+    }
+
+  return 0;
+}
+
+
 guint 
 canvas_portion_width  (
                        Canvas * c,
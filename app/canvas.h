@@ -108,6 +108,12 @@ RefRC          canvas_portion_refro     (Canvas *, int x, int y);
 RefRC          canvas_portion_refrw     (Canvas *, int x, int y);
 RefRC          canvas_portion_unref     (Canvas *, int x, int y);
 
+/* a stamp that changes whenever the portion holding this pixel is
+   reffed for writing, allocated or freed.  zero means the portion
+   was never allocated.  stamps are unique across all canvases */
+guint          canvas_portion_serial    (Canvas *, int x, int y);
+guint          canvas_serial_next       (void);
+
 /* initialize the backing store for this pixel */
 typedef guint (*CanvasInitFunc) (Canvas *, int, int, int, int,  void *);
 void           canvas_portion_init_setup (Canvas *, CanvasInitFunc, void *);
@@ -46,6 +46,8 @@ struct GimpChannel
   BoundSeg  *segs_out;          /*  outline of selected region   */
   int num_segs_in;              /*  number of lines in boundary  */
   int num_segs_out;             /*  number of lines in boundary  */
+  BoundaryCache *cache_in;      /*  per tile boundary pieces     */
+  BoundaryCache *cache_out;     /*  per tile boundary pieces     */
   int empty;                    /*  is the region empty?         */
   int bounds_known;             /*  recalculate the bounds?      */
   int x1, y1;                   /*  coordinates for bounding box */
@@ -58,7 +58,11 @@
 #endif
 
 #include "config.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #include "../lib/version.h"
+#include "../lib/wire/iostats.h"
 #include "libgimp/gimpintl.h"
 #include "depth/float16.h"
 #include "convert.h"
@@ -95,6 +99,14 @@
 /* the func used to transform, depending on the data being float or uint */
 typedef void  (*TransformFunc) (CMSTransform *transform, void *src_data, void *dest_data, int num_pixels);
 
+static double *cms_float_scratch (int num_doubles);
+static void    cms_float_pack    (CMSTransform *transform, void *src_data,
+                                  double *dbuffer, int num_pixels);
+static void    cms_float_unpack  (CMSTransform *transform, double *dbuffer,
+                                  void *dest_data, int num_pixels);
+static void    cms_transform_lut (CMSTransform *transform, void *src_data,
+                                  void *dest_data, int num_pixels);
+
 
 /*** TYPES ***/
 /* an entry in the profile cache */
@@ -107,10 +119,12 @@ typedef struct _ProfileCacheEntry
    the transform is a transform in memory,
    the device_link_file is the file name of a temporary 
    pre-calculated transform stored on disc,
+   the lut_file holds the baked grid of the same transform, if any,
    device_link_handle is the handle to it */
 typedef struct _TransformCacheEntry
 {   CMSTransform *transform;
     char*         device_link_file;
+    char*         lut_file;
     gint          ref_count;
 } TransformCacheEntry;
 
@@ -134,6 +148,8 @@ struct _CMSTransform
     icColorSpaceSignature colourspace_in;  /*!< source/image colour space */
     DWORD lcms_input_format;        /*!< put information about alpha ... */
     DWORD lcms_output_format;       /*!< put information about alpha ... */
+    float *lut;                     /*!< baked rgb grid of the whole chain */
+    int    lut_size;                /*!< grid points per axis of lut */
 };
     
 /*** VARIABLE DECLARATIONS ***/
@@ -152,6 +168,20 @@ static GHashTable *transform_cache = NULL;
    but kept in memory for efficiency
    will be few, < MAX_TRANSFORMS_KEPT_IN_MEM */
 static GList *unused_transforms_kept_in_mem = NULL;
+/* reused double buffer of cms_transform_float and cms_transform_area */
+static double *float_scratch = NULL;
+static int float_scratch_size = 0;
+
+#ifdef HAVE_PTHREAD
+/* lcms transforms and the scratch are used from the display render
+   threads; baked luts go without the lock */
+static pthread_mutex_t cms_lock = PTHREAD_MUTEX_INITIALIZER;
+#define CMS_LOCK()   pthread_mutex_lock (&cms_lock)
+#define CMS_UNLOCK() pthread_mutex_unlock (&cms_lock)
+#else
+#define CMS_LOCK()
+#define CMS_UNLOCK()
+#endif
 
 /* buffer to return profile information in */
 static CMSProfileInfo *profile_info_buffer = NULL;
@@ -230,10 +260,15 @@ cms_delete_transform_from_cache(gpointer key,
      }
 
      g_free(cache_entry->transform->cache_key);
+     g_free(cache_entry->transform->lut);
      g_free(cache_entry->transform);		
 
      g_free(cache_entry->device_link_file);
      cache_entry->device_link_file = NULL;
+     if (cache_entry->lut_file)
+         remove(cache_entry->lut_file);
+     g_free(cache_entry->lut_file);
+     cache_entry->lut_file = NULL;
      g_free(cache_entry);
 
      return TRUE;
@@ -586,6 +621,9 @@ void cms_free()
     g_hash_table_foreach_remove(transform_cache, cms_delete_transform_from_cache, NULL);
     g_hash_table_destroy(transform_cache);
     g_free(profile_info_buffer);
+    g_free(float_scratch);
+    float_scratch = NULL;
+    float_scratch_size = 0;
 }
 
 
@@ -1834,7 +1872,10 @@ cms_get_transform(GSList *profiles,
         cache_entry->transform->dest_tag = dest_tag;
         cache_entry->transform->cache_key = hash_key->str;
         cache_entry->transform->handle = transform;
+        cache_entry->transform->lut = NULL;
+        cache_entry->transform->lut_size = 0;
         cache_entry->device_link_file = NULL;
+        cache_entry->lut_file = NULL;
 
         /* Float Lab hack */
         cache_entry->transform->colourspace_in = cmsGetColorSpace(profile_array[0]);
@@ -1855,6 +1896,7 @@ cms_get_transform(GSList *profiles,
               cmsDeleteTransform(exp_form->handle);
 
             g_free(exp_form->cache_key);
+            g_free(exp_form->lut);
             g_free(exp_form);
             *expensive_transform = NULL;
           }
@@ -1971,6 +2013,10 @@ cms_return_transform(CMSTransform *transform)
 	{   TransformCacheEntry *old_cache_entry = (TransformCacheEntry *)unused_transforms_kept_in_mem->data;
 	    cmsDeleteTransform(old_cache_entry->transform->handle);
 	    old_cache_entry->transform->handle = NULL;
+	    /* the grid is on disc as well */
+	    g_free(old_cache_entry->transform->lut);
+	    old_cache_entry->transform->lut = NULL;
+	    old_cache_entry->transform->lut_size = 0;
 	    unused_transforms_kept_in_mem = g_list_remove(unused_transforms_kept_in_mem, old_cache_entry);
 	}
     }	
@@ -2015,6 +2061,7 @@ cms_transform_buffer (CMSTransform *transform, void *src_data, void *dest_data,
     double * dest_data_ = NULL;
     int len = 0;
     int bytes = 2;
+    IOStatsTimer timer;
 
     if (!transform || !transform->handle)
     {   g_warning ("%s:%d %s(): transform empty",__FILE__,__LINE__,__func__);
@@ -2043,6 +2090,9 @@ cms_transform_buffer (CMSTransform *transform, void *src_data, void *dest_data,
         return;
     }
 
+    if (transform->lut)
+        transform_func = cms_transform_lut;
+
     if(src_data == dest_data &&
        tag_format(transform->dest_tag) == FORMAT_GRAY)
     {
@@ -2051,7 +2101,9 @@ cms_transform_buffer (CMSTransform *transform, void *src_data, void *dest_data,
       dest_data = dest_data_;
     }
 
+    iostats_timer_start (&timer);
     (*transform_func) (transform, src_data, dest_data, num_pixels);
+    iostats_timer_stop (&timer, IOSTATS_CMS);
 
     if(dest_data_)
     {
@@ -2076,6 +2128,7 @@ cms_transform_area(CMSTransform *transform, PixelArea *src_area, PixelArea *dest
     void *src_data, *dest_data;
     guint num_pixels;
     void *pag;
+    IOStatsTimer timer;
     
     if (tag_precision(src_tag) != tag_precision(dest_tag)) 
     {
@@ -2104,13 +2157,54 @@ cms_transform_area(CMSTransform *transform, PixelArea *src_area, PixelArea *dest
       return;
     }
 
+    if (transform->lut)
+        transform_func = cms_transform_lut;
 
+    iostats_timer_start (&timer);
     for (pag = pixelarea_register (2, src_area, dest_area);
 	 pag != NULL;
 	 pag = pixelarea_process (pag))
     {   h = pixelarea_height(src_area);	  
         num_pixels = pixelarea_width(dest_area);  
 
+        /* whole portions in one go, lcms has a per call overhead */
+        if (transform_func == cms_transform_float &&
+            (tag_precision(dest_tag) == PRECISION_FLOAT ||
+             tag_precision(dest_tag) == PRECISION_FLOAT16))
+        {   int chan_in = MAX (tag_num_channels(transform->src_tag), 4);
+            int chan_out = MAX (tag_num_channels(transform->dest_tag), 4);
+            double *src_dbuffer, *dest_dbuffer;
+            guint y;
+
+            CMS_LOCK ();
+            src_dbuffer = cms_float_scratch (num_pixels * h * (chan_in + chan_out));
+            dest_dbuffer = src_dbuffer + num_pixels * h * chan_in;
+
+            for (y = 0; y < h; y++)
+                cms_float_pack (transform,
+                                pixelarea_data(src_area) + y * pixelarea_rowstride(src_area),
+                                src_dbuffer + y * num_pixels * tag_num_channels(transform->src_tag),
+                                num_pixels);
+
+            cmsDoTransform (transform->handle, src_dbuffer, dest_dbuffer,
+                            num_pixels * h);
+
+            for (y = 0; y < h; y++)
+                cms_float_unpack (transform,
+                                  dest_dbuffer + y * num_pixels * tag_num_channels(transform->dest_tag),
+                                  pixelarea_data(dest_area) + y * pixelarea_rowstride(dest_area),
+                                  num_pixels);
+            CMS_UNLOCK ();
+            continue;
+        }
+
+        /* rows without gaps between them are done as a single run */
+        if (pixelarea_rowstride(src_area) == num_pixels * pixelarea_bytes(src_area) &&
+            pixelarea_rowstride(dest_area) == num_pixels * pixelarea_bytes(dest_area))
+        {   num_pixels *= h;
+            h = 1;
+        }
+
 	while (h--)
         {   pixelarea_getdata(src_area, &src_row_buffer, h);	    
 	    pixelarea_getdata(dest_area, &dest_row_buffer, h);
@@ -2122,6 +2216,7 @@ cms_transform_area(CMSTransform *transform, PixelArea *src_area, PixelArea *dest
             (*transform_func) (transform, src_data, dest_data, num_pixels);
 	}
     } 
+    iostats_timer_stop (&timer, IOSTATS_CMS);
 }
 
 #if 0
@@ -2256,7 +2351,9 @@ cms_transform_uint(CMSTransform *transform, void *src_data, void *dest_data, int
                    __FILE__,__LINE__,__func__);
 
     /* easy, no previous conversion, lcms does it all */
+    CMS_LOCK ();
     cmsDoTransform(transform->handle,src_data,dest_data,num_pixels);
+    CMS_UNLOCK ();
 
 #   if 0
     cms_transform_uint_extra( transform, src_data, dest_data, num_pixels );
@@ -2290,229 +2387,403 @@ cms_transform_uint(CMSTransform *transform, void *src_data, void *dest_data, int
 #   endif
 }
 
-void
-cms_transform_float(CMSTransform *transform, void *src_data, void *dest_data, int num_pixels) 
-{   /* need to convert data to double for lcms's convenience */
-    int cchan_in = T_CHANNELS( transform->lcms_input_format );
-    int cchan_out = T_CHANNELS( transform->lcms_output_format );
-    int chan_in = tag_num_channels( transform->src_tag );
-    int chan_out = tag_num_channels( transform->dest_tag );
-    int chan = chan_out;
-    int alpha = tag_alpha( transform->dest_tag ) == ALPHA_YES ? 1:0;
-    /*int extra_in = chan_in - cchan_in;
-    int extra_out = chan_out - cchan_out; */
-    int src_alpha = tag_alpha( transform->src_tag ) == ALPHA_YES ? 1:0;
-    int dest_alpha = tag_alpha( transform->dest_tag ) == ALPHA_YES ? 1:0;
-    int i, j, pix;
-    float *src_fbuffer = (float *)src_data;
-    float *dest_fbuffer = (float *)dest_data;
-    guint16 *src_hbuffer = (guint16 *)src_data;
-    guint16 *dest_hbuffer = (guint16 *)dest_data;
-    double *src_dbuffer = NULL,
-           *dest_dbuffer = NULL;
-    void  * src_buffer = NULL,
-          * dest_buffer = NULL;
-    double* dbuffer = NULL;
-    ShortsFloat u;
-    Precision dest_p = tag_precision( transform->dest_tag );
-
-    if (!transform || !transform->handle)
-        g_warning ("%s:%d %s() transform not allocated\n",
-                   __FILE__,__LINE__,__func__);
-    if (!src_data || !dest_data)
-        g_warning ("%s:%d %s() array not allocated\n",
-                   __FILE__,__LINE__,__func__);
-
-#   if 1
-    src_dbuffer = malloc(sizeof(double) * num_pixels * 4);
-    if( dest_p == PRECISION_FLOAT16 ||
-        dest_p == PRECISION_FLOAT)
+/* scratch for the double buffers lcms wants for float data,
+   kept between calls and only grown */
+static double *
+cms_float_scratch (int num_doubles)
+{
+    if (num_doubles > float_scratch_size)
     {
-      dest_dbuffer = malloc(sizeof(double) * num_pixels * 4);
-      dest_buffer = dest_dbuffer;
-    } else
-      dest_buffer = dest_data;
-    src_buffer = src_dbuffer;
-#   else
-    dbuffer = malloc(sizeof(double) * num_pixels * 4);
-#   endif
+      g_free (float_scratch);
+      float_scratch = g_new (double, num_doubles);
+      float_scratch_size = num_doubles;
+    }
+    return float_scratch;
+}
 
-#   ifdef DEBUG_
-    printf ("%s:%d %s()  colourspace%d extra:%d channels:%d lcms_bytes%d \n", __FILE__,__LINE__,__func__, T_COLORSPACE(transform->lcms_input_format), T_EXTRA(transform->lcms_input_format), T_CHANNELS(transform->lcms_input_format), T_BYTES(transform->lcms_input_format) );
-#   endif
+/* float or half pixels into lcms doubles */
+static void
+cms_float_pack (CMSTransform *transform, void *src_data, double *dbuffer,
+                int num_pixels)
+{
+    int n = num_pixels * tag_num_channels( transform->src_tag );
+    int i;
 
-#if 1
     switch (tag_precision( transform->src_tag ))
     {
       case PRECISION_FLOAT16:
-        for (i=0; i < num_pixels * chan_in; ++i) 
         {
-          if(T_COLORSPACE(transform->lcms_input_format) == PT_CMYK)
-            src_dbuffer[i] = (double) FLT( src_hbuffer[i], u ) * 100.;
-          else
-            src_dbuffer[i] = (double) FLT( src_hbuffer[i], u );
+          guint16 *src = (guint16 *)src_data;
+          double scale = T_COLORSPACE(transform->lcms_input_format) == PT_CMYK ?
+                         100. : 1.;
+          ShortsFloat u;
+
+          for (i = 0; i < n; ++i)
+            dbuffer[i] = (double) FLT( src[i], u ) * scale;
         }
         break;
       case PRECISION_FLOAT:
-# if 0
-        // Lab floating point makes no sense
-        if (transform->colourspace_in == icSigLabData)
         {
-          for (pix=0; pix < num_pixels; ++pix)
-          { i = pix * chan_in;
-           /* The 100. multiplicator comes from PT_ANY in cms_get_lcms_format().
-             */
-            src_dbuffer[i+0] = (double) src_fbuffer[i+0]*100.;
-            src_dbuffer[i+1] = (double) src_fbuffer[i+1]*100.;
-            src_dbuffer[i+2] = (double) src_fbuffer[i+2]*100.;
-            if(src_alpha)
-              src_dbuffer[i+3] = (double)  src_fbuffer[i+3];
-          }
-        } else {
-# endif
-          for (i=0; i < num_pixels * chan_in; ++i) 
-# if 0
-            if(transform->colourspace_in == icSigCmykData)
-              src_dbuffer[i]=(double)src_fbuffer[i] * 100.;
-            else
-# endif
-              src_dbuffer[i]=(double)src_fbuffer[i];
-/*        } */
+          /* Lab floating point makes no sense, no scaling here */
+          float *src = (float *)src_data;
+
+          for (i = 0; i < n; ++i)
+            dbuffer[i] = (double) src[i];
+        }
         break;
       default:
-        dest_buffer = dest_data;
-        return;
+        break;
     }
+}
 
-    cmsDoTransform( transform->handle, src_buffer, dest_buffer, num_pixels );
+/* lcms doubles back into float or half pixels */
+static void
+cms_float_unpack (CMSTransform *transform, double *dbuffer, void *dest_data,
+                  int num_pixels)
+{
+    int cchan_out = T_CHANNELS( transform->lcms_output_format );
+    int chan_in = tag_num_channels( transform->src_tag );
+    int chan_out = tag_num_channels( transform->dest_tag );
+    int dest_alpha = tag_alpha( transform->dest_tag ) == ALPHA_YES ? 1:0;
+    int i, j;
 
-    /* and convert back */
     switch (tag_precision( transform->dest_tag ))
     {
       case PRECISION_FLOAT16:
-          for (i=0; i < num_pixels; ++i) 
+        {
+          guint16 *dest = (guint16 *)dest_data;
+          double scale = T_COLORSPACE(transform->lcms_output_format) == PT_CMYK ?
+                         1. / 100. : 1.;
+          ShortsFloat u;
+
+          for (i = 0; i < num_pixels; ++i, dest += chan_out, dbuffer += chan_out)
           {
-            for(j = 0; j < cchan_out; ++j)
-              /* copy colour channels */
-              if(T_COLORSPACE(transform->lcms_output_format) == PT_CMYK)
-                dest_hbuffer[i*chan_out + j] = (double) FLT16( dest_dbuffer[i*chan_out + j] / 100., u );
-              else
-                dest_hbuffer[i*chan_out + j] = (double) FLT16( dest_dbuffer[i*chan_out + j], u );
-            for(j = chan_in; j < chan_out; ++j)
-              if(dest_alpha && j+1 == chan_out)
+            /* copy colour channels */
+            for (j = 0; j < cchan_out; ++j)
+              dest[j] = FLT16( dbuffer[j] * scale, u );
+            for (j = chan_in; j < chan_out; ++j)
+              if (dest_alpha && j+1 == chan_out)
                 /* set CinePaints alpha channel to opace */
-                dest_hbuffer[i*chan_out + j] = ONE_FLOAT16;
+                dest[j] = ONE_FLOAT16;
               else
                 /* refill with previous values */
-                dest_hbuffer[i*chan_out + j] = dest_hbuffer[i*chan_out + j-1];
+                dest[j] = dest[j-1];
               /* ignore other untouched channels */
           }
+        }
         break;
       case PRECISION_FLOAT:
-          for (i=0; i < num_pixels; ++i) 
+        {
+          float *dest = (float *)dest_data;
+
+          for (i = 0; i < num_pixels; ++i, dest += chan_out, dbuffer += chan_out)
           {
-            for(j = 0; j < cchan_out; ++j)
-#             if 0
-              if(T_COLORSPACE(transform->lcms_output_format) == PT_CMYK)
-                dest_fbuffer[i*chan_out + j] = dest_dbuffer[i*chan_out + j]/100.0;
-              else
-#             endif
-                dest_fbuffer[i*chan_out + j] = dest_dbuffer[i*chan_out + j];
-            for(j = chan_in; j < chan_out; ++j)
-              if(dest_alpha && j+1 == chan_out)
-                dest_fbuffer[i*chan_out + j] = 1.0;
+            for (j = 0; j < cchan_out; ++j)
+              dest[j] = dbuffer[j];
+            for (j = chan_in; j < chan_out; ++j)
+              if (dest_alpha && j+1 == chan_out)
+                dest[j] = 1.0;
               else
-                dest_fbuffer[i*chan_out + j] = dest_fbuffer[i*chan_out + j-1];
+                dest[j] = dest[j-1];
           }
+        }
         break;
       default:
         break;
     }
+}
 
-    if(dest_dbuffer) g_free(dest_dbuffer);
-    if(src_dbuffer) g_free(src_dbuffer);
-# else
+void
+cms_transform_float(CMSTransform *transform, void *src_data, void *dest_data, int num_pixels) 
+{   /* need to convert data to double for lcms's convenience */
+    int chan_in = tag_num_channels( transform->src_tag );
+    int chan_out = tag_num_channels( transform->dest_tag );
+    Precision src_p = tag_precision( transform->src_tag );
+    Precision dest_p = tag_precision( transform->dest_tag );
+    double *src_dbuffer, *dest_dbuffer;
 
-    switch (tag_precision( transform->dest_tag ))
+    if (!transform || !transform->handle)
+        g_warning ("%s:%d %s() transform not allocated\n",
+                   __FILE__,__LINE__,__func__);
+    if (!src_data || !dest_data)
+        g_warning ("%s:%d %s() array not allocated\n",
+                   __FILE__,__LINE__,__func__);
+
+    if (src_p != PRECISION_FLOAT16 && src_p != PRECISION_FLOAT)
+        return;
+
+#   ifdef DEBUG_
+    printf ("%s:%d %s()  colourspace%d extra:%d channels:%d lcms_bytes%d \n", __FILE__,__LINE__,__func__, T_COLORSPACE(transform->lcms_input_format), T_EXTRA(transform->lcms_input_format), T_CHANNELS(transform->lcms_input_format), T_BYTES(transform->lcms_input_format) );
+#   endif
+
+    CMS_LOCK ();
+    src_dbuffer = cms_float_scratch (num_pixels * (MAX (chan_in, 4) + MAX (chan_out, 4)));
+    dest_dbuffer = src_dbuffer + num_pixels * MAX (chan_in, 4);
+
+    cms_float_pack (transform, src_data, src_dbuffer, num_pixels);
+
+    if (dest_p == PRECISION_FLOAT16 || dest_p == PRECISION_FLOAT)
     {
-      case PRECISION_FLOAT16:
-        for (i=0; i < num_pixels * chan; ++i) 
-        {
-          if(T_COLORSPACE(transform->lcms_input_format) == PT_CMYK)
-            dbuffer[i] = (double) FLT( src_hbuffer[i], u ) * 100.;
-          else
-            dbuffer[i] = (double) FLT( src_hbuffer[i], u );
-        }
-        break;
-      case PRECISION_FLOAT:
-        if (transform->colourspace_in == icSigLabData)
-        {
-          for (pix=0; pix < num_pixels; ++pix)
-          { i = pix * chan;
-           /* The 100. multiplicator comes from PT_ANY in cms_get_lcms_format().
-             */
-            dbuffer[i+0] = (double) src_fbuffer[i+0]*100.;
-            dbuffer[i+1] = (double) src_fbuffer[i+1]*100.;
-            dbuffer[i+2] = (double) src_fbuffer[i+2]*100.;
-            if(alpha)
-              dbuffer[i+3] = (double)  src_fbuffer[i+3];
-          }
-        } else {
-          for (i=0; i < num_pixels * chan; ++i) 
-            if(transform->colourspace_in == icSigCmykData)
-              dbuffer[i]=(double)src_fbuffer[i] * 100.;
-            else
-              dbuffer[i]=(double)src_fbuffer[i];
-        }
-        break;
-      default:
-        g_warning ("cms_transform: precision not supported");
+      cmsDoTransform( transform->handle, src_dbuffer, dest_dbuffer, num_pixels );
+      /* and convert back */
+      cms_float_unpack (transform, dest_dbuffer, dest_data, num_pixels);
+    }
+    else
+      cmsDoTransform( transform->handle, src_dbuffer, dest_data, num_pixels );
+    CMS_UNLOCK ();
+}
+
+
+/* read a lut written by cms_lut_save, FALSE if it does not fit */
+static gboolean
+cms_lut_load (const char *file_name, float *lut, int lut_size)
+{
+    FILE *fp = fopen (file_name, "rb");
+    int size = 0;
+    int n = lut_size * lut_size * lut_size * 3;
+    gboolean ok;
+
+    if (!fp)
+        return FALSE;
+
+    ok = fread (&size, sizeof (int), 1, fp) == 1 &&
+         size == lut_size &&
+         fread (lut, sizeof (float), n, fp) == (size_t) n;
+
+    fclose (fp);
+    return ok;
+}
+
+static void
+cms_lut_save (const char *file_name, float *lut, int lut_size)
+{
+    FILE *fp = fopen (file_name, "wb");
+    int n = lut_size * lut_size * lut_size * 3;
+
+    if (!fp)
         return;
+
+    if (fwrite (&lut_size, sizeof (int), 1, fp) != 1 ||
+        fwrite (lut, sizeof (float), n, fp) != (size_t) n)
+        g_warning ("%s:%d %s(): could not write %s",
+                   __FILE__,__LINE__,__func__, file_name);
+
+    fclose (fp);
+}
+
+/* one colour channel of a pixel as 0..1 value */
+static float
+cms_lut_get (Precision p, void *data, int i)
+{
+    ShortsFloat u;
+
+    switch (p)
+    {
+      case PRECISION_U8:      return ((guint8 *)data)[i] / 255.f;
+      case PRECISION_U16:     return ((guint16 *)data)[i] / 65535.f;
+      case PRECISION_FLOAT:   return ((float *)data)[i];
+      case PRECISION_FLOAT16: return FLT (((guint16 *)data)[i], u);
+      default:                return 0;
     }
+}
 
-    cmsDoTransform(transform->handle,dbuffer,dbuffer,num_pixels);
+static void
+cms_lut_set (Precision p, void *data, int i, float v)
+{
+    ShortsFloat u;
 
-    /* and convert back */
-    switch (tag_precision( transform->dest_tag ))
+    switch (p)
     {
-      case PRECISION_FLOAT16:
-          for (i=0; i < num_pixels; ++i) 
-          {
-            for(j = 0; j < cchan_out; ++j)
-              /* copy colour channels */
-              if(T_COLORSPACE(transform->lcms_output_format) == PT_CMYK)
-                dest_hbuffer[i*chan + j] = (double) FLT16( dbuffer[i*chan + j] / 100., u );
-              else
-                dest_hbuffer[i*chan + j] = (double) FLT16( dbuffer[i*chan + j], u );
-            for(j = cchan_out; j < cchan_in; ++j)
-              if(alpha && j+1 == chan)
-                /* set CinePaints alpha channel to opace */
-                dest_hbuffer[i*chan + j] = ONE_FLOAT16;
-              else
-                /* refill with previous values */
-                dest_hbuffer[i*chan + j] = dest_hbuffer[i*chan + j-1];
-              /* ignore other untouched channels */
-          }
+      case PRECISION_U8:
+        ((guint8 *)data)[i] = (guint8) (CLAMP (v, 0, 1) * 255.f + .5f);
+        break;
+      case PRECISION_U16:
+        ((guint16 *)data)[i] = (guint16) (CLAMP (v, 0, 1) * 65535.f + .5f);
         break;
       case PRECISION_FLOAT:
-          for (i=0; i < num_pixels; ++i) 
-          {
-            for(j = 0; j < cchan_out; ++j)
-              if(T_COLORSPACE(transform->lcms_output_format) == PT_CMYK)
-                dest_fbuffer[i*chan + j] = dbuffer[i*chan + j]/100.0;
-              else
-                dest_fbuffer[i*chan + j] = dbuffer[i*chan + j];
-            for(j = cchan_out; j < cchan_in; ++j)
-              if(alpha && j+1 == chan)
-                dest_fbuffer[i*chan + j] = 1.0;
-              else
-                dest_fbuffer[i*chan + j] = dest_fbuffer[i*chan + j-1];
-          }
+        ((float *)data)[i] = v;
+        break;
+      case PRECISION_FLOAT16:
+        ((guint16 *)data)[i] = FLT16 (v, u);
+        break;
+      default:
         break;
     }
+}
 
-    g_free(dbuffer);
-# endif
+/*
+ * sample the transform on a lut_size^3 grid, so that the display
+ * and proofing chains cost one tetrahedral lookup per pixel.
+ * only rgb to rgb transforms with equal tags are baked.
+ * lut_size < 2 drops a baked grid again
+ */
+gboolean
+cms_transform_bake_lut (CMSTransform *transform, int lut_size)
+{
+    TransformCacheEntry *cache_entry;
+    Precision p;
+    int chan, r, g, b, j;
+    int n;
+    float *lut;
+    void *buffer;
+
+    if (!transform || !transform->handle)
+        return FALSE;
+
+    if (lut_size < 2)
+    {   g_free (transform->lut);
+        transform->lut = NULL;
+        transform->lut_size = 0;
+        return FALSE;
+    }
+
+    if (transform->lut && transform->lut_size == lut_size)
+        return TRUE;
+
+    if (transform->src_tag != transform->dest_tag ||
+        tag_format (transform->src_tag) != FORMAT_RGB ||
+        T_CHANNELS (transform->lcms_input_format) != 3 ||
+        T_CHANNELS (transform->lcms_output_format) != 3)
+        return FALSE;
+
+    p = tag_precision (transform->src_tag);
+    chan = tag_num_channels (transform->src_tag);
+    n = lut_size * lut_size * lut_size * 3;
+
+    g_free (transform->lut);
+    transform->lut = NULL;
+    transform->lut_size = 0;
+    lut = g_new (float, n);
+
+    /* the disc cache keeps the grid next to the device link */
+    cache_entry = g_hash_table_lookup (transform_cache, transform->cache_key);
+    if (cache_entry && cache_entry->transform == transform &&
+        cache_entry->lut_file &&
+        cms_lut_load (cache_entry->lut_file, lut, lut_size))
+    {   transform->lut = lut;
+        transform->lut_size = lut_size;
+        return TRUE;
+    }
+
+    /* one red slice at a time */
+    buffer = g_malloc (lut_size * lut_size * tag_bytes (transform->src_tag));
+    for (r = 0; r < lut_size; r++)
+    {   int i = 0;
+
+        for (g = 0; g < lut_size; g++)
+          for (b = 0; b < lut_size; b++, i += chan)
+          {   cms_lut_set (p, buffer, i + 0, (float) r / (lut_size - 1));
+              cms_lut_set (p, buffer, i + 1, (float) g / (lut_size - 1));
+              cms_lut_set (p, buffer, i + 2, (float) b / (lut_size - 1));
+              for (j = 3; j < chan; j++)
+                cms_lut_set (p, buffer, i + j, 1.f);
+          }
+
+        cms_transform_buffer (transform, buffer, buffer, lut_size * lut_size, p);
+
+        for (i = 0; i < lut_size * lut_size; i++)
+          for (j = 0; j < 3; j++)
+            lut[(r * lut_size * lut_size + i) * 3 + j] = cms_lut_get (p, buffer, i * chan + j);
+    }
+    g_free (buffer);
+
+    if (cache_entry && cache_entry->transform == transform)
+    {   if (!cache_entry->lut_file)
+            cache_entry->lut_file = file_temp_name ("lut");
+        cms_lut_save (cache_entry->lut_file, lut, lut_size);
+    }
+
+    transform->lut = lut;
+    transform->lut_size = lut_size;
+
+    return TRUE;
+}
+
+/* tetrahedral interpolation in the baked grid.  float pixels outside
+   the grid go through lcms, so that hdr values are not clipped */
+static void
+cms_transform_lut (CMSTransform *transform, void *src_data, void *dest_data,
+                   int num_pixels)
+{
+    Precision p = tag_precision (transform->src_tag);
+    int chan = tag_num_channels (transform->src_tag);
+    int bytes = tag_bytes (transform->src_tag);
+    int size = transform->lut_size;
+    int sr = size * size * 3, sg = size * 3, sb = 3;
+    float *lut = transform->lut;
+    int i, j, run = -1;
+
+    for (i = 0; i <= num_pixels; i++)
+    {
+      float c[3], d[3];
+      int   ci[3];
+      float *c0, *c1, *c2, *c3;
+      float d1, d2, d3;
+
+      if (i < num_pixels)
+        for (j = 0; j < 3; j++)
+          c[j] = cms_lut_get (p, src_data, i * chan + j);
+
+      if (i == num_pixels ||
+          (c[0] >= 0 && c[0] <= 1 && c[1] >= 0 && c[1] <= 1 &&
+           c[2] >= 0 && c[2] <= 1))
+      {
+        /* finish the pending run of out of range pixels */
+        if (run >= 0)
+        {   cms_transform_float (transform,
+                                 (guchar *)src_data + run * bytes,
+                                 (guchar *)dest_data + run * bytes,
+                                 i - run);
+            run = -1;
+        }
+        if (i == num_pixels)
+          break;
+      }
+      else
+      {   if (run < 0)
+            run = i;
+          continue;
+      }
+
+      for (j = 0; j < 3; j++)
+      {   float f = c[j] * (size - 1);
+          ci[j] = MIN ((int) f, size - 2);
+          d[j] = f - ci[j];
+      }
+
+      c0 = lut + ci[0] * sr + ci[1] * sg + ci[2] * sb;
+      c3 = c0 + sr + sg + sb;
+
+      /* walk from c0 to c3 along the largest fractions first */
+      if (d[0] >= d[1])
+      {
+        if (d[1] >= d[2])
+        { c1 = c0 + sr; c2 = c1 + sg; d1 = d[0]; d2 = d[1]; d3 = d[2]; }
+        else if (d[0] >= d[2])
+        { c1 = c0 + sr; c2 = c1 + sb; d1 = d[0]; d2 = d[2]; d3 = d[1]; }
+        else
+        { c1 = c0 + sb; c2 = c1 + sr; d1 = d[2]; d2 = d[0]; d3 = d[1]; }
+      }
+      else
+      {
+        if (d[2] >= d[1])
+        { c1 = c0 + sb; c2 = c1 + sg; d1 = d[2]; d2 = d[1]; d3 = d[0]; }
+        else if (d[2] >= d[0])
+        { c1 = c0 + sg; c2 = c1 + sb; d1 = d[1]; d2 = d[2]; d3 = d[0]; }
+        else
+        { c1 = c0 + sg; c2 = c1 + sr; d1 = d[1]; d2 = d[0]; d3 = d[2]; }
+      }
+
+      for (j = 0; j < 3; j++)
+        cms_lut_set (p, dest_data, i * chan + j,
+                     c0[j] + d1 * (c1[j] - c0[j]) + d2 * (c2[j] - c1[j]) +
+                     d3 * (c3[j] - c2[j]));
+
+      /* lcms leaves extra channels alone */
+      if (src_data != dest_data)
+        for (j = 3; j < chan; j++)
+          cms_lut_set (p, dest_data, i * chan + j, cms_lut_get (p, src_data, i * chan + j));
+    }
 }
 
 
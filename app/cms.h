@@ -211,6 +211,11 @@ void cms_transform_buffer( CMSTransform *transform,
                            void *src, void *dest,
                            int n_pixel,
                            Precision precision);
+/* bake the transform into a lut_size^3 grid used by the functions
+   above, lut_size < 2 goes back to lcms.  returns FALSE if the
+   transform can not be baked */
+gboolean cms_transform_bake_lut( CMSTransform *transform,
+                                 int lut_size);
 /* transforms a pixel area, src and dest have to be same precision */
 void cms_transform_area(   CMSTransform *transform,
                            PixelArea *src_area, PixelArea *dest_area);
@@ -720,6 +720,342 @@ find_mask_boundary (Canvas *      mask,
 }
 
 
+/**********************/
+/*  Cached boundaries  */
+
+/* the boundary of a mask is kept per canvas portion.  a portion owns
+   the horizontal edges on its own rows and the vertical edges on its
+   own columns, so its segments depend only on itself, the portion to
+   the left and the portion above.  those three serials decide whether
+   the cached segments are still good */
+
+typedef struct BoundTile BoundTile;
+
+struct BoundTile
+{
+  guint      serial[3];
+  int        valid;
+  BoundSeg * segs;
+  int        num_segs;
+};
+
+struct BoundaryCache
+{
+  /* the mask the tiles were made from */
+  Canvas *     mask;
+  int          width, height;
+  int          tile_w, tile_h;
+  int          cols, rows;
+  BoundTile *  tiles;
+
+  /* the parameters the tiles were made with */
+  BoundaryType type;
+  int          x1, y1, x2, y2;
+};
+
+static void boundary_cache_reset (BoundaryCache *);
+static void boundary_tile_segs   (BoundaryCache *, BoundTile *, int, int);
+static void make_tile_edges      (guint8 *, int, int, int, int, int, int);
+
+
+BoundaryCache *
+boundary_cache_new (void)
+{
+  BoundaryCache * cache;
+
+  cache = (BoundaryCache *) g_malloc_zero (sizeof (BoundaryCache));
+  
+  return cache;
+}
+
+
+void
+boundary_cache_free (BoundaryCache * cache)
+{
+  if (cache)
+    {
+      boundary_cache_reset (cache);
+      g_free (cache);
+    }
+}
+
+
+static void
+boundary_cache_reset (BoundaryCache * cache)
+{
+  int i;
+
+  if (cache->tiles)
+    {
+      for (i = 0; i < cache->cols * cache->rows; i++)
+        if (cache->tiles[i].segs)
+          g_free (cache->tiles[i].segs);
+      g_free (cache->tiles);
+    }
+
+  cache->tiles = NULL;
+  cache->mask = NULL;
+  cache->cols = 0;
+  cache->rows = 0;
+}
+
+
+/* like find_mask_boundary for the whole mask, but only portions that
+   were written since the last call are traced again.  bx1..by2 are
+   the bounds of the non-empty part of the mask; portions which cannot
+   see it are not read at all */
+BoundSeg *
+boundary_cache_find (BoundaryCache * cache,
+                     Canvas *        mask,
+                     int *           num_elems,
+                     BoundaryType    type,
+                     int             x1,
+                     int             y1,
+                     int             x2,
+                     int             y2,
+                     int             bx1,
+                     int             by1,
+                     int             bx2,
+                     int             by2)
+{
+  BoundSeg * new_segs = NULL;
+  int tx, ty;
+  int n;
+
+  /* start over if the mask or the parameters changed */
+  if (cache->mask != mask ||
+      cache->width != canvas_width (mask) ||
+      cache->height != canvas_height (mask) ||
+      cache->type != type ||
+      cache->x1 != x1 || cache->y1 != y1 ||
+      cache->x2 != x2 || cache->y2 != y2)
+    {
+      boundary_cache_reset (cache);
+
+      cache->mask = mask;
+      cache->width = canvas_width (mask);
+      cache->height = canvas_height (mask);
+      cache->tile_w = canvas_portion_width (mask, 0, 0);
+      cache->tile_h = canvas_portion_height (mask, 0, 0);
+      cache->cols = (cache->width + cache->tile_w - 1) / cache->tile_w;
+      cache->rows = (cache->height + cache->tile_h - 1) / cache->tile_h;
+      cache->tiles = g_new0 (BoundTile, cache->cols * cache->rows);
+      cache->type = type;
+      cache->x1 = x1;
+      cache->y1 = y1;
+      cache->x2 = x2;
+      cache->y2 = y2;
+    }
+
+  /* bring every portion up to date */
+  n = 0;
+  for (ty = 0; ty < cache->rows; ty++)
+    for (tx = 0; tx < cache->cols; tx++)
+      {
+        BoundTile * tile = &cache->tiles[ty * cache->cols + tx];
+        int x = tx * cache->tile_w;
+        int y = ty * cache->tile_h;
+        guint serial[3];
+
+        serial[0] = canvas_portion_serial (mask, x, y);
+        serial[1] = (tx > 0) ? canvas_portion_serial (mask, x - 1, y) : 0;
+        serial[2] = (ty > 0) ? canvas_portion_serial (mask, x, y - 1) : 0;
+
+        if (! tile->valid ||
+            tile->serial[0] != serial[0] ||
+            tile->serial[1] != serial[1] ||
+            tile->serial[2] != serial[2])
+          {
+            if (tile->segs)
+              g_free (tile->segs);
+            tile->segs = NULL;
+            tile->num_segs = 0;
+
+            /*  the portion and the edges it owns lie outside the
+             *  non-empty part of the mask
+             */
+            if (x - 1 < bx2 && x + cache->tile_w > bx1 &&
+                y - 1 < by2 && y + cache->tile_h > by1)
+              boundary_tile_segs (cache, tile, tx, ty);
+
+            memcpy (tile->serial, serial, sizeof (serial));
+            tile->valid = TRUE;
+          }
+
+        n += tile->num_segs;
+      }
+
+  /*  Merge the portions into one boundary  */
+  *num_elems = n;
+  if (n)
+    {
+      BoundSeg * s;
+      int i;
+
+      new_segs = (BoundSeg *) g_malloc (sizeof (BoundSeg) * n);
+      s = new_segs;
+      for (i = 0; i < cache->cols * cache->rows; i++)
+        if (cache->tiles[i].num_segs)
+          {
+            memcpy (s, cache->tiles[i].segs,
+                    sizeof (BoundSeg) * cache->tiles[i].num_segs);
+            s += cache->tiles[i].num_segs;
+          }
+    }
+
+  return new_segs;
+}
+
+
+/* trace the edges owned by one portion */
+static void
+boundary_tile_segs (BoundaryCache * cache,
+                    BoundTile *     tile,
+                    int             tx,
+                    int             ty)
+{
+  int x0, y0, w, h;
+  int sx, ex;
+  int x1, x2;
+  int stride;
+  int r, i;
+  int *empty;
+  int num_empty;
+  guint8 * inside;
+
+  x0 = tx * cache->tile_w;
+  y0 = ty * cache->tile_h;
+  w = MINIMUM (cache->tile_w, cache->width - x0);
+  h = MINIMUM (cache->tile_h, cache->height - y0);
+
+  /*  the portion plus one column to the left and one row above, with
+   *  a spare column and row of nothing on the far sides
+   */
+  stride = w + 2;
+  inside = g_new0 (guint8, stride * (h + 2));
+  empty = g_new (int, w + 5);
+
+  sx = MAXIMUM (x0 - 1, 0);
+  ex = x0 + w;
+
+  cur_mask = cache->mask;
+  cur_x = sx;
+  cur_y = 0;
+  cur_w = ex - sx;
+  cur_h = cache->height;
+
+  /*  limit the WithinBounds scan to our columns  */
+  x1 = cache->x1;
+  x2 = cache->x2;
+  if (cache->type == WithinBounds)
+    {
+      x1 = MAXIMUM (x1, sx);
+      x2 = MINIMUM (x2, ex);
+    }
+
+  if (cache->type != WithinBounds || x2 > x1)
+    for (r = 0; r < h + 1; r++)
+      {
+        guint8 * row = inside + r * stride - (x0 - 1);
+
+        find_empty_segs (y0 - 1 + r, empty, w + 5, &num_empty,
+                         cache->type, x1, cache->y1, x2, cache->y2);
+
+        for (i = 1; i < num_empty - 1; i += 2)
+          {
+            int s = MAXIMUM (empty[i], sx);
+            int e = MINIMUM (empty[i + 1], ex);
+            if (e > s)
+              memset (row + s, 1, e - s);
+          }
+      }
+
+  num_segs = 0;
+  make_tile_edges (inside, stride, x0, y0, w, h,
+                   ((x0 + w == cache->width) ? 1 : 0) |
+                   ((y0 + h == cache->height) ? 2 : 0));
+
+  tile->num_segs = num_segs;
+  if (num_segs)
+    {
+      tile->segs = (BoundSeg *) g_malloc (sizeof (BoundSeg) * num_segs);
+      memcpy (tile->segs, tmp_segs, sizeof (BoundSeg) * num_segs);
+    }
+
+  g_free (empty);
+  g_free (inside);
+}
+
+
+/* emit the edges between inside and outside pixels of a portion.  the
+   open flag is set when the inside lies below or to the right, as the
+   scanline tracer does.  last has bit 0 set when the portion touches
+   the right side of the mask and bit 1 for the bottom, in which case
+   the far edges belong to it as well */
+static void
+make_tile_edges (guint8 * inside,
+                 int      stride,
+                 int      x0,
+                 int      y0,
+                 int      w,
+                 int      h,
+                 int      last)
+{
+  int x, y;
+  int nx = w + ((last & 1) ? 1 : 0);
+  int ny = h + ((last & 2) ? 1 : 0);
+
+  /*  horizontal edges: row y against the row above  */
+  for (y = 0; y < ny; y++)
+    {
+      guint8 * above = inside + y * stride + 1;
+      guint8 * here = above + stride;
+      int start = -1;
+      int open = 0;
+
+      for (x = 0; x <= w; x++)
+        {
+          int edge = (x < w && above[x] != here[x]);
+
+          if (start >= 0 && (! edge || here[x] != open))
+            {
+              make_seg (x0 + start, y0 + y, x0 + x, y0 + y, open);
+              start = -1;
+            }
+          if (edge && start < 0)
+            {
+              start = x;
+              open = here[x];
+            }
+        }
+    }
+
+  /*  vertical edges: column x against the column to the left  */
+  for (x = 0; x < nx; x++)
+    {
+      int start = -1;
+      int open = 0;
+
+      for (y = 0; y <= h; y++)
+        {
+          guint8 * here = inside + (y + 1) * stride + 1 + x;
+          int edge = (y < h && here[-1] != here[0]);
+
+          if (start >= 0 && (! edge || here[0] != open))
+            {
+              make_seg (x0 + x, y0 + start, x0 + x, y0 + y, open);
+              start = -1;
+            }
+          if (edge && start < 0)
+            {
+              start = y;
+              open = here[0];
+            }
+        }
+    }
+}
+
+
 /************************/
 /*  Sorting a Boundary  */
 
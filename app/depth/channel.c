@@ -165,6 +165,8 @@ channel_new (int gimage_ID, int width, int height, Precision p, char *name,
   channel->segs_out = NULL;
   channel->num_segs_in = 0;
   channel->num_segs_out = 0;
+  channel->cache_in = NULL;
+  channel->cache_out = NULL;
   channel->bounds_known = TRUE;
   channel->boundary_known = TRUE;
   channel->x1 = channel->y1 = 0;
@@ -263,6 +265,10 @@ gimp_channel_destroy (GtkObject *object)
     g_free (channel->segs_in);
   if (channel->segs_out)
     g_free (channel->segs_out);
+  if (channel->cache_in)
+    boundary_cache_free (channel->cache_in);
+  if (channel->cache_out)
+    boundary_cache_free (channel->cache_out);
 
   if (GTK_OBJECT_CLASS (parent_class)->destroy)
     (*GTK_OBJECT_CLASS (parent_class)->destroy) (object);
@@ -510,46 +516,13 @@ channel_get_link_paint (Channel *channel)
 Canvas *
 channel_preview (Channel *channel, int w, int h)
 {
-  if (w < 1) w = 1;
-  if (h < 1) h = 1;
+  Precision p = tag_precision (drawable_tag (GIMP_DRAWABLE(channel)));
 
-  if (! (GIMP_DRAWABLE(channel)->preview_valid &&
-         canvas_width (GIMP_DRAWABLE(channel)->preview) == w &&
-         canvas_height (GIMP_DRAWABLE(channel)->preview) == h))
-    {
-      PixelArea srcPR, destPR;
-      Canvas * preview_buf;
-      Precision p;
-
-      p = tag_precision (drawable_tag (GIMP_DRAWABLE(channel)));
-      
-      preview_buf = canvas_new (tag_new (p, FORMAT_GRAY, ALPHA_NO),
-                                w, h,
-                                STORAGE_FLAT);
-
-      pixelarea_init (&srcPR, GIMP_DRAWABLE(channel)->tiles,
-                      0, 0,
-                      0, 0,
-                      FALSE);
-
-      pixelarea_init (&destPR, preview_buf,
-                      0, 0,
-                      0, 0,
-                      TRUE);
-
-      scale_area_no_resample (&srcPR, &destPR);
-
-      if (GIMP_DRAWABLE(channel)->preview)
-	canvas_delete (GIMP_DRAWABLE(channel)->preview);
-
-      GIMP_DRAWABLE(channel)->preview = preview_buf;
-      GIMP_DRAWABLE(channel)->preview_valid = TRUE;
-    }
-
-  return GIMP_DRAWABLE(channel)->preview;
+  return drawable_preview (GIMP_DRAWABLE(channel),
+                           tag_new (p, FORMAT_GRAY, ALPHA_NO),
+                           w, h);
 }
 
-
 void
 channel_invalidate_previews (int gimage_id)
 {
@@ -613,25 +586,26 @@ channel_boundary (Channel *mask, BoundSeg **segs_in, BoundSeg **segs_out,
       
       if (channel_bounds (mask, &x3, &y3, &x4, &y4))
         {
-	  mask->segs_out = find_mask_boundary (GIMP_DRAWABLE(mask)->tiles,
-                                               x3, y3,
-                                               (x4 - x3), (y4 - y3),
-                                               &mask->num_segs_out, IgnoreBounds,
-					       x1, y1,
-					       x2, y2);
-	  x1 = MAXIMUM (x1, x3);
-	  y1 = MAXIMUM (y1, y3);
-	  x2 = MINIMUM (x2, x4);
-	  y2 = MINIMUM (y2, y4);
-
-	  if (x2 > x1 && y2 > y1)
+          /* only the tiles touched since the last call are traced again */
+          if (! mask->cache_out)
+            mask->cache_out = boundary_cache_new ();
+          if (! mask->cache_in)
+            mask->cache_in = boundary_cache_new ();
+
+	  mask->segs_out = boundary_cache_find (mask->cache_out,
+                                                GIMP_DRAWABLE(mask)->tiles,
+                                                &mask->num_segs_out, IgnoreBounds,
+                                                x1, y1, x2, y2,
+                                                x3, y3, x4, y4);
+
+	  if (MINIMUM (x2, x4) > MAXIMUM (x1, x3) &&
+              MINIMUM (y2, y4) > MAXIMUM (y1, y3))
 	    {
-	      mask->segs_in =  find_mask_boundary (GIMP_DRAWABLE(mask)->tiles,
-                                                   0, 0,
-                                                   0, 0,
+	      mask->segs_in = boundary_cache_find (mask->cache_in,
+                                                   GIMP_DRAWABLE(mask)->tiles,
                                                    &mask->num_segs_in, WithinBounds,
-						   x1, y1,
-						   x2, y2);
+                                                   x1, y1, x2, y2,
+                                                   x3, y3, x4, y4);
 	    }
 	  else
 	    {
@@ -1791,8 +1765,10 @@ channel_push_undo (Channel *mask)
   undo_push_mask (gimage, mask_undo);
   gimage_mask_invalidate (gimage);
 
-  /*  invalidate the preview  */
-  GIMP_DRAWABLE(mask)->preview_valid = 0;
+  /*  invalidate the preview, the whole mask as the change that follows
+   *  may reach beyond the current bounds
+   */
+  drawable_invalidate_preview (GIMP_DRAWABLE(mask));
 }
 
 
@@ -62,9 +62,38 @@ typedef struct HistogramPrivate
   double       pixels;
   double       count;
   double       percentile;
+
+  int          hdr;      /* log2 spaced bins for float data */
   
 } HistogramPrivate;
 
+/*  partial histograms of whole canvas portions, reused while the
+ *  portion serial shows the pixels have not been written since
+ */
+#define HISTOGRAM_TILE_BUCKETS  1024
+#define HISTOGRAM_TILE_MAX      4096
+
+typedef struct HistogramTile HistogramTile;
+struct HistogramTile
+{
+  Canvas            *canvas;
+  int                x, y;
+  guint              serial;
+  HistogramInfoFunc  info_func;
+  int                bins;
+  int                color;
+  int                hdr;
+  float             *values;    /* HISTOGRAM_ALPHA + 1 rows of bins */
+  HistogramTile     *next;
+};
+
+static HistogramTile *histogram_tiles[HISTOGRAM_TILE_BUCKETS];
+static int            histogram_tile_count = 0;
+
+/*  range of the hdr bins in stops around 1.0  */
+#define HISTOGRAM_HDR_MIN_EV  -14.0
+#define HISTOGRAM_HDR_MAX_EV    6.0
+
 HistogramRangeCallback histogram_histogram_range;
 
 /**************************/
@@ -268,6 +297,150 @@ histogram_free (Histogram  *histogram)
   g_free (histogram);
 }
 
+static void
+histogram_tiles_clear (void)
+{
+  HistogramTile *t;
+  int i;
+
+  for (i = 0; i < HISTOGRAM_TILE_BUCKETS; i++)
+    while ((t = histogram_tiles[i]))
+      {
+        histogram_tiles[i] = t->next;
+        g_free (t->values);
+        g_free (t);
+      }
+  histogram_tile_count = 0;
+}
+
+/*  add the histogram of the portion under src_area to the values,
+ *  binning it only if it changed.  returns FALSE if src_area does not
+ *  cover a whole portion so the caller bins it directly
+ */
+static int
+histogram_tile_merge (Histogram         *histogram,
+                      Canvas            *canvas,
+                      PixelArea         *src_area,
+                      HistogramInfoFunc  info_func)
+{
+  HistogramPrivate *histogram_p = (HistogramPrivate *) histogram->private_part;
+  HistogramValues   tile_values;
+  HistogramTile    *t;
+  int x = pixelarea_x (src_area);
+  int y = pixelarea_y (src_area);
+  int bins = histogram_p->bins;
+  guint serial;
+  int b, i, j;
+
+  if (x != canvas_portion_x (canvas, x, y) ||
+      y != canvas_portion_y (canvas, x, y) ||
+      pixelarea_width (src_area) != canvas_portion_width (canvas, x, y) ||
+      pixelarea_height (src_area) != canvas_portion_height (canvas, x, y))
+    return FALSE;
+
+  b = ((gulong) canvas / sizeof (gpointer) + x * 7 + y * 131) % HISTOGRAM_TILE_BUCKETS;
+  serial = canvas_portion_serial (canvas, x, y);
+
+  for (t = histogram_tiles[b]; t; t = t->next)
+    if (t->canvas == canvas && t->x == x && t->y == y &&
+        t->info_func == info_func && t->bins == bins &&
+        t->color == histogram_p->color && t->hdr == histogram_p->hdr)
+      break;
+
+  if (!t || t->serial != serial)
+    {
+      if (!t)
+        {
+          if (histogram_tile_count >= HISTOGRAM_TILE_MAX)
+            histogram_tiles_clear ();
+
+          t = g_new (HistogramTile, 1);
+          t->canvas = canvas;
+          t->x = x;
+          t->y = y;
+          t->info_func = info_func;
+          t->bins = bins;
+          t->color = histogram_p->color;
+          t->hdr = histogram_p->hdr;
+          t->values = g_new (float, (HISTOGRAM_ALPHA + 1) * bins);
+          t->next = histogram_tiles[b];
+          histogram_tiles[b] = t;
+          histogram_tile_count++;
+        }
+
+      for (j = 0; j <= HISTOGRAM_ALPHA; j++)
+        tile_values[j] = g_new0 (double, bins);
+
+      (* info_func) (src_area, NULL, tile_values, histogram);
+
+      for (j = 0; j <= HISTOGRAM_ALPHA; j++)
+        {
+          for (i = 0; i < bins; i++)
+            t->values[j * bins + i] = tile_values[j][i];
+          g_free (tile_values[j]);
+        }
+      t->serial = serial;
+    }
+
+  for (j = 0; j <= HISTOGRAM_ALPHA; j++)
+    {
+      float  *src = t->values + j * bins;
+      double *dest = histogram_p->values[j];
+
+      for (i = 0; i < bins; i++)
+        dest[i] += src[i];
+    }
+
+  return TRUE;
+}
+
+void
+histogram_set_hdr (Histogram *histogram,
+                   int        hdr)
+{
+  HistogramPrivate *histogram_p;
+
+  histogram_p = (HistogramPrivate *) histogram->private_part;
+  histogram_p->hdr = hdr;
+}
+
+int
+histogram_hdr (Histogram *histogram)
+{
+  HistogramPrivate *histogram_p;
+
+  histogram_p = (HistogramPrivate *) histogram->private_part;
+  return histogram_p->hdr;
+}
+
+static int
+histogram_hdr_bin (gfloat value,
+                   int    bins)
+{
+  int bin;
+
+  /*  also catches NaN  */
+  if (!(value > 0.0))
+    return 0;
+
+  bin = (int) ((log (value) / log (2.0) - HISTOGRAM_HDR_MIN_EV) * bins /
+               (HISTOGRAM_HDR_MAX_EV - HISTOGRAM_HDR_MIN_EV));
+
+  return CLAMP (bin, 0, bins - 1);
+}
+
+static double
+histogram_bin_value (HistogramPrivate *histogram_p,
+                     int               bin,
+                     int               bins)
+{
+  if (histogram_p->hdr)
+    return pow (2.0, HISTOGRAM_HDR_MIN_EV + (bin + 0.5) *
+                (HISTOGRAM_HDR_MAX_EV - HISTOGRAM_HDR_MIN_EV) / bins);
+
+  return bin / (double) bins;
+}
+
 void
 histogram_update (Histogram         *histogram,
 		  CanvasDrawable      *drawable,
@@ -310,6 +483,8 @@ histogram_update (Histogram         *histogram,
   if (no_mask)
   {
     for (pr = pixelarea_register (1, &src_area); pr != NULL; pr = pixelarea_process (pr))
+      if (! histogram_tile_merge (histogram, drawable_data (drawable),
+                                  &src_area, info_func))
         (* info_func) (&src_area, NULL, histogram_p->values, histogram);
   }
   else
@@ -709,6 +884,20 @@ histogram_histogram_info_float (PixelArea *src_area,
 	       blue  = s[BLUE_PIX];
                if(has_alpha)
                    alpha  = s[ALPHA_PIX];
+	       if (histogram_p->hdr)
+		 {
+		   value = MAX (red, green);
+		   value = MAX (value, blue);
+
+		   value_bin = histogram_hdr_bin (value, bins);
+		   red_bin = histogram_hdr_bin (red, bins);
+		   green_bin = histogram_hdr_bin (green, bins);
+		   blue_bin = histogram_hdr_bin (blue, bins);
+		   if(has_alpha)
+		     alpha_bin = (int)(CLAMP (alpha, 0.0, 1.0) * (bins-1));
+		 }
+	       else
+		 {
 #if 1
 	       red = CLAMP (red, 0.0, 1.0);
 	       green = CLAMP (green, 0.0, 1.0);
@@ -725,6 +914,7 @@ histogram_histogram_info_float (PixelArea *src_area,
 	       blue_bin = (int)(blue * (bins-1));
                if(has_alpha)
                    alpha_bin = (int)(alpha * (bins-1));
+		 }
 
 	       if (mask_area)
 		 {
@@ -748,7 +938,10 @@ histogram_histogram_info_float (PixelArea *src_area,
 	   else
 	     {
 	       value = s[GRAY_PIX];
-	       value_bin = (int)(value * (bins-1));
+	       if (histogram_p->hdr)
+		 value_bin = histogram_hdr_bin (value, bins);
+	       else
+		 value_bin = (int)(value * (bins-1));
 	       if (mask_area)
 		 values[HISTOGRAM_VALUE][value_bin] += (double) *m;
 	       else
@@ -815,6 +1008,20 @@ histogram_histogram_info_float16 (PixelArea *src_area,
 	       blue  = FLT (s[BLUE_PIX], u);
                if(has_alpha)
 	           alpha  = FLT (s[ALPHA_PIX], u);
+	       if (histogram_p->hdr)
+		 {
+		   value = MAX (red, green);
+		   value = MAX (value, blue);
+
+		   value_bin = histogram_hdr_bin (value, bins);
+		   red_bin = histogram_hdr_bin (red, bins);
+		   green_bin = histogram_hdr_bin (green, bins);
+		   blue_bin = histogram_hdr_bin (blue, bins);
+		   if(has_alpha)
+		     alpha_bin = (int)(CLAMP (alpha, 0.0, 1.0) * (bins-1));
+		 }
+	       else
+		 {
 #if 1
 	       red = CLAMP (red, -0.01, 1.01);
 	       green = CLAMP (green, -0.01, 1.01);
@@ -831,6 +1038,7 @@ histogram_histogram_info_float16 (PixelArea *src_area,
 	       blue_bin = (int)((blue) * 100 + 1);
                if(has_alpha)
                    alpha_bin = (int)((alpha) * 100 + 1);
+		 }
 
 	       if (mask_area)
 		 {
@@ -855,8 +1063,13 @@ histogram_histogram_info_float16 (PixelArea *src_area,
 	     }
 	   else
 	     {
+	       if (histogram_p->hdr)
+		 value_bin = histogram_hdr_bin (FLT (s[GRAY_PIX], u), bins);
+	       else
+		 {
 	       value = s[GRAY_PIX];
 	       value_bin = (int)(value * (bins-1));
+		 }
 	       if (mask_area)
 		 values[HISTOGRAM_VALUE][value_bin] += (double) FLT(*m, u);
 	       else
@@ -989,7 +1202,6 @@ histogram_histogram_range_float16 (int          start,
   double 		 percentile;
   double 		 tmp;
   int 			 i;
-  double 		 bin_width = 1.0/(double)bins;
   HistogramPrivate *histogram_p;
 
   htd = (Histogram *) user_data;
@@ -1010,10 +1222,10 @@ histogram_histogram_range_float16 (int          start,
   median = -1;
   for (i = start; i <= end; i++)
     {
-      mean += (i*bin_width) * values[histogram_p->channel][i];
+      mean += histogram_bin_value (histogram_p, i, bins) * values[histogram_p->channel][i];
       tmp += values[histogram_p->channel][i];
       if (median == -1 && tmp > count / 2)
-	median = (i*bin_width);
+	median = histogram_bin_value (histogram_p, i, bins);
     }
 
   if (count)
@@ -1021,7 +1233,7 @@ histogram_histogram_range_float16 (int          start,
 
   std_dev = 0.0;
   for (i = start; i <= end; i++)
-    std_dev += values[histogram_p->channel][i] * (i*bin_width - mean) * (i*bin_width - mean);
+    std_dev += values[histogram_p->channel][i] * (histogram_bin_value (histogram_p, i, bins) - mean) * (histogram_bin_value (histogram_p, i, bins) - mean);
 
   if (count)
     std_dev = sqrt (std_dev / count);
@@ -1055,7 +1267,6 @@ histogram_histogram_range_float (int        start,
   double 		 percentile;
   double 		 tmp;
   int 			 i;
-  double 		 bin_width = 1.0/(double)(bins);
   HistogramPrivate *histogram_p;
 
   htd = (Histogram *) user_data;
@@ -1076,10 +1287,10 @@ histogram_histogram_range_float (int        start,
   median = -1;
   for (i = start; i <= end; i++)
     {
-      mean += (i*bin_width) * values[histogram_p->channel][i];
+      mean += histogram_bin_value (histogram_p, i, bins) * values[histogram_p->channel][i];
       tmp += values[histogram_p->channel][i];
       if (median == -1 && tmp > count / 2)
-	median = (i*bin_width);
+	median = histogram_bin_value (histogram_p, i, bins);
     }
 
   if (count)
@@ -1087,7 +1298,7 @@ histogram_histogram_range_float (int        start,
 
   std_dev = 0.0;
   for (i = start; i <= end; i++)
-    std_dev += values[histogram_p->channel][i] * (i*bin_width - mean) * (i*bin_width - mean);
+    std_dev += values[histogram_p->channel][i] * (histogram_bin_value (histogram_p, i, bins) - mean) * (histogram_bin_value (histogram_p, i, bins) - mean);
 
   if (count)
     std_dev = sqrt (std_dev / count);
@@ -1335,7 +1546,12 @@ histogram_dialog_update_float (Histogram *htd,
   gtk_label_set (GTK_LABEL (htd->info_labels[3]), text);
 
   /*  intensity  */
-  sprintf (text, "%f..%f", (start-1)/100.0, (end-1)/100.0);
+  if (histogram_p->hdr)
+    sprintf (text, "%.4g..%.4g",
+             histogram_bin_value (histogram_p, start, histogram_p->bins),
+             histogram_bin_value (histogram_p, end, histogram_p->bins));
+  else
+    sprintf (text, "%f..%f", (start-1)/100.0, (end-1)/100.0);
   gtk_label_set (GTK_LABEL (htd->info_labels[4]), text);
 
   /*  count  */
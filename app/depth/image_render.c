@@ -20,6 +20,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include "config.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
 #include "../appenv.h"
 #include "../canvas.h"
 #include "../channel.h"
@@ -55,6 +60,20 @@ TraceTimer trace_timer;
 typedef struct RenderInfo  RenderInfo;
 typedef void (*RenderFunc) (RenderInfo *info);
 
+/* rows rendered in one go by render_image_bands */
+#define RENDER_BAND_HEIGHT 64
+#define RENDER_MAX_THREADS 32
+
+#ifdef HAVE_PTHREAD
+/* worker threads share the projection portions */
+static pthread_mutex_t render_lock = PTHREAD_MUTEX_INITIALIZER;
+#define RENDER_LOCK()   pthread_mutex_lock (&render_lock)
+#define RENDER_UNLOCK() pthread_mutex_unlock (&render_lock)
+#else
+#define RENDER_LOCK()
+#define RENDER_UNLOCK()
+#endif
+
 struct RenderInfo
 {
   GDisplay *gdisp;
@@ -81,6 +100,7 @@ struct RenderInfo
   Channel *single_visible_channel;
   int aux_channels_visible;  
   CMSTransform *transform_buffer;
+  guchar *tile_buf;
 };
 
 CMSTransform* render_image_get_cms_transform( GDisplay   * gdisp ,
@@ -260,6 +280,13 @@ static guchar* render_image_accelerate_scaling (int           width,
 						int           scalesrc,
 						int           scaledest);
 static guchar* render_image_tile_fault         (RenderInfo   *info);
+static int     render_image_prepare            (RenderInfo   *info,
+						GDisplay     *gdisp,
+						int           x,
+						int           y,
+						int           w,
+						int           h);
+static void    render_image_run                (RenderInfo   *info);
 
 
 static RenderFunc render_funcs[6] =
@@ -319,11 +346,32 @@ render_image (GDisplay *gdisp,
 	      int       h)
 {
   RenderInfo info;
+
+  if (!render_image_prepare (&info, gdisp, x, y, w, h))
+    return;
+
+  info.tile_buf = tile_buf;
+  render_image_run (&info);
+
+  if(info.transform_buffer)
+    cms_return_transform(info.transform_buffer);
+}
+
+
+/* fill in the info, FALSE if the projection can not be displayed */
+static int
+render_image_prepare (RenderInfo *info,
+		      GDisplay   *gdisp,
+		      int         x,
+		      int         y,
+		      int         w,
+		      int         h)
+{
   Tag t;
   
-  render_image_init_info (&info, gdisp, x, y, w, h);
+  render_image_init_info (info, gdisp, x, y, w, h);
 
-  t = canvas_tag (info.src_canvas);
+  t = canvas_tag (info->src_canvas);
 
   switch (tag_format (t))
     {
@@ -335,51 +383,237 @@ render_image (GDisplay *gdisp,
       if (tag_precision (t) != PRECISION_U8)
         {
           g_warning ("indexed images only supported in 8 bit mode");
-          return;
+          goto fail;
         }
         break;
 
     case FORMAT_NONE:
     default:
       g_warning ("unsupported gimage projection type");
-      return;
+      goto fail;
     }
 
-  if ((info.dest_bpp < 1) || (info.dest_bpp > 4))
+  if ((info->dest_bpp < 1) || (info->dest_bpp > 4))
     {
-      g_message ("unsupported destination bytes per pixel: %d", info.dest_bpp);
-      return;
+      g_message ("unsupported destination bytes per pixel: %d", info->dest_bpp);
+      goto fail;
     }
+
+  return TRUE;
+
+ fail:
+  if(info->transform_buffer)
+    cms_return_transform(info->transform_buffer);
+  return FALSE;
+}
+
+
+/* render the rows of a prepared info, touches nothing but the info,
+   its tile_buf and dest rows and the projection portions it faults in */
+static void
+render_image_run (RenderInfo *info)
+{
+  Tag t = canvas_tag (info->src_canvas);
+  int image_type = tag_to_drawable_type (tag_set_precision (t, PRECISION_U8));
   
-  {
-    int image_type = tag_to_drawable_type (tag_set_precision (t, PRECISION_U8));
-  
-    switch (tag_precision (t))
-      {
-      case PRECISION_U8:
-        (* render_funcs[image_type]) (&info);
-        break;
-      case PRECISION_U16:
-        (* render_funcs_u16[image_type]) (&info);
-  	break;
-      case PRECISION_FLOAT:
-        (* render_funcs_float[image_type]) (&info);
-  	break;
-      case PRECISION_FLOAT16:
-        (* render_funcs_float16[image_type]) (&info);
-  	break;
-      case PRECISION_BFP:
-         (* render_funcs_bfp[image_type]) (&info);
-  	break;	
-      case PRECISION_NONE:
-        break;
-      }
-  }
+  switch (tag_precision (t))
+    {
+    case PRECISION_U8:
+      (* render_funcs[image_type]) (info);
+      break;
+    case PRECISION_U16:
+      (* render_funcs_u16[image_type]) (info);
+      break;
+    case PRECISION_FLOAT:
+      (* render_funcs_float[image_type]) (info);
+      break;
+    case PRECISION_FLOAT16:
+      (* render_funcs_float16[image_type]) (info);
+      break;
+    case PRECISION_BFP:
+      (* render_funcs_bfp[image_type]) (info);
+      break;	
+    case PRECISION_NONE:
+      break;
+    }
+}
 
-  if(info.transform_buffer)
-    cms_return_transform(info.transform_buffer);
+
+/*
+ * render an area as horizontal bands of RENDER_BAND_HEIGHT rows into
+ * consecutive rows of the gximage.  the bands are shared out to
+ * render_threads worker threads, and done() is called in the main
+ * thread for each finished band in top to bottom order, so it can be
+ * put on screen while the rest is still being rendered
+ */
+#ifdef HAVE_PTHREAD
+typedef struct RenderBand RenderBand;
+typedef struct RenderJob  RenderJob;
+
+struct RenderBand
+{
+  RenderInfo info;
+  int        y, h;
+  int        row;
+  int        done;
+};
+
+struct RenderJob
+{
+  RenderBand *    bands;
+  int             num_bands;
+  int             next;
+  pthread_mutex_t lock;
+  pthread_cond_t  cond;
+};
+
+/* render the next unclaimed band, FALSE if there is none left */
+static int
+render_job_step (RenderJob *job,
+		 guchar    *buf)
+{
+  RenderBand *band;
+
+  pthread_mutex_lock (&job->lock);
+  if (job->next >= job->num_bands)
+    {
+      pthread_mutex_unlock (&job->lock);
+      return FALSE;
+    }
+  band = &job->bands[job->next++];
+  pthread_mutex_unlock (&job->lock);
+
+  band->info.tile_buf = buf;
+  render_image_run (&band->info);
+
+  pthread_mutex_lock (&job->lock);
+  band->done = TRUE;
+  pthread_cond_broadcast (&job->cond);
+  pthread_mutex_unlock (&job->lock);
+
+  return TRUE;
+}
+
+static void *
+render_job_worker (void *data)
+{
+  RenderJob *job = (RenderJob *) data;
+  guchar *buf = g_new (guchar, GXIMAGE_WIDTH * MAX_CHANNELS * 4);
+
+  while (render_job_step (job, buf))
+    ;
+
+  g_free (buf);
+  return NULL;
 }
 
+static int
+render_num_threads (void)
+{
+  int n = render_threads;
+
+  if (n <= 0)
+    n = sysconf (_SC_NPROCESSORS_ONLN);
+
+  return CLAMP (n, 1, RENDER_MAX_THREADS);
+}
+#endif
+
+void
+render_image_bands (GDisplay      *gdisp,
+		    int            x,
+		    int            y,
+		    int            w,
+		    int            h,
+		    RenderBandFunc done,
+		    gpointer       data)
+{
+#ifdef HAVE_PTHREAD
+  RenderJob job;
+  pthread_t threads[RENDER_MAX_THREADS];
+  int num_threads = render_num_threads ();
+  int num_started = 0;
+  int shown = 0;
+  int i;
+
+  if (num_threads < 2 || h <= RENDER_BAND_HEIGHT)
+#endif
+    {
+      render_image (gdisp, x, y, w, h);
+      (* done) (gdisp, x, y, w, h, 0, data);
+      return;
+    }
+
+#ifdef HAVE_PTHREAD
+  job.num_bands = (h + RENDER_BAND_HEIGHT - 1) / RENDER_BAND_HEIGHT;
+  job.bands = g_new (RenderBand, job.num_bands);
+  job.next = 0;
+
+  /* everything that touches the caches is set up here, the bands
+     differ only in their rows */
+  if (!render_image_prepare (&job.bands[0].info, gdisp, x, y, w, h))
+    {
+      g_free (job.bands);
+      return;
+    }
+
+  for (i = 0; i < job.num_bands; i++)
+    {
+      RenderBand *band = &job.bands[i];
+      RenderInfo *info = &band->info;
+
+      band->row = i * RENDER_BAND_HEIGHT;
+      band->y = y + band->row;
+      band->h = MIN (RENDER_BAND_HEIGHT, h - band->row);
+      band->done = FALSE;
+
+      if (i > 0)
+        *info = job.bands[0].info;
+      info->y = band->y + gdisp->offset_y;
+      info->h = band->h;
+      info->src_y = UNSCALE (gdisp, info->y);
+      info->dest = job.bands[0].info.dest + band->row * info->dest_bpl;
+    }
+
+  pthread_mutex_init (&job.lock, NULL);
+  pthread_cond_init (&job.cond, NULL);
+
+  for (i = 0; i < num_threads - 1; i++)
+    if (pthread_create (&threads[num_started], NULL,
+			render_job_worker, &job) == 0)
+      num_started++;
+
+  /* the main thread renders as well, and shows what is ready */
+  while (shown < job.num_bands)
+    {
+      int ready;
+
+      pthread_mutex_lock (&job.lock);
+      while (!job.bands[shown].done && job.next >= job.num_bands)
+	pthread_cond_wait (&job.cond, &job.lock);
+      ready = job.bands[shown].done;
+      pthread_mutex_unlock (&job.lock);
+
+      if (ready)
+	{
+	  RenderBand *band = &job.bands[shown++];
+	  (* done) (gdisp, x, band->y, w, band->h, band->row, data);
+	}
+      else
+	render_job_step (&job, tile_buf);
+    }
+
+  for (i = 0; i < num_started; i++)
+    pthread_join (threads[i], NULL);
+
+  pthread_cond_destroy (&job.cond);
+  pthread_mutex_destroy (&job.lock);
+
+  if (job.bands[0].info.transform_buffer)
+    cms_return_transform (job.bands[0].info.transform_buffer);
+  g_free (job.bands);
+#endif
+}
 
 
 /*************************/
@@ -1008,6 +1242,9 @@ render_image_get_cms_transform( GDisplay * gdisp, RenderInfo * info)
       g_slist_free(profiles);
   }
 
+  if(transform_buffer)
+    cms_transform_bake_lut (transform_buffer, cms_display_lut_size);
+
   if(!transform_buffer)
   {
     GDisplay *disp = gdisplay_get_from_gimage(image);
@@ -1344,9 +1581,9 @@ render_image_tile_fault_expose (RenderInfo *info,
   float    sb, db;
   ShortsFloat u;
 
-  f = (float*)tile_buf;
-  u16 = (guint16*)tile_buf;
-  u8 = (guint8*)tile_buf;
+  f = (float*)info->tile_buf;
+  u16 = (guint16*)info->tile_buf;
+  u8 = (guint8*)info->tile_buf;
   if(info->gdisp->expose != EXPOSE_DEFAULT ||
      info->gdisp->offset != OFFSET_DEFAULT ||
      info->gdisp->gamma  != GAMMA_DEFAULT)
@@ -1472,10 +1709,10 @@ render_image_tile_fault_expose (RenderInfo *info,
   }
 
   if(info->transform_buffer)
-    cms_transform_buffer( info->transform_buffer, tile_buf, tile_buf, info->w,
+    cms_transform_buffer( info->transform_buffer, info->tile_buf, info->tile_buf, info->w,
                           tag_precision(gimage_tag(info->gdisp->gimage)) );
 
-  return tile_buf;
+  return info->tile_buf;
 }
 
 static guchar*
@@ -1491,16 +1728,11 @@ render_image_tile_fault (RenderInfo *info)
   int step;
   int x;
   int src_bpp;
-  int bps = info->src_bpp/info->src_num_channels;
   int dest_sample_width = info->w*info->src_num_channels;
   Tag tag = canvas_tag (info->src_canvas);
   int has_alpha = tag_alpha (tag) == ALPHA_YES ? 1:0;
   int i;
   float   *f;
-  guint16 *u16;
-  guint8  *u8;
-  float    sb, db;
-  ShortsFloat u;
 
   float offset = pow(2.0,info->gdisp->offset )-1;
   float gamma = 1.0/info->gdisp->gamma;
@@ -1511,21 +1743,25 @@ render_image_tile_fault (RenderInfo *info)
   y_portion = info->src_y;
   
   /* fault in the first portion */ 
+  RENDER_LOCK ();
   canvas_portion_refro (info->src_canvas, x_portion, y_portion); 
   data = canvas_portion_data (info->src_canvas, info->src_x, info->src_y);
   if (!data)
     {
       canvas_portion_unref( info->src_canvas, x_portion, y_portion); 
+      RENDER_UNLOCK ();
       return NULL;
     }
-  scale = info->scale;
-  step = info->scalesrc * info->src_bpp;
-  dest = tile_buf;
-  
   /* the first portions width */ 
   portion_width = canvas_portion_width ( info->src_canvas, 
                                          x_portion,
                                          y_portion );
+  RENDER_UNLOCK ();
+
+  scale = info->scale;
+  step = info->scalesrc * info->src_bpp;
+  dest = info->tile_buf;
+  
   x = info->src_x;
   width = info->w;
   src_bpp = info->src_bpp;
@@ -1538,10 +1774,14 @@ render_image_tile_fault (RenderInfo *info)
            info->gdisp->gamma != GAMMA_DEFAULT) &&
        	   info->scalesrc == 1 && info->scaledest == 1)
       {
-        memcpy(dest,data, src_bpp * portion_width);
-        dest += src_bpp * portion_width;
-        data += step * portion_width;
-        x += portion_width;
+        /* no more than the row needs */
+        int n = MIN (portion_width, width + 1);
+
+        memcpy(dest,data, src_bpp * n);
+        dest += src_bpp * n;
+        data += step * n;
+        x += n;
+        width -= n - 1;
         /*scale += portion_width;*/
       } else
         for (i = 0; i < info->src_bpp; i++)
@@ -1561,16 +1801,18 @@ render_image_tile_fault (RenderInfo *info)
 
 	  if (x >= x_portion + portion_width)
 	    {
+              RENDER_LOCK ();
 	      canvas_portion_unref (info->src_canvas, x_portion, y_portion);
               if (x >= CAST(int) info->src_width)
               {
-                f = (float*)tile_buf;
+                RENDER_UNLOCK ();
+                f = (float*)info->tile_buf;
                 render_image_tile_fault_expose (info,
-                                tile_buf, f, dest_sample_width,
+                                info->tile_buf, f, dest_sample_width,
                                 offset, expose, gamma,
                                 has_alpha, tag_precision(tag));
                    
-                return tile_buf;
+                return info->tile_buf;
               }
 	      x_portion += portion_width;
               canvas_portion_refro (info->src_canvas, x_portion, y_portion ); 
@@ -1578,23 +1820,27 @@ render_image_tile_fault (RenderInfo *info)
               if(!data)
                 {
                   canvas_portion_unref (info->src_canvas, x_portion, y_portion ); 
+                  RENDER_UNLOCK ();
                   return NULL;
                 }
 	      portion_width = canvas_portion_width ( info->src_canvas, 
                                               x_portion,
                                               y_portion );
+              RENDER_UNLOCK ();
             }
         }
     }
 
-  f = (float*)tile_buf;
+  f = (float*)info->tile_buf;
   render_image_tile_fault_expose (info,
-                                tile_buf, f, dest_sample_width,
+                                info->tile_buf, f, dest_sample_width,
                                 offset, expose, gamma,
                                 has_alpha, tag_precision(tag));
 
+  RENDER_LOCK ();
   canvas_portion_unref (info->src_canvas, x_portion, y_portion);
-  return tile_buf;
+  RENDER_UNLOCK ();
+  return info->tile_buf;
 }
 #endif
 
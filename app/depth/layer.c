@@ -1231,97 +1231,29 @@ layer_preview (layer, w, h)
      Layer *layer;
      int w, h;
 {
-  if (w < 1) w = 1;
-  if (h < 1) h = 1;
-
-  if (! (GIMP_DRAWABLE(layer)->preview_valid &&
-         canvas_width (GIMP_DRAWABLE(layer)->preview) == w &&
-         canvas_height (GIMP_DRAWABLE(layer)->preview) == h))
-    {
-      PixelArea srcPR, destPR;
-      Canvas * preview_buf;
-      Tag tag = drawable_tag (GIMP_DRAWABLE(layer));
-      Precision p = tag_precision (tag);
-      Format f = tag_format (tag);
-      Alpha a = tag_alpha (tag);
-      
-      preview_buf = canvas_new (tag_new (p, f, a),
-                                w, h,
-                                STORAGE_FLAT);
-
-      pixelarea_init (&srcPR, GIMP_DRAWABLE(layer)->tiles,
-                      0, 0,
-                      0, 0,
-                      FALSE);
-
-      pixelarea_init (&destPR, preview_buf,
-                      0, 0,
-                      0, 0,
-                      TRUE);
-
-      scale_area_no_resample (&srcPR, &destPR);
-
-      if (GIMP_DRAWABLE(layer)->preview)
-	canvas_delete (GIMP_DRAWABLE(layer)->preview);
-
-      GIMP_DRAWABLE(layer)->preview = preview_buf;
-      GIMP_DRAWABLE(layer)->preview_valid = TRUE;
-    }
-
-  return GIMP_DRAWABLE(layer)->preview;
+  return drawable_preview (GIMP_DRAWABLE(layer),
+                           drawable_tag (GIMP_DRAWABLE(layer)),
+                           w, h);
 }
 
-
 Canvas *
 layer_mask_preview (layer, w, h)
      Layer *layer;
      int w, h;
 {
   LayerMask * mask = layer->mask;
+  Precision p;
 
   if (!mask)
     return NULL;
 
-  if (w < 1) w = 1; 
-  if (h < 1) h = 1;
+  p = tag_precision (drawable_tag (GIMP_DRAWABLE(mask)));
 
-  if (! (GIMP_DRAWABLE(mask)->preview_valid &&
-         canvas_width (GIMP_DRAWABLE(mask)->preview) == w &&
-         canvas_height (GIMP_DRAWABLE(mask)->preview) == h))
-    {
-      PixelArea srcPR, destPR;
-      Canvas * preview_buf;
-      Precision p;
-
-      p = tag_precision (drawable_tag (GIMP_DRAWABLE(mask)));
-
-      preview_buf = canvas_new (tag_new (p, FORMAT_GRAY, ALPHA_NO),
-                                w, h,
-                                STORAGE_FLAT);
-      
-     pixelarea_init (&srcPR, GIMP_DRAWABLE(mask)->tiles,
-                      0, 0,
-                      0, 0,
-                      FALSE);
-
-      pixelarea_init (&destPR, preview_buf,
-                      0, 0,
-                      0, 0,
-                      TRUE);
-
-      scale_area_no_resample (&srcPR, &destPR);
-
-      if (GIMP_DRAWABLE(mask)->preview)
-	canvas_delete (GIMP_DRAWABLE(mask)->preview);
-
-      GIMP_DRAWABLE(mask)->preview = preview_buf;
-      GIMP_DRAWABLE(mask)->preview_valid = TRUE;
-    }
-
-  return GIMP_DRAWABLE(mask)->preview;
+  return drawable_preview (GIMP_DRAWABLE(mask),
+                           tag_new (p, FORMAT_GRAY, ALPHA_NO),
+                           w, h);
 }
 
-
 void
 layer_invalidate_previews (gimage_id)
      int gimage_id;
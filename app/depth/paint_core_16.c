@@ -70,8 +70,14 @@ static void      paint_core_16_cursor_update   (Tool *, GdkEventMotion *, gpoint
 static void      paint_core_16_control         (Tool *, int, gpointer);
 static void      paint_core_16_no_draw         (Tool *);
 
+static void      stroke_queue_push             (Tool *, GdkEventMotion *);
+static void      stroke_queue_drain            (Tool *, int);
+static void      stroke_queue_stop             (void);
+
 
 static void      painthit_init                 (PaintCore16 *, CanvasDrawable *, Canvas *);
+static void      paint_core_16_area_buffers    (PaintCore16 *, CanvasDrawable *);
+static void      paint_core_16_batch_begin     (PaintCore16 *, gfloat, int);
 
 static void
 brush_to_canvas_tiles(
@@ -99,10 +105,11 @@ brush_to_canvas_buf(
 
 static void      painthit_finish               (CanvasDrawable *, PaintCore16 *,
                                                 Canvas *);
+static void      painthit_free_masks           (PaintCore16 *);
 
 static Canvas *  brush_mask_get                (PaintCore16 *, Canvas *, int, gdouble);
 static Canvas *  brush_mask_subsample          (Canvas *, double, double, double);
-static Canvas *  brush_mask_solidify           (PaintCore16 *, Canvas *);
+static Canvas *  brush_mask_solidify           (Canvas *);
 static Canvas *  brush_mask_noise  	       (PaintCore16 *, Canvas *);
 
 static void brush_solidify_mask_u8 ( Canvas *, Canvas *);
@@ -124,7 +131,7 @@ static Canvas * paint_core_scale_mask           (Canvas  *brush_mask,
                                                  gdouble  pos_x,
                                                  gdouble  pos_y,      
 						 gdouble  scale);
-static Canvas  *scale_brush     = NULL;
+static void     brush_cache_prebuild_stop       (void);
 
 /* ------------------------------------------------------------------------
 
@@ -407,6 +414,8 @@ paint_core_16_finish  (
   GImage *gimage;
   PaintUndo *pu;
 
+  brush_cache_prebuild_stop ();
+  paint_core_16_batch_flush (paint_core);
 
   if (! (gimage = drawable_gimage (drawable)))
 {
@@ -467,9 +476,15 @@ paint_core_16_finish  (
   /*  invalidate the drawable--have to do it here, because
    *  it is not done during the actual painting.
    */
-  drawable_invalidate_preview (drawable);
+  drawable_invalidate_preview_area (drawable,
+                                    paint_core->x1, paint_core->y1,
+                                    paint_core->x2 - paint_core->x1,
+                                    paint_core->y2 - paint_core->y1);
   if (paint_core->linked_drawable)
-    drawable_invalidate_preview (paint_core->linked_drawable);
+    drawable_invalidate_preview_area (paint_core->linked_drawable,
+                                      paint_core->x1, paint_core->y1,
+                                      paint_core->x2 - paint_core->x1,
+                                      paint_core->y2 - paint_core->y1);
 
 
 }
@@ -480,6 +495,9 @@ paint_core_16_cleanup  (
                         PaintCore16 * paint_core 
                         )
 {
+  brush_cache_prebuild_stop ();
+  paint_core->batch_pending = FALSE;
+
   if (paint_core->undo_tiles)
     {
       canvas_delete (paint_core->undo_tiles);
@@ -535,6 +553,8 @@ paint_core_16_button_press  (Tool * tool,
   gdisp = (GDisplay *) gdisp_ptr;
   paint_core = (PaintCore16 *) tool->private;
 
+  stroke_queue_stop ();
+
   gdisplay_untransform_coords_f (gdisp,
                                  (double) bevent->x, (double) bevent->y,
                                  &x, &y,
@@ -637,6 +657,7 @@ paint_core_16_button_press  (Tool * tool,
   else
     (* paint_core->paint_func) (paint_core, drawable, MOTION_PAINT);
 
+  paint_core_16_batch_flush (paint_core);
   gdisplay_flush (gdisp);
 }
 
@@ -657,6 +678,11 @@ paint_core_16_button_release  (
   gimage = gdisp->gimage;
   paint_core = (PaintCore16 *) tool->private;
 
+  /*  paint the samples still waiting in the queue  */
+  if (stroke_tool == tool)
+    stroke_queue_drain (tool, 0);
+  stroke_queue_stop ();
+
   /*  resume the current selection and ungrab the pointer  */
   gdisplays_selection_visibility (gdisp->gimage->ID, SelectionResume);
 
@@ -674,69 +700,181 @@ paint_core_16_button_release  (
 }
 
 
-static void 
-paint_core_16_motion  (
-                       Tool * tool,
-                       GdkEventMotion * mevent,
-                       gpointer gdisp_ptr
-                       )
+/* pen samples are recorded by the motion handler and painted from an
+   idle handler, so input is not held up while a dab is being rendered.
+   the display is flushed at a fixed rate instead of once per event */
+#define STROKE_QUEUE_SIZE      256
+#define STROKE_FLUSH_INTERVAL  16
+#define STROKE_DRAIN_STEP      4
+
+typedef struct StrokeSample StrokeSample;
+struct StrokeSample
 {
-  GDisplay * gdisp;
-  PaintCore16 * paint_core;
+  double  x, y;
+  double  pressure;
+  double  xtilt, ytilt;
+  int     state;
+};
 
-  gdisp = (GDisplay *) gdisp_ptr;
-  paint_core = (PaintCore16 *) tool->private;
+static StrokeSample stroke_queue[STROKE_QUEUE_SIZE];
+static int          stroke_head = 0;
+static int          stroke_count = 0;
+static Tool *       stroke_tool = NULL;
+static guint        stroke_idle = 0;
+static guint        stroke_timer = 0;
+static int          stroke_dirty = FALSE;
+
+static gint
+stroke_queue_idle (
+                   gpointer data
+                   )
+{
+  stroke_queue_drain ((Tool *) data, STROKE_DRAIN_STEP);
+
+  if (stroke_count)
+    return TRUE;
+
+  stroke_idle = 0;
+  return FALSE;
+}
+
+static gint
+stroke_queue_flush (
+                    gpointer data
+                    )
+{
+  Tool * tool = (Tool *) data;
+
+  if (stroke_dirty && tool->gdisp_ptr)
+    {
+      paint_core_16_batch_flush ((PaintCore16 *) tool->private);
+      gdisplay_flush ((GDisplay *) tool->gdisp_ptr);
+      stroke_dirty = FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+stroke_queue_push (
+                   Tool * tool,
+                   GdkEventMotion * mevent
+                   )
+{
+  GDisplay * gdisp = (GDisplay *) tool->gdisp_ptr;
+  StrokeSample * s;
+
+  /* never drop a sample; paint the oldest ones if we run out of room */
+  if (stroke_count == STROKE_QUEUE_SIZE)
+    stroke_queue_drain (tool, STROKE_DRAIN_STEP);
+
+  s = &stroke_queue[(stroke_head + stroke_count) % STROKE_QUEUE_SIZE];
 
   gdisplay_untransform_coords_f (gdisp,
                                  (double) mevent->x, (double) mevent->y,
-				 &paint_core->curx, &paint_core->cury,
+				 &s->x, &s->y,
                                  TRUE);
 
-  paint_core->state = mevent->state;
+  s->state = mevent->state;
   /*wacom */
 #if GTK_MAJOR_VERSION > 1
-      if (gdk_event_get_axis (mevent, GDK_AXIS_PRESSURE, &paint_core->curpressure))
-        paint_core->curpressure = CLAMP (paint_core->curpressure, .0,
-                                  1.);
-      else
-        paint_core->curpressure = 1.0;
+  if (gdk_event_get_axis (mevent, GDK_AXIS_PRESSURE, &s->pressure))
+    s->pressure = CLAMP (s->pressure, .0, 1.);
+  else
+    s->pressure = 1.0;
 
-      if (gdk_event_get_axis (mevent, GDK_AXIS_XTILT, &paint_core->curxtilt))
-      {
-# ifdef DEBUG_
-        printf("curxtilt = %f",paint_core->curxtilt);
-# endif
-        paint_core->curxtilt = CLAMP (paint_core->curxtilt, -1.0,
-                               1.0);
-      } else
-        paint_core->curxtilt = 0.0;
+  if (gdk_event_get_axis (mevent, GDK_AXIS_XTILT, &s->xtilt))
+    s->xtilt = CLAMP (s->xtilt, -1.0, 1.0);
+  else
+    s->xtilt = 0.0;
 
-      if (gdk_event_get_axis (mevent, GDK_AXIS_YTILT, &paint_core->curytilt))
-      {
-# ifdef DEBUG_
-        printf("curytilt = %f\n",paint_core->curytilt);
-# endif
-        paint_core->curytilt = CLAMP (paint_core->curytilt, -1.0,
-                               1.0);
-      } else
-        paint_core->curytilt = 0.0;
+  if (gdk_event_get_axis (mevent, GDK_AXIS_YTILT, &s->ytilt))
+    s->ytilt = CLAMP (s->ytilt, -1.0, 1.0);
+  else
+    s->ytilt = 0.0;
 #else
-  paint_core->curpressure = mevent->pressure;
-  paint_core->curxtilt = mevent->xtilt;
-  paint_core->curytilt = mevent->ytilt;
+  s->pressure = mevent->pressure;
+  s->xtilt = mevent->xtilt;
+  s->ytilt = mevent->ytilt;
 #endif
 
-  
-  paint_core_16_interpolate (paint_core, gimage_active_drawable (gdisp->gimage));
- 
+  stroke_count++;
+  stroke_tool = tool;
 
-  gdisplay_flush (gdisp);
-  
-  paint_core->lastx = paint_core->curx;
-  paint_core->lasty = paint_core->cury;
-  paint_core->lastpressure = paint_core->curpressure;
-  paint_core->lastxtilt    = paint_core->curxtilt;
-  paint_core->lastytilt    = paint_core->curytilt;
+  if (!stroke_idle)
+    stroke_idle = gtk_idle_add (stroke_queue_idle, tool);
+  if (!stroke_timer)
+    stroke_timer = gtk_timeout_add (STROKE_FLUSH_INTERVAL,
+                                    stroke_queue_flush, tool);
+}
+
+/* paint up to n queued samples, all of them if n is 0 */
+static void
+stroke_queue_drain (
+                    Tool * tool,
+                    int n
+                    )
+{
+  GDisplay * gdisp = (GDisplay *) tool->gdisp_ptr;
+  PaintCore16 * paint_core = (PaintCore16 *) tool->private;
+  StrokeSample * s;
+
+  if (!gdisp)
+    {
+      stroke_count = 0;
+      return;
+    }
+
+  while (stroke_count && (n == 0 || n-- > 0))
+    {
+      s = &stroke_queue[stroke_head];
+      stroke_head = (stroke_head + 1) % STROKE_QUEUE_SIZE;
+      stroke_count--;
+
+      paint_core->curx = s->x;
+      paint_core->cury = s->y;
+      paint_core->curpressure = s->pressure;
+      paint_core->curxtilt = s->xtilt;
+      paint_core->curytilt = s->ytilt;
+      paint_core->state = s->state;
+
+      paint_core_16_interpolate (paint_core, gimage_active_drawable (gdisp->gimage));
+
+      paint_core->lastx = paint_core->curx;
+      paint_core->lasty = paint_core->cury;
+      paint_core->lastpressure = paint_core->curpressure;
+      paint_core->lastxtilt    = paint_core->curxtilt;
+      paint_core->lastytilt    = paint_core->curytilt;
+
+      stroke_dirty = TRUE;
+    }
+}
+
+/* forget pending samples and remove the handlers */
+static void
+stroke_queue_stop (void)
+{
+  if (stroke_idle)
+    gtk_idle_remove (stroke_idle);
+  if (stroke_timer)
+    gtk_timeout_remove (stroke_timer);
+
+  stroke_idle = 0;
+  stroke_timer = 0;
+  stroke_head = 0;
+  stroke_count = 0;
+  stroke_dirty = FALSE;
+  stroke_tool = NULL;
+}
+
+static void 
+paint_core_16_motion  (
+                       Tool * tool,
+                       GdkEventMotion * mevent,
+                       gpointer gdisp_ptr
+                       )
+{
+  stroke_queue_push (tool, mevent);
 }
 
 
@@ -816,6 +954,7 @@ paint_core_16_control  (
       draw_core_resume (paint_core->core, tool);
       break;
     case HALT :
+      stroke_queue_stop ();
       (* paint_core->paint_func) (paint_core, drawable, FINISH_PAINT);
       paint_core_16_cleanup (paint_core);
       break;
@@ -843,7 +982,6 @@ paint_core_16_area_setup  (
                      CanvasDrawable * drawable
                      )
 {
-  Tag   tag;
   int   x, y;
   int   dw, dh;
   int   bw, bh;
@@ -870,13 +1008,32 @@ paint_core_16_area_setup  (
   paint_core->y = y1;
   paint_core->w = x2 - x1;
   paint_core->h = y2 - y1;
-  
+  paint_core->canvas_buf_width = (x2 - x1);
+  paint_core->canvas_buf_height = (y2 - y1);
+
+  /* batched dabs only get a painthit when the batch is composited */
+  if (!paint_core->batch)
+    paint_core_16_area_buffers (paint_core, drawable);
+}
+
+
+/* allocate and fill the painthit for the area set in paint_core */
+static void
+paint_core_16_area_buffers  (
+                             PaintCore16 * paint_core,
+                             CanvasDrawable * drawable
+                             )
+{
+  Tag   tag;
+  int   w = paint_core->w;
+  int   h = paint_core->h;
+
   /* configure the canvas buffer */
   tag = tag_set_alpha (drawable_tag (drawable), ALPHA_YES);
 #ifdef NO_TILES
   if(!paint_core->canvas_buf)
   {  paint_core->canvas_buf = canvas_new (tag,
-                           (x2 - x1), (y2 - y1),
+                           w, h,
                            STORAGE_FLAT);
   }
 #else
@@ -884,7 +1041,7 @@ paint_core_16_area_setup  (
     canvas_delete (paint_core->canvas_buf);
 
   paint_core->canvas_buf = canvas_new (tag,
-                           (x2 - x1), (y2 - y1),
+                           w, h,
                            STORAGE_FLAT);
 #endif
   paint_core->setup_mode = NORMAL_SETUP;
@@ -902,17 +1059,124 @@ paint_core_16_area_setup  (
       canvas_delete (paint_core->linked_canvas_buf);
 
     paint_core->linked_canvas_buf = canvas_new (tag,
-			     (x2 - x1), (y2 - y1),
+			     w, h,
 			     STORAGE_FLAT);
     paint_core->setup_mode = LINKED_SETUP;
     (*paint_core->painthit_setup) (paint_core, paint_core->linked_canvas_buf); 
   }
+}
 
-  paint_core->canvas_buf_width = (x2 - x1);
-  paint_core->canvas_buf_height = (y2 - y1);
- 
- 
-  
+
+/* start or extend the batch of CONSTANT dabs with the current paint hit */
+#define PAINT_BATCH_AREA  (1024 * 1024)
+
+static void
+paint_core_16_batch_begin  (
+                            PaintCore16 * paint_core,
+                            gfloat image_opacity,
+                            int paint_mode
+                            )
+{
+  int x1 = paint_core->x;
+  int y1 = paint_core->y;
+  int x2 = paint_core->x + paint_core->w;
+  int y2 = paint_core->y + paint_core->h;
+
+  if (paint_core->batch_pending &&
+      (image_opacity != paint_core->batch_opacity ||
+       paint_mode != paint_core->batch_mode))
+    paint_core_16_batch_flush (paint_core);
+
+  if (paint_core->batch_pending)
+    {
+      double area = (double) (MAX (x2, paint_core->batch_x2) - MIN (x1, paint_core->batch_x1)) *
+                    (MAX (y2, paint_core->batch_y2) - MIN (y1, paint_core->batch_y1));
+
+      /* keep the composited rectangle from growing far past the dabs */
+      if (area > MAX (PAINT_BATCH_AREA, 2.0 * paint_core->w * paint_core->h))
+        paint_core_16_batch_flush (paint_core);
+    }
+
+  if (paint_core->batch_pending)
+    {
+      paint_core->batch_x1 = MIN (x1, paint_core->batch_x1);
+      paint_core->batch_y1 = MIN (y1, paint_core->batch_y1);
+      paint_core->batch_x2 = MAX (x2, paint_core->batch_x2);
+      paint_core->batch_y2 = MAX (y2, paint_core->batch_y2);
+    }
+  else
+    {
+      paint_core->batch_x1 = x1;
+      paint_core->batch_y1 = y1;
+      paint_core->batch_x2 = x2;
+      paint_core->batch_y2 = y2;
+      paint_core->batch_opacity = image_opacity;
+      paint_core->batch_mode = paint_mode;
+      paint_core->batch_pending = TRUE;
+    }
+}
+
+
+/* composite the accumulated CONSTANT dabs onto the drawable as one
+   painthit.  the result is the same as applying them one by one since
+   each application starts from the undo tiles */
+void
+paint_core_16_batch_flush  (
+                            PaintCore16 * paint_core
+                            )
+{
+  CanvasDrawable * drawable = paint_core->drawable;
+  int x = paint_core->x;
+  int y = paint_core->y;
+  int w = paint_core->w;
+  int h = paint_core->h;
+
+  if (!paint_core->batch_pending)
+    return;
+
+  paint_core->batch_pending = FALSE;
+
+  if (! drawable_gimage (drawable))
+    return;
+
+  paint_core->x = paint_core->batch_x1;
+  paint_core->y = paint_core->batch_y1;
+  paint_core->w = paint_core->batch_x2 - paint_core->batch_x1;
+  paint_core->h = paint_core->batch_y2 - paint_core->batch_y1;
+  paint_core->canvas_buf_width = paint_core->w;
+  paint_core->canvas_buf_height = paint_core->h;
+
+  /* the gaps between dabs need undo tiles too */
+  painthit_init (paint_core, drawable, paint_core->undo_tiles);
+  if (paint_core->linked_drawable)
+    painthit_init (paint_core, paint_core->linked_drawable, paint_core->linked_undo_tiles);
+
+  paint_core_16_area_buffers (paint_core, drawable);
+  canvas_tiles_to_canvas_buf (paint_core);
+
+  gimage_apply_painthit (drawable_gimage (drawable), drawable,
+			 paint_core->undo_tiles, paint_core->canvas_buf,
+			 0, 0,
+			 0, 0,
+			 FALSE, paint_core->batch_opacity, paint_core->batch_mode,
+			 paint_core->x, paint_core->y);
+
+  if (paint_core->linked_drawable)
+    gimage_apply_painthit (drawable_gimage (drawable), paint_core->linked_drawable,
+			   paint_core->linked_undo_tiles, paint_core->linked_canvas_buf,
+			   0, 0,
+			   0, 0,
+			   FALSE, paint_core->batch_opacity, paint_core->batch_mode,
+			   paint_core->x, paint_core->y);
+
+  painthit_finish (drawable, paint_core, paint_core->canvas_buf);
+
+  paint_core->x = x;
+  paint_core->y = y;
+  paint_core->w = w;
+  paint_core->h = h;
+  paint_core->canvas_buf_width = w;
+  paint_core->canvas_buf_height = h;
 }
 
 
@@ -1105,6 +1369,18 @@ paint_core_16_area_paste  (
     {
     return;
     }
+
+  if (paint_core->batch)
+    {
+      if (apply_mode == CONSTANT)
+        paint_core_16_batch_begin (paint_core, image_opacity, paint_mode);
+      else
+        {
+          paint_core_16_batch_flush (paint_core);
+          paint_core_16_area_buffers (paint_core, drawable);
+        }
+    }
+
   painthit_init (paint_core, drawable, paint_core->undo_tiles);
 
   if (paint_core->linked_drawable)
@@ -1134,6 +1410,8 @@ paint_core_16_area_paste  (
     {
     case CONSTANT:
       brush_to_canvas_tiles(paint_core,brush_mask2,brush_opacity);
+      if (paint_core->batch)
+        break;
       canvas_tiles_to_canvas_buf(paint_core); 
       undo_canvas = paint_core->undo_tiles; 
       undo_linked_canvas = paint_core->linked_undo_tiles; 
@@ -1148,6 +1426,13 @@ paint_core_16_area_paste  (
   if (brush_mask2 != brush_mask)
     canvas_delete (brush_mask2);
 
+  /* batched dabs are composited by paint_core_16_batch_flush */
+  if (paint_core->batch && apply_mode == CONSTANT)
+    {
+      painthit_free_masks (paint_core);
+      return;
+    }
+
   gimage_apply_painthit (drawable_gimage (drawable), drawable,
 			 undo_canvas, paint_core->canvas_buf,
 			 0, 0,
@@ -1520,6 +1805,15 @@ painthit_finish (
                          paint_core->x + offx, paint_core->y + offy,
                          canvas_width (painthit), canvas_height (painthit));
 
+  painthit_free_masks (paint_core);
+}
+
+
+static void
+painthit_free_masks (
+                     PaintCore16 * paint_core
+                     )
+{
   if (paint_core->noise_mask)
    {
      canvas_delete (paint_core->noise_mask);
@@ -1532,50 +1826,291 @@ painthit_finish (
      paint_core->solid_mask = NULL;
    }
 
+  if (paint_core->subsampled_mask)
+   {
+     canvas_delete (paint_core->subsampled_mask);
+     paint_core->subsampled_mask = NULL;
+   }
 }
 
 
-static Canvas * 
-brush_mask_get  (
-		 PaintCore16 *paint_core,
-                 Canvas* brush_mask,
-                 int brush_hardness,
-		 gdouble scale
-                 )
-{
-  Canvas * bm;
+/* prepared brush masks, keyed by brush, quantized scale, subpixel
+   phase and hardness.  the cache owns the masks it hands out, so
+   callers must not delete them */
+#define BRUSH_CACHE_SIZE   64
+#define BRUSH_PHASES       4
+#define BRUSH_SCALE_STEPS  256
 
 #ifndef GDK_CORE_POINTER
 #define GDK_CORE_POINTER 0xfedc
 #endif
 
-  if (current_device == GDK_CORE_POINTER || fabs(1.0 - scale)  < 0.001)
-    bm = brush_mask;
-  else
-    bm = paint_core_scale_mask (brush_mask, 
-                                paint_core->curx, paint_core->cury,
-                                scale);
+typedef struct BrushCacheEntry BrushCacheEntry;
+struct BrushCacheEntry
+{
+  Canvas * brush;
+  guint    serial;
+  int      hardness;
+  int      direct;
+  int      scale;
+  int      phase_x;
+  int      phase_y;
+
+  Canvas * mask;
+  guint    stamp;
+};
+
+static BrushCacheEntry brush_cache[BRUSH_CACHE_SIZE];
+static guint           brush_cache_clock = 0;
+
+/* the key whose remaining phases are built while the stroke is idle */
+static BrushCacheEntry brush_cache_pending;
+static int             brush_cache_pending_phase = 0;
+static guint           brush_cache_idle = 0;
+
+static void
+brush_cache_key (
+                 BrushCacheEntry * key,
+                 Canvas * brush_mask,
+                 int hardness,
+                 gdouble scale,
+                 double x,
+                 double y
+                 )
+{
+  double ip;
+  double jump_x = modf (x, &ip),
+         jump_y = modf (y, &ip);
+
+  if (jump_x < 0)
+    jump_x = 1.0 + jump_x;
+  if (jump_y < 0)
+    jump_y = 1.0 + jump_y;
+
+  key->brush = brush_mask;
+  key->serial = canvas_portion_serial (brush_mask, 0, 0);
+  key->hardness = hardness;
+  key->direct = (current_device == GDK_CORE_POINTER ||
+                 fabs (1.0 - scale) < 0.001);
+  key->scale = (int) (CLAMP (scale, 0.0, 1.0) * BRUSH_SCALE_STEPS + 0.5);
+  key->phase_x = MIN ((int) (jump_x * BRUSH_PHASES), BRUSH_PHASES - 1);
+  key->phase_y = MIN ((int) (jump_y * BRUSH_PHASES), BRUSH_PHASES - 1);
+
+  /* solidifying the unscaled brush ignores scale and phase */
+  if (key->direct && hardness == HARD)
+    {
+      key->scale = BRUSH_SCALE_STEPS;
+      key->phase_x = key->phase_y = 0;
+    }
+}
+
+static int
+brush_cache_match (
+                   BrushCacheEntry * a,
+                   BrushCacheEntry * b
+                   )
+{
+  return (a->brush == b->brush &&
+          a->serial == b->serial &&
+          a->hardness == b->hardness &&
+          a->direct == b->direct &&
+          a->scale == b->scale &&
+          a->phase_x == b->phase_x &&
+          a->phase_y == b->phase_y);
+}
+
+static BrushCacheEntry *
+brush_cache_find (
+                  BrushCacheEntry * key
+                  )
+{
+  int i;
+
+  for (i = 0; i < BRUSH_CACHE_SIZE; i++)
+    if (brush_cache[i].mask && brush_cache_match (&brush_cache[i], key))
+      return &brush_cache[i];
+
+  return NULL;
+}
+
+static void
+brush_cache_insert (
+                    BrushCacheEntry * key,
+                    Canvas * mask
+                    )
+{
+  BrushCacheEntry * e = &brush_cache[0];
+  int i;
+
+  /* take a free slot, else the least recently used one */
+  for (i = 0; i < BRUSH_CACHE_SIZE; i++)
+    {
+      if (!brush_cache[i].mask)
+        {
+          e = &brush_cache[i];
+          break;
+        }
+      if (brush_cache[i].stamp < e->stamp)
+        e = &brush_cache[i];
+    }
+
+  if (e->mask)
+    canvas_delete (e->mask);
 
-  switch (brush_hardness)
+  *e = *key;
+  e->mask = mask;
+  e->stamp = ++brush_cache_clock;
+}
+
+/* build the mask for a key from scratch; returns the brush itself when
+   there is nothing to do, otherwise a new canvas owned by the caller */
+static Canvas *
+brush_cache_build (
+                   BrushCacheEntry * key
+                   )
+{
+  Canvas * bm;
+  Canvas * scaled = NULL;
+  double jump_x = (double) key->phase_x / BRUSH_PHASES,
+         jump_y = (double) key->phase_y / BRUSH_PHASES;
+  double scale = (double) key->scale / BRUSH_SCALE_STEPS;
+
+  if (key->direct)
+    bm = key->brush;
+  else if (!(bm = scaled = paint_core_scale_mask (key->brush,
+                                                 jump_x, jump_y, scale)))
+    return NULL;
+
+  switch (key->hardness)
     {
     case SOFT:
-      if (current_device == GDK_CORE_POINTER || fabs(1.0 - scale)  < 0.001)
-        bm = brush_mask_subsample (bm,
-                                   paint_core->curx, paint_core->cury, scale);
+      if (key->direct)
+        bm = brush_mask_subsample (bm, jump_x, jump_y, scale);
       break;
-      
+
     case HARD:
-      bm = brush_mask_solidify (paint_core, bm);
+      bm = brush_mask_solidify (bm);
       break;
 
     case EXACT:
       break;
-      
+
     default:
       bm = NULL;
       break;
     }
 
+  if (scaled && scaled != bm && scaled != key->brush)
+    canvas_delete (scaled);
+
+  return bm;
+}
+
+static gint
+brush_cache_prebuild_step (
+                           gpointer data
+                           )
+{
+  GimpBrushP brush = get_active_brush ();
+  BrushCacheEntry key = brush_cache_pending;
+  Canvas * bm;
+
+  /* stop if the brush went away or changed under us */
+  if (!brush || brush->mask != key.brush ||
+      canvas_portion_serial (key.brush, 0, 0) != key.serial ||
+      brush_cache_pending_phase >= BRUSH_PHASES * BRUSH_PHASES)
+    {
+      brush_cache_idle = 0;
+      return FALSE;
+    }
+
+  key.phase_x = brush_cache_pending_phase % BRUSH_PHASES;
+  key.phase_y = brush_cache_pending_phase / BRUSH_PHASES;
+  brush_cache_pending_phase++;
+
+  if (!brush_cache_find (&key))
+    {
+      bm = brush_cache_build (&key);
+      if (bm && bm != key.brush)
+        brush_cache_insert (&key, bm);
+    }
+
+  return TRUE;
+}
+
+static void
+brush_cache_prebuild (
+                      BrushCacheEntry * key
+                      )
+{
+  if (key->direct && key->hardness == HARD)
+    return;
+
+  if (brush_cache_idle)
+    {
+      BrushCacheEntry k = *key;
+
+      k.phase_x = brush_cache_pending.phase_x;
+      k.phase_y = brush_cache_pending.phase_y;
+      if (brush_cache_match (&k, &brush_cache_pending))
+        return;
+    }
+
+  brush_cache_pending = *key;
+  brush_cache_pending_phase = 0;
+
+  if (!brush_cache_idle)
+    brush_cache_idle = gtk_idle_add (brush_cache_prebuild_step, NULL);
+}
+
+static void
+brush_cache_prebuild_stop (void)
+{
+  if (brush_cache_idle)
+    {
+      gtk_idle_remove (brush_cache_idle);
+      brush_cache_idle = 0;
+    }
+}
+
+static Canvas * 
+brush_mask_get  (
+		 PaintCore16 *paint_core,
+                 Canvas* brush_mask,
+                 int brush_hardness,
+		 gdouble scale
+                 )
+{
+  BrushCacheEntry key;
+  BrushCacheEntry * e;
+  Canvas * bm;
+
+  brush_cache_key (&key, brush_mask, brush_hardness, scale,
+                   paint_core->curx, paint_core->cury);
+
+  /* noise masks are new every dab, so their result is not cached */
+  if (brush_mask != paint_core->brush_mask)
+    {
+      bm = brush_cache_build (&key);
+      if (bm != brush_mask)
+        paint_core->subsampled_mask = bm;
+      return bm;
+    }
+
+  if (key.direct && brush_hardness == EXACT)
+    return brush_mask;
+
+  if ((e = brush_cache_find (&key)))
+    {
+      e->stamp = ++brush_cache_clock;
+      return e->mask;
+    }
+
+  bm = brush_cache_build (&key);
+  if (bm && bm != brush_mask)
+    brush_cache_insert (&key, bm);
+
+  brush_cache_prebuild (&key);
 
   return bm;
 }
@@ -2035,7 +2570,6 @@ canvas_16_to_bfp (
 
 static Canvas * 
 brush_mask_solidify  (
-		      PaintCore16 * paint_core,	
                       Canvas * brush_mask
                       )
 {
@@ -2054,8 +2588,6 @@ brush_mask_solidify  (
   canvas_portion_unref (solid_brush, 0, 0);
   canvas_portion_unref (brush_mask, 0, 0);
   
-  paint_core->solid_mask = solid_brush;
-  
   return solid_brush;
 }
 
@@ -2191,10 +2723,7 @@ paint_core_scale_mask (Canvas  *brush_mask,
                        gdouble  orig_y,
 		       gdouble  scale)
 {
-  static Canvas *last_brush  = NULL;
-  static gdouble last_jump_x = 0.0,
-                 last_jump_y = 0.0;
-  static gdouble last_scale  = 0.0;
+  Canvas *scale_brush;
   gint dest_width;
   gint dest_height;
   PixelArea srcPR, destPR;
@@ -2229,20 +2758,6 @@ paint_core_scale_mask (Canvas  *brush_mask,
   dest_width  ++;
   dest_height ++;
 
-  if (brush_mask == last_brush &&
-      jump_x == last_jump_x &&
-      jump_y == last_jump_y &&
-      scale == last_scale)
-    return scale_brush;
-
-  if (scale_brush)
-    canvas_delete (scale_brush);
-
-  last_brush  = brush_mask;
-  last_jump_x = jump_x;
-  last_jump_y = jump_y;
-  last_scale  = scale;
-
   pixelarea_init (&srcPR, brush_mask,
                   0, 0,
                   0, 0,
@@ -213,6 +213,161 @@ static int color_hash_hits;
 #define RANDOM_SEED        314159265
 static int random_table [RANDOM_TABLE_SIZE];
 
+/* for picking row kernels by instruction set */
+typedef void (*x_addFunc) (PixelRow*, PixelRow*);
+typedef void (*BlendRowFunc) (PixelRow*, PixelRow*, PixelRow*, gfloat, gint);
+
+#define PAINT_PRECISIONS   (PRECISION_BFP + 1)
+
+/*  the kernels a level provides, indexed by precision.  a NULL
+ *  entry falls back to the kernel of the next lower level  */
+typedef struct PaintFuncs PaintFuncs;
+
+struct PaintFuncs
+{
+  x_addFunc    x_add [PAINT_PRECISIONS];
+  BlendRowFunc blend [PAINT_PRECISIONS];
+};
+
+static PaintFuncs paint_funcs_levels [CPU_LEVEL_COUNT] =
+{
+  /* scalar */
+  {
+    { NULL, x_add_row_u8, x_add_row_u16, x_add_row_float, x_add_row_float16, x_add_row_bfp },
+    { NULL, blend_row_u8, blend_row_u16, blend_row_float, blend_row_float16, blend_row_bfp }
+  },
+  /* sse4.1 */
+  {
+    { NULL },
+    { NULL }
+  },
+  /* avx2 */
+  {
+    { NULL },
+#ifdef PAINT_FUNCS_X86
+    { NULL, NULL, NULL, blend_row_float_avx2, NULL, NULL }
+#else
+    { NULL }
+#endif
+  },
+  /* avx512 */
+  {
+    { NULL },
+    { NULL }
+  }
+};
+
+static const char * cpu_level_names [CPU_LEVEL_COUNT] =
+{
+  "scalar", "sse4.1", "avx2", "avx512"
+};
+
+/* the kernels in use, resolved once from the table above */
+static PaintFuncs paint_funcs;
+static CpuLevel paint_funcs_level = CPU_LEVEL_SCALAR;
+static int paint_funcs_resolved = FALSE;
+
+static CpuLevel
+cpu_level_detect  (
+                   void
+                   )
+{
+#ifdef PAINT_FUNCS_X86
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx512f"))
+    return CPU_LEVEL_AVX512;
+  if (__builtin_cpu_supports ("avx2"))
+    return CPU_LEVEL_AVX2;
+  if (__builtin_cpu_supports ("sse4.1"))
+    return CPU_LEVEL_SSE41;
+#endif
+  return CPU_LEVEL_SCALAR;
+}
+
+/* the CINEPAINT_CPU_LEVEL environment variable wins over the
+   cpu-level gimprc option, neither may go above what the cpu has */
+static CpuLevel
+cpu_level_pick  (
+                 void
+                 )
+{
+  CpuLevel detected = cpu_level_detect ();
+  const char * name = getenv ("CINEPAINT_CPU_LEVEL");
+  int i;
+
+  if (!name || !*name)
+    name = cpu_level;
+  if (!name || !*name || !strcmp (name, "auto"))
+    return detected;
+
+  for (i = 0; i < CPU_LEVEL_COUNT; i++)
+    if (!strcmp (name, cpu_level_names[i]))
+      break;
+
+  if (i == CPU_LEVEL_COUNT)
+    {
+      g_warning ("unknown cpu level \"%s\", using %s",
+                 name, cpu_level_names[detected]);
+      return detected;
+    }
+  if (i > detected)
+    {
+      g_warning ("cpu level %s is not supported here, using %s",
+                 name, cpu_level_names[detected]);
+      return detected;
+    }
+  return (CpuLevel) i;
+}
+
+static void
+paint_funcs_resolve  (
+                      CpuLevel level
+                      )
+{
+  int l, p;
+
+  for (l = CPU_LEVEL_SCALAR; l <= level; l++)
+    for (p = 0; p < PAINT_PRECISIONS; p++)
+      {
+        if (paint_funcs_levels[l].x_add[p])
+          paint_funcs.x_add[p] = paint_funcs_levels[l].x_add[p];
+        if (paint_funcs_levels[l].blend[p])
+          paint_funcs.blend[p] = paint_funcs_levels[l].blend[p];
+      }
+
+  paint_funcs_level = level;
+  paint_funcs_resolved = TRUE;
+}
+
+static PaintFuncs *
+paint_funcs_get  (
+                  void
+                  )
+{
+  /* areas can be processed before setup in batch mode */
+  if (!paint_funcs_resolved)
+    paint_funcs_resolve (CPU_LEVEL_SCALAR);
+  return &paint_funcs;
+}
+
+CpuLevel
+paint_funcs_cpu_level  (
+                        void
+                        )
+{
+  return paint_funcs_level;
+}
+
+const char *
+paint_funcs_cpu_level_name  (
+                             CpuLevel level
+                             )
+{
+  if (level < CPU_LEVEL_SCALAR || level >= CPU_LEVEL_COUNT)
+    return "unknown";
+  return cpu_level_names[level];
+}
+
 
 void 
 paint_funcs_area_setup  (
@@ -221,6 +376,8 @@ paint_funcs_area_setup  (
 {
   int i;
 
+  paint_funcs_resolve (cpu_level_pick ());
+
   /*  initialize the color hash table--invalidate all entries  */
   for (i = 0; i < HASH_TABLE_SIZE; i++)
     color_hash_table[i].colormap_ID = -1;
@@ -285,29 +442,18 @@ check_precision (
   return 0;
 }
   
-typedef void (*x_addFunc) (PixelRow*, PixelRow*);
 static x_addFunc x_add_area_funcs (Tag);
 static x_addFunc
 x_add_area_funcs (
                    Tag tag
                    )
 {
-  switch (tag_precision (tag))
-    {
-    case PRECISION_U8:
-      return x_add_row_u8;
-    case PRECISION_U16:
-      return x_add_row_u16;
-    case PRECISION_FLOAT:
-      return x_add_row_float;
-    case PRECISION_FLOAT16:
-      return x_add_row_float16;
-    case PRECISION_BFP:
-      return x_add_row_bfp;
-    case PRECISION_NONE:
-    default:
-      g_warning ("x_add: bad precision");
-    }
+  Precision p = tag_precision (tag);
+
+  if (p > PRECISION_NONE && p < PAINT_PRECISIONS)
+    return paint_funcs_get ()->x_add[p];
+
+  g_warning ("x_add: bad precision");
   return NULL;
 }
 
@@ -726,7 +872,6 @@ color_area  (
 
 /* ---------------------------------------------------------*/
 
-typedef void (*BlendRowFunc) (PixelRow*, PixelRow*, PixelRow*, gfloat, gint);
 static BlendRowFunc blend_area_funcs (Tag);
 
 static BlendRowFunc 
@@ -735,21 +880,11 @@ blend_area_funcs (
 		)
 	  
 {
-  switch (tag_precision (tag))
-  {
-  case PRECISION_U8:
-    return blend_row_u8;
-  case PRECISION_U16:
-    return blend_row_u16;
-  case PRECISION_FLOAT:
-    return blend_row_float;
-  case PRECISION_FLOAT16:
-    return blend_row_float16;
-  case PRECISION_BFP:
-    return blend_row_bfp;
-  default:
-    return NULL;
-  } 
+  Precision p = tag_precision (tag);
+
+  if (p > PRECISION_NONE && p < PAINT_PRECISIONS)
+    return paint_funcs_get ()->blend[p];
+  return NULL;
 }
 
 void 
@@ -4849,7 +4984,24 @@ initial_area  (
       g_free (buf_row_data);
 }
 
-static void combine_areas_funcs (Tag);
+/*  the layouts that have fixed stride row kernels  */
+static gint
+layout_is_rgb (
+               Tag tag
+               )
+{
+  return (tag_format (tag) == FORMAT_RGB && tag_alpha (tag) == ALPHA_NO);
+}
+
+static gint
+layout_is_rgba (
+                Tag tag
+                )
+{
+  return (tag_format (tag) == FORMAT_RGB && tag_alpha (tag) == ALPHA_YES);
+}
+
+static void combine_areas_funcs (Tag, Tag);
 typedef void (*CombineIndexedAndIndexedRowFunc) (PixelRow *, PixelRow *, PixelRow *, PixelRow *, gfloat, gint *);
 typedef void (*CombineIndexedAndIndexedARowFunc) (PixelRow *, PixelRow *, PixelRow *, PixelRow *, gfloat, gint *);
 typedef void (*CombineIndexedAAndIndexedARowFunc) (PixelRow *, PixelRow *, PixelRow *, PixelRow *, gfloat, gint *);
@@ -4885,7 +5037,8 @@ static EraseIndexedRowFunc erase_indexed_row;
 
 static void 
 combine_areas_funcs (
-		Tag tag
+		Tag tag,
+		Tag src2_tag
 		)
 	  
 {
@@ -5000,6 +5153,20 @@ combine_areas_funcs (
     erase_indexed_row = NULL;
     break;
   } 
+
+  /* fixed stride kernels when both sides are rgba */
+  if (layout_is_rgba (tag) && layout_is_rgba (src2_tag))
+    switch (tag_precision (tag))
+      {
+      case PRECISION_U16:
+        combine_inten_a_and_inten_a_row = combine_inten_a_and_inten_a_row_u16_rgba;
+        break;
+      case PRECISION_FLOAT:
+        combine_inten_a_and_inten_a_row = combine_inten_a_and_inten_a_row_float_rgba;
+        break;
+      default:
+        break;
+      }
 }
 
 int
@@ -5107,7 +5274,7 @@ combine_areas  (
       return;
     }
 
-  combine_areas_funcs (src1_tag); 
+  combine_areas_funcs (src1_tag, src2_tag); 
 
   buf_size = src2_width * src2_bytes;
   buf_row_data = (guchar *) g_malloc (buf_size);
@@ -5493,7 +5660,7 @@ cubic (
 /************************************/
 /*       apply layer modes          */
 /************************************/
-static void apply_layer_mode_funcs (Tag);
+static void apply_layer_mode_funcs (Tag, Tag);
 
 typedef void (*MultiplyRowFunc) (PixelRow *, PixelRow *, PixelRow *);
 typedef void (*ScreenRowFunc) (PixelRow *, PixelRow *, PixelRow *);
@@ -5519,7 +5686,8 @@ static ColorOnlyRowFunc color_only_row;
 
 static void 
 apply_layer_mode_funcs (
-		Tag tag
+		Tag tag,
+		Tag src2_tag
 		)
 	  
 {
@@ -5610,6 +5778,40 @@ apply_layer_mode_funcs (
     color_only_row = NULL; 
     break;
   } 
+
+  /* fixed stride kernels when both sources share an rgb layout */
+  if (layout_is_rgba (tag) && layout_is_rgba (src2_tag))
+    switch (tag_precision (tag))
+      {
+      case PRECISION_U16:
+        multiply_row = multiply_row_u16_rgba;
+        screen_row = screen_row_u16_rgba;
+        overlay_row = overlay_row_u16_rgba;
+        break;
+      case PRECISION_FLOAT:
+        multiply_row = multiply_row_float_rgba;
+        screen_row = screen_row_float_rgba;
+        overlay_row = overlay_row_float_rgba;
+        break;
+      default:
+        break;
+      }
+  else if (layout_is_rgb (tag) && layout_is_rgb (src2_tag))
+    switch (tag_precision (tag))
+      {
+      case PRECISION_U16:
+        multiply_row = multiply_row_u16_rgb;
+        screen_row = screen_row_u16_rgb;
+        overlay_row = overlay_row_u16_rgb;
+        break;
+      case PRECISION_FLOAT:
+        multiply_row = multiply_row_float_rgb;
+        screen_row = screen_row_float_rgb;
+        overlay_row = overlay_row_float_rgb;
+        break;
+      default:
+        break;
+      }
 }
 
 
@@ -5635,7 +5837,7 @@ apply_layer_mode  (
   gint width = pixelrow_width (dest_row); 
   Format src1_format = tag_format (src1_tag);
   
-  apply_layer_mode_funcs (src1_tag);
+  apply_layer_mode_funcs (src1_tag, src2_tag);
  
   if (!ha1 && !ha2)
     combine = COMBINE_INTEN_INTEN;
@@ -0,0 +1,336 @@
+/* The GIMP -- an image manipulation program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*  paint-funcs-bench: times the area and row kernels of paint_funcs
+ *  on synthetic canvases for every precision, format and alpha
+ *  combination.  it links only the pixel code, no display.
+ *
+ *  usage: paint-funcs-bench [-s size] [-i iterations] [-l cpu-level]
+ *                           [kernel ...]
+ *
+ *  one tab separated line is printed per measurement:
+ *  kernel precision format alpha cpu-level pixels seconds mpix/s
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include "float16.h"
+#include "bfp.h"
+#include "../canvas.h"
+#include "../paint_funcs_area.h"
+#include "../pixelarea.h"
+#include "../pixelrow.h"
+#include "../tag.h"
+
+/* stand-ins for the gimprc settings paint_funcs_area.c reads */
+char * cpu_level = NULL;
+int    cubic_interpolation = 0;
+
+typedef void (*BenchFunc) (Canvas *, Canvas *, Canvas *, gint);
+
+typedef struct
+{
+  const char * name;
+  BenchFunc    func;
+  gint         mode;
+} BenchKernel;
+
+static gint bench_size = 1024;
+static gint bench_iterations = 10;
+static gint affect[4] = { 1, 1, 1, 1 };
+
+
+static void
+bench_fill  (
+             Canvas * c
+             )
+{
+  PixelArea area;
+  void * pag;
+  ShortsFloat u;
+
+  pixelarea_init (&area, c, 0, 0, 0, 0, TRUE);
+  for (pag = pixelarea_register (1, &area);
+       pag != NULL;
+       pag = pixelarea_process (pag))
+    {
+      Tag tag = pixelarea_tag (&area);
+      gint n = pixelarea_width (&area) * tag_num_channels (tag);
+      gint h = pixelarea_height (&area);
+      guchar * data = pixelarea_data (&area);
+      gint i;
+
+      while (h--)
+        {
+          switch (tag_precision (tag))
+            {
+            case PRECISION_U8:
+              for (i = 0; i < n; i++)
+                data[i] = rand () & 0xff;
+              break;
+            case PRECISION_U16:
+              for (i = 0; i < n; i++)
+                ((guint16 *) data)[i] = rand () & 0xffff;
+              break;
+            case PRECISION_FLOAT:
+              for (i = 0; i < n; i++)
+                ((gfloat *) data)[i] = (rand () & 0xffff) / 65535.0;
+              break;
+            case PRECISION_FLOAT16:
+              for (i = 0; i < n; i++)
+                ((guint16 *) data)[i] = FLT16 ((rand () & 0xffff) / 65535.0, u);
+              break;
+            case PRECISION_BFP:
+              for (i = 0; i < n; i++)
+                ((guint16 *) data)[i] = rand () % (ONE_BFP + 1);
+              break;
+            default:
+              break;
+            }
+          data += pixelarea_rowstride (&area);
+        }
+    }
+}
+
+
+static void
+bench_combine  (
+                Canvas * src1,
+                Canvas * src2,
+                Canvas * dest,
+                gint mode
+                )
+{
+  PixelArea src1_area, src2_area, dest_area;
+  gint type = combine_areas_type (canvas_tag (src1), canvas_tag (src2));
+
+  pixelarea_init (&src1_area, src1, 0, 0, 0, 0, FALSE);
+  pixelarea_init (&src2_area, src2, 0, 0, 0, 0, FALSE);
+  pixelarea_init (&dest_area, dest, 0, 0, 0, 0, TRUE);
+  combine_areas (&src1_area, &src2_area, &dest_area, NULL, NULL,
+                 0.8, mode, affect, type, FALSE);
+}
+
+
+static void
+bench_blend  (
+              Canvas * src1,
+              Canvas * src2,
+              Canvas * dest,
+              gint mode
+              )
+{
+  PixelArea src1_area, src2_area, dest_area;
+
+  pixelarea_init (&src1_area, src1, 0, 0, 0, 0, FALSE);
+  pixelarea_init (&src2_area, src2, 0, 0, 0, 0, FALSE);
+  pixelarea_init (&dest_area, dest, 0, 0, 0, 0, TRUE);
+  blend_area (&src1_area, &src2_area, &dest_area, 0.5, FALSE);
+}
+
+
+static void
+bench_scale  (
+              Canvas * src1,
+              Canvas * src2,
+              Canvas * dest,
+              gint mode
+              )
+{
+  PixelArea src_area, dest_area;
+  gint w = canvas_width (dest) * 3 / 4;
+  gint h = canvas_height (dest) * 3 / 4;
+
+  pixelarea_init (&src_area, src1, 0, 0, 0, 0, FALSE);
+  pixelarea_init (&dest_area, dest, 0, 0, w, h, TRUE);
+  scale_area (&src_area, &dest_area);
+}
+
+
+static void
+bench_convolve  (
+                 Canvas * src1,
+                 Canvas * src2,
+                 Canvas * dest,
+                 gint mode
+                 )
+{
+  static gfloat matrix[9] = { 1, 2, 1,
+                              2, 4, 2,
+                              1, 2, 1 };
+  PixelArea src_area, dest_area;
+
+  pixelarea_init (&src_area, src1, 0, 0, 0, 0, FALSE);
+  pixelarea_init (&dest_area, dest, 0, 0, 0, 0, TRUE);
+  convolve_area (&src_area, &dest_area, matrix, 3, 16, NORMAL,
+                 tag_alpha (canvas_tag (src1)) == ALPHA_YES);
+}
+
+
+static void
+bench_gaussian  (
+                 Canvas * src1,
+                 Canvas * src2,
+                 Canvas * dest,
+                 gint mode
+                 )
+{
+  PixelArea area;
+
+  pixelarea_init (&area, dest, 0, 0, 0, 0, TRUE);
+  gaussian_blur_area (&area, 3.0);
+}
+
+
+static BenchKernel kernels[] =
+{
+  { "combine-normal",     bench_combine,  NORMAL_MODE },
+  { "combine-multiply",   bench_combine,  MULTIPLY_MODE },
+  { "combine-screen",     bench_combine,  SCREEN_MODE },
+  { "combine-overlay",    bench_combine,  OVERLAY_MODE },
+  { "combine-difference", bench_combine,  DIFFERENCE_MODE },
+  { "combine-addition",   bench_combine,  ADDITION_MODE },
+  { "combine-darken",     bench_combine,  DARKEN_ONLY_MODE },
+  { "blend",              bench_blend,    0 },
+  { "scale",              bench_scale,    0 },
+  { "convolve",           bench_convolve, 0 },
+  { "gaussian",           bench_gaussian, 0 }
+};
+#define N_KERNELS (sizeof (kernels) / sizeof (kernels[0]))
+
+
+static gint
+bench_wanted  (
+               const char * name,
+               char ** filters,
+               gint n_filters
+               )
+{
+  gint i;
+
+  if (n_filters == 0)
+    return TRUE;
+  for (i = 0; i < n_filters; i++)
+    if (!strncmp (name, filters[i], strlen (filters[i])))
+      return TRUE;
+  return FALSE;
+}
+
+
+static void
+bench_run  (
+            BenchKernel * k,
+            Precision p,
+            Format f,
+            Alpha a
+            )
+{
+  Tag tag = tag_new (p, f, a);
+  Canvas * src1 = canvas_new (tag, bench_size, bench_size, STORAGE_TILED);
+  Canvas * src2 = canvas_new (tag, bench_size, bench_size, STORAGE_TILED);
+  Canvas * dest = canvas_new (tag, bench_size, bench_size, STORAGE_TILED);
+  GTimer * timer = g_timer_new ();
+  gdouble pixels = (gdouble) bench_size * bench_size * bench_iterations;
+  gdouble secs;
+  gint i;
+
+  bench_fill (src1);
+  bench_fill (src2);
+  bench_fill (dest);
+
+  /* one untimed pass so tile allocation is not measured */
+  (*k->func) (src1, src2, dest, k->mode);
+
+  g_timer_start (timer);
+  for (i = 0; i < bench_iterations; i++)
+    (*k->func) (src1, src2, dest, k->mode);
+  g_timer_stop (timer);
+  secs = g_timer_elapsed (timer, NULL);
+
+  printf ("%s\t%s\t%s\t%s\t%s\t%.0f\t%.6f\t%.2f\n",
+          k->name,
+          tag_string_precision (p),
+          tag_string_format (f),
+          tag_string_alpha (a),
+          paint_funcs_cpu_level_name (paint_funcs_cpu_level ()),
+          pixels, secs,
+          secs > 0 ? pixels / secs / 1e6 : 0.0);
+  fflush (stdout);
+
+  g_timer_destroy (timer);
+  canvas_delete (src1);
+  canvas_delete (src2);
+  canvas_delete (dest);
+}
+
+
+int
+main  (
+       int argc,
+       char ** argv
+       )
+{
+  static Precision precisions[] = { PRECISION_U8, PRECISION_U16, PRECISION_FLOAT,
+                                    PRECISION_FLOAT16, PRECISION_BFP };
+  static Format formats[] = { FORMAT_RGB, FORMAT_GRAY };
+  static Alpha alphas[] = { ALPHA_NO, ALPHA_YES };
+  char ** filters;
+  gint n_filters = 0;
+  guint k, p, f, a;
+  gint i;
+
+  filters = g_new (char *, argc);
+  for (i = 1; i < argc; i++)
+    {
+      if (!strcmp (argv[i], "-s") && i + 1 < argc)
+        bench_size = MAX (16, atoi (argv[++i]));
+      else if (!strcmp (argv[i], "-i") && i + 1 < argc)
+        bench_iterations = MAX (1, atoi (argv[++i]));
+      else if (!strcmp (argv[i], "-l") && i + 1 < argc)
+        cpu_level = argv[++i];
+      else if (argv[i][0] == '-')
+        {
+          fprintf (stderr, "usage: %s [-s size] [-i iterations] [-l cpu-level] [kernel ...]\n",
+                   argv[0]);
+          return 1;
+        }
+      else
+        filters[n_filters++] = argv[i];
+    }
+
+  srand (1);
+  paint_funcs_area_setup ();
+
+  printf ("# kernel\tprecision\tformat\talpha\tcpu-level\tpixels\tseconds\tmpix/s\n");
+
+  for (k = 0; k < N_KERNELS; k++)
+    {
+      if (!bench_wanted (kernels[k].name, filters, n_filters))
+        continue;
+      for (p = 0; p < sizeof (precisions) / sizeof (precisions[0]); p++)
+        for (f = 0; f < sizeof (formats) / sizeof (formats[0]); f++)
+          for (a = 0; a < sizeof (alphas) / sizeof (alphas[0]); a++)
+            bench_run (&kernels[k], precisions[p], formats[f], alphas[a]);
+    }
+
+  paint_funcs_area_free ();
+  g_free (filters);
+  return 0;
+}
@@ -272,6 +272,69 @@ blend_row_float  (
 }
 
 
+#ifdef PAINT_FUNCS_X86
+/*  blend_row_float built for avx2.  rows without alpha are blended
+ *  as one flat run and rgba rows with a fixed stride, so the compiler
+ *  can vectorize both.  the alpha lane is blended along with the rest
+ *  and then overwritten with src1's alpha, as inf or nan in src2 would
+ *  leak through the zero weight.  other layouts use the generic row.
+ */
+__attribute__ ((target ("avx2")))
+void 
+blend_row_float_avx2  (
+                       PixelRow * src1_row,
+                       PixelRow * src2_row,
+                       PixelRow * dest_row,
+                       gfloat blend,
+                       gint blend_alpha
+                       )
+{
+  gint i, b;
+  Tag     src1_tag     = pixelrow_tag (src1_row); 
+  gfloat *dest         = (gfloat*)pixelrow_data (dest_row);
+  gfloat *src1         = (gfloat*)pixelrow_data (src1_row);
+  gfloat *src2         = (gfloat*)pixelrow_data (src2_row);
+  gint    width        = MIN(pixelrow_width (dest_row),pixelrow_width (src1_row));
+  gint    has_alpha    = (tag_alpha (src1_tag)==ALPHA_YES)? TRUE: FALSE;
+  gint    num_channels = tag_num_channels (src1_tag);
+  gfloat  blend_comp   = (1.0 - blend);
+  gfloat  w1[4], w2[4];
+  gfloat  a;
+
+  if (!has_alpha)
+    {
+      gint n = width * num_channels;
+      for (i = 0; i < n; i++)
+	dest[i] = src1[i] * blend_comp + src2[i] * blend;
+    }
+  else if (num_channels == 4)
+    {
+      for (b = 0; b < 3; b++)
+	{
+	  w1[b] = blend_comp;
+	  w2[b] = blend;
+	}
+      w1[3] = 1.0;
+      w2[3] = 0.0;
+
+      while (width --)
+	{
+	  a = src1[3];  /*  dest may be src1  */
+	  for (b = 0; b < 4; b++)
+	    dest[b] = src1[b] * w1[b] + src2[b] * w2[b];
+	  dest[3] = a;
+
+	  src1 += 4;
+	  src2 += 4;
+	  dest += 4;
+	}
+    }
+  else
+    blend_row_float (src1_row, src2_row, dest_row, blend, blend_alpha);
+}
+#endif
+
+
 void 
 shade_row_float  (
                   PixelRow * src_row,
@@ -653,6 +716,153 @@ overlay_row_float (
     }
 }
 
+/*  fixed stride variants of the layer modes above for the common
+ *  RGB and RGBA layouts, where both sources have the same format.
+ *  the channel loops have a constant trip count, so the compiler
+ *  can unroll and vectorize them.
+ */
+void
+multiply_row_float_rgb (
+		      PixelRow *src1_row,
+		      PixelRow *src2_row,
+		      PixelRow *dest_row
+		      )
+{
+  gfloat *dest  = (gfloat*)pixelrow_data (dest_row);
+  gfloat *src1  = (gfloat*)pixelrow_data (src1_row);
+  gfloat *src2  = (gfloat*)pixelrow_data (src2_row);
+  gint    n      = 3 * MIN(pixelrow_width (dest_row),pixelrow_width (src1_row));
+  gint    i;
+
+  for (i = 0; i < n; i++)
+    dest[i] = src1[i] * src2[i];
+}
+
+
+void
+multiply_row_float_rgba (
+		       PixelRow *src1_row,
+		       PixelRow *src2_row,
+		       PixelRow *dest_row
+		       )
+{
+  gint b;
+  gfloat *dest  = (gfloat*)pixelrow_data (dest_row);
+  gfloat *src1  = (gfloat*)pixelrow_data (src1_row);
+  gfloat *src2  = (gfloat*)pixelrow_data (src2_row);
+  gint    width  = MIN(pixelrow_width (dest_row),pixelrow_width (src1_row));
+
+  while (width --)
+    {
+      for (b = 0; b < 3; b++)
+	dest[b] = src1[b] * src2[b];
+      dest[3] = MIN (src1[3], src2[3]);
+
+      src1 += 4;
+      src2 += 4;
+      dest += 4;
+    }
+}
+
+
+void
+screen_row_float_rgb (
+		    PixelRow *src1_row,
+		    PixelRow *src2_row,
+		    PixelRow *dest_row
+		    )
+{
+  gfloat *dest  = (gfloat*)pixelrow_data (dest_row);
+  gfloat *src1  = (gfloat*)pixelrow_data (src1_row);
+  gfloat *src2  = (gfloat*)pixelrow_data (src2_row);
+  gint    n      = 3 * MIN(pixelrow_width (dest_row),pixelrow_width (src1_row));
+  gint    i;
+
+  for (i = 0; i < n; i++)
+    dest[i] = 1.0 - ((1.0 - src1[i]) * (1.0 - src2[i]));
+}
+
+
+void
+screen_row_float_rgba (
+		     PixelRow *src1_row,
+		     PixelRow *src2_row,
+		     PixelRow *dest_row
+		     )
+{
+  gint b;
+  gfloat *dest  = (gfloat*)pixelrow_data (dest_row);
+  gfloat *src1  = (gfloat*)pixelrow_data (src1_row);
+  gfloat *src2  = (gfloat*)pixelrow_data (src2_row);
+  gint    width  = MIN(pixelrow_width (dest_row),pixelrow_width (src1_row));
+
+  while (width --)
+    {
+      for (b = 0; b < 3; b++)
+	dest[b] = 1.0 - ((1.0 - src1[b]) * (1.0 - src2[b]));
+      dest[3] = MIN (src1[3], src2[3]);
+
+      src1 += 4;
+      src2 += 4;
+      dest += 4;
+    }
+}
+
+
+void
+overlay_row_float_rgb (
+		     PixelRow *src1_row,
+		     PixelRow *src2_row,
+		     PixelRow *dest_row
+		     )
+{
+  gfloat screen, mult;
+  gfloat *dest  = (gfloat*)pixelrow_data (dest_row);
+  gfloat *src1  = (gfloat*)pixelrow_data (src1_row);
+  gfloat *src2  = (gfloat*)pixelrow_data (src2_row);
+  gint    n      = 3 * MIN(pixelrow_width (dest_row),pixelrow_width (src1_row));
+  gint    i;
+
+  for (i = 0; i < n; i++)
+    {
+      screen = 1.0 - ((1.0 - src1[i]) * (1.0 - src2[i]));
+      mult = src1[i] * src2[i];
+      dest[i] = screen * src1[i] + mult * (1.0 - src1[i]);
+    }
+}
+
+
+void
+overlay_row_float_rgba (
+		      PixelRow *src1_row,
+		      PixelRow *src2_row,
+		      PixelRow *dest_row
+		      )
+{
+  gint b;
+  gfloat screen, mult;
+  gfloat *dest  = (gfloat*)pixelrow_data (dest_row);
+  gfloat *src1  = (gfloat*)pixelrow_data (src1_row);
+  gfloat *src2  = (gfloat*)pixelrow_data (src2_row);
+  gint    width  = MIN(pixelrow_width (dest_row),pixelrow_width (src1_row));
+
+  while (width --)
+    {
+      for (b = 0; b < 3; b++)
+	{
+	  screen = 1.0 - ((1.0 - src1[b]) * (1.0 - src2[b]));
+	  mult = src1[b] * src2[b];
+	  dest[b] = screen * src1[b] + mult * (1.0 - src1[b]);
+	}
+      dest[3] = MIN (src1[3], src2[3]);
+
+      src1 += 4;
+      src2 += 4;
+      dest += 4;
+    }
+}
+
+
 
 void
 add_row_float ( 
@@ -1559,6 +1769,73 @@ combine_inten_a_and_inten_a_row_float  (
       }
   }
 }
+
+/*  fixed stride variant of the above for RGBA, the affect and
+ *  mask tests are hoisted out of the pixel loop
+ */
+void 
+combine_inten_a_and_inten_a_row_float_rgba  (
+                                             PixelRow * src1_row,
+                                             PixelRow * src2_row,
+                                             PixelRow * dest_row,
+                                             PixelRow * mask_row,
+                                             gfloat opacity,
+                                             int * affect,
+                                             int mode_affect
+                                             )
+{
+  gint b;
+  gfloat src2_alpha;
+  gfloat new_alpha;
+  float ratio, compl_ratio;
+  gfloat *src1         = (gfloat*)pixelrow_data (src1_row);
+  gfloat *src2         = (gfloat*)pixelrow_data (src2_row);
+  gfloat *dest         = (gfloat*)pixelrow_data (dest_row);
+  gfloat *m            = (gfloat*)pixelrow_data (mask_row);
+  gint    mask_step    = m ? 1 : 0;
+  gint    width        = pixelrow_width (src1_row);
+  gint    aff[4];
+
+  for (b = 0; b < 4; b++)
+    aff[b] = affect[b] ? TRUE : FALSE;
+  if (!m)
+    m = &no_mask;
+
+  while (width --)
+    {
+      src2_alpha = src2[3] * *m * opacity;
+      new_alpha = src1[3] + (1.0 - src1[3]) * src2_alpha;
+
+      if (new_alpha == 0 || src2_alpha == 0)
+	{
+	  for (b = 0; b < 3; b++)
+	    dest[b] = src1[b];
+	}
+      else if (src2_alpha == new_alpha)
+	{
+	  for (b = 0; b < 3; b++)
+	    dest[b] = aff[b] ? src2[b] : src1[b];
+	}
+      else
+	{
+	  ratio = (float) src2_alpha / new_alpha;
+	  compl_ratio = 1.0 - ratio;
+	  for (b = 0; b < 3; b++)
+	    dest[b] = aff[b] ? (src2[b] * ratio + src1[b] * compl_ratio) : src1[b];
+	}
+
+      if (mode_affect)
+	dest[3] = aff[3] ? new_alpha : src1[3];
+      else
+	dest[3] = (src1[3] || !aff[3]) ? src1[3] : new_alpha;
+
+      m += mask_step;
+      src1 += 4;
+      src2 += 4;
+      dest += 4;
+    }
+}
+
 #undef alphify
 
 
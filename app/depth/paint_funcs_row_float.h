@@ -77,6 +77,17 @@ blend_row_float (
 	      gint alpha
               );
 
+#ifdef PAINT_FUNCS_X86
+void
+blend_row_float_avx2 (
+              PixelRow *src1_row,
+	      PixelRow *src2_row,
+	      PixelRow *dest_row,
+	      gfloat blend,
+	      gint alpha
+              );
+#endif
+
 void
 shade_row_float (
 		 PixelRow *src_row,
@@ -143,6 +154,48 @@ overlay_row_float (
 		   PixelRow *dest_row
 		   );
 
+void
+multiply_row_float_rgb (
+		PixelRow *src1_row,
+		PixelRow *src2_row,
+		PixelRow *dest_row
+		);
+
+void
+multiply_row_float_rgba (
+		PixelRow *src1_row,
+		PixelRow *src2_row,
+		PixelRow *dest_row
+		);
+
+void
+screen_row_float_rgb (
+		PixelRow *src1_row,
+		PixelRow *src2_row,
+		PixelRow *dest_row
+		);
+
+void
+screen_row_float_rgba (
+		PixelRow *src1_row,
+		PixelRow *src2_row,
+		PixelRow *dest_row
+		);
+
+void
+overlay_row_float_rgb (
+		PixelRow *src1_row,
+		PixelRow *src2_row,
+		PixelRow *dest_row
+		);
+
+void
+overlay_row_float_rgba (
+		PixelRow *src1_row,
+		PixelRow *src2_row,
+		PixelRow *dest_row
+		);
+
 void
 add_row_float ( 
 	       PixelRow *src1_row,
@@ -339,6 +392,17 @@ combine_inten_a_and_inten_a_row_float (
 					gint       mode_affect
 					);
 
+void
+combine_inten_a_and_inten_a_row_float_rgba (
+					PixelRow *src1_row,
+					PixelRow *src2_row,
+					PixelRow *dest_row,
+					PixelRow *mask_row,
+					gfloat opac,
+					gint      *affect,
+					gint       mode_affect
+					);
+
 /*  combine a channel with intensity-alpha pixels based
  *  on some opacity, and a channel color...
  *  destination is intensity-alpha
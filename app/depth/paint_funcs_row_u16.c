@@ -672,6 +672,159 @@ overlay_row_u16 (
     }
 }
 
+/*  fixed stride variants of the layer modes above for the common
+ *  RGB and RGBA layouts, where both sources have the same format.
+ *  the channel loops have a constant trip count, so the compiler
+ *  can unroll and vectorize them.
+ */
+void
+multiply_row_u16_rgb (
+		      PixelRow *src1_row,
+		      PixelRow *src2_row,
+		      PixelRow *dest_row
+		      )
+{
+  guint32 t;
+  guint16 *dest  = (guint16*)pixelrow_data (dest_row);
+  guint16 *src1  = (guint16*)pixelrow_data (src1_row);
+  guint16 *src2  = (guint16*)pixelrow_data (src2_row);
+  gint    n      = 3 * MIN(pixelrow_width (dest_row),pixelrow_width (src1_row));
+  gint    i;
+
+  for (i = 0; i < n; i++)
+    dest[i] = INT_MULT_16 (src1[i], src2[i], t);
+}
+
+
+void
+multiply_row_u16_rgba (
+		       PixelRow *src1_row,
+		       PixelRow *src2_row,
+		       PixelRow *dest_row
+		       )
+{
+  gint b;
+  guint32 t;
+  guint16 *dest  = (guint16*)pixelrow_data (dest_row);
+  guint16 *src1  = (guint16*)pixelrow_data (src1_row);
+  guint16 *src2  = (guint16*)pixelrow_data (src2_row);
+  gint    width  = MIN(pixelrow_width (dest_row),pixelrow_width (src1_row));
+
+  while (width --)
+    {
+      for (b = 0; b < 3; b++)
+	dest[b] = INT_MULT_16 (src1[b], src2[b], t);
+      dest[3] = MIN (src1[3], src2[3]);
+
+      src1 += 4;
+      src2 += 4;
+      dest += 4;
+    }
+}
+
+
+void
+screen_row_u16_rgb (
+		    PixelRow *src1_row,
+		    PixelRow *src2_row,
+		    PixelRow *dest_row
+		    )
+{
+  guint32 t;
+  guint16 *dest  = (guint16*)pixelrow_data (dest_row);
+  guint16 *src1  = (guint16*)pixelrow_data (src1_row);
+  guint16 *src2  = (guint16*)pixelrow_data (src2_row);
+  gint    n      = 3 * MIN(pixelrow_width (dest_row),pixelrow_width (src1_row));
+  gint    i;
+
+  for (i = 0; i < n; i++)
+    dest[i] = 65535 - (INT_MULT_16 (65535 - src1[i], 65535 - src2[i], t));
+}
+
+
+void
+screen_row_u16_rgba (
+		     PixelRow *src1_row,
+		     PixelRow *src2_row,
+		     PixelRow *dest_row
+		     )
+{
+  gint b;
+  guint32 t;
+  guint16 *dest  = (guint16*)pixelrow_data (dest_row);
+  guint16 *src1  = (guint16*)pixelrow_data (src1_row);
+  guint16 *src2  = (guint16*)pixelrow_data (src2_row);
+  gint    width  = MIN(pixelrow_width (dest_row),pixelrow_width (src1_row));
+
+  while (width --)
+    {
+      for (b = 0; b < 3; b++)
+	dest[b] = 65535 - (INT_MULT_16 (65535 - src1[b], 65535 - src2[b], t));
+      dest[3] = MIN (src1[3], src2[3]);
+
+      src1 += 4;
+      src2 += 4;
+      dest += 4;
+    }
+}
+
+
+void
+overlay_row_u16_rgb (
+		     PixelRow *src1_row,
+		     PixelRow *src2_row,
+		     PixelRow *dest_row
+		     )
+{
+  guint32 screen, mult;
+  guint32 t, s;
+  guint16 *dest  = (guint16*)pixelrow_data (dest_row);
+  guint16 *src1  = (guint16*)pixelrow_data (src1_row);
+  guint16 *src2  = (guint16*)pixelrow_data (src2_row);
+  gint    n      = 3 * MIN(pixelrow_width (dest_row),pixelrow_width (src1_row));
+  gint    i;
+
+  for (i = 0; i < n; i++)
+    {
+      screen = 65535 - (INT_MULT_16 (65535 - src1[i], 65535 - src2[i], t));
+      mult = INT_MULT_16 (src1[i], src2[i], t);
+      dest[i] = INT_MULT_16 (screen, src1[i], s) + INT_MULT_16 (mult, 65535 - src1[i], t);
+    }
+}
+
+
+void
+overlay_row_u16_rgba (
+		      PixelRow *src1_row,
+		      PixelRow *src2_row,
+		      PixelRow *dest_row
+		      )
+{
+  gint b;
+  guint32 screen, mult;
+  guint32 t, s;
+  guint16 *dest  = (guint16*)pixelrow_data (dest_row);
+  guint16 *src1  = (guint16*)pixelrow_data (src1_row);
+  guint16 *src2  = (guint16*)pixelrow_data (src2_row);
+  gint    width  = MIN(pixelrow_width (dest_row),pixelrow_width (src1_row));
+
+  while (width --)
+    {
+      for (b = 0; b < 3; b++)
+	{
+	  screen = 65535 - (INT_MULT_16 (65535 - src1[b], 65535 - src2[b], t));
+	  mult = INT_MULT_16 (src1[b], src2[b], t);
+	  dest[b] = INT_MULT_16 (screen, src1[b], s) + INT_MULT_16 (mult, 65535 - src1[b], t);
+	}
+      dest[3] = MIN (src1[3], src2[3]);
+
+      src1 += 4;
+      src2 += 4;
+      dest += 4;
+    }
+}
+
+
 
 void
 add_row_u16 ( 
@@ -1953,6 +2106,73 @@ combine_inten_a_and_inten_a_row_u16  (
       }
   }
 }
+
+/*  fixed stride variant of the above for RGBA, the affect and
+ *  mask tests are hoisted out of the pixel loop
+ */
+void 
+combine_inten_a_and_inten_a_row_u16_rgba  (
+                                           PixelRow * src1_row,
+                                           PixelRow * src2_row,
+                                           PixelRow * dest_row,
+                                           PixelRow * mask_row,
+                                           gfloat opacity,
+                                           int * affect,
+                                           int mode_affect
+                                           )
+{
+  gint b;
+  guint16 src2_alpha;
+  guint16 new_alpha;
+  guint16 mask_val;
+  float ratio, compl_ratio;
+  guint32 t;
+  guint16 *src1         = (guint16*)pixelrow_data (src1_row);
+  guint16 *src2         = (guint16*)pixelrow_data (src2_row);
+  guint16 *dest         = (guint16*)pixelrow_data (dest_row);
+  guint16 *m            = (guint16*)pixelrow_data (mask_row);
+  gint    mask_step     = m ? 1 : 0;
+  gint    width         = pixelrow_width (src1_row);
+  guint16 opac = opacity * 65535;
+  gint    aff[4];
+
+  for (b = 0; b < 4; b++)
+    aff[b] = affect[b] ? TRUE : FALSE;
+  if (!m)
+    m = &no_mask;
+
+  while (width --)
+    {
+      mask_val = INT_MULT_16 (*m, opac, t);
+      src2_alpha = INT_MULT_16 (src2[3], mask_val, t);
+      new_alpha = src1[3] + INT_MULT_16 (65535 - src1[3], src2_alpha, t);
+
+      if (new_alpha == 0 || src2_alpha == 0)
+	{
+	  for (b = 0; b < 3; b++)
+	    dest[b] = src1[b];
+	}
+      else
+	{
+	  ratio = (float) src2_alpha / new_alpha;
+	  compl_ratio = 1.0 - ratio;
+	  for (b = 0; b < 3; b++)
+	    dest[b] = aff[b] ?
+	      (guint16) (src2[b] * ratio + src1[b] * compl_ratio + EPSILON) : src1[b];
+	}
+
+      if (mode_affect)
+	dest[3] = aff[3] ? new_alpha : src1[3];
+      else
+	dest[3] = (src1[3] || !aff[3]) ? src1[3] : new_alpha;
+
+      m += mask_step;
+      src1 += 4;
+      src2 += 4;
+      dest += 4;
+    }
+}
+
 #undef alphify
 
 
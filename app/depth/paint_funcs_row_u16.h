@@ -142,6 +142,48 @@ overlay_row_u16 (
 		   PixelRow *dest_row
 		   );
 
+void
+multiply_row_u16_rgb (
+		PixelRow *src1_row,
+		PixelRow *src2_row,
+		PixelRow *dest_row
+		);
+
+void
+multiply_row_u16_rgba (
+		PixelRow *src1_row,
+		PixelRow *src2_row,
+		PixelRow *dest_row
+		);
+
+void
+screen_row_u16_rgb (
+		PixelRow *src1_row,
+		PixelRow *src2_row,
+		PixelRow *dest_row
+		);
+
+void
+screen_row_u16_rgba (
+		PixelRow *src1_row,
+		PixelRow *src2_row,
+		PixelRow *dest_row
+		);
+
+void
+overlay_row_u16_rgb (
+		PixelRow *src1_row,
+		PixelRow *src2_row,
+		PixelRow *dest_row
+		);
+
+void
+overlay_row_u16_rgba (
+		PixelRow *src1_row,
+		PixelRow *src2_row,
+		PixelRow *dest_row
+		);
+
 void
 add_row_u16 ( 
 	       PixelRow *src1_row,
@@ -413,6 +455,17 @@ combine_inten_a_and_inten_a_row_u16 (
 					gint       mode_affect
 					);
 
+void
+combine_inten_a_and_inten_a_row_u16_rgba (
+					PixelRow *src1_row,
+					PixelRow *src2_row,
+					PixelRow *dest_row,
+					PixelRow *mask_row,
+					gfloat opac,
+					gint      *affect,
+					gint       mode_affect
+					);
+
 /*  combine a channel with intensity-alpha pixels based
  *  on some opacity, and a channel color...
  *  destination is intensity-alpha
@@ -54,6 +54,13 @@ static void gimp_drawable_destroy    (GtkObject		*object);
 
 static gint drawable_signals[LAST_SIGNAL] = { 0 };
 
+static void drawable_preview_base_update (CanvasDrawable *);
+static gint drawable_preview_idle        (gpointer);
+
+/* drawables whose preview base is refreshed when the ui is idle */
+static GSList *preview_pending = NULL;
+static guint   preview_idle = 0;
+
 static CanvasDrawableClass *parent_class = NULL;
 
 guint
@@ -314,7 +321,8 @@ drawable_update  (
   gdisplays_update_area (gimage->ID, x, y, w, h);
 
   /*  invalidate the preview  */
-  drawable_invalidate_preview (drawable);
+  drawable_invalidate_preview_area (drawable,
+                                    x - offset_x, y - offset_y, w, h);
 }
 
 
@@ -357,13 +365,59 @@ void
 drawable_invalidate_preview  (
                               CanvasDrawable * drawable
                               )
+{
+  g_return_if_fail (drawable != NULL);
+
+  drawable_invalidate_preview_area (drawable, 0, 0,
+                                    drawable_width (drawable),
+                                    drawable_height (drawable));
+}
+
+
+void 
+drawable_invalidate_preview_area  (
+                                   CanvasDrawable * drawable,
+                                   int x,
+                                   int y,
+                                   int w,
+                                   int h
+                                   )
 {
   GImage *gimage;
+  int x1, y1, x2, y2;
 
   g_return_if_fail (drawable != NULL);
 
   drawable->preview_valid = FALSE;
 
+  /*  remember which part of the preview base went stale  */
+  x1 = BOUNDS (x, 0, drawable_width (drawable));
+  y1 = BOUNDS (y, 0, drawable_height (drawable));
+  x2 = BOUNDS (x + w, 0, drawable_width (drawable));
+  y2 = BOUNDS (y + h, 0, drawable_height (drawable));
+
+  if (x1 < x2 && y1 < y2)
+    {
+      if (drawable->preview_dirty_x1 < drawable->preview_dirty_x2)
+        {
+          x1 = MIN (x1, drawable->preview_dirty_x1);
+          y1 = MIN (y1, drawable->preview_dirty_y1);
+          x2 = MAX (x2, drawable->preview_dirty_x2);
+          y2 = MAX (y2, drawable->preview_dirty_y2);
+        }
+      drawable->preview_dirty_x1 = x1;
+      drawable->preview_dirty_y1 = y1;
+      drawable->preview_dirty_x2 = x2;
+      drawable->preview_dirty_y2 = y2;
+
+      if (drawable->preview_base && !g_slist_find (preview_pending, drawable))
+        {
+          preview_pending = g_slist_append (preview_pending, drawable);
+          if (!preview_idle)
+            preview_idle = gtk_idle_add (drawable_preview_idle, NULL);
+        }
+    }
+
   gtk_signal_emit (GTK_OBJECT(drawable), drawable_signals[INVALIDATE_PREVIEW]);
 
   gimage = drawable_gimage (drawable);
@@ -591,6 +645,140 @@ drawable_channel    (CanvasDrawable *drawable)
     return NULL;
 }
 
+/*  previews are scaled from a base copy of the drawable reduced by a
+ *  power of two, so a preview of any size is cheap once the base exists.
+ *  only the stale part of the base is rebuilt after an update.
+ */
+#define PREVIEW_BASE_SIZE 256
+
+static void
+drawable_preview_base_update (CanvasDrawable *drawable)
+{
+  PixelArea srcPR, destPR;
+  Tag tag = drawable_tag (drawable);
+  int width = drawable_width (drawable);
+  int height = drawable_height (drawable);
+  int shift = 0;
+  int bw, bh;
+  int x1, y1, x2, y2;
+
+  while ((width >> shift) > PREVIEW_BASE_SIZE ||
+         (height >> shift) > PREVIEW_BASE_SIZE)
+    shift++;
+
+  bw = MAX ((width + (1 << shift) - 1) >> shift, 1);
+  bh = MAX ((height + (1 << shift) - 1) >> shift, 1);
+
+  /*  start over if the drawable was resized or converted  */
+  if (! drawable->preview_base ||
+      drawable->preview_shift != shift ||
+      canvas_width (drawable->preview_base) != bw ||
+      canvas_height (drawable->preview_base) != bh ||
+      ! tag_equal (canvas_tag (drawable->preview_base), tag))
+    {
+      if (drawable->preview_base)
+        canvas_delete (drawable->preview_base);
+      drawable->preview_base = canvas_new (tag, bw, bh, STORAGE_FLAT);
+      drawable->preview_shift = shift;
+      drawable->preview_dirty_x1 = 0;
+      drawable->preview_dirty_y1 = 0;
+      drawable->preview_dirty_x2 = width;
+      drawable->preview_dirty_y2 = height;
+    }
+
+  if (drawable->preview_dirty_x1 >= drawable->preview_dirty_x2 ||
+      drawable->preview_dirty_y1 >= drawable->preview_dirty_y2)
+    return;
+
+  x1 = drawable->preview_dirty_x1 >> shift;
+  y1 = drawable->preview_dirty_y1 >> shift;
+  x2 = MIN ((drawable->preview_dirty_x2 + (1 << shift) - 1) >> shift, bw);
+  y2 = MIN ((drawable->preview_dirty_y2 + (1 << shift) - 1) >> shift, bh);
+
+  drawable->preview_dirty_x1 = drawable->preview_dirty_x2 = 0;
+  drawable->preview_dirty_y1 = drawable->preview_dirty_y2 = 0;
+
+  pixelarea_init (&srcPR, drawable->tiles,
+                  x1 << shift, y1 << shift,
+                  MIN (x2 << shift, width) - (x1 << shift),
+                  MIN (y2 << shift, height) - (y1 << shift),
+                  FALSE);
+  pixelarea_init (&destPR, drawable->preview_base,
+                  x1, y1,
+                  x2 - x1, y2 - y1,
+                  TRUE);
+
+  if (shift)
+    scale_area_no_resample (&srcPR, &destPR);
+  else
+    copy_area (&srcPR, &destPR);
+}
+
+static gint
+drawable_preview_idle (gpointer data)
+{
+  CanvasDrawable *drawable;
+
+  if (preview_pending)
+    {
+      drawable = (CanvasDrawable *) preview_pending->data;
+      preview_pending = g_slist_remove (preview_pending, drawable);
+      if (drawable->tiles)
+        drawable_preview_base_update (drawable);
+    }
+
+  if (preview_pending)
+    return TRUE;
+
+  preview_idle = 0;
+  return FALSE;
+}
+
+Canvas *
+drawable_preview (CanvasDrawable *drawable,
+                  Tag tag,
+                  int w,
+                  int h)
+{
+  g_return_val_if_fail (drawable != NULL, NULL);
+
+  if (w < 1) w = 1;
+  if (h < 1) h = 1;
+
+  if (! (drawable->preview_valid &&
+         canvas_width (drawable->preview) == w &&
+         canvas_height (drawable->preview) == h &&
+         tag_equal (canvas_tag (drawable->preview), tag)))
+    {
+      PixelArea srcPR, destPR;
+      Canvas * preview_buf;
+
+      drawable_preview_base_update (drawable);
+
+      preview_buf = canvas_new (tag, w, h, STORAGE_FLAT);
+
+      pixelarea_init (&srcPR, drawable->preview_base,
+                      0, 0,
+                      0, 0,
+                      FALSE);
+
+      pixelarea_init (&destPR, preview_buf,
+                      0, 0,
+                      0, 0,
+                      TRUE);
+
+      scale_area_no_resample (&srcPR, &destPR);
+
+      if (drawable->preview)
+	canvas_delete (drawable->preview);
+
+      drawable->preview = preview_buf;
+      drawable->preview_valid = TRUE;
+    }
+
+  return drawable->preview;
+}
+
 void
 drawable_deallocate (CanvasDrawable *drawable)
 {
@@ -611,6 +799,10 @@ gimp_drawable_init (CanvasDrawable *drawable)
   drawable->gimage_ID = -1;
   drawable->preview = NULL;
   drawable->preview_valid = FALSE;
+  drawable->preview_base = NULL;
+  drawable->preview_shift = 0;
+  drawable->preview_dirty_x1 = drawable->preview_dirty_x2 = 0;
+  drawable->preview_dirty_y1 = drawable->preview_dirty_y2 = 0;
 
   drawable->ID = global_drawable_ID++;
   if (drawable_table == NULL)
@@ -643,6 +835,11 @@ gimp_drawable_destroy (GtkObject *object)
     canvas_delete (drawable->preview);
   drawable->preview = NULL;
 
+  if (drawable->preview_base)
+    canvas_delete (drawable->preview_base);
+  drawable->preview_base = NULL;
+  preview_pending = g_slist_remove (preview_pending, drawable);
+
   if (GTK_OBJECT_CLASS (parent_class)->destroy)
     (*GTK_OBJECT_CLASS (parent_class)->destroy) (object);
 }
@@ -683,5 +880,9 @@ gimp_drawable_configure  (
   /*  preview variables  */
   drawable->preview = NULL;
   drawable->preview_valid = FALSE;
+  drawable->preview_dirty_x1 = 0;
+  drawable->preview_dirty_y1 = 0;
+  drawable->preview_dirty_x2 = width;
+  drawable->preview_dirty_y2 = height;
 }
   
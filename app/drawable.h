@@ -48,6 +48,10 @@ void             drawable_update             (CanvasDrawable *,
 int              drawable_mask_bounds        (CanvasDrawable *,
 					      int *, int *, int *, int *);
 void             drawable_invalidate_preview (CanvasDrawable *);
+void             drawable_invalidate_preview_area (CanvasDrawable *,
+					      int, int, int, int);
+Canvas *         drawable_preview            (CanvasDrawable *, Tag,
+					      int, int);
 int              drawable_dirty              (CanvasDrawable *);
 int              drawable_clean              (CanvasDrawable *);
 int              drawable_has_alpha          (CanvasDrawable *);
@@ -88,6 +92,11 @@ struct CanvasDrawable
 
   Canvas *preview;		/* preview of the channel */
   int preview_valid;			/* is the preview valid? */
+
+  Canvas *preview_base;		/* reduced copy previews are scaled from */
+  int preview_shift;			/* base is 1/2^shift of the drawable */
+  int preview_dirty_x1, preview_dirty_y1; /* stale part of the base */
+  int preview_dirty_x2, preview_dirty_y2;
 };
 
 struct CanvasDrawableClass
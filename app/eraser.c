@@ -151,6 +151,7 @@ tools_new_eraser ()
   private = (PaintCore *) tool->private;
   private->paint_func = (PaintFunc16) eraser_paint_func;
   private->painthit_setup = eraser_painthit_setup;
+  private->batch = TRUE;
 
   return tool;
 }
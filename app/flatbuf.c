@@ -29,6 +29,7 @@ struct FlatBuf
 
   int      is_alloced;
   int      ref_count;
+  guint    serial;
   guchar *   data;
 
   int      bytes;
@@ -55,6 +56,7 @@ flatbuf_new (
   
   f->is_alloced = FALSE;
   f->ref_count = 0;
+  f->serial = 0;
   f->data = NULL;
 
   f->bytes = tag_bytes (tag);
@@ -210,6 +212,7 @@ flatbuf_portion_refrw  (
       if (f->is_alloced == TRUE)
         {
           f->ref_count++;
+          f->serial = canvas_serial_next ();
           rc = REFRC_OK;
         }
     }
@@ -355,6 +358,7 @@ flatbuf_portion_alloc  (
             {
               memset (f->data, 0, n);
               f->is_alloced = TRUE;
+              f->serial = canvas_serial_next ();
               if (canvas_portion_init (f->canvas,
                                        0, 0,
                                        f->width, f->height) != TRUE)
@@ -369,6 +373,19 @@ flatbuf_portion_alloc  (
 }
 
 
+guint 
+flatbuf_portion_serial  (
+                         FlatBuf * f,
+                         int x,
+                         int y
+                         )
+{
+  if (f && (x < f->width) && (y < f->height))
+    return f->serial;
+  return 0;
+}
+
+
 guint 
 flatbuf_portion_unalloc  (
                           FlatBuf * f,
@@ -387,6 +404,7 @@ flatbuf_portion_unalloc  (
 	     g_free (f->data);
           f->data = NULL;
           f->is_alloced = FALSE;
+          f->serial = canvas_serial_next ();
           return TRUE;
         }
     }
@@ -55,5 +55,6 @@ guint          flatbuf_portion_unalloc   (FlatBuf *, int x, int y);
 RefRC          flatbuf_portion_refro     (FlatBuf *, int x, int y);
 RefRC          flatbuf_portion_refrw     (FlatBuf *, int x, int y);
 RefRC          flatbuf_portion_unref     (FlatBuf *, int x, int y);
+guint          flatbuf_portion_serial    (FlatBuf *, int x, int y);
 
 #endif /* __FLATBUF_H__ */
@@ -16,6 +16,7 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "config.h"
 #include "libgimp/gimpintl.h"
@@ -25,6 +26,7 @@
 #include "draw_core.h"
 #include "drawable.h"
 #include "edit_selection.h"
+#include "depth/bfp.h"
 #include "depth/float16.h"
 #include "fuzzy_select.h"
 #include "gimage_mask.h"
@@ -38,104 +40,124 @@
 
 /* ------------------------------------------------------------
   
-      prototype of a generalized PixelArea control structure
-             with a sample seed-fill application
+        span based seed fill with a per-tile distance cache
   
   ------------------------------------------------------------ */
 
-/* a bounding box */
+/* the seed fill walks horizontal spans with an explicit stack.  the
+   distance of every pixel to the seed color is computed once per
+   source tile, as a float in 0..1 regardless of precision, so the
+   walk itself is precision neutral and a change of threshold only
+   needs a new walk over the cached distances */
 
-typedef struct BBox BBox;
-struct BBox
-{
-  gint x, y, w, h;
-};
+typedef struct SeedFill SeedFill;
+typedef struct FillSpan FillSpan;
+typedef struct FillTile FillTile;
+typedef struct FillPin FillPin;
 
+/* turn a row of pixels into distances from the seed color */
+typedef void (*FillDistFunc) (guchar *, guchar *, gfloat *, gint, gint);
 
 
-/* a range of pixels in a row */
-
-typedef struct Segment Segment;
-struct Segment
+/* a range of pixels in a row which may need filling */
+struct FillSpan
 {
-  guint start;
-  guint end;
-  Segment * next;
+  gint x1, x2;
+  gint y;
 };
 
-static Segment * segment_new    (guint start, guint end, Segment * next);
-static void      segment_delete (Segment * s);
-static void      segment_add    (Segment ** s, guint start, guint end);
-static void      segment_del    (Segment ** s, guint start, guint end);
-
 
+/* cached state for one portion of the source canvas */
+struct FillTile
+{
+  /* distance to the seed color, tile_w pixels per row */
+  gfloat * dist;
 
-/* a generalized PixelArea control structure */
+  /* pixels already claimed by the current walk */
+  guint8 * done;
 
-typedef struct PixelIter PixelIter;
+  /* the walk that last cleared done */
+  guint run;
+};
 
-/* an image area operation.  it may be precision neutral or not */
-typedef guint (*PIFunc) (PixelIter * p);
 
-/* the data block for the control structure */
-struct PixelIter
+/* a destination mask portion that stays reffed during a walk */
+struct FillPin
 {
-  /* the image on which to operate */
-  Canvas * image;
-
-  /* automatic canvas portion ref: none, RO, RW */
-  guint reftype;
-  
-  /* the bounding box of the whole area */
-  BBox area; 
-  
-  /* the bounding box of the current chunk */
-  BBox chunk;
-  
-  /* user callback to invoke */
-  PIFunc callback;
-
-  /* user data */
-  void * data;
-
-  /* pixel to do list */
-  Segment ** todo;  
+  guchar * data;
+  guint rowstride;
 };
 
-/* public methods */
-PixelIter *  pixeliter_new       (void);
-void         pixeliter_delete    (PixelIter *);
-guint        pixeliter_init      (PixelIter * p, Canvas * c,
-                                  PIFunc callback, void * userdata,
-                                  guint x, guint y, guint w, guint h,
-                                  guint reftype);
-guint        pixeliter_process   (PixelIter *);
-guint        pixeliter_get_work  (PixelIter *, gint *, gint *);
-void         pixeliter_add_work  (PixelIter *, gint, gint, gint, gint);
-void         pixeliter_del_work  (PixelIter *, gint, gint, gint, gint);
 
-/* private methods */
-static guint pixeliter_choose_chunk (PixelIter *);
-static guint pixeliter_first        (PixelIter *, BBox *, guint *, guint *);
+struct SeedFill
+{
+  /* the image to sample and its portion grid */
+  Canvas * src;
+  gint width, height;
+  gint tile_w, tile_h;
+  gint cols, rows;
+  FillTile * tiles;
+
+  /* the seed point and its color */
+  gint x, y;
+  guint seeded;
+  guchar color[TAG_MAX_BYTES];
+  gint channels;
+  FillDistFunc dist_row;
+
+  /* parms of the current walk */
+  guint run;
+  gfloat threshold;
+  gfloat limit;
+  guint antialias;
 
-/* types of refs for pixeliter_init */
-#define REF_NONE 0
-#define REF_RO   1
-#define REF_RW   2
+  /* the mask being filled and its pinned portions */
+  Canvas * mask;
+  gint mask_bytes;
+  gint mtile_w, mtile_h;
+  gint mcols, mrows;
+  FillPin * pins;
+
+  /* distances of the span being stored */
+  gfloat * row;
+
+  /* spans waiting to be examined */
+  FillSpan * stack;
+  gint stack_size;
+  gint stack_count;
+};
 
+static SeedFill * seed_fill_new    (GImage *, CanvasDrawable *, int, int, int);
+static void       seed_fill_delete (SeedFill *);
+static Channel *  seed_fill_region (SeedFill *, GImage *, int, gfloat);
 
+static void       seed_fill_run        (SeedFill *);
+static FillTile * seed_fill_tile       (SeedFill *, gint, gint);
+static FillPin *  seed_fill_pin        (SeedFill *, gint, gint);
+static void       seed_fill_unpin      (SeedFill *);
+static void       seed_fill_push       (SeedFill *, gint, gint, gint);
+static gint       seed_fill_scan_right (SeedFill *, gint, gint, gint, guint);
+static gint       seed_fill_scan_left  (SeedFill *, gint, gint, gint, guint);
+static void       seed_fill_span       (SeedFill *, gint, gint, gint);
+static void       seed_fill_store      (SeedFill *, guchar *, gfloat *, gint);
 
+static void seed_fill_dist_u8      (guchar *, guchar *, gfloat *, gint, gint);
+static void seed_fill_dist_u16     (guchar *, guchar *, gfloat *, gint, gint);
+static void seed_fill_dist_float   (guchar *, guchar *, gfloat *, gint, gint);
+static void seed_fill_dist_float16 (guchar *, guchar *, gfloat *, gint, gint);
+static void seed_fill_dist_bfp     (guchar *, guchar *, gfloat *, gint, gint);
 
+/* is this distance inside the current threshold */
+#define FILL_INSIDE(f,d) \
+   ((f)->antialias ? ((d) < (f)->limit) : ((d) <= (f)->limit))
 
+/* may this pixel still be claimed by the current walk */
+#define FILL_WANTED(f,d,dn) \
+   ((!(dn) && FILL_INSIDE (f, d)) ? TRUE : FALSE)
 
 
 
 typedef struct FuzzyOptions FuzzyOptions;
-typedef struct SeedFillData SeedFillData;
-
-/* the precision-specific kernel for the seed fill */
-typedef guint (*SFFunc) (PixelIter * p, SeedFillData * d);
-
 
 struct FuzzyOptions
 {
@@ -147,37 +169,10 @@ struct FuzzyOptions
   gfloat         threshold;    /*  threshold value for soft seed fill     */
 
   int            op;           /*  selection operation (ADD, SUB, etc)     */
-};
-
 
-struct SeedFillData
-{
-  /* the specific kernel to use */
-  SFFunc kernel;
-  
-  /* fill this with the contiguous area */
-  Canvas * mask;
-
-  /* the threshold */
-  gfloat threshold;
-
-  /* should we antialias */
-  guint antialias;
-
-  /* the color to match */
-  PixelRow color;
-  
-  /* size of existing scratch space */
-  guint x_w, x_h;
-
-  /* temp copy of mask for this chunk */
-  Canvas * x_mask;
-
-  /* the output of absdiff for this chunk */
-  Canvas * x_diff;
+  SeedFill *     fill;         /*  distance cache while the tool is active */
 };
 
-
 /*  fuzzy select action functions  */
 
 static void   fuzzy_select_button_press   (Tool *, GdkEventButton *, gpointer);
@@ -200,19 +195,6 @@ static SelectionOptions *fuzzy_selection_options = NULL;
 static void fuzzy_select (GImage *, CanvasDrawable *, int, int, double);
 static Argument *fuzzy_select_invoker (Argument *);
 
-
-/* seed fill kernel */
-
-static guint seed_fill        (PixelIter * p);
-static guint seed_fill_alloc  (PixelIter * p, SeedFillData * d);
-static void  seed_fill_free   (SeedFillData * d);
-static guint seed_fill_u8     (PixelIter * p, SeedFillData * d);
-static guint seed_fill_u16    (PixelIter * p, SeedFillData * d);
-static guint seed_fill_float  (PixelIter * p, SeedFillData * d);
-static guint seed_fill_float16  (PixelIter * p, SeedFillData * d);
-static guint seed_fill_bfp  (PixelIter * p, SeedFillData * d);
-
-
 /*************************************/
 /*  Fuzzy selection apparatus  */
 
@@ -227,595 +209,662 @@ find_contiguous_region  (
                          int sample_merged
                          )
 {
+  SeedFill * f;
   Channel * mask;
-  Canvas * s;
 
+  f = seed_fill_new (gimage, drawable, x, y, sample_merged);
+  mask = seed_fill_region (f, gimage, antialias, threshold);
+  seed_fill_delete (f);
+
+  return mask;
+}
+
+
+/* set up a seed fill at x,y.  the distance cache starts empty and is
+   filled in as walks reach new tiles */
+static SeedFill *
+seed_fill_new (
+               GImage * gimage,
+               CanvasDrawable * drawable,
+               int x,
+               int y,
+               int sample_merged
+               )
+{
+  SeedFill * f;
+  Canvas * s;
+  Tag tag;
+  
   /* use either the current layer or the composite */
   s = (sample_merged)
     ? gimage_projection (gimage)
     : drawable_data (drawable);
 
-  /* create a new mask */
-  mask = channel_new_mask (gimage->ID,
-                           canvas_width (s), canvas_height (s),
-                           tag_precision (canvas_tag (s)));
+  tag = canvas_tag (s);
+  
+  f = (SeedFill *) g_malloc_zero (sizeof (SeedFill));
+
+  f->src = s;
+  f->width = canvas_width (s);
+  f->height = canvas_height (s);
+  f->tile_w = canvas_portion_width (s, 0, 0);
+  f->tile_h = canvas_portion_height (s, 0, 0);
+  f->cols = (f->width + f->tile_w - 1) / f->tile_w;
+  f->rows = (f->height + f->tile_h - 1) / f->tile_h;
+  f->tiles = g_new0 (FillTile, f->cols * f->rows);
+  f->channels = tag_num_channels (tag);
+  f->x = x;
+  f->y = y;
+
+  /* choose the right distance function */
+  switch (tag_precision (tag))
+    {
+    case PRECISION_U8:
+      f->dist_row = seed_fill_dist_u8;
+      break;
+    case PRECISION_U16:
+      f->dist_row = seed_fill_dist_u16;
+      break;
+    case PRECISION_FLOAT:
+      f->dist_row = seed_fill_dist_float;
+      break;
+    case PRECISION_FLOAT16:
+      f->dist_row = seed_fill_dist_float16;
+      break;
+    case PRECISION_BFP:
+      f->dist_row = seed_fill_dist_bfp;
+      break;
+    case PRECISION_NONE:
+    default:
+      f->dist_row = NULL;
+    }
 
-  /* if the image refs okay, do a seed fill */
-  if (canvas_portion_refro (s, x, y) == REFRC_OK)
+  /* grab the color to match */
+  if ((f->dist_row != NULL) &&
+      (x >= 0) && (x < f->width) &&
+      (y >= 0) && (y < f->height) &&
+      (canvas_portion_refro (s, x, y) == REFRC_OK))
     {
-      SeedFillData data;
-      PixelIter * p;
-      
-      /* choose the right kernel */
-      switch (tag_precision (canvas_tag (s)))
-        {
-        case PRECISION_U8:
-          data.kernel = seed_fill_u8;
-          break;
-        case PRECISION_U16:
-          data.kernel = seed_fill_u16;
-          break;
-        case PRECISION_FLOAT:
-          data.kernel = seed_fill_float;
-          break;
-        case PRECISION_FLOAT16:
-          data.kernel = seed_fill_float16;
-          break;
-        case PRECISION_BFP:
-          data.kernel = seed_fill_bfp;
-          break;
-        case PRECISION_NONE:
-        default:
-          data.kernel = NULL;
-        }
+      memcpy (f->color, canvas_portion_data (s, x, y), tag_bytes (tag));
+      canvas_portion_unref (s, x, y);
+      f->seeded = TRUE;
+    }
 
-      /* init the seed fill parms */
-      data.mask = drawable_data (GIMP_DRAWABLE(mask));
-      data.threshold = threshold ? threshold : 0.000001;
-      data.antialias = antialias;
-      pixelrow_init (&data.color,
-                     canvas_tag (s),
-                     canvas_portion_data (s, x, y),
-                     1);
-        
-      /* init the scratch space too */
-      data.x_w = 0;
-      data.x_h = 0;
-      data.x_mask = NULL;
-      data.x_diff = NULL;
-      
-      /* set up a processor for the seed fill */
-      p = pixeliter_new ();
-      
-      if (pixeliter_init (p, s,
-                          seed_fill, &data,
-                          0, 0,
-                          0, 0,
-                          REF_RO))
-        {
-          /* mark the initial click point for processing */
-          pixeliter_add_work (p, x, y, 1, 1);
+  f->row = g_new (gfloat, f->width);
 
-          /* at this point, the seed fill operation could be queued
-             for execution.  a smart scheduler could optimize the
-             execution of the seed fill.  since no such mechanism
-             exists, do the work immediately */
-          while (pixeliter_process (p));
+  return f;
+}
 
-        }
 
-      /* clean up */
-      pixeliter_delete (p);
-      seed_fill_free (&data);
+static void
+seed_fill_delete (
+                  SeedFill * f
+                  )
+{
+  gint i;
+
+  g_return_if_fail (f != NULL);
 
-      /* unref the canvas */
-      canvas_portion_unref (s, x, y);
+  for (i = 0; i < f->cols * f->rows; i++)
+    {
+      g_free (f->tiles[i].dist);
+      g_free (f->tiles[i].done);
+    }
+
+  g_free (f->tiles);
+  g_free (f->row);
+  g_free (f->stack);
+  g_free (f);
+}
+
+
+/* walk the fill with the given threshold and return the result as a
+   new mask */
+static Channel *
+seed_fill_region (
+                  SeedFill * f,
+                  GImage * gimage,
+                  int antialias,
+                  gfloat threshold
+                  )
+{
+  Channel * mask;
+
+  /* create a new mask */
+  mask = channel_new_mask (gimage->ID,
+                           f->width, f->height,
+                           tag_precision (canvas_tag (f->src)));
+
+  if (f->seeded)
+    {
+      f->mask = drawable_data (GIMP_DRAWABLE(mask));
+      f->mask_bytes = tag_bytes (canvas_tag (f->mask));
+      f->mtile_w = canvas_portion_width (f->mask, 0, 0);
+      f->mtile_h = canvas_portion_height (f->mask, 0, 0);
+      f->mcols = (f->width + f->mtile_w - 1) / f->mtile_w;
+      f->mrows = (f->height + f->mtile_h - 1) / f->mtile_h;
+      f->pins = g_new0 (FillPin, f->mcols * f->mrows);
+
+      f->threshold = threshold ? threshold : 0.000001;
+      f->antialias = antialias;
+      f->limit = (antialias) ? f->threshold * 1.5 : f->threshold;
+
+      seed_fill_run (f);
+
+      /* let go of the mask */
+      seed_fill_unpin (f);
+      g_free (f->pins);
+      f->pins = NULL;
+      f->mask = NULL;
     }
 
-  /* we don;t know the bounds anymore */
+  /* we don't know the bounds anymore */
   channel_invalidate_bounds (mask);
   
   return mask;
 }
 
-static guint 
-seed_fill  (
-            PixelIter * p
-            )
+
+static void
+seed_fill_run (
+               SeedFill * f
+               )
 {
-  PixelArea src, dst;
-  SeedFillData * d;
+  FillSpan s;
   
-  /* abort the entire operation if things get weird */
-  g_return_val_if_fail (p != NULL, FALSE);
-  d = (SeedFillData *) p->data;
-  g_return_val_if_fail (d != NULL, FALSE);
-  g_return_val_if_fail (d->kernel != NULL, FALSE);
+  /* a new walk sees every pixel as unclaimed */
+  f->run++;
+  f->stack_count = 0;
   
-  /* realloc scratch space */
-  if (seed_fill_alloc (p, d) != TRUE)
-    return FALSE;
+  seed_fill_push (f, f->x, f->x, f->y);
   
-  /* copy in part of the existing mask into our scratch pad */
-  pixelarea_init (&src, d->mask,
-                  p->chunk.x, p->chunk.y,
-                  p->chunk.w, p->chunk.h,
-                  FALSE);    
-  pixelarea_init (&dst, d->x_mask,
-                  0, 0,
-                  0, 0,
-                  TRUE);
-  copy_area (&src, &dst);
-
-  /* create the sufficiently_different map */
-  pixelarea_init (&src, p->image,
-                  p->chunk.x, p->chunk.y,
-                  p->chunk.w, p->chunk.h,
-                  FALSE);    
-  pixelarea_init (&dst, d->x_diff,
-                  0, 0,
-                  0, 0,
-                  TRUE);
-  absdiff_area (&src, &dst, &d->color, d->threshold, d->antialias);
-
-  /* process the chunk and save any modifications to the real mask */
-  if (d->kernel (p, d) == TRUE)
+  while (f->stack_count > 0)
     {
-      pixelarea_init (&src, d->x_mask,
-                      0, 0,
-                      0, 0,
-                      FALSE);
-      pixelarea_init (&dst, d->mask,
-                      p->chunk.x, p->chunk.y,
-                      p->chunk.w, p->chunk.h,
-                      TRUE);    
-      copy_area (&src, &dst);
-    }
+      gint x, l, r;
+      
+      s = f->stack[--f->stack_count];
+      x = s.x1;
 
-  /* we want to be called again */
-  return TRUE;
+      while (x <= s.x2)
+        {
+          /* find the next claimable pixel in the span */
+          x = seed_fill_scan_right (f, x, s.x2, s.y, TRUE);
+          if (x > s.x2)
+            break;
+
+          /* grow it into the widest run on this row */
+          l = seed_fill_scan_left (f, x, 0, s.y, FALSE) + 1;
+          r = seed_fill_scan_right (f, x, f->width - 1, s.y, FALSE) - 1;
+
+          seed_fill_span (f, l, r, s.y);
+
+          /* and look above and below it */
+          if (s.y > 0)
+            seed_fill_push (f, l, r, s.y - 1);
+          if (s.y < f->height - 1)
+            seed_fill_push (f, l, r, s.y + 1);
+
+          x = r + 1;
+        }
+    }
 }
 
 
-/* allocate scratch space for use while calculating contiguous mask */
-static guint 
-seed_fill_alloc  (
-                  PixelIter * p,
-                  SeedFillData * d
-                  )
+static void
+seed_fill_push (
+                SeedFill * f,
+                gint x1,
+                gint x2,
+                gint y
+                )
 {
-  /* see if the old stuff is the right size */
-  if ((p->chunk.w == CAST(int) d->x_w) &&
-      (p->chunk.h == CAST(int) d->x_h) &&
-      (d->x_mask) && (d->x_diff))
+  if (f->stack_count == f->stack_size)
     {
-      return TRUE;
+      f->stack_size = (f->stack_size) ? f->stack_size * 2 : 256;
+      f->stack = g_renew (FillSpan, f->stack, f->stack_size);
     }
 
-  /* blow away the old stuff */
-  seed_fill_free (d);
+  f->stack[f->stack_count].x1 = x1;
+  f->stack[f->stack_count].x2 = x2;
+  f->stack[f->stack_count].y = y;
+  f->stack_count++;
+}
 
-  /* save the new chunk size */
-  d->x_w = p->chunk.w;
-  d->x_h = p->chunk.h;
 
-  /* temporary copy of existing mask */
-  d->x_mask = canvas_new (canvas_tag (d->mask),
-                          d->x_w, d->x_h,
-                          STORAGE_FLAT);
+/* get the cached distances for a source tile, computing them on first
+   use.  the source portion is only reffed while it is converted */
+static FillTile *
+seed_fill_tile (
+                SeedFill * f,
+                gint tx,
+                gint ty
+                )
+{
+  FillTile * t = &f->tiles[ty * f->cols + tx];
+  gint n = f->tile_w * f->tile_h;
 
-  if (canvas_portion_refrw (d->x_mask, 0, 0) != REFRC_OK)
+  if (t->dist == NULL)
     {
-      g_warning ("ooooops");
-      return FALSE;
-    }
-  
+      gint x = tx * f->tile_w;
+      gint y = ty * f->tile_h;
+      gint w = MIN (f->tile_w, f->width - x);
+      gint h = MIN (f->tile_h, f->height - y);
+      guchar * data;
+      guint rowstride;
+      gint i;
+
+      if (canvas_portion_refro (f->src, x, y) != REFRC_OK)
+        return NULL;
+      
+      data = canvas_portion_data (f->src, x, y);
+      rowstride = canvas_portion_rowstride (f->src, x, y);
+
+      t->dist = g_new (gfloat, n);
+      t->done = g_new (guint8, n);
+      t->run = 0;
 
-  /* scratch pad holding abs diff values */
-  d->x_diff = canvas_new (canvas_tag (d->mask),
-                          d->x_w, d->x_h,
-                          STORAGE_FLAT);
+      for (i = 0; i < h; i++)
+        (*f->dist_row) (data + i * rowstride, f->color,
+                        t->dist + i * f->tile_w,
+                        w, f->channels);
+      
+      canvas_portion_unref (f->src, x, y);
+    }
 
-  if (canvas_portion_refrw (d->x_diff, 0, 0) != REFRC_OK)
+  if (t->run != f->run)
     {
-      g_warning ("ooooops2");
-      return FALSE;
+      memset (t->done, 0, n);
+      t->run = f->run;
     }
   
-  return TRUE;
+  return t;
 }
 
 
-/* delete any scratch space that's hanging around */
-static void 
-seed_fill_free  (
-                 SeedFillData * d
-                 )
+/* return the first x in [x, xmax] whose claimability is want, or
+   xmax + 1 if there is none */
+static gint
+seed_fill_scan_right (
+                      SeedFill * f,
+                      gint x,
+                      gint xmax,
+                      gint y,
+                      guint want
+                      )
 {
-  if (d->x_mask)
+  gint tx = x / f->tile_w;
+  gint ty = y / f->tile_h;
+  
+  while (x <= xmax)
     {
-      canvas_portion_unref (d->x_mask, 0, 0);
-      canvas_delete (d->x_mask);
-    }
+      FillTile * t = seed_fill_tile (f, tx, ty);
+      gint x0 = tx * f->tile_w;
+      gint end = MIN (xmax, x0 + f->tile_w - 1);
 
-  if (d->x_diff)
-    {
-      canvas_portion_unref (d->x_diff, 0, 0);
-      canvas_delete (d->x_diff);
+      if (t == NULL)
+        {
+          /* an unreadable tile is never claimable */
+          if (want == FALSE)
+            return x;
+        }
+      else
+        {
+          gint offset = (y - ty * f->tile_h) * f->tile_w - x0;
+          gfloat * dist = t->dist + offset;
+          guint8 * done = t->done + offset;
+
+          for (; x <= end; x++)
+            if (FILL_WANTED (f, dist[x], done[x]) == want)
+              return x;
+        }
+
+      x = end + 1;
+      tx++;
     }
+
+  return x;
 }
 
 
-static guint
-seed_fill_u8 (
-               PixelIter * p,
-               SeedFillData * d
-               )
+/* return the first x in [xmin, x] whose claimability is want, walking
+   leftwards, or xmin - 1 if there is none */
+static gint
+seed_fill_scan_left (
+                     SeedFill * f,
+                     gint x,
+                     gint xmin,
+                     gint y,
+                     guint want
+                     )
 {
-  guint changed = FALSE;
-  guint x, y;
+  gint tx = x / f->tile_w;
+  gint ty = y / f->tile_h;
   
-  /* get pixels in this chunk which need attention */
-  while (pixeliter_get_work (p, &x, &y))
+  while (x >= xmin)
     {
-      guint8 * dd, * md;
-      int xmin_c, xmax_c;
-
-      /* see if this pixel should be done */
-      dd = (guint8*) canvas_portion_data (d->x_diff, 0, y - p->chunk.y);
-      if (dd[x - p->chunk.x] == 0)
-        continue;
-
-      /* see if this pixel is already done */
-      md = (guint8*) canvas_portion_data (d->x_mask, 0, y - p->chunk.y);
-      if (md[x - p->chunk.x] != 0)
-        continue;
-      
-      /* find contig segment endpoints */
-      for (xmin_c = x - p->chunk.x;
-           (xmin_c >= 0) && (dd[xmin_c] != 0);
-           xmin_c--);
-
-      for (xmax_c = x - p->chunk.x;
-           (xmax_c < p->chunk.w) && (dd[xmax_c] != 0);
-           xmax_c++);
-             
-      /* add work to adjacent chunks if segment reached the edges */
-      if (xmin_c < 0)
+      FillTile * t = seed_fill_tile (f, tx, ty);
+      gint x0 = tx * f->tile_w;
+      gint end = MAX (xmin, x0);
+
+      if (t == NULL)
         {
-          pixeliter_add_work (p,
-                              p->chunk.x - 1, y,
-                              1, 1);
+          if (want == FALSE)
+            return x;
         }
-
-      if (xmax_c == p->chunk.w)
+      else
         {
-          pixeliter_add_work (p,
-                              p->chunk.x + p->chunk.w, y,
-                              1, 1);
+          gint offset = (y - ty * f->tile_h) * f->tile_w - x0;
+          gfloat * dist = t->dist + offset;
+          guint8 * done = t->done + offset;
+
+          for (; x >= end; x--)
+            if (FILL_WANTED (f, dist[x], done[x]) == want)
+              return x;
         }
-      
-      xmin_c++;
-      xmax_c--;
-      
-      /* del work for those pixels */
-      pixeliter_del_work (p,
-                          p->chunk.x + xmin_c, y,
-                          xmax_c - xmin_c + 1, 1);
-
-      /* add work to next and prev rows */
-      pixeliter_add_work (p,
-                          p->chunk.x + xmin_c, y - 1,
-                          xmax_c - xmin_c + 1, 1);
-      
-      pixeliter_add_work (p,
-                          p->chunk.x + xmin_c, y + 1,
-                          xmax_c - xmin_c + 1, 1);
-      
-      /* save those pixels on x_mask */
-      memcpy (&md[xmin_c], &dd[xmin_c], (xmax_c - xmin_c + 1) * sizeof (guint8));
-      changed = TRUE;
+
+      x = end - 1;
+      tx--;
     }
 
-  return changed;
+  return x;
+}
+
+
+/* claim the pixels l..r on row y and write their coverage to the mask */
+static void
+seed_fill_span (
+                SeedFill * f,
+                gint l,
+                gint r,
+                gint y
+                )
+{
+  gint ty = y / f->tile_h;
+  gint x;
+
+  /* mark the source side */
+  for (x = l; x <= r; )
+    {
+      gint tx = x / f->tile_w;
+      FillTile * t = seed_fill_tile (f, tx, ty);
+      gint x0 = tx * f->tile_w;
+      gint end = MIN (r, x0 + f->tile_w - 1);
+      gint offset = (y - ty * f->tile_h) * f->tile_w - x0;
+
+      memset (t->done + offset + x, 1, end - x + 1);
+      memcpy (f->row + x, t->dist + offset + x, (end - x + 1) * sizeof (gfloat));
+      x = end + 1;
+    }
+
+  /* then the mask side, which may be cut up differently */
+  for (x = l; x <= r; )
+    {
+      FillPin * p = seed_fill_pin (f, x, y);
+      gint x0 = (x / f->mtile_w) * f->mtile_w;
+      gint y0 = (y / f->mtile_h) * f->mtile_h;
+      gint end = MIN (r, x0 + f->mtile_w - 1);
+
+      if (p != NULL)
+        seed_fill_store (f,
+                         p->data + (y - y0) * p->rowstride + (x - x0) * f->mask_bytes,
+                         f->row + x,
+                         end - x + 1);
+      x = end + 1;
+    }
 }
 
-static guint
-seed_fill_u16 (
-               PixelIter * p,
-               SeedFillData * d
+
+/* ref the mask portion holding x,y for writing.  it stays reffed until
+   the walk is finished */
+static FillPin *
+seed_fill_pin (
+               SeedFill * f,
+               gint x,
+               gint y
                )
 {
-  guint changed = FALSE;
-  guint x, y;
-  
-  /* get pixels in this chunk which need attention */
-  while (pixeliter_get_work (p, &x, &y))
+  gint tx = x / f->mtile_w;
+  gint ty = y / f->mtile_h;
+  FillPin * p = &f->pins[ty * f->mcols + tx];
+
+  if (p->data == NULL)
     {
-      guint16 * dd, * md;
-      int xmin_c, xmax_c;
-
-      /* see if this pixel should be done */
-      dd = (guint16*) canvas_portion_data (d->x_diff, 0, y - p->chunk.y);
-      if (dd[x - p->chunk.x] == 0)
-        continue;
-
-      /* see if this pixel is already done */
-      md = (guint16*) canvas_portion_data (d->x_mask, 0, y - p->chunk.y);
-      if (md[x - p->chunk.x] != 0)
-        continue;
-      
-      /* find contig segment endpoints */
-      for (xmin_c = x - p->chunk.x;
-           (xmin_c >= 0) && (dd[xmin_c] != 0);
-           xmin_c--);
-
-      for (xmax_c = x - p->chunk.x;
-           (xmax_c < p->chunk.w) && (dd[xmax_c] != 0);
-           xmax_c++);
-             
-      /* add work to adjacent chunks if segment reached the edges */
-      if (xmin_c < 0)
-        {
-          pixeliter_add_work (p,
-                              p->chunk.x - 1, y,
-                              1, 1);
-        }
+      x = tx * f->mtile_w;
+      y = ty * f->mtile_h;
 
-      if (xmax_c == p->chunk.w)
-        {
-          pixeliter_add_work (p,
-                              p->chunk.x + p->chunk.w, y,
-                              1, 1);
-        }
-      
-      xmin_c++;
-      xmax_c--;
-      
-      /* del work for those pixels */
-      pixeliter_del_work (p,
-                          p->chunk.x + xmin_c, y,
-                          xmax_c - xmin_c + 1, 1);
-
-      /* add work to next and prev rows */
-      pixeliter_add_work (p,
-                          p->chunk.x + xmin_c, y - 1,
-                          xmax_c - xmin_c + 1, 1);
-      
-      pixeliter_add_work (p,
-                          p->chunk.x + xmin_c, y + 1,
-                          xmax_c - xmin_c + 1, 1);
-      
-      /* save those pixels on x_mask */
-      memcpy (&md[xmin_c], &dd[xmin_c], (xmax_c - xmin_c + 1) * sizeof (guint16));
-      changed = TRUE;
+      if (canvas_portion_refrw (f->mask, x, y) != REFRC_OK)
+        return NULL;
+
+      p->data = canvas_portion_data (f->mask, x, y);
+      p->rowstride = canvas_portion_rowstride (f->mask, x, y);
     }
 
-  return changed;
+  return p;
+}
+
+
+static void
+seed_fill_unpin (
+                 SeedFill * f
+                 )
+{
+  gint i;
+
+  for (i = 0; i < f->mcols * f->mrows; i++)
+    if (f->pins[i].data != NULL)
+      {
+        canvas_portion_unref (f->mask,
+                              (i % f->mcols) * f->mtile_w,
+                              (i / f->mcols) * f->mtile_h);
+        f->pins[i].data = NULL;
+      }
 }
 
-static guint
-seed_fill_float (
-                 PixelIter * p,
-                 SeedFillData * d
+
+/* convert distances to coverage in the precision of the mask */
+static void
+seed_fill_store (
+                 SeedFill * f,
+                 guchar * dest,
+                 gfloat * dist,
+                 gint width
                  )
 {
-  guint changed = FALSE;
-  guint x, y;
+  Precision p = tag_precision (canvas_tag (f->mask));
+  gint i;
   
-  /* get pixels in this chunk which need attention */
-  while (pixeliter_get_work (p, &x, &y))
+  for (i = 0; i < width; i++)
     {
-      gfloat * dd, * md;
-      int xmin_c, xmax_c;
-
-      /* see if this pixel should be done */
-      dd = (gfloat*) canvas_portion_data (d->x_diff, 0, y - p->chunk.y);
-      if (dd[x - p->chunk.x] == 0)
-        continue;
-
-      /* see if this pixel is already done */
-      md = (gfloat*) canvas_portion_data (d->x_mask, 0, y - p->chunk.y);
-      if (md[x - p->chunk.x] != 0)
-        continue;
+      gfloat c = 1.0;
       
-      /* find contig segment endpoints */
-      for (xmin_c = x - p->chunk.x;
-           (xmin_c >= 0) && (dd[xmin_c] != 0);
-           xmin_c--);
-
-      for (xmax_c = x - p->chunk.x;
-           (xmax_c < p->chunk.w) && (dd[xmax_c] != 0);
-           xmax_c++);
-             
-      /* add work to adjacent chunks if segment reached the edges */
-      if (xmin_c < 0)
+      if (f->antialias)
         {
-          pixeliter_add_work (p,
-                              p->chunk.x - 1, y,
-                              1, 1);
+          gfloat aa = 1.5 - (dist[i] / f->threshold);
+          if (aa <= 0)
+            c = 0;
+          else if (aa < 0.5)
+            c = aa * 2.0;
         }
 
-      if (xmax_c == p->chunk.w)
+      switch (p)
         {
-          pixeliter_add_work (p,
-                              p->chunk.x + p->chunk.w, y,
-                              1, 1);
+        case PRECISION_U8:
+          ((guint8 *) dest)[i] = c * 255;
+          break;
+        case PRECISION_U16:
+          ((guint16 *) dest)[i] = c * 65535;
+          break;
+        case PRECISION_FLOAT:
+          ((gfloat *) dest)[i] = c;
+          break;
+        case PRECISION_FLOAT16:
+          {
+            ShortsFloat u;
+            ((guint16 *) dest)[i] = FLT16 (c, u);
+          }
+          break;
+        case PRECISION_BFP:
+          ((guint16 *) dest)[i] = c * ONE_BFP;
+          break;
+        case PRECISION_NONE:
+        default:
+          break;
         }
-      
-      xmin_c++;
-      xmax_c--;
-      
-      /* del work for those pixels */
-      pixeliter_del_work (p,
-                          p->chunk.x + xmin_c, y,
-                          xmax_c - xmin_c + 1, 1);
-
-      /* add work to next and prev rows */
-      pixeliter_add_work (p,
-                          p->chunk.x + xmin_c, y - 1,
-                          xmax_c - xmin_c + 1, 1);
-      
-      pixeliter_add_work (p,
-                          p->chunk.x + xmin_c, y + 1,
-                          xmax_c - xmin_c + 1, 1);
-      
-      /* save those pixels on x_mask */
-      memcpy (&md[xmin_c], &dd[xmin_c], (xmax_c - xmin_c + 1) * sizeof (gfloat));
-      changed = TRUE;
     }
-
-  return changed;
 }
 
-static guint
-seed_fill_float16 (
-                 PixelIter * p,
-                 SeedFillData * d
-                 )
+
+/* the distance functions measure the largest channel difference to
+   the seed color, scaled the same way the old absdiff rows scaled
+   the threshold */
+static void
+seed_fill_dist_u8 (
+                   guchar * src,
+                   guchar * color,
+                   gfloat * dist,
+                   gint width,
+                   gint channels
+                   )
 {
-  guint changed = FALSE;
-  guint x, y;
+  guint8 * s = (guint8 *) src;
+  guint8 * c = (guint8 *) color;
   
-  /* get pixels in this chunk which need attention */
-  while (pixeliter_get_work (p, &x, &y))
+  while (width--)
     {
-      guint16 * dd, * md;
-      int xmin_c, xmax_c;
-
-      /* see if this pixel should be done */
-      dd = (guint16*) canvas_portion_data (d->x_diff, 0, y - p->chunk.y);
-      if (dd[x - p->chunk.x] == ZERO_FLOAT16)
-        continue;
-
-      /* see if this pixel is already done */
-      md = (guint16*) canvas_portion_data (d->x_mask, 0, y - p->chunk.y);
-      if (md[x - p->chunk.x] != ZERO_FLOAT16)
-        continue;
-      
-      /* find contig segment endpoints */
-      for (xmin_c = x - p->chunk.x;
-           (xmin_c >= 0) && (dd[xmin_c] != ZERO_FLOAT16);
-           xmin_c--);
-
-      for (xmax_c = x - p->chunk.x;
-           (xmax_c < p->chunk.w) && (dd[xmax_c] != ZERO_FLOAT16);
-           xmax_c++);
-             
-      /* add work to adjacent chunks if segment reached the edges */
-      if (xmin_c < 0)
+      gint b, diff, max = 0;
+
+      for (b = 0; b < channels; b++)
         {
-          pixeliter_add_work (p,
-                              p->chunk.x - 1, y,
-                              1, 1);
+          diff = abs (s[b] - c[b]);
+          if (diff > max)
+            max = diff;
         }
 
-      if (xmax_c == p->chunk.w)
+      *dist++ = max / 255.0;
+      s += channels;
+    }
+}
+
+static void
+seed_fill_dist_u16 (
+                    guchar * src,
+                    guchar * color,
+                    gfloat * dist,
+                    gint width,
+                    gint channels
+                    )
+{
+  guint16 * s = (guint16 *) src;
+  guint16 * c = (guint16 *) color;
+  
+  while (width--)
+    {
+      gint b, diff, max = 0;
+
+      for (b = 0; b < channels; b++)
         {
-          pixeliter_add_work (p,
-                              p->chunk.x + p->chunk.w, y,
-                              1, 1);
+          diff = abs (s[b] - c[b]);
+          if (diff > max)
+            max = diff;
         }
-      
-      xmin_c++;
-      xmax_c--;
-      
-      /* del work for those pixels */
-      pixeliter_del_work (p,
-                          p->chunk.x + xmin_c, y,
-                          xmax_c - xmin_c + 1, 1);
-
-      /* add work to next and prev rows */
-      pixeliter_add_work (p,
-                          p->chunk.x + xmin_c, y - 1,
-                          xmax_c - xmin_c + 1, 1);
-      
-      pixeliter_add_work (p,
-                          p->chunk.x + xmin_c, y + 1,
-                          xmax_c - xmin_c + 1, 1);
-      
-      /* save those pixels on x_mask */
-      memcpy (&md[xmin_c], &dd[xmin_c], (xmax_c - xmin_c + 1) * sizeof (guint16));
-      changed = TRUE;
-    }
 
-  return changed;
+      *dist++ = max / 65535.0;
+      s += channels;
+    }
 }
 
-static guint
-seed_fill_bfp (
-               PixelIter * p,
-               SeedFillData * d
-               )
+static void
+seed_fill_dist_float (
+                      guchar * src,
+                      guchar * color,
+                      gfloat * dist,
+                      gint width,
+                      gint channels
+                      )
 {
-  guint changed = FALSE;
-  guint x, y;
+  gfloat * s = (gfloat *) src;
+  gfloat * c = (gfloat *) color;
   
-  /* get pixels in this chunk which need attention */
-  while (pixeliter_get_work (p, &x, &y))
+  while (width--)
     {
-      guint16 * dd, * md;
-      int xmin_c, xmax_c;
-
-      /* see if this pixel should be done */
-      dd = (guint16*) canvas_portion_data (d->x_diff, 0, y - p->chunk.y);
-      if (dd[x - p->chunk.x] == 0)
-        continue;
-
-      /* see if this pixel is already done */
-      md = (guint16*) canvas_portion_data (d->x_mask, 0, y - p->chunk.y);
-      if (md[x - p->chunk.x] != 0)
-        continue;
-      
-      /* find contig segment endpoints */
-      for (xmin_c = x - p->chunk.x;
-           (xmin_c >= 0) && (dd[xmin_c] != 0);
-           xmin_c--);
-
-      for (xmax_c = x - p->chunk.x;
-           (xmax_c < p->chunk.w) && (dd[xmax_c] != 0);
-           xmax_c++);
-             
-      /* add work to adjacent chunks if segment reached the edges */
-      if (xmin_c < 0)
+      gint b;
+      gfloat diff, max = 0;
+
+      for (b = 0; b < channels; b++)
         {
-          pixeliter_add_work (p,
-                              p->chunk.x - 1, y,
-                              1, 1);
+          diff = fabs (s[b] - c[b]);
+          if (diff > max)
+            max = diff;
         }
 
-      if (xmax_c == p->chunk.w)
+      *dist++ = max;
+      s += channels;
+    }
+}
+
+static void
+seed_fill_dist_float16 (
+                        guchar * src,
+                        guchar * color,
+                        gfloat * dist,
+                        gint width,
+                        gint channels
+                        )
+{
+  guint16 * s = (guint16 *) src;
+  guint16 * c = (guint16 *) color;
+  gfloat cf[TAG_MAX_BYTES / sizeof (guint16)];
+  ShortsFloat u;
+  gint b;
+
+  for (b = 0; b < channels; b++)
+    cf[b] = FLT (c[b], u);
+  
+  while (width--)
+    {
+      gfloat diff, max = 0;
+
+      for (b = 0; b < channels; b++)
         {
-          pixeliter_add_work (p,
-                              p->chunk.x + p->chunk.w, y,
-                              1, 1);
+          diff = fabs (FLT (s[b], u) - cf[b]);
+          if (diff > max)
+            max = diff;
         }
-      
-      xmin_c++;
-      xmax_c--;
-      
-      /* del work for those pixels */
-      pixeliter_del_work (p,
-                          p->chunk.x + xmin_c, y,
-                          xmax_c - xmin_c + 1, 1);
-
-      /* add work to next and prev rows */
-      pixeliter_add_work (p,
-                          p->chunk.x + xmin_c, y - 1,
-                          xmax_c - xmin_c + 1, 1);
-      
-      pixeliter_add_work (p,
-                          p->chunk.x + xmin_c, y + 1,
-                          xmax_c - xmin_c + 1, 1);
-      
-      /* save those pixels on x_mask */
-      memcpy (&md[xmin_c], &dd[xmin_c], (xmax_c - xmin_c + 1) * sizeof (guint16));
-      changed = TRUE;
+
+      *dist++ = max;
+      s += channels;
     }
+}
 
-  return changed;
+static void
+seed_fill_dist_bfp (
+                    guchar * src,
+                    guchar * color,
+                    gfloat * dist,
+                    gint width,
+                    gint channels
+                    )
+{
+  guint16 * s = (guint16 *) src;
+  guint16 * c = (guint16 *) color;
+  
+  while (width--)
+    {
+      gint b, diff, max = 0;
+
+      for (b = 0; b < channels; b++)
+        {
+          diff = abs (s[b] - c[b]);
+          if (diff > max)
+            max = diff;
+        }
+
+      *dist++ = max / 65535.0;
+      s += channels;
+    }
 }
 
+
 static void
 fuzzy_select (GImage *gimage, CanvasDrawable *drawable, int op, int feather,
 	      double feather_radius)
@@ -890,13 +939,11 @@ fuzzy_select_button_press (Tool *tool, GdkEventButton *bevent,
     }
 
   /*  calculate the region boundary  */
-  /*segs = fuzzy_select_calculate (tool, gdisp_ptr, &num_segs);*/
+  segs = fuzzy_select_calculate (tool, gdisp_ptr, &num_segs);
 
-#if 0
   draw_core_start (fuzzy_opts->core,
 		   gdisp->canvas->window,
 		   tool);
-#endif
 }
 
 static void
@@ -913,14 +960,14 @@ fuzzy_select_button_release (Tool *tool, GdkEventButton *bevent,
   gdk_pointer_ungrab (bevent->time);
   gdk_flush ();
 
-#if 0
   draw_core_stop (fuzzy_opts->core, tool);
-#endif
   tool->state = INACTIVE;
 
   /*  First take care of the case where the user "cancels" the action  */
   if (! (bevent->state & GDK_BUTTON3_MASK))
     {
+      if (segs)
+	g_free (segs);
       segs = fuzzy_select_calculate (tool, gdisp_ptr, &num_segs);
       drawable = (fuzzy_selection_options->sample_merged) ? NULL : gimage_active_drawable (gdisp->gimage);
       fuzzy_select (gdisp->gimage, drawable, fuzzy_opts->op,
@@ -936,14 +983,13 @@ fuzzy_select_button_release (Tool *tool, GdkEventButton *bevent,
   if (segs)
     g_free (segs);
   segs = NULL;
-}
 
-static void
-fuzzy_select_motion (Tool *tool, GdkEventMotion *mevent, gpointer gdisp_ptr)
-{
+  /*  the cached distances are only good for this drag  */
+  if (fuzzy_opts->fill)
+    seed_fill_delete (fuzzy_opts->fill);
+  fuzzy_opts->fill = NULL;
 }
 
-#if 0
 static void
 fuzzy_select_motion (Tool *tool, GdkEventMotion *mevent, gpointer gdisp_ptr)
 {
@@ -983,7 +1029,6 @@ fuzzy_select_motion (Tool *tool, GdkEventMotion *mevent, gpointer gdisp_ptr)
   /*  start the new boundary  */
   draw_core_resume (fuzzy_opts->core, tool);
 }
-#endif
 
 static GdkSegment *
 fuzzy_select_calculate (Tool *tool, void *gdisp_ptr, int *nsegs)
@@ -1006,8 +1051,16 @@ fuzzy_select_calculate (Tool *tool, void *gdisp_ptr, int *nsegs)
   gdisplay_untransform_coords (gdisp, fuzzy_opts->x,
 			       fuzzy_opts->y, &x, &y, FALSE, use_offsets);
 
-  new = find_contiguous_region (gdisp->gimage, drawable, fuzzy_selection_options->antialias,
-				fuzzy_opts->threshold, x, y, fuzzy_selection_options->sample_merged);
+  /*  the seed stays put while the threshold is dragged, so the
+   *  distances to it are kept until the button is released
+   */
+  if (! fuzzy_opts->fill)
+    fuzzy_opts->fill = seed_fill_new (gdisp->gimage, drawable, x, y,
+				      fuzzy_selection_options->sample_merged);
+
+  new = seed_fill_region (fuzzy_opts->fill, gdisp->gimage,
+			  fuzzy_selection_options->antialias,
+			  fuzzy_opts->threshold);
 
   if (fuzzy_mask)
     channel_delete (fuzzy_mask);
@@ -1109,6 +1162,8 @@ tools_free_fuzzy_select (Tool *tool)
   FuzzyOptions * fuzzy_opts;
 
   fuzzy_opts = (FuzzyOptions *) tool->private;
+  if (fuzzy_opts->fill)
+    seed_fill_delete (fuzzy_opts->fill);
   draw_core_free (fuzzy_opts->core);
   g_free (fuzzy_opts);
 }
@@ -1285,593 +1340,3 @@ fuzzy_select_invoker (Argument *args)
 
   return procedural_db_return_args (&fuzzy_select_proc, success);
 }
-
-
-
-
-
-
-
-
-
-
-
-/* the rest of this stuff goes elsewhere eventually */
-
-static Segment *
-segment_new (
-             guint start,
-             guint end,
-             Segment * next
-             )
-{
-  Segment * s = (Segment *) g_malloc (sizeof (Segment));
-
-  s->start = start;
-  s->end = end;
-  s->next = next;
-
-  return s;
-}
-
-
-static void
-segment_delete (
-                Segment * s
-                )
-{
-  g_free (s);
-}
-
-
-/* add (x1 <= x < x2) to the segment */
-static void 
-segment_add  (
-              Segment ** s,
-              guint start,
-              guint end
-              )
-{
-  g_return_if_fail (s != NULL);
-
-  if (start >= end)
-    return;
-  
-  /* insert a new segment or extend an existing one */
-  while (1)
-    {
-      /* did we hit the end of the list */
-      if (*s == NULL)
-        {
-          /* insert at the end of the (possibly empty) list */
-          *s = segment_new (start, end, NULL);
-          return;
-        }
-
-      /* do we start before this guy */
-      if (start < (*s)->start)
-        {
-          /* insert a new segment */
-          *s = segment_new (start, end, *s);
-          break;
-        }
-      
-      /* do we start in or immediately after this guy */
-      if (start <= (*s)->end)
-        {
-          /* do we end before this guy */
-          if (end <= (*s)->end)
-            return;
-
-          /* extend the current segment */
-          (*s)->end = end;
-          break;
-        }
-
-      /* try next segment */
-      s = &((*s)->next);
-    }
-
-  /* at this point, *s points to a segment with the correct start and
-     end points.  however, it might overlap the following segments */
-  while (1)
-    {
-      /* are we at the end of the list */
-      if ((*s)->next == NULL)
-        return;
-
-      /* is the next guy correct */
-      if ((*s)->next->start > (*s)->end)
-        return;
-
-      {
-        /* pull the next guy out of the list */
-        Segment * n = (*s)->next;
-        (*s)->next = n->next;
-
-        /* does the next guy have a partial segment we need */
-        if (n->end > (*s)->end)
-          (*s)->end = n->end;
-
-        segment_delete (n);
-      }
-    }
-}
-
-
-static void 
-segment_del  (
-              Segment ** s,
-              guint start,
-              guint end
-              )
-{
-  g_return_if_fail (s != NULL);
-
-  if (start >= end)
-    return;
-  
-  while (1)
-    {
-      /* we hit the end of the list */
-      if (*s == NULL)
-        return;
-
-      /* see if we overlap segment head */
-      if ((*s)->end > end)
-        {
-          if ((*s)->start >= end)
-            {
-              /* first segment is completely after deletion */
-              return;
-            }
-          else if ((*s)->start >= start)
-            {
-              /* first segment head overlaps us */
-              (*s)->start = end;
-              return;
-            }
-          else
-            {
-              /* we split first segment */
-              *s = segment_new ((*s)->start, start, *s);
-              (*s)->next->start = end;
-              return;
-            }
-        }
-      
-      /* see if we overlap segment tail */
-      else if ((*s)->end > start)
-        {
-          if ((*s)->start >= start)
-            {
-              Segment * n = *s;
-              *s = (*s)->next;
-              segment_delete (n);
-              continue;
-            }
-          else
-            {
-              (*s)->end = start;
-            }
-        }
-
-      /* next segment */
-      s = &((*s)->next);
-    }
-}
-
-
-PixelIter * 
-pixeliter_new  (
-                void
-                )
-{
-  PixelIter * p;
-  
-  p = (PixelIter *) g_malloc (sizeof (PixelIter));
-  
-  p->image = NULL;
-  p->reftype = REF_NONE;
-  p->area.x = 0;
-  p->area.y = 0;
-  p->area.w = 0;
-  p->area.h = 0;
-  p->chunk.x = 0;
-  p->chunk.y = 0;
-  p->chunk.w = 0;
-  p->chunk.h = 0;
-
-  p->callback = NULL;
-  p->data = NULL;
-  p->todo = NULL;
-
-  return p;
-}
-
-
-void 
-pixeliter_delete  (
-                   PixelIter * p
-                   )
-{
-  guint h;
-  
-  g_return_if_fail (p != NULL);
-  g_return_if_fail (p->todo != NULL);
-
-  h = p->area.h;
-
-  while (h-- > 0)
-    {
-      Segment * s = p->todo[h];
-      while (s)
-        {
-          Segment * n = s->next;
-          segment_delete (s);
-          s = n;
-        }
-    }
-
-  g_free (p->todo);
-}
-
-
-/* set up p so that it will work within the xywh bounding box on image
-  calling callback with the pixeliter p as an arg.
-
-  data is stored inside p so callback has access to it
-*/
-guint 
-pixeliter_init  (
-                 PixelIter * p,
-                 Canvas * image,
-                 PIFunc callback,
-                 void * data,
-                 guint x,
-                 guint y,
-                 guint w,
-                 guint h,
-                 guint reftype
-                 )
-{
-  g_return_val_if_fail (p != NULL, FALSE);
-  g_return_val_if_fail (image != NULL, FALSE);
-  g_return_val_if_fail (w >= 0, FALSE);
-  g_return_val_if_fail (h >= 0, FALSE);
-  g_return_val_if_fail (callback != NULL, FALSE);
-  g_return_val_if_fail (CAST(int) x < canvas_width (image), FALSE);
-  g_return_val_if_fail (CAST(int) y < canvas_height (image), FALSE);
-
-  p->image = image;
-  p->reftype = reftype;
-  p->area.x = x;
-  p->area.y = y;
-  p->area.w = canvas_width (image);
-  if ((w > 0) && (CAST(int) w <= p->area.w))
-    p->area.w = w;
-  p->area.h = canvas_height (image);
-  if ((h > 0) && (CAST(int) h <= p->area.h))
-    p->area.h = h;
-  p->chunk.x = 0;
-  p->chunk.y = 0;
-  p->chunk.w = 0;
-  p->chunk.h = 0;
-  
-  p->callback = callback;
-  p->data = data;
-  p->todo = (Segment **) g_malloc (sizeof (Segment*) * p->area.h);
-  memset (p->todo, 0, (sizeof (Segment*) * p->area.h));
-  
-  return TRUE;
-}
-
-
-/* choose a chunk of the image to process and invoke the user callback
-  on that chunk.
-
-  from the perspective of the user callback, the exact area chosen is
-  random.  however, the entire area is guaranteed to be contained
-  somewhere within a single portion of the canvas and inside the
-  bounding box specified in the init call.
-
-  the user callback may cause the entire operation to cease simply by
-  returning FALSE.  this is useful for things like "is_area_empty"
-  which may only need to see a single data point to return an answer.
-
-  the user callback may add or delete work from the todo list.  this
-  is useful for operations like seed fill that need to go exploring.
-
-  it is trivial to emulate the current pixelarea_process behaviour.
-  simply schedule the top left corner of the bounding box as the
-  initial work, have the callback process the entire chunk, then add
-  work for the strip of pixels directly to the right and below the
-  chunk.  if pixeliter_choose_chunk() always prefers upper left chunks
-  over lower right chunks, the chunks will be processed in exactly the
-  same order.
-  
-  return true if more work remains, false if todo list is empty or if
-  the operation was aborted by the user callback */
-guint 
-pixeliter_process  (
-                    PixelIter * p
-                    )
-{
-  guint rc = FALSE;
-  
-  g_return_val_if_fail (p != NULL, FALSE);
-
-  /* see if work remains on this image */
-  if (pixeliter_choose_chunk (p) != TRUE)
-    return FALSE;
-  
-  /* if requested, ref the underlying image data */
-  if (p->reftype == REF_RO)
-    if (canvas_portion_refro (p->image, p->chunk.x, p->chunk.y) != REFRC_OK)
-      return FALSE;
-
-  if (p->reftype == REF_RW)
-    if (canvas_portion_refrw (p->image, p->chunk.x, p->chunk.y) != REFRC_OK)
-      return FALSE;
-
-  /* ready ike?  kick the callback! */
-  rc = p->callback (p);
-
-  /* unref the image data if required */
-  if ((p->reftype == REF_RO) || (p->reftype == REF_RW))
-    {
-      (void) canvas_portion_unref (p->image, p->chunk.x, p->chunk.y);
-    }
-
-  return rc;
-}
-
-
-/* pick a pixel that needs attention and decide how big of a chunk to
-   work on.  set the chunk boundaries.
-
-   any policy decisions can go in here, but we must at a minimum
-   respect the users bounding box and the underlying canvas portion
-   boundaries */
-static guint
-pixeliter_choose_chunk (
-                        PixelIter * p
-                        )
-{
-  gint x, y, w, h;
-
-  /* pick a pixel from the todo list */
-  if (pixeliter_first (p, &p->area, &x, &y) != TRUE)
-    return FALSE;
-  
-  /* size the chunk around the pixel, respecting user bounding box and
-     canvas portion boundaries.  other criteria, such as an absolute
-     maximum chunk size/aspect ratio/whatever can be added */
-  x = MAX (p->area.x,
-           CAST(int) canvas_portion_x (p->image, x, y));
-  y = MAX (p->area.y,
-           CAST(int) canvas_portion_y (p->image, x, y));
-  w = MIN (p->area.w - (x - p->area.x),
-           CAST(int) canvas_portion_width (p->image, x, y));
-  h = MIN (p->area.h - (y - p->area.y),
-           CAST(int) canvas_portion_height (p->image, x, y));
-
-  /* save it so the callback knows where to work */
-  p->chunk.x = x;
-  p->chunk.y = y;
-  p->chunk.w = w;
-  p->chunk.h = h;
-
-  return TRUE;
-}         
-
-
-/* find the first pixel in the todo list for p that lies within box b.
-   return coords in x,y */
-static guint 
-pixeliter_first  (
-                  PixelIter * p,
-                  BBox * b,
-                  guint * xx,
-                  guint * yy
-                  )
-{
-  guint x, y, w, h;
-  
-  g_return_val_if_fail (p != NULL, FALSE);
-  g_return_val_if_fail (b != NULL, FALSE);
-  g_return_val_if_fail (xx != NULL, FALSE);
-  g_return_val_if_fail (yy != NULL, FALSE);
-
-  x = b->x;
-  y = b->y;
-  w = b->w;
-  h = b->h;
-  
-  /* is the work right or below area */
-  if (CAST(int) x >= p->area.x + p->area.w)
-    return FALSE;
-  
-  if (CAST(int) y >= p->area.y + p->area.h)
-    return FALSE;
-
-  /* does work start left or above area */
-  if (CAST(int) x < p->area.x)
-    {
-      w = w - (p->area.x - x);
-      x = p->area.x;
-    }
-  
-  if (CAST(int) y < p->area.y)
-    {
-      h = h - (p->area.y - y);
-      y = p->area.y;
-    }
-
-  w = CLAMP (CAST(int) w, 0, p->area.w);
-  h = CLAMP (CAST(int) h, 0, p->area.h);
-
-  if ((w == 0) || (h == 0))
-    return FALSE;
-
-  while (h--)
-    {
-      Segment * s = p->todo[y - p->area.y];
-      while (s)
-        {
-          /* is segment completely to right of our range */
-          if (s->start >= x+w)
-            break;
-          
-          /* is segment completely to left of our range */
-          if (s->end <= x)
-            {
-              s = s->next;
-              continue;
-            }
-          
-          *xx = MAX (s->start, x);
-          *yy = y;
-          
-          return TRUE;
-        }
-
-      /* try next row */
-      y++;
-    }
-
-  return FALSE;
-}
-
-
-/* add the specified rectangle to the PixelIter's todo list.  only the
-  part that overlaps the PixelIters area will be added.
-
-  no return code */
-void 
-pixeliter_add_work  (
-                     PixelIter * p,
-                     gint x,
-                     gint y,
-                     gint w,
-                     gint h
-                     )
-{
-  g_return_if_fail (p != NULL);
-  g_return_if_fail (p->todo != NULL);
-
-  /* is the work right or below area */
-  if (x >= p->area.x + p->area.w)
-    return;
-  
-  if (y >= p->area.y + p->area.h)
-    return;
-
-  /* does work start left or above area */
-  if (x < p->area.x)
-    {
-      w = w - (p->area.x - x);
-      x = p->area.x;
-    }
-  
-  if (y < p->area.y)
-    {
-      h = h - (p->area.y - y);
-      y = p->area.y;
-    }
-
-  w = CLAMP (w, 0, p->area.w);
-  h = CLAMP (h, 0, p->area.h);
-
-  if ((w == 0) || (h == 0))
-    return;
-
-  /* add to each segment list */
-  while (h--)
-    {
-      Segment ** s = &(p->todo[y - p->area.y]);
-      segment_add (s, x, x + w);
-      y++;
-    }
-}
-
-
-/* remove the specified rectangle to the PixelIter's todo list.  only
-  the part that overlaps the PixelIters area will be cleared.
-
-  no return code */
-void
-pixeliter_del_work  (
-                     PixelIter * p,
-                     gint x,
-                     gint y,
-                     gint w,
-                     gint h
-                     )
-{
-  g_return_if_fail (p != NULL);
-  g_return_if_fail (p->todo != NULL);
-  
-  /* is the work right or below area */
-  if (x >= p->area.x + p->area.w)
-    return;
-  
-  if (y >= p->area.y + p->area.h)
-    return;
-
-  /* does work start left or above area */
-  if (x < p->area.x)
-    {
-      w = w - (p->area.x - x);
-      x = p->area.x;
-    }
-  
-  if (y < p->area.y)
-    {
-      h = h - (p->area.y - y);
-      y = p->area.y;
-    }
-
-  w = CLAMP (w, 0, p->area.w);
-  h = CLAMP (h, 0, p->area.h);
-
-  if ((w == 0) || (h == 0))
-    return;
-
-  /* add to each segment list */
-  while (h--)
-    {
-      Segment ** s = &(p->todo[y - p->area.y]);
-      segment_del (s, x, x + w);
-      y++;
-    }
-}
-
-
-/* see if there are any pixels in the todo list that fall within the
-  chunk we are processing. if so, pick one, remove from todo list, and
-  store in x,y.
-
-  return true if a point was returned, false if not */
-guint 
-pixeliter_get_work  (
-                     PixelIter * p,
-                     gint * x,
-                     gint * y
-                     )
-{
-  g_return_val_if_fail (p != NULL, FALSE);
-  g_return_val_if_fail (p->todo != NULL, FALSE);
-  g_return_val_if_fail (x != NULL, FALSE);
-  g_return_val_if_fail (y != NULL, FALSE);
-
-  /* get a pixel */
-  if (pixeliter_first (p, &p->chunk, x, y) != TRUE)
-    return FALSE;
-
-  /* mark it as done */
-  pixeliter_del_work (p, *x, *y, 1, 1);
-  
-  return TRUE;
-}
-
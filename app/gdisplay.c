@@ -33,6 +33,7 @@
 #include "gimage_mask.h"
 #include "rc.h"
 #include "gximage.h"
+#include "../lib/wire/iostats.h"
 #include "image_render.h"
 #include "info_window.h"
 #include "interface.h"
@@ -76,6 +77,7 @@ static GSList *   gdisplay_process_area_list(GSList *, GArea *);
 static void       gdisplay_paint_area       (GDisplay *, int, int, int, int);
 static void	  gdisplay_draw_cursor	    (GDisplay *);
 static void       gdisplay_display_area     (GDisplay *, int, int, int, int);
+static void       gdisplay_put_band         (GDisplay *, int, int, int, int, int, gpointer);
 static guint      gdisplay_hash             (GDisplay *);
 /* updates the projection */
 /*static void       gdisplay_project          (GDisplay *, int, int, int, int);*/
@@ -956,10 +958,12 @@ gdisplay_display_area (GDisplay *gdisp,
   int x2, y2;
   int dx, dy;
   int i, j;
+  IOStatsTimer timer;
 
   if (!(gdisp->gimage))
     return;
 
+  iostats_timer_start (&timer);
   sx = SCALE (gdisp, gdisp->gimage->width);
   sy = SCALE (gdisp, gdisp->gimage->height);
 
@@ -1009,10 +1013,26 @@ gdisplay_display_area (GDisplay *gdisp,
       {
 	dx = (x2 - j < GXIMAGE_WIDTH) ? x2 - j : GXIMAGE_WIDTH;
 	dy = (y2 - i < GXIMAGE_HEIGHT) ? y2 - i : GXIMAGE_HEIGHT;
-	render_image (gdisp, j - gdisp->disp_xoffset, i - gdisp->disp_yoffset, dx, dy);
-	gximage_put (gdisp->canvas->window,
-		     j, i, dx, dy, gdisp->offset_x, gdisp->offset_y);
+	render_image_bands (gdisp, j - gdisp->disp_xoffset, i - gdisp->disp_yoffset,
+			    dx, dy, gdisplay_put_band, NULL);
       }
+  iostats_timer_stop (&timer, IOSTATS_RENDER);
+}
+
+
+/*  show a rendered band, called from render_image_bands  */
+static void
+gdisplay_put_band (GDisplay *gdisp,
+		   int       x,
+		   int       y,
+		   int       w,
+		   int       h,
+		   int       row,
+		   gpointer  data)
+{
+  gximage_put_rows (gdisp->canvas->window,
+		    x + gdisp->disp_xoffset, y + gdisp->disp_yoffset, w, h,
+		    gdisp->offset_x, gdisp->offset_y, row);
 }
 
 
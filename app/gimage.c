@@ -48,6 +48,7 @@
 #include "zoom.h"
 #include "gdisplay.h"
 #include "base_frame_manager.h"
+#include "../lib/wire/iostats.h"
 
 #include "layer_pvt.h"
 #include "channel_pvt.h"		/* ick ick. */
@@ -1581,11 +1582,15 @@ gimage_construct (GImage *gimage, int x, int y, int w, int h)
 {
   if (!gimage_is_flat (gimage))
     {
+       IOStatsTimer timer;
+
+       iostats_timer_start (&timer);
        gimage->construct_flag = 0;
        gimage_initialize_projection (gimage, x, y, w, h);
        gimage_construct_layers (gimage, x, y, w, h);
        image_render_set_visible_channels(gimage, x, y, w, h);
        gimage_construct_channels (gimage, x, y, w, h);
+       iostats_timer_stop (&timer, IOSTATS_PROJECTION);
     }
 }
 
@@ -3519,6 +3524,7 @@ gimage_construct_composite_preview (GImage *gimage, int width, int height,
   Canvas *comp = NULL;
   Canvas *layer_buf = NULL;
   Canvas *mask_buf = NULL;
+  Canvas *cms_buf = NULL;
   GSList *reverse_list = NULL;
   double ratio;
   int x, y, w, h;
@@ -3588,15 +3594,28 @@ gimage_construct_composite_preview (GImage *gimage, int width, int height,
                       TRUE);
       
       layer_buf = layer_preview (layer, w, h);
-      /* update the layers preview cache */
-      GIMP_DRAWABLE(layer)->preview_valid = FALSE;
 
-      pixelarea_init (&src2PR, layer_buf,
-                      x1, y1,
-                      (x2 - x1), (y2 - y1),
-                      FALSE);
+      /* transform a copy so the cached layer preview stays valid */
+      cms_buf = NULL;
       if(transform_buffer)
-        cms_transform_area( transform_buffer, &src2PR, &src2PR );
+        {
+          PixelArea cmsPR;
+
+          cms_buf = canvas_new (canvas_tag (layer_buf),
+                                canvas_width (layer_buf),
+                                canvas_height (layer_buf),
+                                STORAGE_FLAT);
+          pixelarea_init (&src2PR, layer_buf,
+                          x1, y1,
+                          (x2 - x1), (y2 - y1),
+                          FALSE);
+          pixelarea_init (&cmsPR, cms_buf,
+                          x1, y1,
+                          (x2 - x1), (y2 - y1),
+                          TRUE);
+          cms_transform_area( transform_buffer, &src2PR, &cmsPR );
+          layer_buf = cms_buf;
+        }
 
       pixelarea_init (&src2PR, layer_buf,
                       x1, y1,
@@ -3652,6 +3671,9 @@ gimage_construct_composite_preview (GImage *gimage, int width, int height,
 
       construct_flag = 1;
 
+      if (cms_buf)
+        canvas_delete (cms_buf);
+
       reverse_list = g_slist_next (reverse_list);
     }
 
@@ -109,6 +109,13 @@ gximage_get_byte_order ()
 
 void
 gximage_put (GdkWindow *win, int x, int y, int w, int h, int xdith, int ydith)
+{
+  gximage_put_rows (win, x, y, w, h, xdith, ydith, 0);
+}
+
+void
+gximage_put_rows (GdkWindow *win, int x, int y, int w, int h, int xdith, int ydith,
+		  int row)
 {
     /*  create the GC if it doesn't yet exist  */
   if (!gximage->gc)
@@ -144,7 +151,7 @@ gximage_put (GdkWindow *win, int x, int y, int w, int h, int xdith, int ydith)
 				h,
 				/* todo: make configurable */
 				GDK_RGB_DITHER_MAX,
-				gximage->data,
+				gximage->data + row * GXIMAGE_WIDTH * 3,
 				GXIMAGE_WIDTH * 3,
 				xdith, ydith);
 }
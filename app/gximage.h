@@ -26,6 +26,9 @@ void     gximage_free           (void);
 
 void     gximage_put            (GdkWindow *win, int x, int y, int w, int h,
 				 int xdith, int ydith);
+/* same, starting at a later row of the image buffer */
+void     gximage_put_rows       (GdkWindow *win, int x, int y, int w, int h,
+				 int xdith, int ydith, int row);
 guchar*  gximage_get_data       (void);
 int      gximage_get_bpp        (void);
 int      gximage_get_bpl        (void);
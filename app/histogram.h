@@ -60,6 +60,8 @@ void             histogram_range   (Histogram *, int, int);
 void             histogram_channel (Histogram *, int);
 HistogramValues *histogram_values  (Histogram *);
 gint             histogram_bins (Histogram *histogram);
+void             histogram_set_hdr (Histogram *, int);
+int              histogram_hdr     (Histogram *);
 void histogram_histogram_funcs (Tag tag);
 
 #endif /* __HISTOGRAM_H__ */
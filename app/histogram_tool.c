@@ -51,6 +51,7 @@ struct HistogramToolDialog
   GtkWidget   *shell;
   GtkWidget   *info_labels[7];
   GtkWidget   *channel_menu;
+  GtkWidget   *hdr_toggle;
   Histogram   *histogram;
   
   double       mean;
@@ -79,6 +80,7 @@ static HistogramToolDialog *  histogram_tool_new_dialog       (gint);
 static void                   histogram_tool_close_callback   (GtkWidget *, gpointer);
 static gint                   histogram_tool_delete_callback  (GtkWidget *, GdkEvent *, gpointer);
 static void                   histogram_tool_value_callback   (GtkWidget *, gpointer);
+static void                   histogram_tool_hdr_callback     (GtkWidget *, gpointer);
 static void                   histogram_tool_red_callback     (GtkWidget *, gpointer);
 static void                   histogram_tool_green_callback   (GtkWidget *, gpointer);
 static void                   histogram_tool_blue_callback    (GtkWidget *, gpointer);
@@ -256,6 +258,18 @@ histogram_tool_initialize (void *gdisp_ptr)
   histogram_tool_dialog->drawable = gimage_active_drawable (gdisp->gimage);
   histogram_tool_dialog->color = drawable_color (histogram_tool_dialog->drawable);
 
+  /*  only float data has values outside 0..1 to bin logarithmically  */
+  {
+    Precision p = tag_precision (gimage_tag (gdisp->gimage));
+    int is_float = (p == PRECISION_FLOAT || p == PRECISION_FLOAT16);
+
+    if (!is_float)
+      gtk_toggle_button_set_state (GTK_TOGGLE_BUTTON (histogram_tool_dialog->hdr_toggle), FALSE);
+    gtk_widget_set_sensitive (histogram_tool_dialog->hdr_toggle, is_float);
+    histogram_set_hdr (histogram_tool_dialog->histogram,
+		       is_float && GTK_TOGGLE_BUTTON (histogram_tool_dialog->hdr_toggle)->active);
+  }
+
   /*  hide or show the channel menu based on image type  */
   if (histogram_tool_dialog->color)
     gtk_widget_show (histogram_tool_dialog->channel_menu);
@@ -374,6 +388,7 @@ histogram_tool_new_dialog ( gint bins )
 
   htd = (HistogramToolDialog *) g_malloc (sizeof (HistogramToolDialog));
   htd->channel = HISTOGRAM_VALUE;
+  htd->drawable = NULL;
 
   for (i = 0; i < 5; ++i)
     color_option_items [i].user_data = (gpointer) htd;
@@ -417,6 +432,14 @@ histogram_tool_new_dialog ( gint bins )
   gtk_widget_show (channel_hbox);
   gtk_option_menu_set_menu (GTK_OPTION_MENU (htd->channel_menu), menu);
 
+  /*  log spaced bins for high dynamic range data  */
+  htd->hdr_toggle = gtk_check_button_new_with_label (_("HDR"));
+  gtk_box_pack_start (GTK_BOX (channel_hbox), htd->hdr_toggle, FALSE, FALSE, 2);
+  gtk_signal_connect (GTK_OBJECT (htd->hdr_toggle), "toggled",
+		      (GtkSignalFunc) histogram_tool_hdr_callback,
+		      htd);
+  gtk_widget_show (htd->hdr_toggle);
+
   /*  The histogram tool histogram  */
   hbox = gtk_hbox_new (TRUE, 1);
   gtk_box_pack_start (GTK_BOX (vbox), hbox, TRUE, FALSE, 0);
@@ -506,6 +529,26 @@ histogram_tool_value_callback (GtkWidget *w,
     }
 }
 
+static void
+histogram_tool_hdr_callback (GtkWidget *w,
+			     gpointer   client_data)
+{
+  HistogramToolDialog *htd;
+  int hdr;
+
+  htd = (HistogramToolDialog *) client_data;
+  hdr = GTK_TOGGLE_BUTTON (w)->active;
+
+  if (hdr != histogram_hdr (htd->histogram) && htd->drawable)
+    {
+      histogram_set_hdr (htd->histogram, hdr);
+      histogram_update (htd->histogram,
+			htd->drawable,
+			histogram_histogram_info,
+			(void *) htd);
+    }
+}
+
 static void
 histogram_tool_red_callback (GtkWidget *w,
 			     gpointer   client_data)
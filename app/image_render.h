@@ -48,6 +48,23 @@ void render_image (GDisplay *gdisp,
 		   int       w,
 		   int       h);
 
+/* called for each finished band, row is its first row in the gximage */
+typedef void (*RenderBandFunc) (GDisplay *gdisp,
+				int       x,
+				int       y,
+				int       w,
+				int       h,
+				int       row,
+				gpointer  data);
+
+void render_image_bands (GDisplay      *gdisp,
+			 int            x,
+			 int            y,
+			 int            w,
+			 int            h,
+			 RenderBandFunc done,
+			 gpointer       data);
+
 /* image exposure functions */
 float image_render_get_gamma();
 float image_render_get_expose();
@@ -76,6 +76,7 @@
 
 #include "threshold.h"
 #include "undo_cmds.h"
+#include "iostats_cmds.h"
 #include "procedural_db.h"
 
 
@@ -84,7 +85,7 @@ internal_procs_init ()
 {
   gfloat pcount = 0;
   /* grep -c procedural_db_register internal_procs.c */
-  gfloat total_pcount = 209;
+  gfloat total_pcount = 210;
   app_init_update_status(_("Internal Procedures"), _("Tool procedures"),
 			 pcount/total_pcount);
 
@@ -393,6 +394,9 @@ internal_procs_init ()
   /*  Gimprc procedures  */
   procedural_db_register (&gimprc_query_proc); pcount++;
 
+  /*  I/O statistics  */
+  procedural_db_register (&iostats_query_proc); pcount++;
+
   app_init_update_status(NULL, _("Procedural database"),
 			 pcount/total_pcount);
 
@@ -0,0 +1,186 @@
+/* The GIMP -- an image manipulation program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "appenv.h"
+#include "iostats_cmds.h"
+#include "rc.h"
+#include "../lib/wire/iostats.h"
+
+static gint iostats_dump_timer = 0;
+
+static int success;
+
+
+/*  append the counters to iostats-dump-file, or stderr if unset  */
+static gint
+iostats_dump_callback (gpointer data)
+{
+  FILE *fp = stderr;
+
+  if (iostats_dump_file && *iostats_dump_file)
+    {
+      fp = fopen (iostats_dump_file, "a");
+      if (!fp)
+	{
+	  g_warning ("iostats: could not open %s", iostats_dump_file);
+	  return TRUE;
+	}
+    }
+
+  iostats_dump (fp);
+
+  if (fp != stderr)
+    fclose (fp);
+  else
+    fflush (fp);
+
+  return TRUE;
+}
+
+void
+iostats_dump_start (void)
+{
+  if (iostats_dump_interval > 0 && !iostats_dump_timer)
+    iostats_dump_timer = gtk_timeout_add (iostats_dump_interval * 1000,
+					  iostats_dump_callback, NULL);
+}
+
+void
+iostats_dump_stop (void)
+{
+  if (iostats_dump_timer)
+    {
+      gtk_timeout_remove (iostats_dump_timer);
+      iostats_dump_timer = 0;
+      iostats_dump_callback (NULL);
+    }
+}
+
+
+/*******************/
+/*  IOSTATS_QUERY  */
+
+static Argument *
+iostats_query_invoker (Argument *args)
+{
+  Argument *return_args;
+  char **names;
+  char **units;
+  gdouble *values;
+  gdouble *events;
+  IOStatsEntry entries[IOSTATS_COUNT];
+  int i;
+
+  success = TRUE;
+
+  names = g_new (char *, IOSTATS_COUNT);
+  units = g_new (char *, IOSTATS_COUNT);
+  values = g_new (gdouble, IOSTATS_COUNT);
+  events = g_new (gdouble, IOSTATS_COUNT);
+
+  iostats_get (entries, args[0].value.pdb_int);
+
+  for (i = 0; i < IOSTATS_COUNT; i++)
+    {
+      names[i] = g_strdup (iostats_name (i));
+      units[i] = g_strdup (iostats_unit (i));
+      values[i] = entries[i].value;
+      events[i] = entries[i].events;
+    }
+
+  return_args = procedural_db_return_args (&iostats_query_proc, success);
+
+  return_args[1].value.pdb_int = IOSTATS_COUNT;
+  return_args[2].value.pdb_pointer = names;
+  return_args[3].value.pdb_int = IOSTATS_COUNT;
+  return_args[4].value.pdb_pointer = units;
+  return_args[5].value.pdb_int = IOSTATS_COUNT;
+  return_args[6].value.pdb_pointer = values;
+  return_args[7].value.pdb_int = IOSTATS_COUNT;
+  return_args[8].value.pdb_pointer = events;
+
+  return return_args;
+}
+
+/*  The procedure definition  */
+ProcArg iostats_query_args[] =
+{
+  { PDB_INT32,
+    "reset",
+    "Clear the counters after reading them: TRUE or FALSE"
+  }
+};
+
+ProcArg iostats_query_out_args[] =
+{
+  { PDB_INT32,
+    "num_counters",
+    "the number of counters"
+  },
+  { PDB_STRINGARRAY,
+    "names",
+    "the counter names"
+  },
+  { PDB_INT32,
+    "num_units",
+    "the number of units"
+  },
+  { PDB_STRINGARRAY,
+    "units",
+    "the unit of each counter: \"bytes\", \"portions\" or \"usecs\""
+  },
+  { PDB_INT32,
+    "num_values",
+    "the number of values"
+  },
+  { PDB_FLOATARRAY,
+    "values",
+    "the accumulated value of each counter"
+  },
+  { PDB_INT32,
+    "num_events",
+    "the number of event counts"
+  },
+  { PDB_FLOATARRAY,
+    "events",
+    "how often each counter was updated"
+  }
+};
+
+ProcRecord iostats_query_proc =
+{
+  "gimp_iostats_query",
+  "Read the I/O and timing counters",
+  "This procedure returns the counters kept for tile faults and allocations, plug-in wire traffic, colour transforms, projection rebuilds, display rendering and undo pushes since startup or the last reset.",
+  "CinePaint developers",
+  "CinePaint developers",
+  "2026",
+  PDB_INTERNAL,
+
+  /*  Input arguments  */
+  1,
+  iostats_query_args,
+
+  /*  Output arguments  */
+  8,
+  iostats_query_out_args,
+
+  /*  Exec method  */
+  { { iostats_query_invoker } },
+};
@@ -74,6 +74,7 @@ void *myAlloc(size_t n) { return calloc(sizeof(char), n); }
 
 #include "appenv.h"
 #include "app_procs.h"
+#include "bench.h"
 #include "errors.h"
 #include "install.h"
 
@@ -259,8 +260,14 @@ int main (int argc, char **argv)
 # endif
 #endif
 
-  /* Initialize Gtk toolkit */
-  gtk_init (&argc, &argv);
+  /* Initialize Gtk toolkit, the benchmark runs without a display */
+  for (i = 1; i < argc; i++)
+    if (strcmp (argv[i], "--bench-xcf") == 0)
+      break;
+  if (i < argc)
+    gtk_init_check (&argc, &argv);
+  else
+    gtk_init (&argc, &argv);
 
 #if GTK_MAJOR_VERSION < 2
   setlocale(LC_NUMERIC, "C");/* must use dot, not comma, as decimal separator */
@@ -344,6 +351,20 @@ int main (int argc, char **argv)
 	  no_data = TRUE;
 	  argv[i] = NULL;
 	}
+      else if (strcmp (argv[i], "--bench-xcf") == 0)
+	{
+	  argv[i] = NULL;
+	  if (i + 1 < argc)
+	    {
+	      bench_add_file (argv[++i]);
+	      argv[i] = NULL;
+	      no_interface = TRUE;
+	      no_splash = TRUE;
+	      console_messages = TRUE;
+	    }
+	  else
+	    show_help = TRUE;
+	}
       else if (strcmp (argv[i], "--no-splash") == 0)
 	{
 	  no_splash = TRUE;
@@ -426,6 +447,7 @@ int main (int argc, char **argv)
       g_print ("  -v --version           Output version info.\n");
       g_print ("  -b --batch <commands>  Run in batch mode.\n");
       g_print ("  -n --no-interface      Run without a user interface.\n");
+      g_print ("  --bench-xcf <file>     Time compositing steps on an XCF file and exit.\n");
       g_print ("  --no-data              Do not load patterns, gradients, palettes, brushes.\n");
       g_print ("  --verbose              Show startup messages.\n");
       g_print ("  --no-splash            Do not show the startup window.\n");
@@ -151,6 +151,16 @@ struct PaintCore16
   SetUpMode setup_mode;
 
   PreMultAlpha pre_mult;
+
+  /* set by tools whose painthit is a flat colour; CONSTANT dabs then
+     only accumulate in canvas_tiles and are composited together by
+     paint_core_16_batch_flush */
+  int       batch;
+  int       batch_pending;
+  int       batch_x1, batch_y1;
+  int       batch_x2, batch_y2;
+  gfloat    batch_opacity;
+  int       batch_mode;
 };
 
 
@@ -173,6 +183,8 @@ void               paint_core_16_finish          (PaintCore16 *,
 
 void               paint_core_16_cleanup         (PaintCore16 *);
 
+void               paint_core_16_batch_flush     (PaintCore16 *);
+
 void               paint_core_16_setnoise (PaintCore16 *, int apply_noise); 
 void               paint_core_16_setnoise_params (PaintCore16 *, gdouble, gdouble, gdouble); 
 			
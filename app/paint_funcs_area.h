@@ -103,8 +103,27 @@ void  hls_to_rgb            (int *, int *, int *);
 #define REPLACE_MODE       21
 
 
+/* instruction set levels the row kernels are dispatched on */
+typedef enum
+{
+  CPU_LEVEL_SCALAR,
+  CPU_LEVEL_SSE41,
+  CPU_LEVEL_AVX2,
+  CPU_LEVEL_AVX512,
+  CPU_LEVEL_COUNT
+} CpuLevel;
+
+/* compilers that can build kernels for a level with a target
+   attribute and check the cpu at runtime */
+#if (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define PAINT_FUNCS_X86 1
+#endif
+
 void paint_funcs_area_setup (void);
 void paint_funcs_area_free (void);
+CpuLevel paint_funcs_cpu_level (void);
+const char * paint_funcs_cpu_level_name (CpuLevel);
 
 void
 x_add_area (
@@ -394,6 +394,7 @@ tools_new_paintbrush ()
   private = (PaintCore *) tool->private;
   private->paint_func = (PaintFunc16) paintbrush_paint_func;
   private->painthit_setup = paintbrush_painthit_setup;
+  private->batch = TRUE;
 
   return tool;
 }
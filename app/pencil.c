@@ -84,6 +84,7 @@ tools_new_pencil ()
   private = (PaintCore *) tool->private;
   private->paint_func = (PaintFunc16) pencil_paint_func;
   private->painthit_setup = pencil_painthit_setup;
+  private->batch = TRUE;
 
   return tool;
 }
@@ -106,6 +106,10 @@ char *    cms_profile_path = NULL;
 char *    look_profile_path = NULL;
 int       tile_cache_size = 4194304;  /* 4 MB */
 int       marching_speed = 150;   /* 150 ms */
+int       render_threads = 0;     /* one per processor */
+char *    cpu_level = NULL;       /* auto */
+int       iostats_dump_interval = 0;  /* off */
+char *    iostats_dump_file = NULL;   /* stderr */
 double    gamma_val = 1.0;
 int       transparency_type = 1;  /* Mid-Tone Checks */
 int       transparency_size = 1;  /* Medium sized */
@@ -177,6 +181,7 @@ int       cms_default_flags = 0;
 int       cms_open_action = 0;
 int       cms_mismatch_action = 0;
 int       cms_manage_by_default = TRUE;
+int       cms_display_lut_size = 0;
 #ifdef HAVE_OY
 int       cms_oyranos = TRUE;
 #else
@@ -260,6 +265,7 @@ static ParseFunc funcs[] =
   { "cms-mismatch-action",   TT_INT,        &cms_mismatch_action, NULL },
   { "cms-bpc-by-default",    TT_BOOLEAN,    &cms_bpc_by_default, NULL },
   { "cms-manage-by-default", TT_BOOLEAN,    &cms_manage_by_default, NULL },
+  { "cms-display-lut-size",  TT_INT,        &cms_display_lut_size, NULL },
 #ifdef HAVE_OY
   { "cms-oyranos",           TT_INT,        &cms_oyranos, NULL },
 #endif
@@ -271,6 +277,10 @@ static ParseFunc funcs[] =
   { "color-cube",            TT_XCOLORCUBE, NULL, NULL },
   { "tile-cache-size",       TT_MEMSIZE,    &tile_cache_size, NULL },
   { "marching-ants-speed",   TT_INT,        &marching_speed, NULL },
+  { "render-threads",        TT_INT,        &render_threads, NULL },
+  { "cpu-level",             TT_STRING,     &cpu_level, NULL },
+  { "iostats-dump-interval", TT_INT,        &iostats_dump_interval, NULL },
+  { "iostats-dump-file",     TT_STRING,     &iostats_dump_file, NULL },
   { "undo-levels",           TT_INT,        &levels_of_undo, NULL },
   { "transparency-type",     TT_INT,        &transparency_type, NULL },
   { "transparency-size",     TT_INT,        &transparency_size, NULL },
@@ -42,6 +42,10 @@ extern char *    pluginrc_path;
 extern char *    cms_profile_path;
 extern int       tile_cache_size;
 extern int       marching_speed;
+extern int       render_threads;
+extern char *    cpu_level;
+extern int       iostats_dump_interval;
+extern char *    iostats_dump_file;
 extern double    gamma_val;
 extern int       transparency_type;
 extern int       transparency_size;
@@ -114,6 +118,7 @@ extern int       cms_default_flags;
 extern int       cms_open_action;
 extern int       cms_mismatch_action;
 extern int       cms_manage_by_default;
+extern int       cms_display_lut_size;
 extern int       cms_oyranos;
 extern char *    look_profile_path;
 
@@ -16,6 +16,7 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 #include <stdlib.h>
+#include <string.h>
 #include "appenv.h"
 #include "boundary.h"
 #include "colormaps.h"
@@ -46,6 +47,7 @@ static void    cycle_ant_colors            (Selection *);
 
 static void    selection_draw              (Selection *);
 static void    selection_transform_segs    (Selection *, BoundSeg *, GdkSegment *, int);
+static int     selection_bound_changed     (BoundSeg **, int *, BoundSeg *, int, int);
 static void    selection_generate_segs     (Selection *);
 static void    selection_free_segs         (Selection *);
 static gint    selection_march_ants        (gpointer);
@@ -330,6 +332,43 @@ selection_transform_segs (Selection  *select,
 }
 
 
+/*  remember the image space segments behind a display boundary.
+ *  returns TRUE if they differ from the ones kept last time
+ */
+static int
+selection_bound_changed (BoundSeg **bound,
+			 int       *num_bound,
+			 BoundSeg  *segs,
+			 int        num_segs,
+			 int        view_changed)
+{
+  int i;
+
+  if (! view_changed && *num_bound == num_segs)
+    {
+      for (i = 0; i < num_segs; i++)
+	if ((*bound)[i].x1 != segs[i].x1 || (*bound)[i].y1 != segs[i].y1 ||
+	    (*bound)[i].x2 != segs[i].x2 || (*bound)[i].y2 != segs[i].y2 ||
+	    (*bound)[i].open != segs[i].open)
+	  break;
+      if (i == num_segs)
+	return FALSE;
+    }
+
+  if (*bound)
+    g_free (*bound);
+  *bound = NULL;
+  *num_bound = num_segs;
+  if (num_segs)
+    {
+      *bound = (BoundSeg *) g_malloc (sizeof (BoundSeg) * num_segs);
+      memcpy (*bound, segs, sizeof (BoundSeg) * num_segs);
+    }
+
+  return TRUE;
+}
+
+
 static void
 selection_generate_segs (Selection *select)
 {
@@ -337,35 +376,73 @@ selection_generate_segs (Selection *select)
   BoundSeg *segs_in;
   BoundSeg *segs_out;
   BoundSeg *segs_layer;
+  int view[5];
+  int view_changed;
+  int j;
 
   gdisp = (GDisplay *) select->gdisp;
 
+  view[0] = gdisp->offset_x;
+  view[1] = gdisp->offset_y;
+  view[2] = gdisp->disp_xoffset;
+  view[3] = gdisp->disp_yoffset;
+  view[4] = gdisp->scale;
+  view_changed = memcmp (view, select->view, sizeof (view));
+  memcpy (select->view, view, sizeof (view));
+
   /*  Ask the gimage for the boundary of its selected region...
-   *  Then transform that information into a new buffer of XSegments
+   *  Then transform that information into a new buffer of XSegments.
+   *  Boundaries that did not move since the last time are kept as is,
+   *  so a recalc that only touched the layer does not redo the ants
    */
   gimage_mask_boundary (gdisp->gimage, &segs_in, &segs_out,
 			&select->num_segs_in, &select->num_segs_out);
-  if (select->num_segs_in)
+
+  if (selection_bound_changed (&select->bound_in, &select->num_bound_in,
+			       segs_in, select->num_segs_in, view_changed))
     {
-      select->segs_in = (GdkSegment *) g_malloc (sizeof (GdkSegment) * select->num_segs_in);
-      selection_transform_segs (select, segs_in, select->segs_in, select->num_segs_in);
+      if (select->segs_in)
+	g_free (select->segs_in);
+      for (j = 0; j < 8; j++)
+	{
+	  if (select->points_in[j])
+	    g_free (select->points_in[j]);
+	  select->points_in[j] = NULL;
+	  select->num_points_in[j] = 0;
+	}
+
+      if (select->num_segs_in)
+	{
+	  select->segs_in = (GdkSegment *) g_malloc (sizeof (GdkSegment) * select->num_segs_in);
+	  selection_transform_segs (select, segs_in, select->segs_in, select->num_segs_in);
 #ifdef USE_XDRAWPOINTS
-      selection_render_points (select);
+	  selection_render_points (select);
 #endif
+	}
+      else
+	select->segs_in = NULL;
     }
-  else
-    select->segs_in = NULL;
 
   /*  Possible secondary boundary representation  */
-  if (select->num_segs_out)
+  if (selection_bound_changed (&select->bound_out, &select->num_bound_out,
+			       segs_out, select->num_segs_out, view_changed))
     {
-      select->segs_out = (GdkSegment *) g_malloc (sizeof (GdkSegment) * select->num_segs_out);
-      selection_transform_segs (select, segs_out, select->segs_out, select->num_segs_out);
+      if (select->segs_out)
+	g_free (select->segs_out);
+
+      if (select->num_segs_out)
+	{
+	  select->segs_out = (GdkSegment *) g_malloc (sizeof (GdkSegment) * select->num_segs_out);
+	  selection_transform_segs (select, segs_out, select->segs_out, select->num_segs_out);
+	}
+      else
+	select->segs_out = NULL;
     }
-  else
-    select->segs_out = NULL;
 
   /*  The active layer's boundary  */
+  if (select->segs_layer)
+    g_free (select->segs_layer);
+
   gimage_layer_boundary (gdisp->gimage, &segs_layer, &select->num_segs_layer);
   if (select->num_segs_layer)
     {
@@ -404,6 +481,16 @@ selection_free_segs (Selection *select)
   select->num_segs_out   = 0;
   select->segs_layer     = NULL;
   select->num_segs_layer = 0;
+
+  if (select->bound_in)
+    g_free (select->bound_in);
+  if (select->bound_out)
+    g_free (select->bound_out);
+
+  select->bound_in       = NULL;
+  select->num_bound_in   = 0;
+  select->bound_out      = NULL;
+  select->num_bound_out  = 0;
 }
 
 
@@ -417,7 +504,6 @@ selection_start_marching (gpointer data)
   /*  if the RECALC bit is set, reprocess the boundaries  */
   if (select->recalc)
     {
-      selection_free_segs (select);
       selection_generate_segs (select);
       /* Toggle the RECALC flag */
       select->recalc = FALSE;
@@ -529,6 +615,10 @@ selection_create (GdkWindow *win,
   new->num_segs_in    = 0;
   new->num_segs_out   = 0;
   new->num_segs_layer = 0;
+  new->bound_in       = NULL;
+  new->bound_out      = NULL;
+  new->num_bound_in   = 0;
+  new->num_bound_out  = 0;
   new->index_in       = 0;
   new->index_out      = 0;
   new->index_layer    = 0;
@@ -538,8 +628,14 @@ selection_create (GdkWindow *win,
   new->speed          = speed;
   new->hidden         = FALSE;
 
+  for (i = 0; i < 5; i++)
+    new->view[i] = 0;
+
   for (i = 0; i < 8; i++)
-    new->points_in[i] = NULL;
+    {
+      new->points_in[i] = NULL;
+      new->num_points_in[i] = 0;
+    }
 
   /*  create a new graphics context  */
   new->gc_in = gdk_gc_new (new->win);
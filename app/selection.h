@@ -18,6 +18,8 @@
 #ifndef __SELECTION_H__
 #define __SELECTION_H__
 
+#include "boundary.h"
+
 typedef struct Selection Selection;
 
 struct Selection
@@ -36,6 +38,11 @@ struct Selection
   int           num_segs_in;     /*  number of segments in segs1       */
   int           num_segs_out;    /*  number of segments in segs2       */
   int           num_segs_layer;  /*  number of segments in segs3       */
+  BoundSeg *    bound_in;        /*  image space copy of segs_in       */
+  BoundSeg *    bound_out;       /*  image space copy of segs_out      */
+  int           num_bound_in;    /*  number of segments in bound_in    */
+  int           num_bound_out;   /*  number of segments in bound_out   */
+  int           view[5];         /*  display transform of the segments */
   int           index_in;        /*  index of current stipple pattern  */
   int           index_out;       /*  index of current stipple pattern  */
   int           index_layer;     /*  index of current stipple pattern  */
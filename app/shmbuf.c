@@ -45,6 +45,7 @@ struct ShmBuf
 
   int      is_alloced;
   int      ref_count;
+  guint    serial;
   void *   data;
 
   int      shmid;
@@ -74,6 +75,7 @@ shmbuf_new  (
   
   f->is_alloced = FALSE;
   f->ref_count = 0;
+  f->serial = 0;
   f->data = NULL;
 
   f->shmid = SHMid;
@@ -228,6 +230,7 @@ shmbuf_portion_refrw  (
       if (f->is_alloced == TRUE)
         {
           f->ref_count++;
+          f->serial = canvas_serial_next ();
           rc = REFRC_OK;
         }
     }
@@ -370,6 +373,7 @@ shmbuf_portion_alloc  (
           if (f->data != 0)
             {
               f->is_alloced = TRUE;
+              f->serial = canvas_serial_next ();
               return TRUE;
             }
         }
@@ -378,6 +382,19 @@ shmbuf_portion_alloc  (
 }
 
 
+guint 
+shmbuf_portion_serial  (
+                        ShmBuf * f,
+                        int x,
+                        int y
+                        )
+{
+  if (f && (x < f->width) && (y < f->height))
+    return f->serial;
+  return 0;
+}
+
+
 guint 
 shmbuf_portion_unalloc  (
                           ShmBuf * f,
@@ -395,6 +412,7 @@ shmbuf_portion_unalloc  (
             }
           f->data = NULL;
           f->is_alloced = FALSE;
+          f->serial = canvas_serial_next ();
           return TRUE;
         }
     }
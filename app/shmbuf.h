@@ -55,6 +55,7 @@ guint          shmbuf_portion_unalloc   (ShmBuf *, int x, int y);
 RefRC          shmbuf_portion_refro       (ShmBuf *, int x, int y);
 RefRC          shmbuf_portion_refrw     (ShmBuf *, int x, int y);
 RefRC          shmbuf_portion_unref     (ShmBuf *, int x, int y);
+guint          shmbuf_portion_serial    (ShmBuf *, int x, int y);
 
 
 extern ProcRecord shmseg_new_proc;
@@ -22,6 +22,7 @@
 #include "tilebuf.h"
 #include "trace.h"
 #include "../lib/wire/iodebug.h"
+#include "../lib/wire/iostats.h"
 
 
 #define TILE16_WIDTH   128 
@@ -48,6 +49,7 @@ struct Tile16
   short     is_alloced;
   short     ref_count;
   guchar  * data;
+  guint     serial;
 };
 
 
@@ -84,6 +86,7 @@ tilebuf_new  (
       t->tiles16[n].is_alloced = FALSE;
       t->tiles16[n].ref_count = 0;
       t->tiles16[n].data = NULL;
+      t->tiles16[n].serial = 0;
     }
 
   t->bytes = tag_bytes (tag);
@@ -237,7 +240,10 @@ tilebuf_portion_refro  (
       
       if (tile16->is_alloced == FALSE)
         if (canvas_autoalloc (t->canvas) == AUTOALLOC_ON)
-          (void) tilebuf_portion_alloc (t, x, y);
+          {
+            iostats_add (IOSTATS_TILE_FAULT, 1);
+            (void) tilebuf_portion_alloc (t, x, y);
+          }
       
       if (tile16->is_alloced == TRUE)
         {
@@ -266,11 +272,15 @@ tilebuf_portion_refrw  (
       
       if (tile16->is_alloced == FALSE)
         if (canvas_autoalloc (t->canvas) == AUTOALLOC_ON)
-          (void) tilebuf_portion_alloc (t, x, y);
+          {
+            iostats_add (IOSTATS_TILE_FAULT, 1);
+            (void) tilebuf_portion_alloc (t, x, y);
+          }
 
       if (tile16->is_alloced == TRUE)
         {
           tile16->ref_count++;
+          tile16->serial = canvas_serial_next ();
           rc = REFRC_OK;
         }
     }
@@ -453,7 +463,9 @@ tilebuf_portion_alloc  (
           if (tile16->data)
             {
               memset (tile16->data, 0, n);
+              iostats_add (IOSTATS_TILE_ALLOC, n);
               tile16->is_alloced = TRUE;
+              tile16->serial = canvas_serial_next ();
               if (canvas_portion_init (t->canvas,
                                        x - tile16_xoffset (t, x),
                                        y - tile16_yoffset (t, y),
@@ -487,8 +499,11 @@ tilebuf_portion_unalloc  (
               g_warning ("Unallocing a reffed tile.  expect a core...\n");
             }
           g_free (tile16->data);
+          iostats_add (IOSTATS_TILE_FREE,
+                       TILE16_WIDTH * TILE16_HEIGHT * t->bytes);
           tile16->data = NULL;
           tile16->is_alloced = FALSE;
+          tile16->serial = canvas_serial_next ();
           return TRUE;
         }
     }
@@ -496,6 +511,19 @@ tilebuf_portion_unalloc  (
 }
 
 
+guint 
+tilebuf_portion_serial  (
+                         TileBuf * t,
+                         int x,
+                         int y
+                         )
+{
+  int i = tile16_index(t, x, y);
+  if (i >= 0)
+    return t->tiles16[i].serial;
+  return 0;
+}
+
 
 static int
 tile16_index (
@@ -56,5 +56,6 @@ guint            tilebuf_portion_unalloc   (TileBuf *, int x, int y);
 RefRC            tilebuf_portion_refro     (TileBuf *, int x, int y);
 RefRC            tilebuf_portion_refrw     (TileBuf *, int x, int y);
 RefRC            tilebuf_portion_unref     (TileBuf *, int x, int y);
+guint            tilebuf_portion_serial    (TileBuf *, int x, int y);
 
 #endif /* __TILE_BUF_H__ */
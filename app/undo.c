@@ -41,6 +41,7 @@
 #include "transform_core.h"
 #include "undo.h"
 #include "zoom.h"
+#include "../lib/wire/iostats.h"
 
 #include "layer_pvt.h"
 #include "channel_pvt.h"
@@ -258,6 +259,7 @@ undo_push (GImage *gimage,
 
   new->bytes = size;
   gimage->undo_bytes += size;
+  iostats_add (IOSTATS_UNDO, size);
   if (!gimage->pushing_undo_group)  /*  only increment levels if not in a group  */
     {
       new->type = type;
@@ -29,6 +29,7 @@
 #define HAVE_DIRENT_H 1
 /* #undef HAVE_DOPRNT */
 #define HAVE_IPC_H 1
+#define HAVE_PTHREAD 1
 /* #undef HAVE_NDIR_H */
 #define HAVE_SHM_H 1
 /* #undef HAVE_SYS_DIR_H */
@@ -0,0 +1,139 @@
+/* iostats.c
+// Always compiled counters and scoped timers per subsystem
+// License MIT (http://opensource.org/licenses/mit-license.php)
+*/
+
+#include "config.h"
+
+#include <string.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include "iostats.h"
+
+IOStatsEntry iostats_entries[IOSTATS_COUNT];
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t iostats_lock = PTHREAD_MUTEX_INITIALIZER;
+#define IOSTATS_LOCK()   pthread_mutex_lock (&iostats_lock)
+#define IOSTATS_UNLOCK() pthread_mutex_unlock (&iostats_lock)
+#else
+#define IOSTATS_LOCK()
+#define IOSTATS_UNLOCK()
+#endif
+
+static const char *iostats_names[IOSTATS_COUNT] =
+{
+  "tile-faults",
+  "tile-allocs",
+  "tile-frees",
+  "wire-read",
+  "wire-write",
+  "cms-transforms",
+  "projection-rebuilds",
+  "render-exposes",
+  "undo-pushes"
+};
+
+static const char *iostats_units[IOSTATS_COUNT] =
+{
+  "portions",
+  "bytes",
+  "bytes",
+  "bytes",
+  "bytes",
+  "usecs",
+  "usecs",
+  "usecs",
+  "bytes"
+};
+
+void
+iostats_count (IOStatsCounter c, double n)
+{
+  IOSTATS_LOCK ();
+  iostats_entries[c].value += n;
+  iostats_entries[c].events++;
+  IOSTATS_UNLOCK ();
+}
+
+void
+iostats_timer_start (IOStatsTimer *t)
+{
+#ifndef WIN32
+  gettimeofday (&t->start, NULL);
+#endif
+  t->running = 1;
+}
+
+void
+iostats_timer_stop (IOStatsTimer *t, IOStatsCounter c)
+{
+  double usecs = 0;
+
+  if (!t->running)
+    return;
+#ifndef WIN32
+  {
+    struct timeval now;
+
+    gettimeofday (&now, NULL);
+    usecs = (now.tv_sec - t->start.tv_sec) * 1e6 +
+            (now.tv_usec - t->start.tv_usec);
+  }
+#endif
+  t->running = 0;
+  iostats_add (c, usecs);
+}
+
+const char *
+iostats_name (IOStatsCounter c)
+{
+  if (c < 0 || c >= IOSTATS_COUNT)
+    return "unknown";
+  return iostats_names[c];
+}
+
+const char *
+iostats_unit (IOStatsCounter c)
+{
+  if (c < 0 || c >= IOSTATS_COUNT)
+    return "";
+  return iostats_units[c];
+}
+
+void
+iostats_reset (void)
+{
+  IOSTATS_LOCK ();
+  memset (iostats_entries, 0, sizeof (iostats_entries));
+  IOSTATS_UNLOCK ();
+}
+
+void
+iostats_get (IOStatsEntry entries[IOSTATS_COUNT], int reset)
+{
+  IOSTATS_LOCK ();
+  memcpy (entries, iostats_entries, sizeof (iostats_entries));
+  if (reset)
+    memset (iostats_entries, 0, sizeof (iostats_entries));
+  IOSTATS_UNLOCK ();
+}
+
+/* one line per counter: name value unit events */
+void
+iostats_dump (FILE *fp)
+{
+  IOStatsEntry entries[IOSTATS_COUNT];
+  int i;
+
+  iostats_get (entries, 0);
+
+  for (i = 0; i < IOSTATS_COUNT; i++)
+    fprintf (fp, "%s\t%.0f\t%s\t%lu\n",
+             iostats_names[i],
+             entries[i].value,
+             iostats_units[i],
+             entries[i].events);
+  fflush (fp);
+}
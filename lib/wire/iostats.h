@@ -0,0 +1,64 @@
+/* iostats.h
+// Always compiled counters and scoped timers per subsystem
+// License MIT (http://opensource.org/licenses/mit-license.php)
+*/
+
+#ifndef IO_STATS_H
+#define IO_STATS_H
+
+#include <stdio.h>
+#ifndef WIN32
+#include <sys/time.h>
+#endif
+#include "dll_api.h"
+
+/* every counter keeps a value and the number of events that added to
+   it, the unit of the value is given by iostats_unit() */
+typedef enum
+{
+  IOSTATS_TILE_FAULT,      /* portions allocated on first reference */
+  IOSTATS_TILE_ALLOC,      /* bytes of tile memory allocated */
+  IOSTATS_TILE_FREE,       /* bytes of tile memory freed */
+  IOSTATS_WIRE_READ,       /* bytes read from the plug-in wire */
+  IOSTATS_WIRE_WRITE,      /* bytes written to the plug-in wire */
+  IOSTATS_CMS,             /* usecs spent in colour transforms */
+  IOSTATS_PROJECTION,      /* usecs spent rebuilding projections */
+  IOSTATS_RENDER,          /* usecs spent rendering display exposes */
+  IOSTATS_UNDO,            /* bytes pushed on undo stacks */
+  IOSTATS_COUNT
+} IOStatsCounter;
+
+typedef struct
+{
+  double value;
+  unsigned long events;
+} IOStatsEntry;
+
+typedef struct
+{
+#ifndef WIN32
+  struct timeval start;
+#endif
+  int running;
+} IOStatsTimer;
+
+DLL_API extern IOStatsEntry iostats_entries[IOSTATS_COUNT];
+
+/* cheap enough to leave in the hot paths; callable from any thread,
+   the display render workers count too */
+#define iostats_add(c,n)  iostats_count ((c), (n))
+
+DLL_API void         iostats_count       (IOStatsCounter, double);
+
+DLL_API void         iostats_timer_start (IOStatsTimer *);
+DLL_API void         iostats_timer_stop  (IOStatsTimer *, IOStatsCounter);
+
+DLL_API const char * iostats_name  (IOStatsCounter);
+DLL_API const char * iostats_unit  (IOStatsCounter);
+DLL_API void         iostats_reset (void);
+/* copy all counters at once, then zero them if reset */
+DLL_API void         iostats_get   (IOStatsEntry entries[IOSTATS_COUNT],
+                                    int reset);
+DLL_API void         iostats_dump  (FILE *);
+
+#endif
@@ -31,6 +31,7 @@
 
 #include <unistd.h>
 #include "wire.h"
+#include "iostats.h"
 #include "protocol.h"
 #include "wirebuffer.h"
 #include "../app/plug_in.h"
@@ -263,6 +264,7 @@ int wire_file_write (int fd, guint8 *buf, gulong count)
 int
 wire_read (int fd,guint8 *buf, gulong count) 
 {
+  iostats_add (IOSTATS_WIRE_READ, count);
 #ifdef WIN32
 	if(!wire_read_func)
 	{	return FALSE;
@@ -330,6 +332,7 @@ wire_write (int     fd,
 	    guint8 *buf,
 	    gulong  count)
 {
+  iostats_add (IOSTATS_WIRE_WRITE, count);
 #ifdef WIN32
 	if(!wire_write_func)
 	{	return FALSE;
@@ -1353,6 +1353,78 @@ Br2HdrManager::complete_LogHDR()
     return merge_LogHDR();      // --> HDR_UPDATED
 }
 
+/**+*************************************************************************\n
+  stream_HDR()  --  Pure merging like merge_HDR(), but band by band of 
+   \a band_rows rows into \a sink; no HDR image is allocated.
+
+  @returns false if no Calctor exists or nothing was merged.
+******************************************************************************/
+bool
+Br2HdrManager::stream_HDR (HdrBandSink & sink, int band_rows)
+{
+    IF_FAIL_RETURN (calctor(), false);
+    IF_FAIL_RETURN (init_ResponseForMerging(), false);
+        
+    bool ok = calctor()->stream_HDR (sink, band_rows);
+    distrib_event_.distribute (HDR_UPDATED);
+    
+    return ok;
+}
+
+/**+*************************************************************************\n
+  stream_LogHDR()  --  analog stream_HDR() for a logarithmic HDR.
+******************************************************************************/
+bool
+Br2HdrManager::stream_LogHDR (HdrBandSink & sink, int band_rows)
+{
+    IF_FAIL_RETURN (calctor(), false);
+    IF_FAIL_RETURN (init_ResponseForMerging(), false);
+        
+    bool ok = calctor()->stream_LogHDR (sink, band_rows);
+    distrib_event_.distribute (HDR_UPDATED);
+    
+    return ok;
+}
+
+/**+*************************************************************************\n
+  complete_HDR (HdrBandSink&, int)  --  complete_HDR() streaming into \a sink.
+  @returns false if something wrong (!calctor OR incomplete response).
+******************************************************************************/
+bool
+Br2HdrManager::complete_HDR (HdrBandSink & sink, int band_rows)
+{
+    IF_FAIL_RETURN (calctor(), false);
+    
+    if (! isUsenextResponseReady())
+      if (use_extern_response_) {
+        br::message (_(str_provide_complete_response__));
+        return false;
+      }
+      else
+        compute_Response();     // --> CCD_UPDATED
+    
+    return stream_HDR (sink, band_rows);      // --> HDR_UPDATED
+}
+
+/**+*************************************************************************\n
+  complete_LogHDR (HdrBandSink&, int)  --  complete_LogHDR() streaming into \a sink.
+******************************************************************************/
+bool
+Br2HdrManager::complete_LogHDR (HdrBandSink & sink, int band_rows)
+{
+    IF_FAIL_RETURN (calctor(), false);
+    
+    if (! isUsenextResponseReady())
+      if (use_extern_response_) {
+        br::message (_(str_provide_complete_response__));
+        return false;
+      }
+      else
+        compute_Response();     // --> CCD_UPDATED
+    
+    return stream_LogHDR (sink, band_rows);   // --> HDR_UPDATED
+}
+
 /**+*************************************************************************\n
   make_HDR()  --  init() + Response() + HDR()                       UNUSED
 ******************************************************************************/
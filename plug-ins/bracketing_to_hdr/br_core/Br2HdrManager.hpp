@@ -517,6 +517,12 @@ public:
     //  Compute response if not existent + merge log HDR
     ImageHDR complete_LogHDR();
     
+    //  The same band by band into a sink, without allocating the HDR image
+    bool stream_HDR (HdrBandSink &, int band_rows);
+    bool stream_LogHDR (HdrBandSink &, int band_rows);
+    bool complete_HDR (HdrBandSink &, int band_rows);
+    bool complete_LogHDR (HdrBandSink &, int band_rows);
+    
     //  Init Calctor + response + merge
     ImageHDR make_HDR();
     
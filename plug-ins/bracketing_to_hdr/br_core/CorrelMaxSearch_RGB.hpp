@@ -75,6 +75,7 @@
 #include <cstdio>                    // printf()   
 #include <cassert>                   // assert()
 #include <cmath>                     // sqrt()        
+#include <algorithm>                 // min(), max()
 
 #include "CorrelMaxSearchBase.hpp"   // CorrelMaxSearchBase
 #include "Vec2.hpp"                  // Vec2_int
@@ -82,6 +83,7 @@
 #include "Rgb_utils.hpp"             // <<-Op for Rgb<> (debug)
 #include "Scheme2D.hpp"              // Scheme2D<>
 #include "DynArray1D.hpp"            // DynArray1D<>
+#include "DynArray2D.hpp"            // DynArray2D<>
 #include "TNT/tnt_stopwatch_.hpp"    // TNT::StopWatch 
 #include "TNT/tnt_array2d.hpp"       // TNT::Array2D<>  (canyon feld)
 
@@ -183,8 +185,25 @@ class CorrelMaxSearch_RGB : public CorrelMaxSearchBase
     
   private:
       
+    /*  Pyramid: correlation areas of at least this size on the coarser
+         level; number of its best maxima refined on the finer one, and
+         the refinement window radius */
+    enum { PYRAMID_MIN_CORREL = 8,
+           PYRAMID_MIN_SEARCH = 8,
+           PYRAMID_CANDIDATES = 3,
+           PYRAMID_RADIUS     = 2 };
+      
     Vec2_int  search_pre      ( int xA, int yA, int Nx, int Ny,
                                 int xB, int yB, int Mx, int My );
+    
+    Vec2_int  search_pyramid  ( int xA, int yA, int Nx, int Ny,
+                                int xB, int yB, int Mx, int My );
+    
+    float     correl_at       ( int xA, int yA, int Nx, int Ny, int xB, int yB,
+                                const Rgb<double> & sA, double sA2 ) const;
+    
+    Vec2_int  climb           ( Vec2_int d, int xA, int yA, int Nx, int Ny,
+                                int xB, int yB, const Rgb<double> & sA, double sA2 );
 };
 
 
@@ -424,6 +443,194 @@ CorrelMaxSearch_RGB<Unsign>::search_pre (  int xA, int yA, int Nx, int Ny,
     return d;
 }
 
+/**+*************************************************************************\n
+  search_pyramid()
+
+  Coarse-to-fine variant of search_pre() for large search areas: Both areas
+   are reduced to half size by 2x2 means and searched there -- recursively,
+   as long as the areas are big enough, see search(). The best few local
+   maxima of the coarse canyon, doubled, are then refined at full resolution
+   by climb(). More than one, because on periodic textures the coarse level
+   may well prefer a neighbour peak of nearly the same height.
+   
+  Instead of (Mx-Nx+1)*(My-Ny+1) correlations at full resolution only a few
+   dozens are computed. Canyon values not computed stay at "-2.0"; those of
+   the four neighbours of the result, needed by eval_result(), always are.
+  
+  Parameters and result as for search_pre().
+******************************************************************************/
+template <typename Unsign>
+Vec2_int
+CorrelMaxSearch_RGB<Unsign>::search_pyramid (  int xA, int yA, int Nx, int Ny,
+                                               int xB, int yB, int Mx, int My)
+{
+    assert (xA + Nx <= A.dim2());
+    assert (yA + Ny <= A.dim1());
+    assert (xB + Mx <= B.dim2());
+    assert (yB + My <= B.dim1());
+    assert (Nx <= Mx);
+    assert (Ny <= My);
+    
+    //  Half size copies of both areas (2x2 means)...
+    int  nx = Nx/2,  ny = Ny/2;
+    int  mx = Mx/2,  my = My/2;
+    DynArray2D <Rgb<Unsign> >  a (ny, nx);
+    DynArray2D <Rgb<Unsign> >  b (my, mx);
+    
+    for (int i=0; i < ny; i++)
+    for (int j=0; j < nx; j++)
+    {   Rgb<unsigned> s = Rgb<unsigned> (A [yA+2*i  ][xA+2*j]) + Rgb<unsigned> (A [yA+2*i  ][xA+2*j+1])
+                        + Rgb<unsigned> (A [yA+2*i+1][xA+2*j]) + Rgb<unsigned> (A [yA+2*i+1][xA+2*j+1]);
+        a [i][j] = Rgb<Unsign> ((s + 2u) / 4u);
+    }
+    for (int i=0; i < my; i++)
+    for (int j=0; j < mx; j++)
+    {   Rgb<unsigned> s = Rgb<unsigned> (B [yB+2*i  ][xB+2*j]) + Rgb<unsigned> (B [yB+2*i  ][xB+2*j+1])
+                        + Rgb<unsigned> (B [yB+2*i+1][xB+2*j]) + Rgb<unsigned> (B [yB+2*i+1][xB+2*j+1]);
+        b [i][j] = Rgb<Unsign> ((s + 2u) / 4u);
+    }
+    
+    //  ...searched on the coarser level
+    CorrelMaxSearch_RGB<Unsign>  coarse (Scheme2D <Rgb<Unsign> > (ny, nx, (Rgb<Unsign>*)a),
+                                         Scheme2D <Rgb<Unsign> > (my, mx, (Rgb<Unsign>*)b));
+    Vec2_int  dc = coarse.search (0,0, nx,ny, 0,0, mx,my);
+    
+    //  Refine at full resolution
+    int  qmax = Mx - Nx;
+    int  pmax = My - Ny;
+    canyon_ = TNT::Array2D <float> (pmax+1, qmax+1, -2.0);  // -2: not computed
+    
+    Rgb<double> sA(0.0);
+    double      sA2(0.0);
+    for (int i=0; i < Ny; i++)
+    for (int j=0; j < Nx; j++)
+    {   Rgb<double> a = A[yA+i][xA+j];        // double <-- Unsign
+        sA  += a;
+        sA2 += a.length2();
+    }
+    
+    //  The best local maxima of the coarse canyon
+    const TNT::Array2D <float> & cc = coarse.canyon();
+    Vec2_int  cand [PYRAMID_CANDIDATES];
+    int       ncand = 0;
+    
+    for (int p=0; p < cc.dim1(); p++)
+    for (int q=0; q < cc.dim2(); q++)
+    {
+        float v = cc[p][q];
+        if (v == -2.0f) continue;       // not computed (pyramid below)
+        
+        bool is_max = true;
+        for (int i = std::max (0, p-1); i <= std::min (cc.dim1()-1, p+1); i++)
+        for (int j = std::max (0, q-1); j <= std::min (cc.dim2()-1, q+1); j++)
+          if (cc[i][j] > v) is_max = false;
+        if (!is_max) continue;
+        
+        //  Insert sorted; if full, only when better than the last
+        int k = ncand;
+        if (k == PYRAMID_CANDIDATES) {
+          if (cc[cand[k-1].y][cand[k-1].x] >= v) continue;
+          k--;
+        }
+        else ncand++;
+        while (k > 0 && cc[cand[k-1].y][cand[k-1].x] < v) {
+          cand[k] = cand[k-1];
+          k--;
+        }
+        cand[k] = Vec2_int (q,p);
+    }
+    if (ncand == 0)
+      cand[ncand++] = dc;
+    
+    //  Refine each at full resolution, keep the best
+    Vec2_int  d;
+    float     rho_max = -2.0f;
+    
+    for (int k=0; k < ncand; k++)
+    {
+        Vec2_int  start (std::min (2*cand[k].x, qmax), std::min (2*cand[k].y, pmax));
+        Vec2_int  dk = climb (start, xA,yA, Nx,Ny, xB,yB, sA,sA2);
+        if (canyon_[dk.y][dk.x] > rho_max) {
+          rho_max = canyon_[dk.y][dk.x];
+          d = dk;
+        }
+    }
+    
+    rho_max_ = canyon_[d.y][d.x];
+    eval_result (d);
+    
+#ifdef VERBOSE_CORREL    
+    printf ("\t%s: coarse d=(%d,%d), d_LO=(%d,%d), rho= %f, min.grad= %f, auf_Rand= %d\n",
+        __func__, dc.x, dc.y, d.x, d.y, rho_max_, min_gradient_, border_reached_);
+#endif
+    
+    return d;
+}
+
+/**+*************************************************************************\n
+  climb()  --  Helper of search_pyramid(): Climbs the canyon from \a d to a
+   local maximum. Correlations are computed (and kept in \a canyon_) in a 
+   (2r+1)x(2r+1) window around \a d only; the window moves to its maximum
+   until the maximum is in its center.
+******************************************************************************/
+template <typename Unsign>
+Vec2_int
+CorrelMaxSearch_RGB<Unsign>::climb (  Vec2_int d, int xA, int yA, int Nx, int Ny,
+                                      int xB, int yB,
+                                      const Rgb<double> & sA, double sA2)
+{
+    int  qmax = canyon_.dim2() - 1;
+    int  pmax = canyon_.dim1() - 1;
+    const int r = PYRAMID_RADIUS;
+    
+    for (;;)
+    {
+        Vec2_int  best = d;
+        for (int p = std::max (0, d.y-r); p <= std::min (pmax, d.y+r); p++)
+        for (int q = std::max (0, d.x-r); q <= std::min (qmax, d.x+r); q++)
+        {
+            if (canyon_[p][q] == -2.0f)
+              canyon_[p][q] = correl_at (xA,yA, Nx,Ny, xB+q,yB+p, sA,sA2);
+            
+            if (canyon_[p][q] > canyon_[best.y][best.x])
+              best = Vec2_int (q,p);
+        }
+        if (best == d) return d;        // maximum in the window center
+        d = best;
+    }
+}
+
+/**+*************************************************************************\n
+  correl_at()  --  Correlation coefficient of the [Nx,Ny] area of \a A at
+   (xA,yA) with that of \a B at (xB,yB). \a sA, \a sA2: sums of the A-values
+   and of their squares, the same for all positions.
+******************************************************************************/
+template <typename Unsign>
+float
+CorrelMaxSearch_RGB<Unsign>::correl_at (  int xA, int yA, int Nx, int Ny,
+                                          int xB, int yB,
+                                          const Rgb<double> & sA, double sA2) const
+{
+    Rgb<double> sB(0.0);
+    double      sB2(0.0), sAB(0.0);
+    
+    for (int i=0; i < Ny; i++)
+    for (int j=0; j < Nx; j++)
+    {   Rgb<double> a = A[yA+i][xA+j];        // double <-- Unsign
+        Rgb<double> b = B[yB+i][xB+j];
+        sB  += b;
+        sB2 += b.length2();
+        sAB += dot(a,b);
+    }
+    
+    int    n   = Nx * Ny;
+    double cov = sAB - dot(sA,sB)/n;            // eigentlich n*cov, nicht cov
+
+    if (cov == 0.0)
+         return 0.0f;
+    else return cov / sqrt( (sA2 - sA.length2()/n) * (sB2 - sB.length2()/n));
+}
+
 /**+*************************************************************************\n
   The official search() routine. Wrapper for the various probe routines, 
    selects one of these (the best).
@@ -441,6 +648,13 @@ CorrelMaxSearch_RGB<Unsign>::search     ( int xA, int yA, int Nx, int Ny,
                                           int xB, int yB, int Mx, int My )
 {
     //return search_ela_pre (xA,yA, Nx,Ny, xB,yB, Mx,My);
+    
+    //  Large search areas coarse-to-fine, if the correlation areas stay
+    //   meaningful at half size
+    if (Nx >= 2*PYRAMID_MIN_CORREL && Ny >= 2*PYRAMID_MIN_CORREL &&
+        std::max (Mx-Nx, My-Ny) >= PYRAMID_MIN_SEARCH)
+      return search_pyramid (xA,yA, Nx,Ny, xB,yB, Mx,My);
+    
     return search_pre (xA,yA, Nx,Ny, xB,yB, Mx,My);
 }                                          
 
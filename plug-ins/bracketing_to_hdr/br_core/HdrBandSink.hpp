@@ -0,0 +1,68 @@
+/*
+ * HdrBandSink.hpp  --  Part of the CinePaint plug-in "Bracketing_to_HDR"
+ *
+ * LICENSE:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+/**
+  @file HdrBandSink.hpp
+
+  Abstract receiver of an HDR image merged band by band.
+*/
+#ifndef HdrBandSink_hpp
+#define HdrBandSink_hpp
+
+
+#include "Rgb.hpp"              // Rgb<>
+
+
+namespace br {
+
+/**===========================================================================
+
+  @class HdrBandSink
+
+  The stream_...() merging functions do not allocate the full-size float
+   result, they merge a band of rows at a time and hand it to a HdrBandSink.
+   Like ProgressInfo the class keeps the numerical code free from any
+   concrete GUI or host: the CinePaint frontend derives a sink writing the
+   bands into a drawable.
+
+  Call sequence: begin() once, put_rows() for the bands top down, end() once
+   (only if begin() returned true).
+
+=============================================================================*/
+class HdrBandSink
+{
+  public:
+    virtual ~HdrBandSink()  {}
+
+    /**  Prepare for an image of \a width x \a height; false cancels merging */
+    virtual bool  begin    (int width, int height) = 0;
+
+    /**  Take rows [y0, y0+nrows), \a width pixels each, row after row. The
+          buffer is reused for the next band. */
+    virtual void  put_rows (int y0, int nrows, const Rgb<float>* rows) = 0;
+
+    /**  All rows delivered */
+    virtual void  end      () = 0;
+};
+
+}  // namespace "br"
+
+#endif  // HdrBandSink_hpp
+
+// END OF FILE
@@ -35,6 +35,7 @@
 #include "br_PackBase.hpp"          // PackBase
 #include "FollowUpValuesBase.hpp"
 #include "ResponseSolverBase.hpp"   // ResponseSolverBase::SolveMode
+#include "HdrBandSink.hpp"          // HdrBandSink
 
 
 
@@ -306,6 +307,14 @@ public:
     virtual ImageHDR merge_HDR() = 0;
     virtual ImageHDR merge_LogHDR() = 0;
 
+    /**
+    *   Merge as above, but hand the image band by band of \a band_rows rows
+    *    to \a sink instead of allocating it. False if no response curves
+    *    exist or the sink refused.
+    */
+    virtual bool stream_HDR (HdrBandSink & sink, int band_rows) = 0;
+    virtual bool stream_LogHDR (HdrBandSink & sink, int band_rows) = 0;
+
         
     /**
     *   Complete the HDR image [or channel] calculation, i.e. pure merging,
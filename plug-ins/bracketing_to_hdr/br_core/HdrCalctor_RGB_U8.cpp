@@ -201,6 +201,36 @@ HdrCalctor_RGB_U8::merge_LogHDR()
                                 protocol_to_file(), protocol_to_stdout());
 }
 
+/**+*************************************************************************\n
+  Merge the LDR pack band by band into \a sink, see stream_Hdr_RGB_U8().
+   @return false, if response curves not ready or the sink refused.
+******************************************************************************/
+bool
+HdrCalctor_RGB_U8::stream_HDR (HdrBandSink & sink, int band_rows)
+{
+    IF_FAIL_RETURN (isResponseReady(), false);
+
+    return stream_Hdr_RGB_U8 (pack_,
+                              logXcrv_[0], logXcrv_[1], logXcrv_[2],
+                              *pWeightMerge_, sink, band_rows, mark_bad_pixel(),
+                              protocol_to_file(), protocol_to_stdout());
+}
+
+/**+*************************************************************************\n
+  Merge the LDR pack band by band into \a sink as a logarithmic HDR image.
+   @return false, if response curves not ready or the sink refused.
+******************************************************************************/
+bool
+HdrCalctor_RGB_U8::stream_LogHDR (HdrBandSink & sink, int band_rows)
+{
+    IF_FAIL_RETURN (isResponseReady(), false);
+
+    return stream_LogHdr_RGB_U8 (pack_,
+                                 logXcrv_[0], logXcrv_[1], logXcrv_[2],
+                                 *pWeightMerge_, sink, band_rows, mark_bad_pixel(),
+                                 protocol_to_file(), protocol_to_stdout());
+}
+
 /**+*************************************************************************\n
   Complete the HDR image calculation, i.e. pure merging, if response curves
    already exists, else compute them before.
@@ -165,6 +165,10 @@ public:
     ImageHDR merge_HDR();
     ImageHDR merge_LogHDR();
 
+    /*  Merge band by band into a sink, without allocating the HDR image */
+    bool stream_HDR (HdrBandSink & sink, int band_rows);
+    bool stream_LogHDR (HdrBandSink & sink, int band_rows);
+
     /*  Complete an HDR image creation. If response curves exist, merge only, 
          else compute them before. */
     ImageHDR complete_HDR();
@@ -0,0 +1,188 @@
+/*
+ * RowBands.cpp  --  Part of the CinePaint plug-in "Bracketing_to_HDR"
+ *
+ * LICENSE:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+/**
+  RowBands.cpp
+*/
+#include "config.h"                     // HAVE_PTHREAD
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+#  include <unistd.h>                   // sysconf()
+#endif
+
+#include "TheProgressInfo.hpp"          // TheProgressInfo
+#include "RowBands.hpp"
+
+
+namespace br {
+
+/**  Rows per band handed out at once, and upper limit of threads */
+static const int  ROWS_PER_BAND = 16;
+static const int  MAX_SLOTS     = 16;
+
+
+#ifdef HAVE_PTHREAD
+
+/**  The bands not yet taken and the rows finished, shared by all threads */
+struct BandQueue 
+{
+    RowBandWork *     work;
+    int               end;              // rows [next,end) are left
+    int               next;             // first row not yet taken
+    int               done;             // number of rows finished
+    pthread_mutex_t   lock;
+    pthread_cond_t    finished;         // signalled when `done' grows
+};
+
+struct BandWorker 
+{
+    BandQueue *       queue;
+    int               slot;
+    pthread_t         thread;
+};
+
+/**  Take the next band [y0,y1) under the lock; false if none left */
+static bool  take_band (BandQueue* q, int & y0, int & y1)
+{
+    pthread_mutex_lock (&q->lock);
+    y0 = q->next;
+    y1 = y0 + ROWS_PER_BAND;
+    if (y1 > q->end) y1 = q->end;
+    q->next = y1;
+    pthread_mutex_unlock (&q->lock);
+    return y0 < y1;
+}
+
+static void  band_done (BandQueue* q, int nrows)
+{
+    pthread_mutex_lock (&q->lock);
+    q->done += nrows;
+    pthread_cond_signal (&q->finished);
+    pthread_mutex_unlock (&q->lock);
+}
+
+static void*  band_worker (void* arg)
+{
+    BandWorker* w = (BandWorker*) arg;
+    int y0, y1;
+    
+    while (take_band (w->queue, y0, y1)) {
+      w->queue->work->rows (y0, y1, w->slot);
+      band_done (w->queue, y1 - y0);
+    }
+    return 0;
+}
+
+#endif  // HAVE_PTHREAD
+
+
+int  row_band_slots (int nrows)
+{
+#ifdef HAVE_PTHREAD
+    long  n     = sysconf (_SC_NPROCESSORS_ONLN);
+    int   bands = (nrows + ROWS_PER_BAND - 1) / ROWS_PER_BAND;
+    
+    if (n > MAX_SLOTS) n = MAX_SLOTS;
+    if (n > bands)     n = bands;
+    if (n < 1)         n = 1;
+    return n;
+#else
+    return 1;
+#endif
+}
+
+
+void  run_row_bands (RowBandWork & work, int y_begin, int y_end, int nslots,
+                     float progress_per_row)
+{
+    int  nrows = y_end - y_begin;
+    
+#ifdef HAVE_PTHREAD
+    if (nslots > MAX_SLOTS) nslots = MAX_SLOTS;
+    
+    if (nslots > 1)
+    {
+      BandQueue   q;
+      BandWorker  workers [MAX_SLOTS];
+      int         nworkers = 0;
+      int         reported = 0;
+      int         y0, y1;
+      
+      q.work  = &work;
+      q.end   = y_end;
+      q.next  = y_begin;
+      q.done  = 0;
+      pthread_mutex_init (&q.lock, 0);
+      pthread_cond_init (&q.finished, 0);
+      
+      //  Slot 0 is ours; a worker that could not be started leaves its
+      //   bands to the others.
+      for (int i=1; i < nslots; i++) {
+        workers[nworkers].queue = &q;
+        workers[nworkers].slot  = i;
+        if (pthread_create (&workers[nworkers].thread, 0, band_worker,
+                            &workers[nworkers]) == 0)
+          nworkers++;
+      }
+      
+      while (take_band (&q, y0, y1)) {
+        work.rows (y0, y1, 0);
+        band_done (&q, y1 - y0);
+        
+        pthread_mutex_lock (&q.lock);
+        int done = q.done;
+        pthread_mutex_unlock (&q.lock);
+        TheProgressInfo::forward (progress_per_row * (done - reported));
+        reported = done;
+      }
+      
+      //  Wait for the bands still running elsewhere, reporting on the way
+      pthread_mutex_lock (&q.lock);
+      while (q.done < nrows) {
+        pthread_cond_wait (&q.finished, &q.lock);
+        int done = q.done;
+        pthread_mutex_unlock (&q.lock);
+        TheProgressInfo::forward (progress_per_row * (done - reported));
+        reported = done;
+        pthread_mutex_lock (&q.lock);
+      }
+      pthread_mutex_unlock (&q.lock);
+      
+      for (int i=0; i < nworkers; i++)
+        pthread_join (workers[i].thread, 0);
+      
+      pthread_cond_destroy (&q.finished);
+      pthread_mutex_destroy (&q.lock);
+      
+      if (reported < nrows)
+        TheProgressInfo::forward (progress_per_row * (nrows - reported));
+      return;
+    }
+#endif  // HAVE_PTHREAD
+
+    for (int y=y_begin; y < y_end; y++) {
+      work.rows (y, y+1, 0);
+      TheProgressInfo::forward (progress_per_row);
+    }
+}
+
+}  // namespace "br"
+
+// END OF FILE
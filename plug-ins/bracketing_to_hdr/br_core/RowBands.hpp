@@ -0,0 +1,65 @@
+/*
+ * RowBands.hpp  --  Part of the CinePaint plug-in "Bracketing_to_HDR"
+ *
+ * LICENSE:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+/**
+  @file RowBands.hpp
+  
+  Running a line-wise computation over bands of rows on several threads.
+   
+  The rows are handed out in bands of a few lines to the calling thread
+   and up to row_band_slots()-1 worker threads. Each band is processed by
+   exactly one thread; \a slot tells which, so the work object can keep
+   per-thread results (min-max values etc.) without locking.
+   
+  Progress is reported only from the calling thread, the one owning the GUI.
+*/
+#ifndef RowBands_hpp
+#define RowBands_hpp
+
+
+namespace br {
+
+/**===========================================================================
+  @class RowBandWork  --  abstract work of run_row_bands().
+  
+  rows(y0,y1,slot) has to process rows [y0,y1) and may be called concurrently
+   for different bands with different slots [0, nslots).
+=============================================================================*/
+class RowBandWork 
+{
+  public:
+    virtual ~RowBandWork()  {}
+    virtual void rows (int y0, int y1, int slot) = 0;
+};
+
+
+/**  Number of slots (threads) worth using for \a nrows rows; 1 without threads */
+int   row_band_slots  (int nrows);
+
+/**  Process rows [y_begin,y_end) by \a work on \a nslots threads and forward
+      the progress info by \a progress_per_row per finished row. With nslots
+      <= 1 all runs line by line in the calling thread. */
+void  run_row_bands   (RowBandWork & work, int y_begin, int y_end, int nslots,
+                       float progress_per_row);
+
+}  // namespace "br"
+
+#endif  // RowBands_hpp
+
+// END OF FILE
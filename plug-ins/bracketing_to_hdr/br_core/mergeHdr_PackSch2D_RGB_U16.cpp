@@ -25,6 +25,8 @@
   Contents: 
    - merge_Hdr_RGB_U16()    :  merging of an HDR-image
    - merge_LogHdr_RGB_U16() :  merging of an logarithmic HDR-image
+   - stream_Hdr_RGB_U16(), stream_LogHdr_RGB_U16() :  the same band by band
+      into a HdrBandSink
 */
 
 #include <cassert>                      // assert()
@@ -44,6 +46,9 @@
 #include "ResponseFunc_U16.hpp"         // ResponseFunc_U16
 #include "TheProgressInfo.hpp"          // TheProgressInfo
 #include "BadPixelProtocol.hpp"         // BadPixelProtocol
+#include "DynArray1D.hpp"               // DynArray1D<>
+#include "RowBands.hpp"                 // run_row_bands()
+#include "HdrBandSink.hpp"              // HdrBandSink
 #include "mergeHdr_PackSch2D_RGB_U16.hpp"
 
 
@@ -56,108 +61,131 @@ using std::max;
 using std::cout;
 
 
-
 /**+*************************************************************************\n
-  merge_Hdr_RGB_U16()  --  Description see: merge_Hdr_RGB_U8().
-  
-  Provisorisch, um ins momentane HdrManager-Regime zu passen: Wir interpretieren
-   die logX-Arrays als Gitterwerte einer tabellierten Responsefunktion zu den
-   Stuetzstellen z=256*i+127. Die Spline-y2-Tabellen werden hier erzeugt. Besser
-   sollten diese Responsefunktionen als Argument uebergeben werden, was erlaubte,
-   die Funktionen ausserhalb zu initialisieren (spline oder tabellieren) und so 
-   mehrfach zu verwenden.
+  gather_min_max()  --  Overall min-max values from the per-slot ones.
 ******************************************************************************/
-br::Image    // IMAGE_RGB_F32
-merge_Hdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16  & pack,
-                   const TNT::Array1D<double>   & logX_R,
-                   const TNT::Array1D<double>   & logX_G,
-                   const TNT::Array1D<double>   & logX_B,
-                   const WeightFunc_U16         & weight,
-                   bool                         mark_bad_pixel, 
-                   bool                         protocol_to_file,
-                   bool                         protocol_to_stdout )
+static void 
+gather_min_max (const DynArray1D< Rgb<float> > & mi,
+                const DynArray1D< Rgb<float> > & ma, int nslots,
+                Rgb<float> & h_min, Rgb<float> & h_max)
 {
-    cout <<__func__<< "(Array1D)...\n";
-    
-    assert (logX_R.dim() == 256);
-    assert (logX_G.dim() == 256);
-    assert (logX_B.dim() == 256);
-    
-    //  Create interpolating response functions from the table values
-    ResponseFunc_U16  resp_R (logX_R),
-                      resp_G (logX_G),
-                      resp_B (logX_B);
-    
-    return merge_Hdr_RGB_U16 (pack, resp_R, resp_G, resp_B, weight, mark_bad_pixel,
-                              protocol_to_file, protocol_to_stdout);
+    h_min = mi[0];
+    h_max = ma[0];
+    for (int i=1; i < nslots; i++) {
+      h_min.r = min (h_min.r, mi[i].r);   h_max.r = max (h_max.r, ma[i].r);
+      h_min.g = min (h_min.g, mi[i].g);   h_max.g = max (h_max.g, ma[i].g);
+      h_min.b = min (h_min.b, mi[i].b);   h_max.b = max (h_max.b, ma[i].b);
+    }
 }
 
+
+static const uint16  z_max = 65535;
+
+//  "Marken-Werte" zur Markierung null-gewichteter Pixel im log. HDR. Sollten
+//   Werte sein, die moeglichst nicht als (logarithm) HDR-Werte auftreten.
+static const float   mark_for_Min = 1e30;
+static const float   mark_for_Max = 1e31;
+
+
 /**+*************************************************************************\n
-  merge_Hdr_RGB_U16()  --  see: merge_Hdr_RGB_U8()
+  threshold_min()  --  Min. threshold z-value, where weight fnct switches to != 0
 ******************************************************************************/
-br::Image    // IMAGE_RGB_F32
-merge_Hdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
-                   const ResponseFunc_U16 &  logX_R,
-                   const ResponseFunc_U16 &  logX_G,
-                   const ResponseFunc_U16 &  logX_B,
-                   const WeightFunc_U16   &  weight,
-                   bool                      mark_bad_pixel, 
-                   bool                      protocol_to_file,
-                   bool                      protocol_to_stdout )
+static uint16
+threshold_min (const WeightFunc_U16 & weight)
 {
-    cout <<__func__<< "(ResponseFunc)...\n";
-    //assert (weight.have_table());
+    uint16  z = 0;
+    while ((z < z_max) && (weight(z) == 0.0))
+      z ++;
+    return z;
+}
 
-    //  Init protocol stuff
-    const char*       fname = protocol_to_file ? BadPixelProtocol::default_fname() : 0;
-    BadPixelProtocol  protocol (fname, protocol_to_stdout);
-    bool              make_protocol = protocol.file() || protocol_to_stdout;
-    cout << "\t(to_file=" << protocol_to_file 
-         << ",  to_stdout=" << protocol_to_stdout
-         << ",  make_protocol=" << make_protocol << ")\n";
-    
-    //  Init progress info
-    TheProgressInfo::start (1.0, _("Merging HDR image..."));
-    
-    int          nlayers = pack.size();
-    int          dim1    = pack.dim1();
-    int          dim2    = pack.dim2();
-    const uint16 z_max   = 65535;
-    
-    const Array1D<double> & logtimes = pack.logtimeVec(); // short name
 
-    //  Determine min. threshold z-value, where weight fnct switches to != 0
-    uint16  z_threshold_min = 0;
-    while ((z_threshold_min < z_max) && (weight(z_threshold_min) == 0.0)) 
-      z_threshold_min ++;
-    cout << "\tz-threshold-min = " << (int)z_threshold_min << '\n';
+/**+*************************************************************************\n
+  scale_log_rows()  --  Scale \a n log. HDR values so that [min_all, min_all +
+   1/fac_all] -> [0,1]. If "bad pixel" were marked, set them to their contrast
+   values instead.
+******************************************************************************/
+static void
+scale_log_rows (Rgb<float>* hdr, long n, float min_all, float fac_all,
+                bool mark_bad_pixel)
+{
+    if (mark_bad_pixel)
+      for (long i=0; i < n; i++)
+      {
+        Rgb<float>& h = hdr[i];                   // short name
 
-    //===========
-    // 2D-Sicht
-    //===========
-    //  Alloc (untyped buffer for) HDR image (dim2==W, dim1==H)
-    Image  img (dim2, dim1, IMAGE_RGB_F32, "HDR: RGB 32-bit Float");
-    //  ...and create a typecasted 2D-view on it
-    ImgScheme2DView< Rgb<float> >  hdr (img);
+        if (h.r == mark_for_Min)       h.r = 1.0;     // Kontrast zum Minimum
+        else if (h.r == mark_for_Max)  h.r = 0.0;     // Kontrast zum Maximum
+        else                           h.r = fac_all * (h.r - min_all);
 
-    //  Smallest and largest resolvable HDR value of this image series
-    Rgb<float> val_min (exp (logX_R(0) - logtimes[nlayers-1]),
-                        exp (logX_G(0) - logtimes[nlayers-1]),
-                        exp (logX_B(0) - logtimes[nlayers-1]));
+        if (h.g == mark_for_Min)       h.g = 1.0;     // Kontrast zum Minimum
+        else if (h.g == mark_for_Max)  h.g = 0.0;     // Kontrast zum Maximum
+        else                           h.g = fac_all * (h.g - min_all);
 
-    Rgb<float> val_max (exp (logX_R(z_max) - logtimes[0]),
-                        exp (logX_G(z_max) - logtimes[0]),
-                        exp (logX_B(z_max) - logtimes[0]));
+        if (h.b == mark_for_Min)       h.b = 1.0;     // Kontrast zum Minimum
+        else if (h.b == mark_for_Max)  h.b = 0.0;     // Kontrast zum Maximum
+        else                           h.b = fac_all * (h.b - min_all);
+      }
+    else
+      for (long i=0; i < n; i++)
+        hdr[i] = fac_all * (hdr[i] - min_all);
+}
 
-    float max_float = std::numeric_limits<float>::max();
-    Rgb<float>  h_min ( max_float);  // Init with largest possible value
-    Rgb<float>  h_max (-max_float);  // Init with least possible value
 
-    Stopwatch uhr;  uhr.start();
-    float progress_add = 1.0 / dim1;  // progress forward per line
+/**===========================================================================
+  HdrRows_RGB_U16  --  the per-pixel work of merge_Hdr_RGB_U16() for a band of rows,
+   see RowBands.hpp. Response and weight functions are only read, so bands
+   can be merged concurrently; min-max values are kept per slot.
+=============================================================================*/
+struct HdrRows_RGB_U16 : public RowBandWork
+{
+    const PackImgScheme2D_RGB_U16 &  pack;
+    const ResponseFunc_U16 &         logX_R;
+    const ResponseFunc_U16 &         logX_G;
+    const ResponseFunc_U16 &         logX_B;
+    const WeightFunc_U16 &           weight;
+    const Array1D<double> &          logtimes;
+    Rgb<float> *                     out;            // rows from out_y0 on, dim2 each
+    int                              out_y0;
+    Rgb<float>                       val_min, val_max;
+    uint16                           z_threshold_min;
+    bool                             mark_bad_pixel;
+    BadPixelProtocol *               protocol;       // 0 if none; with one slot only
+    DynArray1D< Rgb<float> >         h_min, h_max;   // per slot
+
+    HdrRows_RGB_U16 (const PackImgScheme2D_RGB_U16 & pack_,
+       const ResponseFunc_U16 & R, const ResponseFunc_U16 & G, const ResponseFunc_U16 & B,
+       const WeightFunc_U16 & w, int nslots)
+      : pack(pack_), logX_R(R), logX_G(G), logX_B(B), weight(w),
+        logtimes(pack_.logtimeVec()), out(0), out_y0(0),
+        mark_bad_pixel(false), protocol(0),
+        h_min(nslots, Rgb<float>( std::numeric_limits<float>::max())),
+        h_max(nslots, Rgb<float>(-std::numeric_limits<float>::max()))
+      {
+        int nlayers = pack.size();
+        z_threshold_min = threshold_min (weight);
+        
+        //  Smallest and largest resolvable HDR value of this image series
+        val_min = Rgb<float> (exp (logX_R(0) - logtimes[nlayers-1]),
+                              exp (logX_G(0) - logtimes[nlayers-1]),
+                              exp (logX_B(0) - logtimes[nlayers-1]));
+
+        val_max = Rgb<float> (exp (logX_R(z_max) - logtimes[0]),
+                              exp (logX_G(z_max) - logtimes[0]),
+                              exp (logX_B(z_max) - logtimes[0]));
+      }
+    
+    void rows (int y0, int y1, int slot);
+};
 
-    //  for all pixels...
-    for (int y=0; y < dim1; y++)
+void HdrRows_RGB_U16::rows (int y0, int y1, int slot)
+{
+    int          nlayers = pack.size();
+    int          dim2    = pack.dim2();
+    Rgb<float> & mi      = h_min [slot];   // min-max values of this slot
+    Rgb<float> & ma      = h_max [slot];
+    
+    for (int y=y0; y < y1; y++)
     {
       for (int x=0; x < dim2; x++)
       {
@@ -179,7 +207,7 @@ merge_Hdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
           sum_e.b += w.b * (logX_B(z.b) - logtimes[p]);
         }
       
-        Rgb<float>&  h = hdr [y] [x];     // short name
+        Rgb<float>&  h = out [(y - out_y0) * dim2 + x];   // short name
 
         //  Compute "h = exp (sum_e / sum_w)", consider cases with sum_w==0
         //
@@ -214,10 +242,10 @@ merge_Hdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
           else h.b = val_max.b;                 // also z > z_threshold_max
         }
 
-        //  Protokoll-Ausgabe: vor dem Markieren, da Letzteres `h aendert und
+        //  Protokoll-Ausgabe: vor dem Markieren, da Letzteres `h� aendert und
         //   danach nur die Markierungswerte noch im Protokoll erschienen.
-        if (make_protocol)  
-          protocol.out (x,y, sum_w, h, val_min, val_max);
+        if (protocol)  
+          protocol->out (x,y, sum_w, h, val_min, val_max);
              
         //  Mark "bad" (cropped, unresolved) pixel
         if (mark_bad_pixel) {
@@ -235,145 +263,73 @@ merge_Hdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
         }  
       
         //  MinMax feststellen... (fakultativ)
-        if (h.r < h_min.r) h_min.r = h.r; else
-        if (h.r > h_max.r) h_max.r = h.r;
+        if (h.r < mi.r) mi.r = h.r;
+        if (h.r > ma.r) ma.r = h.r;
 
-        if (h.g < h_min.g) h_min.g = h.g; else
-        if (h.g > h_max.g) h_max.g = h.g;
+        if (h.g < mi.g) mi.g = h.g;
+        if (h.g > ma.g) ma.g = h.g;
 
-        if (h.b < h_min.b) h_min.b = h.b; else
-        if (h.b > h_max.b) h_max.b = h.b;
+        if (h.b < mi.b) mi.b = h.b;
+        if (h.b > ma.b) ma.b = h.b;
       
       }  // for all x (columns)
-      
-      TheProgressInfo::forward (progress_add);
-    
     }  // for all y (lines)
-
-        
-    //  Weil bei streng fallenden Folgen obige else-Zweige nie erreicht
-    //   wuerden, pruefen, ob h_max geaendert wurde; wenn nicht, ist
-    //   Maximalwert der erste, denn wie gesagt: streng fallend...
-    
-    if (h_max.r == -max_float) h_max.r = hdr[0][0].r;
-    if (h_max.g == -max_float) h_max.g = hdr[0][0].g;
-    if (h_max.b == -max_float) h_max.b = hdr[0][0].b;
-
-    double zeit = uhr.stop();
-    printf ("\tTime for HDR merging: %f sec\n", zeit);
-
-    cout << "min. resolvable HDR value = " << val_min << '\n';
-    cout << "   image's min. HDR value = " << h_min   << '\n';
-    cout << "max. resolvable HDR value = " << val_max << '\n';
-    cout << "   image's max. HDR value = " << h_max   << '\n';
-
-    TheProgressInfo::finish();
-    return img;
 }
 
 
-/**+*************************************************************************\n
-  merge_Hdr_RGB_U16 (..., TNT::Array1D)  
-   
-  Provisorisch... see: merge_Hdr_RGB_U16(..., TNT::Array1D).
-******************************************************************************/
-br::Image    // IMAGE_RGB_F32
-merge_LogHdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
-                      const TNT::Array1D<double> &  logX_R,
-                      const TNT::Array1D<double> &  logX_G,
-                      const TNT::Array1D<double> &  logX_B,
-                      const WeightFunc_U16 &        weight,
-                      bool                          mark_bad_pixel, 
-                      bool                          protocol_to_file,
-                      bool                          protocol_to_stdout )
+/**===========================================================================
+  LogHdrRows_RGB_U16  --  the per-pixel work of merge_LogHdr_RGB_U16() for a band of rows,
+   see RowBands.hpp. Comments see HdrRows_RGB_U16.
+=============================================================================*/
+struct LogHdrRows_RGB_U16 : public RowBandWork
 {
-    cout <<__func__<< "(Array1D)...\n";
-    
-    assert (logX_R.dim() == 256);
-    assert (logX_G.dim() == 256);
-    assert (logX_B.dim() == 256);
-    
-    //  Create interpolating response functions from the table values
-    ResponseFunc_U16  resp_R (logX_R),
-                      resp_G (logX_G),
-                      resp_B (logX_B);
+    const PackImgScheme2D_RGB_U16 &  pack;
+    const ResponseFunc_U16 &         logX_R;
+    const ResponseFunc_U16 &         logX_G;
+    const ResponseFunc_U16 &         logX_B;
+    const WeightFunc_U16 &           weight;
+    const Array1D<double> &          logtimes;
+    Rgb<float> *                     out;            // rows from out_y0 on, dim2 each
+    int                              out_y0;
+    Rgb<float>                       val_min, val_max;
+    uint16                           z_threshold_min;
+    bool                             mark_bad_pixel;
+    BadPixelProtocol *               protocol;       // 0 if none; with one slot only
+    DynArray1D< Rgb<float> >         h_min, h_max;   // per slot
+
+    LogHdrRows_RGB_U16 (const PackImgScheme2D_RGB_U16 & pack_,
+       const ResponseFunc_U16 & R, const ResponseFunc_U16 & G, const ResponseFunc_U16 & B,
+       const WeightFunc_U16 & w, int nslots)
+      : pack(pack_), logX_R(R), logX_G(G), logX_B(B), weight(w),
+        logtimes(pack_.logtimeVec()), out(0), out_y0(0),
+        mark_bad_pixel(false), protocol(0),
+        h_min(nslots, Rgb<float>( std::numeric_limits<float>::max())),
+        h_max(nslots, Rgb<float>(-std::numeric_limits<float>::max()))
+      {
+        int nlayers = pack.size();
+        z_threshold_min = threshold_min (weight);
+        
+        //  Smallest and largest resolvable log.HDR value of this image series
+        val_min = Rgb<float> (logX_R(0) - logtimes[nlayers-1],
+                              logX_G(0) - logtimes[nlayers-1],
+                              logX_B(0) - logtimes[nlayers-1]);
+
+        val_max = Rgb<float> (logX_R(z_max) - logtimes[0],
+                              logX_G(z_max) - logtimes[0],
+                              logX_B(z_max) - logtimes[0]);
+      }
     
-    return merge_LogHdr_RGB_U16 (pack, resp_R, resp_G, resp_B, weight, mark_bad_pixel, 
-                                 protocol_to_file, protocol_to_stdout); 
-}
+    void rows (int y0, int y1, int slot);
+};
 
-/**+*************************************************************************\n
-  merge_LogHdr_RGB_U16 (ResponseFunc_U16)  --  see: merge_Hdr_RGB_U16().
-******************************************************************************/
-br::Image    // IMAGE_RGB_F32
-merge_LogHdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
-                      const ResponseFunc_U16 &  logX_R,
-                      const ResponseFunc_U16 &  logX_G,
-                      const ResponseFunc_U16 &  logX_B,
-                      const WeightFunc_U16   &  weight,
-                      bool                      mark_bad_pixel, 
-                      bool                      protocol_to_file,
-                      bool                      protocol_to_stdout )
+void LogHdrRows_RGB_U16::rows (int y0, int y1, int slot)
 {
-    cout <<__func__<< "( ResponseFunc_U16 )...\n";
-    //assert (weight.have_table());
-
-    //  Init protocol stuff
-    const char*       fname = protocol_to_file ? BadPixelProtocol::default_fname() : 0;
-    BadPixelProtocol  protocol (fname, protocol_to_stdout);
-    bool              make_protocol = protocol.file() || protocol_to_stdout;
-    
-    cout << "\t(to_file=" << protocol_to_file 
-         << ",  to_stdout=" << protocol_to_stdout
-         << ",  make_protocol=" << make_protocol << ")\n";
-    
-    //  Init progress info
-    TheProgressInfo::start (1.0, _("Merging logarithmic HDR image..."));
-
-    //  "Marken-Werte" zur Markierung null-gewichteter Pixel. Sollten Werte
-    //   sein, die moeglichst nicht als (logarithm) HDR-Werte auftreten.
-    const float  mark_for_Min = 1e30;
-    const float  mark_for_Max = 1e31;
-    
     int          nlayers = pack.size();
-    int          dim1    = pack.dim1();
     int          dim2    = pack.dim2();
-    const uint16 z_max   = 65535;
-    
-    const Array1D<double> & logtimes = pack.logtimeVec(); // short name
-
-    //  Determine min. threshold z-value, where weight fnct switches to != 0
-    uint16  z_threshold_min = 0;
-    while ((z_threshold_min < z_max) && (weight(z_threshold_min) == 0.0)) 
-      z_threshold_min ++;
-    cout << "\tz-threshold-min = " << (int)z_threshold_min << '\n';
+    Rgb<float> & mi      = h_min [slot];   // min-max values of this slot
+    Rgb<float> & ma      = h_max [slot];
     
-    //==========
-    // 2D-Sicht
-    //==========
-    //  Alloc (untyped buffer for) HDR image (dim2==W, dim1==H)
-    Image  img (dim2, dim1, IMAGE_RGB_F32, "HDR: RGB 32-bit Float");
-    //  ...and create a typecasted 2D view on it
-    ImgScheme2DView< Rgb<float> >  hdr (img);
-
-    //  Smallest and largest resolvable log.HDR value of this image series
-    Rgb<float> val_min (logX_R(0) - logtimes[nlayers-1],
-                        logX_G(0) - logtimes[nlayers-1],
-                        logX_B(0) - logtimes[nlayers-1]);
-
-    Rgb<float> val_max (logX_R(z_max) - logtimes[0],
-                        logX_G(z_max) - logtimes[0],
-                        logX_B(z_max) - logtimes[0]);
-
-    float max_float = std::numeric_limits<float>::max();
-    Rgb<float> h_min ( max_float);    // Init with largest possible value
-    Rgb<float> h_max (-max_float);    // Init with smallest possible value
-
-    Stopwatch uhr;  uhr.start();
-    float progress_add = 0.95 / dim1;  // progress forward per line
-
-    //  For all pixels...
-    for (int y=0; y < dim1; y++)
+    for (int y=y0; y < y1; y++)
     {
       for (int x=0; x < dim2; x++)
       {
@@ -395,7 +351,7 @@ merge_LogHdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
           sum_e.b += w.b * (logX_B(z.b) - logtimes[p]);
         }
       
-        Rgb<float>&  h = hdr [y] [x];     // short name
+        Rgb<float>&  h = out [(y - out_y0) * dim2 + x];   // short name
 
         //  Compute "h = sum_e / sum_w", consider cases with sum_w==0!
         //   Comment see merge_Hdr_RGB_U8().
@@ -428,8 +384,8 @@ merge_LogHdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
         //  Protokoll-Ausgabe: VOR dem Markieren, da Letzteres HDR-Wert aendert
         //   und danach nur die Markierungswerte noch im Protokoll erschienen.
         //   Allerdings werden hier die *unskalierten* Werte ausgegeben!
-        if (make_protocol)  
-          protocol.out (x,y, sum_w, h, val_min, val_max);
+        if (protocol)  
+          protocol->out (x,y, sum_w, h, val_min, val_max);
              
         //  Mark "bad" (cropped, zero-weighted, unresolved) pixel. Weil wir anschliessend
         //   noch skalieren muessen, koennen nicht hier schon die Kontrastwerte gesetzt
@@ -444,8 +400,8 @@ merge_LogHdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
             else                   h.r = mark_for_Max;
           } 
           else {  //  MinMax feststellen
-            if (h.r < h_min.r) h_min.r = h.r; else
-            if (h.r > h_max.r) h_max.r = h.r;
+            if (h.r < mi.r) mi.r = h.r;
+            if (h.r > ma.r) ma.r = h.r;
           }
         
           if (sum_w.g == 0) {
@@ -453,8 +409,8 @@ merge_LogHdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
             else                   h.g = mark_for_Max;
           }
           else {  //  MinMax feststellen
-            if (h.g < h_min.g) h_min.g = h.g; else
-            if (h.g > h_max.g) h_max.g = h.g;
+            if (h.g < mi.g) mi.g = h.g;
+            if (h.g > ma.g) ma.g = h.g;
           }
 
           if (sum_w.b == 0) {
@@ -462,67 +418,220 @@ merge_LogHdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
             else                   h.b = mark_for_Max;
           }
           else {  //  MinMax feststellen
-            if (h.b < h_min.b) h_min.b = h.b; else
-            if (h.b > h_max.b) h_max.b = h.b;
+            if (h.b < mi.b) mi.b = h.b;
+            if (h.b > ma.b) ma.b = h.b;
           }
         }  
         else {    //  MinMax feststellen ohne Markieren (einfach)
-          if (h.r < h_min.r) h_min.r = h.r; else
-          if (h.r > h_max.r) h_max.r = h.r;
+          if (h.r < mi.r) mi.r = h.r;
+          if (h.r > ma.r) ma.r = h.r;
 
-          if (h.g < h_min.g) h_min.g = h.g; else
-          if (h.g > h_max.g) h_max.g = h.g;
+          if (h.g < mi.g) mi.g = h.g;
+          if (h.g > ma.g) ma.g = h.g;
 
-          if (h.b < h_min.b) h_min.b = h.b; else
-          if (h.b > h_max.b) h_max.b = h.b;
+          if (h.b < mi.b) mi.b = h.b;
+          if (h.b > ma.b) ma.b = h.b;
         }
         
       }  // for all x (columns)
-        
-      TheProgressInfo::forward (progress_add);
-
     }  // for all y (lines)
+}
+
+
+
+/**+*************************************************************************\n
+  merge_Hdr_RGB_U16()  --  Description see: merge_Hdr_RGB_U8().
+  
+  Provisorisch, um ins momentane HdrManager-Regime zu passen: Wir interpretieren
+   die logX-Arrays als Gitterwerte einer tabellierten Responsefunktion zu den
+   Stuetzstellen z=256*i+127. Die Spline-y2-Tabellen werden hier erzeugt. Besser
+   sollten diese Responsefunktionen als Argument uebergeben werden, was erlaubte,
+   die Funktionen ausserhalb zu initialisieren (spline oder tabellieren) und so 
+   mehrfach zu verwenden.
+******************************************************************************/
+br::Image    // IMAGE_RGB_F32
+merge_Hdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16  & pack,
+                   const TNT::Array1D<double>   & logX_R,
+                   const TNT::Array1D<double>   & logX_G,
+                   const TNT::Array1D<double>   & logX_B,
+                   const WeightFunc_U16         & weight,
+                   bool                         mark_bad_pixel, 
+                   bool                         protocol_to_file,
+                   bool                         protocol_to_stdout )
+{
+    cout <<__func__<< "(Array1D)...\n";
     
+    assert (logX_R.dim() == 256);
+    assert (logX_G.dim() == 256);
+    assert (logX_B.dim() == 256);
     
-    //  Weil bei streng fallenden Folgen obige else-Zweige nie erreicht wuerden,
-    //   pruefen, ob h_max geaendert wurde; wenn nicht, ist Maximalwert der
-    //   erste, denn wie gesagt: *streng fallend*.
-    //   Falls allerdings "bad pixel" markiert wurden, koennte erste Pixel einen
-    //   Markierungswert haben. In diesem Fall ist der erste nichtmarkierte zu
-    //   suchen, welcher dann auch der erste in die Min-Max-Suche eingegangene.
-    if (mark_bad_pixel) {
-      int i;
-      if (h_max.r == -max_float) {      // Suche ersten Nichtmarkierten
-        i = 0;
-        while ((hdr.view1d(i).r == mark_for_Min || 
-                hdr.view1d(i).r == mark_for_Max) && i < hdr.size())  i++;
-        h_max.r = hdr.view1d(i).r;
-      }                
-      if (h_max.g == -max_float) {      // Suche ersten Nichtmarkierten
-        i = 0;
-        while ((hdr.view1d(i).g == mark_for_Min || 
-                hdr.view1d(i).g == mark_for_Max) && i < hdr.size())  i++;
-        h_max.g = hdr.view1d(i).g;
-      }                
-      if (h_max.b == -max_float) {      // Suche ersten Nichtmarkierten
-        i = 0;
-        while ((hdr.view1d(i).b == mark_for_Min || 
-                hdr.view1d(i).b == mark_for_Max) && i < hdr.size())  i++;
-        h_max.b = hdr.view1d(i).b;
-      }                
-    }
-    else {  
-      if (h_max.r == -max_float) h_max.r = hdr[0][0].r;
-      if (h_max.g == -max_float) h_max.g = hdr[0][0].g;
-      if (h_max.b == -max_float) h_max.b = hdr[0][0].b;
-    }
+    //  Create interpolating response functions from the table values
+    ResponseFunc_U16  resp_R (logX_R),
+                      resp_G (logX_G),
+                      resp_B (logX_B);
+    
+    return merge_Hdr_RGB_U16 (pack, resp_R, resp_G, resp_B, weight, mark_bad_pixel,
+                              protocol_to_file, protocol_to_stdout);
+}
+
+/**+*************************************************************************\n
+  merge_Hdr_RGB_U16()  --  see: merge_Hdr_RGB_U8()
+******************************************************************************/
+br::Image    // IMAGE_RGB_F32
+merge_Hdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
+                   const ResponseFunc_U16 &  logX_R,
+                   const ResponseFunc_U16 &  logX_G,
+                   const ResponseFunc_U16 &  logX_B,
+                   const WeightFunc_U16   &  weight,
+                   bool                      mark_bad_pixel, 
+                   bool                      protocol_to_file,
+                   bool                      protocol_to_stdout )
+{
+    cout <<__func__<< "(ResponseFunc)...\n";
+    //assert (weight.have_table());
+
+    //  Init protocol stuff
+    const char*       fname = protocol_to_file ? BadPixelProtocol::default_fname() : 0;
+    BadPixelProtocol  protocol (fname, protocol_to_stdout);
+    bool              make_protocol = protocol.file() || protocol_to_stdout;
+    cout << "\t(to_file=" << protocol_to_file 
+         << ",  to_stdout=" << protocol_to_stdout
+         << ",  make_protocol=" << make_protocol << ")\n";
+    
+    //  Init progress info
+    TheProgressInfo::start (1.0, _("Merging HDR image..."));
+    
+    int          dim1    = pack.dim1();
+    int          dim2    = pack.dim2();
+    
+    //  Alloc (untyped buffer for) HDR image (dim2==W, dim1==H)
+    Image  img (dim2, dim1, IMAGE_RGB_F32, "HDR: RGB 32-bit Float");
+
+    Stopwatch uhr;  uhr.start();
+    float progress_add = 1.0 / dim1;  // progress forward per line
+
+    //  Merge bands of rows on several threads; the bad pixel protocol wants
+    //   pixel order though, so one thread then. The work determines the
+    //   z-threshold and the resolvable HDR values.
+    int  nslots = make_protocol ? 1 : row_band_slots (dim1);
+    HdrRows_RGB_U16  work (pack, logX_R, logX_G, logX_B, weight, nslots);
+    work.out             = (Rgb<float>*) img.buffer();
+    work.mark_bad_pixel  = mark_bad_pixel;
+    if (make_protocol)
+      work.protocol      = &protocol;
+    cout << "\tz-threshold-min = " << (int)work.z_threshold_min << '\n';
+
+    run_row_bands (work, 0, dim1, nslots, progress_add);
+    
+    //  Min-max search above has no "else" between min and max test, so
+    //   h_max is set also for strictly falling sequences and bands.
+    Rgb<float>  h_min, h_max;
+    gather_min_max (work.h_min, work.h_max, nslots, h_min, h_max);
+
+    double zeit = uhr.stop();
+    printf ("\tTime for HDR merging: %f sec\n", zeit);
+
+    cout << "min. resolvable HDR value = " << work.val_min << '\n';
+    cout << "   image's min. HDR value = " << h_min   << '\n';
+    cout << "max. resolvable HDR value = " << work.val_max << '\n';
+    cout << "   image's max. HDR value = " << h_max   << '\n';
+
+    TheProgressInfo::finish();
+    return img;
+}
+
+
+/**+*************************************************************************\n
+  merge_Hdr_RGB_U16 (..., TNT::Array1D)  
+   
+  Provisorisch... see: merge_Hdr_RGB_U16(..., TNT::Array1D).
+******************************************************************************/
+br::Image    // IMAGE_RGB_F32
+merge_LogHdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
+                      const TNT::Array1D<double> &  logX_R,
+                      const TNT::Array1D<double> &  logX_G,
+                      const TNT::Array1D<double> &  logX_B,
+                      const WeightFunc_U16 &        weight,
+                      bool                          mark_bad_pixel, 
+                      bool                          protocol_to_file,
+                      bool                          protocol_to_stdout )
+{
+    cout <<__func__<< "(Array1D)...\n";
+    
+    assert (logX_R.dim() == 256);
+    assert (logX_G.dim() == 256);
+    assert (logX_B.dim() == 256);
+    
+    //  Create interpolating response functions from the table values
+    ResponseFunc_U16  resp_R (logX_R),
+                      resp_G (logX_G),
+                      resp_B (logX_B);
+    
+    return merge_LogHdr_RGB_U16 (pack, resp_R, resp_G, resp_B, weight, mark_bad_pixel, 
+                                 protocol_to_file, protocol_to_stdout); 
+}
+
+/**+*************************************************************************\n
+  merge_LogHdr_RGB_U16 (ResponseFunc_U16)  --  see: merge_Hdr_RGB_U16().
+******************************************************************************/
+br::Image    // IMAGE_RGB_F32
+merge_LogHdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
+                      const ResponseFunc_U16 &  logX_R,
+                      const ResponseFunc_U16 &  logX_G,
+                      const ResponseFunc_U16 &  logX_B,
+                      const WeightFunc_U16   &  weight,
+                      bool                      mark_bad_pixel, 
+                      bool                      protocol_to_file,
+                      bool                      protocol_to_stdout )
+{
+    cout <<__func__<< "( ResponseFunc_U16 )...\n";
+    //assert (weight.have_table());
+
+    //  Init protocol stuff
+    const char*       fname = protocol_to_file ? BadPixelProtocol::default_fname() : 0;
+    BadPixelProtocol  protocol (fname, protocol_to_stdout);
+    bool              make_protocol = protocol.file() || protocol_to_stdout;
+    
+    cout << "\t(to_file=" << protocol_to_file 
+         << ",  to_stdout=" << protocol_to_stdout
+         << ",  make_protocol=" << make_protocol << ")\n";
+    
+    //  Init progress info
+    TheProgressInfo::start (1.0, _("Merging logarithmic HDR image..."));
+
+    int          dim1    = pack.dim1();
+    int          dim2    = pack.dim2();
+    
+    //  Alloc (untyped buffer for) HDR image (dim2==W, dim1==H)
+    Image  img (dim2, dim1, IMAGE_RGB_F32, "HDR: RGB 32-bit Float");
+
+    Stopwatch uhr;  uhr.start();
+    float progress_add = 0.95 / dim1;  // progress forward per line
+
+    //  Merge bands of rows on several threads; the bad pixel protocol wants
+    //   pixel order though, so one thread then.
+    int  nslots = make_protocol ? 1 : row_band_slots (dim1);
+    LogHdrRows_RGB_U16  work (pack, logX_R, logX_G, logX_B, weight, nslots);
+    work.out             = (Rgb<float>*) img.buffer();
+    work.mark_bad_pixel  = mark_bad_pixel;
+    if (make_protocol)
+      work.protocol      = &protocol;
+    cout << "\tz-threshold-min = " << (int)work.z_threshold_min << '\n';
+
+    run_row_bands (work, 0, dim1, nslots, progress_add);
+    
+    //  Min-max search above has no "else" between min and max test, so
+    //   h_max is set also for strictly falling sequences and bands. Marked
+    //   "bad" pixels did not take part.
+    Rgb<float>  h_min, h_max;
+    gather_min_max (work.h_min, work.h_max, nslots, h_min, h_max);
 
     double zeit = uhr.stop();
     printf ("\tTime for Log-HDR merging: %f sec\n", zeit);
 
-    cout << "min. resolvable HDR value = " << val_min << '\n';
+    cout << "min. resolvable HDR value = " << work.val_min << '\n';
     cout << "   image's min. HDR value = " << h_min   << '\n';
-    cout << "max. resolvable HDR value = " << val_max << '\n';
+    cout << "max. resolvable HDR value = " << work.val_max << '\n';
     cout << "   image's max. HDR value = " << h_max   << '\n';
 
     //  Logarithm domain is (-infty, +infty). Normalize values to [0,1]:
@@ -535,32 +644,253 @@ merge_LogHdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
     
     //  Falls "bad pixel" markiert wurden, diese jetzt raussuchen und auf ihre
     //   Kontrastwerte setzen. Falls nicht markiert wurde, schlicht skalieren.
-    if (mark_bad_pixel)
-      for (int i=0; i < hdr.size(); i++)          // 1D-View
-      {
-        Rgb<float>& h = hdr.view1d(i);            // short name
-      
-        if (h.r == mark_for_Min)       h.r = 1.0;     // Kontrast zum Minimum
-        else if (h.r == mark_for_Max)  h.r = 0.0;     // Kontrast zum Maximum
-        else                           h.r = fac_all * (h.r - min_all);
-        
-        if (h.g == mark_for_Min)       h.g = 1.0;     // Kontrast zum Minimum
-        else if (h.g == mark_for_Max)  h.g = 0.0;     // Kontrast zum Maximum
-        else                           h.g = fac_all * (h.g - min_all);
-        
-        if (h.b == mark_for_Min)       h.b = 1.0;     // Kontrast zum Minimum
-        else if (h.b == mark_for_Max)  h.b = 0.0;     // Kontrast zum Maximum
-        else                           h.b = fac_all * (h.b - min_all);
-      }
-    else
-      for (int i=0; i < hdr.size(); i++)          // 1D-View
-        hdr.view1d(i) = fac_all * (hdr.view1d(i) - min_all);
+    scale_log_rows (work.out, (long)dim1 * dim2, min_all, fac_all, mark_bad_pixel);
       
     TheProgressInfo::finish();
     return img;
 }
 
 
+/**+*************************************************************************\n
+  stream_Hdr_RGB_U16 (..., TNT::Array1D)  
+   
+  Provisorisch... see: merge_Hdr_RGB_U16(..., TNT::Array1D).
+******************************************************************************/
+bool
+stream_Hdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
+                    const TNT::Array1D<double> &  logX_R,
+                    const TNT::Array1D<double> &  logX_G,
+                    const TNT::Array1D<double> &  logX_B,
+                    const WeightFunc_U16 &        weight,
+                    HdrBandSink &                 sink,
+                    int                           band_rows,
+                    bool                          mark_bad_pixel, 
+                    bool                          protocol_to_file,
+                    bool                          protocol_to_stdout )
+{
+    cout <<__func__<< "(Array1D)...\n";
+    
+    assert (logX_R.dim() == 256);
+    assert (logX_G.dim() == 256);
+    assert (logX_B.dim() == 256);
+    
+    //  Create interpolating response functions from the table values
+    ResponseFunc_U16  resp_R (logX_R),
+                      resp_G (logX_G),
+                      resp_B (logX_B);
+    
+    return stream_Hdr_RGB_U16 (pack, resp_R, resp_G, resp_B, weight, sink, band_rows,
+                               mark_bad_pixel, protocol_to_file, protocol_to_stdout);
+}
+
+/**+*************************************************************************\n
+  stream_Hdr_RGB_U16()  --  merge_Hdr_RGB_U16() without a full-size result.
+
+  Bands of \a band_rows rows are merged into one band buffer, each handed to
+   \a sink before the next one is merged. So besides the inputs only one band
+   of floats is held, whatever the image size. \a band_rows <= 0 means all
+   rows at once.
+
+  @returns false if the sink refused the image.
+******************************************************************************/
+bool
+stream_Hdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
+                    const ResponseFunc_U16 &  logX_R,
+                    const ResponseFunc_U16 &  logX_G,
+                    const ResponseFunc_U16 &  logX_B,
+                    const WeightFunc_U16   &  weight,
+                    HdrBandSink &             sink,
+                    int                       band_rows,
+                    bool                      mark_bad_pixel, 
+                    bool                      protocol_to_file,
+                    bool                      protocol_to_stdout )
+{
+    cout <<__func__<< "(ResponseFunc)...\n";
+
+    //  Init protocol stuff
+    const char*       fname = protocol_to_file ? BadPixelProtocol::default_fname() : 0;
+    BadPixelProtocol  protocol (fname, protocol_to_stdout);
+    bool              make_protocol = protocol.file() || protocol_to_stdout;
+    
+    int          dim1    = pack.dim1();
+    int          dim2    = pack.dim2();
+    
+    if (band_rows <= 0 || band_rows > dim1)  band_rows = dim1;
+    cout << "\t(band_rows=" << band_rows << ",  make_protocol=" << make_protocol << ")\n";
+    
+    if (! sink.begin (dim2, dim1))
+      return false;
+    
+    //  Init progress info
+    TheProgressInfo::start (1.0, _("Merging HDR image..."));
+    
+    DynArray1D< Rgb<float> >  band (band_rows * dim2);
+
+    Stopwatch uhr;  uhr.start();
+    float progress_add = 1.0 / dim1;  // progress forward per line
+
+    int  nslots = make_protocol ? 1 : row_band_slots (band_rows);
+    HdrRows_RGB_U16  work (pack, logX_R, logX_G, logX_B, weight, nslots);
+    work.out             = band;
+    work.mark_bad_pixel  = mark_bad_pixel;
+    if (make_protocol)
+      work.protocol      = &protocol;
+
+    for (int y=0; y < dim1; y += band_rows)
+    {
+      int  n = min (band_rows, dim1 - y);
+      work.out_y0 = y;
+      run_row_bands (work, y, y + n, nslots, progress_add);
+      sink.put_rows (y, n, band);
+    }
+    sink.end();
+    
+    Rgb<float>  h_min, h_max;
+    gather_min_max (work.h_min, work.h_max, nslots, h_min, h_max);
+
+    double zeit = uhr.stop();
+    printf ("\tTime for HDR merging: %f sec\n", zeit);
+
+    cout << "min. resolvable HDR value = " << work.val_min << '\n';
+    cout << "   image's min. HDR value = " << h_min   << '\n';
+    cout << "max. resolvable HDR value = " << work.val_max << '\n';
+    cout << "   image's max. HDR value = " << h_max   << '\n';
+
+    TheProgressInfo::finish();
+    return true;
+}
+
+
+/**+*************************************************************************\n
+  stream_LogHdr_RGB_U16 (..., TNT::Array1D)  
+   
+  Provisorisch... see: merge_Hdr_RGB_U16(..., TNT::Array1D).
+******************************************************************************/
+bool
+stream_LogHdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
+                       const TNT::Array1D<double> &  logX_R,
+                       const TNT::Array1D<double> &  logX_G,
+                       const TNT::Array1D<double> &  logX_B,
+                       const WeightFunc_U16 &        weight,
+                       HdrBandSink &                 sink,
+                       int                           band_rows,
+                       bool                          mark_bad_pixel, 
+                       bool                          protocol_to_file,
+                       bool                          protocol_to_stdout )
+{
+    cout <<__func__<< "(Array1D)...\n";
+    
+    assert (logX_R.dim() == 256);
+    assert (logX_G.dim() == 256);
+    assert (logX_B.dim() == 256);
+    
+    //  Create interpolating response functions from the table values
+    ResponseFunc_U16  resp_R (logX_R),
+                      resp_G (logX_G),
+                      resp_B (logX_B);
+    
+    return stream_LogHdr_RGB_U16 (pack, resp_R, resp_G, resp_B, weight, sink, band_rows,
+                                  mark_bad_pixel, protocol_to_file, protocol_to_stdout);
+}
+
+/**+*************************************************************************\n
+  stream_LogHdr_RGB_U16()  --  merge_LogHdr_RGB_U16() without a full-size result.
+
+  The scaling to [0,1] needs the min-max values of the whole image before the
+   first band can be handed out. Without a full-size buffer to keep, the bands
+   are merged twice: a first pass only gathers the min-max values, the second
+   merges again, scales and hands each band to \a sink. A bad pixel protocol
+   is written in the first pass only.
+
+  @returns false if the sink refused the image.
+******************************************************************************/
+bool
+stream_LogHdr_RGB_U16 (const br::PackImgScheme2D_RGB_U16 &  pack,
+                       const ResponseFunc_U16 &  logX_R,
+                       const ResponseFunc_U16 &  logX_G,
+                       const ResponseFunc_U16 &  logX_B,
+                       const WeightFunc_U16   &  weight,
+                       HdrBandSink &             sink,
+                       int                       band_rows,
+                       bool                      mark_bad_pixel, 
+                       bool                      protocol_to_file,
+                       bool                      protocol_to_stdout )
+{
+    cout <<__func__<< "( ResponseFunc_U16 )...\n";
+
+    //  Init protocol stuff
+    const char*       fname = protocol_to_file ? BadPixelProtocol::default_fname() : 0;
+    BadPixelProtocol  protocol (fname, protocol_to_stdout);
+    bool              make_protocol = protocol.file() || protocol_to_stdout;
+    
+    int          dim1    = pack.dim1();
+    int          dim2    = pack.dim2();
+    
+    if (band_rows <= 0 || band_rows > dim1)  band_rows = dim1;
+    cout << "\t(band_rows=" << band_rows << ",  make_protocol=" << make_protocol << ")\n";
+    
+    if (! sink.begin (dim2, dim1))
+      return false;
+    
+    //  Init progress info
+    TheProgressInfo::start (1.0, _("Merging logarithmic HDR image..."));
+
+    DynArray1D< Rgb<float> >  band (band_rows * dim2);
+
+    Stopwatch uhr;  uhr.start();
+    float progress_add = 0.5 / dim1;  // progress forward per line and pass
+
+    //  Pass 1: min-max values only; one thread if a protocol is written
+    int  nslots = row_band_slots (band_rows);
+    LogHdrRows_RGB_U16  work (pack, logX_R, logX_G, logX_B, weight, nslots);
+    work.out             = band;
+    work.mark_bad_pixel  = mark_bad_pixel;
+    if (make_protocol)
+      work.protocol      = &protocol;
+
+    for (int y=0; y < dim1; y += band_rows)
+    {
+      int  n = min (band_rows, dim1 - y);
+      work.out_y0 = y;
+      run_row_bands (work, y, y + n, make_protocol ? 1 : nslots, progress_add);
+    }
+    
+    Rgb<float>  h_min, h_max;
+    gather_min_max (work.h_min, work.h_max, nslots, h_min, h_max);
+
+    cout << "min. resolvable HDR value = " << work.val_min << '\n';
+    cout << "   image's min. HDR value = " << h_min   << '\n';
+    cout << "max. resolvable HDR value = " << work.val_max << '\n';
+    cout << "   image's max. HDR value = " << h_max   << '\n';
+
+    //  Scale so, that overall-max -> 1, overall-min -> 0:
+    float max_all = max (max(h_max.r, h_max.g), max(h_max.g, h_max.b));  
+    float min_all = min (min(h_min.r, h_min.g), min(h_min.g, h_min.b));  
+    float fac_all = 1.0 / (max_all - min_all);
+
+    cout << "max_all=" << max_all << "  min_all=" << min_all << "  fac_all=" << fac_all << '\n'; 
+    
+    //  Pass 2: merge again, scale and hand out; no protocol twice
+    work.protocol = 0;
+    
+    for (int y=0; y < dim1; y += band_rows)
+    {
+      int  n = min (band_rows, dim1 - y);
+      work.out_y0 = y;
+      run_row_bands (work, y, y + n, nslots, progress_add);
+      scale_log_rows (band, (long)n * dim2, min_all, fac_all, mark_bad_pixel);
+      sink.put_rows (y, n, band);
+    }
+    sink.end();
+    
+    double zeit = uhr.stop();
+    printf ("\tTime for Log-HDR merging: %f sec\n", zeit);
+
+    TheProgressInfo::finish();
+    return true;
+}
+
+
 #if 0
 /**+*************************************************************************\n
   merge_LogHdr_RGB_U16()
@@ -35,6 +35,7 @@
 #include "br_Image.hpp"                 // br::Image
 #include "WeightFunc_U16.hpp"           // WeightFunc_U16
 #include "ResponseFunc_U16.hpp"         // ResponseFunc_U16
+#include "HdrBandSink.hpp"              // HdrBandSink
 
 
 namespace br {
@@ -98,6 +99,61 @@ merge_LogHdr_RGB_U16 (  const br::PackImgScheme2D_RGB_U16 & pack,
                         bool                         protocol_to_file   = false, 
                         bool                         protocol_to_stdout = false );
 
+/****************************************************************************\n
+  stream_Hdr_RGB_U16()  --  merge_Hdr_RGB_U16() band by band into \a sink,
+   without a full-size result. Description: ~.cpp file.
+******************************************************************************/
+bool
+stream_Hdr_RGB_U16 (    const br::PackImgScheme2D_RGB_U16 & pack,
+                        const ResponseFunc_U16 & logX_R,
+                        const ResponseFunc_U16 & logX_G,
+                        const ResponseFunc_U16 & logX_B,
+                        const WeightFunc_U16   & weight,
+                        HdrBandSink            & sink,
+                        int                      band_rows,
+                        bool                     mark_bad_pixel     = false,
+                        bool                     protocol_to_file   = false, 
+                        bool                     protocol_to_stdout = false );
+
+bool
+stream_Hdr_RGB_U16 (    const br::PackImgScheme2D_RGB_U16 & pack,
+                        const TNT::Array1D<double> & logX_R,
+                        const TNT::Array1D<double> & logX_G,
+                        const TNT::Array1D<double> & logX_B,
+                        const WeightFunc_U16       & weight,
+                        HdrBandSink                & sink,
+                        int                          band_rows,
+                        bool                         mark_bad_pixel     = false,
+                        bool                         protocol_to_file   = false, 
+                        bool                         protocol_to_stdout = false );
+
+/****************************************************************************\n
+  stream_LogHdr_RGB_U16()  --  merge_LogHdr_RGB_U16() band by band into \a sink.
+******************************************************************************/
+bool
+stream_LogHdr_RGB_U16 ( const br::PackImgScheme2D_RGB_U16 & pack,
+                        const ResponseFunc_U16 & logX_R,
+                        const ResponseFunc_U16 & logX_G,
+                        const ResponseFunc_U16 & logX_B,
+                        const WeightFunc_U16   & weight,
+                        HdrBandSink            & sink,
+                        int                      band_rows,
+                        bool                     mark_bad_pixel     = false,
+                        bool                     protocol_to_file   = false, 
+                        bool                     protocol_to_stdout = false );
+
+bool
+stream_LogHdr_RGB_U16 ( const br::PackImgScheme2D_RGB_U16 & pack,
+                        const TNT::Array1D<double> & logX_R,
+                        const TNT::Array1D<double> & logX_G,
+                        const TNT::Array1D<double> & logX_B,
+                        const WeightFunc_U16       & weight,
+                        HdrBandSink                & sink,
+                        int                          band_rows,
+                        bool                         mark_bad_pixel     = false,
+                        bool                         protocol_to_file   = false, 
+                        bool                         protocol_to_stdout = false );
+
                         
 }  // namespace "br"
 
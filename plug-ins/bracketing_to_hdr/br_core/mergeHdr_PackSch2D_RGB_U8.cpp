@@ -25,6 +25,8 @@
   Contents: 
    - merge_Hdr_RGB_U8()
    - merge_LogHdr_RGB_U8()
+   - stream_Hdr_RGB_U8(), stream_LogHdr_RGB_U8() :  the same band by band
+      into a HdrBandSink
    
   @todo ProgressInfo strings like "Merge HDR image..." are used both here and in
     the U16 case (file "mergeHdr_PckSch2D_RGB_U16.cpp"). Could be centralized.
@@ -47,6 +49,9 @@
 #include "WeightFunc_U8.hpp"            // WeightFunc_U8
 #include "TheProgressInfo.hpp"          // TheProgressInfo
 #include "BadPixelProtocol.hpp"         // BadPixelProtocol
+#include "DynArray1D.hpp"               // DynArray1D<>
+#include "RowBands.hpp"                 // run_row_bands()
+#include "HdrBandSink.hpp"              // HdrBandSink
 #include "mergeHdr_PackSch2D_RGB_U8.hpp" // prototypes
 
 
@@ -60,208 +65,132 @@ using std::cout;
 
 
 /**+*************************************************************************\n
-  merge_Hdr_RGB_U8() 
-  
-  Merging of a Pack of typed \a ImgScheme2D schemes of RGB_U8 image buffers 
-   into one single HDR(float) Rgb-image using three given response curves, a
-   (in the Pack) given vector of exposure times and a given weight function.
-   
-  @param pack: Pack of typed \a ImgScheme2D schemes of RGB_U8 image buffers.
+  gather_min_max()  --  Overall min-max values from the per-slot ones.
+******************************************************************************/
+static void 
+gather_min_max (const DynArray1D< Rgb<float> > & mi,
+                const DynArray1D< Rgb<float> > & ma, int nslots,
+                Rgb<float> & h_min, Rgb<float> & h_max)
+{
+    h_min = mi[0];
+    h_max = ma[0];
+    for (int i=1; i < nslots; i++) {
+      h_min.r = min (h_min.r, mi[i].r);   h_max.r = max (h_max.r, ma[i].r);
+      h_min.g = min (h_min.g, mi[i].g);   h_max.g = max (h_max.g, ma[i].g);
+      h_min.b = min (h_min.b, mi[i].b);   h_max.b = max (h_max.b, ma[i].b);
+    }
+}
 
-  @param logX_R|G|B: Logarithm. inverse of the response function <i>z=f(X)</i>. 
-     \a logX_R[z]: Logarithm exposure \a log(X) to the pixel value \a z in 
-     channel \a R accordingly to <pre>
-        z = f(X) = f(E*t) 
-        f^-1(z) = X = E*t  
-        g(z) = log(X) = log(E)+log(t)  
-     with
-        g(z) := log[f^-1(z)]. </pre>
- 
-  @param weight: Weight function object; weight[z]: weight of value z.
-    Almost jene auch bei der logX_*-Berechnung verwendete. 
 
-  @param progressinfo: Pointer to a ProgressInfo instance. Default: 0.
- 
-  @param protocol_to_file: A bad-pixel-protocol to a file? Default: false.
-     (Using default filename of BadPixelProtocol.)
-     
-  @param protocol_to_stdout: A bad-pixel-protocol to stdout? Default: false.
-  
-  @return HDR<float>-RGB-Bild: die aus <i>log(E)=log(X)-log(t)</i> resultierenden
-     E-Daten: logE(z) = logX(z) - logTimes, oder vielmehr delogarithmiert:
-     exp(logE).
- 
-  
-  @note Beachte, dass die Scheme2D der Pack-Ausgangsdaten Sub-Arrays darstellen
-   koennen. Benutze fuer diese daher nur die "[][]"-Syntax oder linearisiere
-   allenfalls innerhalb einer Zeile. Fuer das hier erzeugte HDR-Bild dagegen ist
-   klar, dass es zusammenhaengend; da kann auch view1d() zur Anwendung kommen.
+static const uint8  z_max = 255;
 
-  
-  <h3>Bemerkungen:</h3>
-  
-  <b>Unaufgeloeste HDR-Werte:</b>
-   Einfach gesagt: Pixelwerte z=255 im kuerzestbelichteten Bild oder z=0 im
-   laengstbelichteten sind unaufgeloest (nicht im Arbeitsbereich). Weil wir alle
-   z-Werte wichten und durch breitere Nullraender der Gewichtsfunktionen auch
-   mehr unaufgeloest sein koennen, machen wir es am Gewicht fest. Eine vereinfachte
-   Alternative zur Markierungsweise unten waere, zum Schluss das hellste und das
-   dunklelste Bild noch einmal durchzugehen und die Stellen mit z=0 bzw. z=255
-   zu markieren.
-  
-   Wenn ein Pixel bzgl. eines Kanals in ALLEN Bildern das Gewicht 0 erhaelt,
-   bekommen wir sum_w = sum_e = 0 und die Operation "sum_e / sum_w" kann nicht
-   ausgefuehrt werden ("0/0"). Der HDR-Wert (jenes Kanals) ist an dieser Stelle 
-   unbestimmt, er muss geeignet <i>gesetzt</i> werden. Weil Wichtungsfunktionen
-   gewoehnlich nur an den Raendern bei z=0 und z=zmax Null werden, wird aus sum_w=0
-   auf "z=0 oder z=max" (in allen Bildern) geschlossen und dass der unbekannte HDR-Wert 
-   (E) folglich  unterhalb bzw. oberhalb des durch diese Belichtungsreihe noch
-   Aufloesbaren liegt. Wir setzen ihn daher fuer z=0 auf die untere Aufloesungsgrenze 
-   (min. HDR-, sprich E-Wert) und fuer z=zmax auf die obere (max. HDR-, sprich E-Wert).
-   
-   Der kleinste reale E-Wert, den diese Belichtungsreihe erfassen koennte, ist
-   der zu <b>z=0</b> im Bild mit der <b>laengsten</b> Belichtungszeit, der groesste
-   noch erfassbare der zu <b>z=zmax</b> im Bild mit der <b>kuerzesten</b> 
-   Belichtungszeit. Gemaess <pre>
-            logE = logX - logtimes </pre>
-   und dem Umstand, dass die Bilder in aufsteigender Belichtungszeit geordnet, 
-   also <pre>
-            logE_min = logX[0] - logtimes[nlayers-1]
-            logE_max = logX[z_max] - logtimes[0]  </pre>
-   
-  <b>Nachtrag:</b>
-   Wir arbeiten unten mit der UNTERSTELLUNG, dass Wichtungsfunktionen w(z) nur von
-   den Raendern her und in zusammenhaengenden Bereichen Null liefern koennen, d.h.
-   dass es zwei Schwellwerte \a z_threshold_min und \a z_threshold_max gebe mit
-   <pre>
-      w(z) == 0 fuer  z .<. z_threshold_min (zu dunkel -> min. HDR-Wert)
-      w(z) == 0 fuer  z .>. z_threshold_max (zu hell -> max. HDR-Wert)
-      w(z) != 0 sonst. </pre>
-   
-   Stossen wir auf ein sum_w==0, wird anhand des z-Wertes entschieden, ob der 
-   HDR-Wert auf min. oder max. HDR-Wert gesetzt wird. Fuer Wichtungsfunktionen mit
-   Nullbereichen in der Mitte wuerde das nicht mehr funktionieren, der zweite else-
-   Zweig in der Abfrage unten verwiese nicht mehr notwendig auf z.>.z_threshold_max.
+//  "Marken-Werte" zur Markierung null-gewichteter Pixel im log. HDR. Sollten
+//   Werte sein, die moeglichst nicht als (logarithm) HDR-Werte auftreten.
+static const float  mark_for_Min = 1e30;
+static const float  mark_for_Max = 1e31;
 
-   Die Klaerung, ob null-gewichtete Pixel auf Min- oder Max-HDR-Wert zu setzen
-   sind anhand der Abfrage
-   <pre>
-      if (sum_w.r != 0)  berechne sum_e.r/sum_w.r;
-      else if (pixel.r .<. z_threshold_min) set_to_min;
-      else                                  set_to_max;  </pre>
-      
-   funktioniert auch fuer Wichtungsfunktionen, die gar nicht oder nur einseitig 
-   Null werden: Wenn gar nicht Null, kann sum_w==0 nicht auftreten, wenn einseitig
-   links Null, kann sum_w nur fuer linke z.<.z_threshold_min Null werden und das 
-   ist der erste else-Zweig, wenn einseitig rechts Null, ist z_threshold_min==0
-   und die Bedingung z.<.z_threshold_min kann fuer solche z nicht zutreffen, 
-   sprich, es wird richtigerweise im zweiten else-Zweig auf Max gesetzt. Wenn eine
-   Wichtungsfunktion komplett 0, ist z_threshold_min=255 und alle z-Werte ausser
-   z=255 sind kleiner als z_threshold_min und werden auf min-HDR gesetzt; z=255
-   auf max-HDR.
-   
-  <b>Kontrastierungen:</b>
-   Das Markieren null-gewichter Pixel (d.h. von HDR-Werten, die auf min-HDR oder
-   max-HDR gesetzt wuerden) durch Kontrastfarben geschieht wie folgt: Wuerde ein
-   HDR-Wert auf min-HDR gesetzt), bekommt er den Wert 1.0 (Kontrast zur angenommenen
-   dunklen Umgebung), wuerde er auf max-HDR gesetzt, bekommt er den Wert 0.0 (Kontrast
-   zur angenommenen hellen Umgebung. Schief (nicht in allen Kanaelen) abgeschnittene
-   HDR-Pixel erscheinen dadurch farbig:  <pre>
-    unten: nur R abgeschnitten --> RGB = (1, wenig, wenig)  (rot)
-           nur G abgeschnitten --> RGB = (wenig, 1, wenig)  (gruen)
-           R+G   abgeschnitten --> RGB = (1, 1, wenig)
-    oben:  nur R abgeschnitten --> RGB = (0, viel, viel)    (cyan)
-           R+G   abgeschnitten --> RGB = (0, 0, viel)       (blau) </pre>
-           
-  @todo Der Kontrastwert "1.0" hat den Nachteil, dass er in einem HDR-Bild, das z.B.
-   bis 10^3 reicht, bei entsprechender Skalierung nicht mehr auffaellt. Alternativ
-   koennte als Kontrast zum Dunklen auch max-HDR (val_max) oder der Bildmaximalwert
-   (h_max) genommen werden. Fuer letzteres muesste Kontrastieren in einem zweiten
-   Durchlauf erfolgen, da die Min-Max-Werte ja erst ermittelt werden muessen, was
-   wiederum verlangte, wie im log-Fall die "0/0"-Faelle aus der Min-Max-Ermittlung
-   zunaechst auszusparen. \n
-  hdr_max != h_max kann dann eintreten, wenn die wegen "0/0" irgendwie zu setzenden
-   Werte nicht in Min-Max-Berechnung eingehen, sondern wie im log-Fall zunaechst 
-   ausgespart werden und erst anschliessend auf endgueltigen Wert gesetzt werden, 
-   z.B. eben dann auf h_max.
-  
-  @todo Es koennte die Option angeboten werden, schief abgeschnittene Pixel (die
-   naemlich auffallen) komplett auf schwarzen min-HDR- bzw. komplett auf weissen
-   max-HDR-Wert zu setzen. Oder anhand der Umgebung korrigieren? Welches natuerlich
-   nur moeglich, wenn die Umgebung nicht selbst gestoert.
 
+/**+*************************************************************************\n
+  threshold_min()  --  Min. threshold z-value, where weight fnct switches to != 0
 ******************************************************************************/
-br::Image    // IMAGE_RGB_F32
-merge_Hdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
-                  const TNT::Array1D<double> &   logX_R,
-                  const TNT::Array1D<double> &   logX_G,
-                  const TNT::Array1D<double> &   logX_B,
-                  const WeightFunc_U8 &          weight,
-                  bool                           mark_bad_pixel, 
-                  bool                           protocol_to_file,
-                  bool                           protocol_to_stdout )
+static uint8
+threshold_min (const WeightFunc_U8 & weight)
 {
-    cout <<__func__<< "()...\n";
-    assert (logX_R.dim() == 256);
-    assert (logX_G.dim() == 256);
-    assert (logX_B.dim() == 256);
-    assert (weight.have_table());
-    //assert (weight.table.dim() == 256);
-    //list (weight);
+    uint8  z = 0;
+    while ((z < z_max) && (weight[z] == 0.0))
+      z ++;
+    return z;
+}
 
-    //  Init protocol stuff
-    const char*       fname = protocol_to_file ? BadPixelProtocol::default_fname() : 0;
-    BadPixelProtocol  protocol (fname, protocol_to_stdout);
-    bool              make_protocol = protocol.file() || protocol_to_stdout;
-    
-    cout << "\t(make_protocol=" << make_protocol
-         << ",  to_file=" << protocol_to_file 
-         << ",  to_stdout=" << protocol_to_stdout << ")\n";
 
-    //  Init progress info
-    TheProgressInfo::start (1.0, _("Merging HDR image..."));
-        
-    int         nlayers = pack.size();
-    int         dim1    = pack.dim1();
-    int         dim2    = pack.dim2();
-    const uint8 z_max   = 255;
+/**+*************************************************************************\n
+  scale_log_rows()  --  Scale \a n log. HDR values so that [min_all, min_all +
+   1/fac_all] -> [0,1]. If "bad pixel" were marked, set them to their contrast
+   values instead.
+******************************************************************************/
+static void
+scale_log_rows (Rgb<float>* hdr, long n, float min_all, float fac_all,
+                bool mark_bad_pixel)
+{
+    if (mark_bad_pixel)
+      for (long i=0; i < n; i++)
+      {
+        Rgb<float>& h = hdr[i];                   // short name
 
-    const Array1D<double> & logtimes = pack.logtimeVec(); // short name
-   
-    //  Determine min. threshold z-value, where weight fnct switches to != 0
-    uint8  z_threshold_min = 0;
-    while ((z_threshold_min < z_max) && (weight[z_threshold_min] == 0.0)) 
-      z_threshold_min ++;
-    cout << "\tz-threshold-min = " << (int)z_threshold_min << '\n';
-    
-    //============
-    //  2D Sicht
-    //============
-    //  Alloc (untyped buffer for) HDR image (dim2==W, dim1==H)
-    Image  img (dim2, dim1, IMAGE_RGB_F32, "HDR: RGB 32-bit Float");
-    //  ...and create a typecasted 2D view on it
-    ImgScheme2DView< Rgb<float> >  hdr (img);
+        if (h.r == mark_for_Min)       h.r = 1.0;     // Kontrast zum Minimum
+        else if (h.r == mark_for_Max)  h.r = 0.0;     // Kontrast zum Maximum
+        else                           h.r = fac_all * (h.r - min_all);
 
-    //  Smallest and largest resolvable HDR value of this image series
-    Rgb<float> val_min (exp (logX_R[0] - logtimes[nlayers-1]),
-                        exp (logX_G[0] - logtimes[nlayers-1]),
-                        exp (logX_B[0] - logtimes[nlayers-1]));
+        if (h.g == mark_for_Min)       h.g = 1.0;     // Kontrast zum Minimum
+        else if (h.g == mark_for_Max)  h.g = 0.0;     // Kontrast zum Maximum
+        else                           h.g = fac_all * (h.g - min_all);
 
-    Rgb<float> val_max (exp (logX_R[z_max] - logtimes[0]),
-                        exp (logX_G[z_max] - logtimes[0]),
-                        exp (logX_B[z_max] - logtimes[0]));
+        if (h.b == mark_for_Min)       h.b = 1.0;     // Kontrast zum Minimum
+        else if (h.b == mark_for_Max)  h.b = 0.0;     // Kontrast zum Maximum
+        else                           h.b = fac_all * (h.b - min_all);
+      }
+    else
+      for (long i=0; i < n; i++)
+        hdr[i] = fac_all * (hdr[i] - min_all);
+}
 
-    float max_float = std::numeric_limits<float>::max();
-    Rgb<float> h_min ( max_float);  // Init with largest possible value
-    Rgb<float> h_max (-max_float);  // Init with least possible value
 
-    Stopwatch uhr;  uhr.start();
-    float progress_add = 1.0 / dim1;  // progress forward per line
+/**===========================================================================
+  HdrRows_RGB_U8  --  the per-pixel work of merge_Hdr_RGB_U8() for a band of rows,
+   see RowBands.hpp. Response tables and weight function are only read, so
+   bands can be merged concurrently; min-max values are kept per slot.
+=============================================================================*/
+struct HdrRows_RGB_U8 : public RowBandWork
+{
+    const PackImgScheme2D_RGB_U8 &   pack;
+    const Array1D<double> &          logX_R;
+    const Array1D<double> &          logX_G;
+    const Array1D<double> &          logX_B;
+    const WeightFunc_U8 &            weight;
+    const Array1D<double> &          logtimes;
+    Rgb<float> *                     out;            // rows from out_y0 on, dim2 each
+    int                              out_y0;
+    Rgb<float>                       val_min, val_max;
+    uint8                            z_threshold_min;
+    bool                             mark_bad_pixel;
+    BadPixelProtocol *               protocol;       // 0 if none; with one slot only
+    DynArray1D< Rgb<float> >         h_min, h_max;   // per slot
+
+    HdrRows_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack_,
+       const Array1D<double> & R, const Array1D<double> & G, const Array1D<double> & B,
+       const WeightFunc_U8 & w, int nslots)
+      : pack(pack_), logX_R(R), logX_G(G), logX_B(B), weight(w),
+        logtimes(pack_.logtimeVec()), out(0), out_y0(0),
+        mark_bad_pixel(false), protocol(0),
+        h_min(nslots, Rgb<float>( std::numeric_limits<float>::max())),
+        h_max(nslots, Rgb<float>(-std::numeric_limits<float>::max()))
+      {
+        int nlayers = pack.size();
+        z_threshold_min = threshold_min (weight);
+        
+        //  Smallest and largest resolvable HDR value of this image series
+        val_min = Rgb<float> (exp (logX_R[0] - logtimes[nlayers-1]),
+                              exp (logX_G[0] - logtimes[nlayers-1]),
+                              exp (logX_B[0] - logtimes[nlayers-1]));
+
+        val_max = Rgb<float> (exp (logX_R[z_max] - logtimes[0]),
+                              exp (logX_G[z_max] - logtimes[0]),
+                              exp (logX_B[z_max] - logtimes[0]));
+      }
+    
+    void rows (int y0, int y1, int slot);
+};
 
-    //  For all pixels...
-    for (int y=0; y < dim1; y++) 
+void HdrRows_RGB_U8::rows (int y0, int y1, int slot)
+{
+    int          nlayers = pack.size();
+    int          dim2    = pack.dim2();
+    Rgb<float> & mi      = h_min [slot];   // min-max values of this slot
+    Rgb<float> & ma      = h_max [slot];
+    
+    for (int y=y0; y < y1; y++)
     {
-      for (int x=0; x < dim2; x++) 
+      for (int x=0; x < dim2; x++)
       {
         Rgb<double> sum_w (0.0);          // for summation of weights
         Rgb<double> sum_e (0.0);          // for summation of radiance values
@@ -278,7 +207,7 @@ merge_Hdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
           sum_e.b += w.b * (logX_B[z.b] - logtimes[p]);
         }
       
-        Rgb<float>&  h = hdr [y] [x];     // short name
+        Rgb<float>&  h = out [(y - out_y0) * dim2 + x];   // short name
 
         //==========
         //  Compute "h = exp (sum_e / sum_w)", consider cases with sum_w==0
@@ -415,8 +344,8 @@ merge_Hdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
 
         //  Protokoll-Ausgabe: VOR dem Markieren, da letzteres HDR-Wert aendert
         //   und danach nur die Markierungswerte noch im Protokoll erschienen.
-        if (make_protocol)  
-          protocol.out (x,y, sum_w, h, val_min, val_max);
+        if (protocol)  
+          protocol->out (x,y, sum_w, h, val_min, val_max);
              
         //  Mark "bad" (cropped, zero-weighted, unresolved) pixel
         if (mark_bad_pixel) {
@@ -434,170 +363,104 @@ merge_Hdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
         }  
         
         //  MinMax feststellen... (fakultativ)
-        if (h.r < h_min.r) h_min.r = h.r; else
-        if (h.r > h_max.r) h_max.r = h.r;
+        if (h.r < mi.r) mi.r = h.r;
+        if (h.r > ma.r) ma.r = h.r;
 
-        if (h.g < h_min.g) h_min.g = h.g; else
-        if (h.g > h_max.g) h_max.g = h.g;
+        if (h.g < mi.g) mi.g = h.g;
+        if (h.g > ma.g) ma.g = h.g;
 
-        if (h.b < h_min.b) h_min.b = h.b; else
-        if (h.b > h_max.b) h_max.b = h.b;
+        if (h.b < mi.b) mi.b = h.b;
+        if (h.b > ma.b) ma.b = h.b;
     
       }  // for all x (columns)
-      
-      TheProgressInfo::forward (progress_add);
-    
     }  // for all y (lines)
+}
 
-    
-    //  Weil bei streng fallenden Folgen obige else-Zweige nie erreicht wuerden,
-    //   pruefen, ob `h_max geaendert wurde; wenn nicht, ist Maximalwert der 
-    //   erste, denn wie gesagt: streng fallend...
-    
-    if (h_max.r == -max_float) h_max.r = hdr[0][0].r;
-    if (h_max.g == -max_float) h_max.g = hdr[0][0].g;
-    if (h_max.b == -max_float) h_max.b = hdr[0][0].b;
 
-    double zeit = uhr.stop();
-    printf ("\tTime for HDR merging: %f sec\n", zeit);
+/**===========================================================================
+  LogHdrRows_RGB_U8  --  the per-pixel work of merge_LogHdr_RGB_U8() for a band of rows,
+   see RowBands.hpp. Comments see HdrRows_RGB_U8.
+=============================================================================*/
+struct LogHdrRows_RGB_U8 : public RowBandWork
+{
+    const PackImgScheme2D_RGB_U8 &   pack;
+    const Array1D<double> &          logX_R;
+    const Array1D<double> &          logX_G;
+    const Array1D<double> &          logX_B;
+    const WeightFunc_U8 &            weight;
+    const Array1D<double> &          logtimes;
+    Rgb<float> *                     out;            // rows from out_y0 on, dim2 each
+    int                              out_y0;
+    Rgb<float>                       val_min, val_max;
+    uint8                            z_threshold_min;
+    bool                             mark_bad_pixel;
+    BadPixelProtocol *               protocol;       // 0 if none; with one slot only
+    DynArray1D< Rgb<float> >         h_min, h_max;   // per slot
+
+    LogHdrRows_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack_,
+       const Array1D<double> & R, const Array1D<double> & G, const Array1D<double> & B,
+       const WeightFunc_U8 & w, int nslots)
+      : pack(pack_), logX_R(R), logX_G(G), logX_B(B), weight(w),
+        logtimes(pack_.logtimeVec()), out(0), out_y0(0),
+        mark_bad_pixel(false), protocol(0),
+        h_min(nslots, Rgb<float>( std::numeric_limits<float>::max())),
+        h_max(nslots, Rgb<float>(-std::numeric_limits<float>::max()))
+      {
+        int nlayers = pack.size();
+        z_threshold_min = threshold_min (weight);
+        
+        //  Smallest and largest resolvable log. HDR value for this series
+        val_min = Rgb<float> (logX_R[0] - logtimes[nlayers-1],
+                              logX_G[0] - logtimes[nlayers-1],
+                              logX_B[0] - logtimes[nlayers-1]);
+
+        val_max = Rgb<float> (logX_R[z_max] - logtimes[0],
+                              logX_G[z_max] - logtimes[0],
+                              logX_B[z_max] - logtimes[0]);
+      }
+    
+    void rows (int y0, int y1, int slot);
+};
 
-    cout << "min. resolvable HDR value = " << val_min << '\n';
-    cout << "   image's min. HDR value = " << h_min   << '\n';
-    cout << "max. resolvable HDR value = " << val_max << '\n';
-    cout << "   image's max. HDR value = " << h_max   << '\n';
+void LogHdrRows_RGB_U8::rows (int y0, int y1, int slot)
+{
+    int          nlayers = pack.size();
+    int          dim2    = pack.dim2();
+    Rgb<float> & mi      = h_min [slot];   // min-max values of this slot
+    Rgb<float> & ma      = h_max [slot];
     
-    TheProgressInfo::finish();
-    return img;
-}
+    for (int y=y0; y < y1; y++)
+    {
+      for (int x=0; x < dim2; x++)
+      {
+        Rgb<double> sum_w (0.0);          // for summation of weights
+        Rgb<double> sum_e (0.0);          // for summation of radiance values
+      
+        for (int p=0; p < nlayers; p++)
+        {
+          Rgb<uint8>  z = pack [p] [y] [x];
+          Rgb<double>  w (weight[z.r], weight[z.g], weight[z.b]);
+        
+          sum_w += w;
+          //  sum_e += w * Rgb<double>(..., ..., ...)
+          sum_e.r += w.r * (logX_R[z.r] - logtimes[p]);
+          sum_e.g += w.g * (logX_G[z.g] - logtimes[p]);
+          sum_e.b += w.b * (logX_B[z.b] - logtimes[p]);
+        }
+      
+        Rgb<float>&  h = out [(y - out_y0) * dim2 + x];   // short name
 
+        //  Compute "h = sum_e / sum_w", consider cases with sum_w==0!
+        //   Comment see: merge_Hdr_RGB_U8().
 
-/**+*************************************************************************\n
-  merge_LogHdr_RGB_U8()
-  
-  Merging of a Pack of typed \a ImgScheme2D schemes of RGB_U8 image buffers 
-   into one single <i>logarithmic</i> HDR(float) Rgb-image using three given
-   response curves, a (in the Pack) given vector of exposure times and a given
-   weight function.
-
-  Logarithm. HDR-Bild extra zu bauen deshalb interessant, weil beim gewoehnl.
-   fuer alle Werte ein `exp(z) auftritt, das hier gespart werden kann. Bei 
-   N Pixeln und P LDR-Bildern sind das 3*N*P exp()-Operationen.
-  
-  @param *: see: merge_Hdr_RGB_U8().
-     
-  @return logarithmiertes HDR<float>-Bild: die gemaess <i>log(E)=log(X)-log(t)</i>
-    resultierenden <i>log(E)</i>-Daten, skaliert auf [0,1].
-   
-  @note Beachte, dass die Scheme2D der Pack-Ausgangsdaten Sub-Arrays darstellen
-   koennen. Benutze fuer diese daher nur die "[][]"-Syntax oder linearisiere
-   allenfalls innerhalb einer Zeile. Fuer das hier erzeugte HDR-Bild dagegen ist
-   klar, dass es zusammenhaengend; da kann auch view1d() zur Anwendung kommen.
-
-******************************************************************************/
-br::Image    // IMAGE_RGB_F32
-merge_LogHdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
-                     const TNT::Array1D<double> &   logX_R,
-                     const TNT::Array1D<double> &   logX_G,
-                     const TNT::Array1D<double> &   logX_B,
-                     const WeightFunc_U8 &          weight,
-                     bool                           mark_bad_pixel, 
-                     bool                           protocol_to_file,
-                     bool                           protocol_to_stdout )
-{
-    cout <<__func__<< "()...\n";
-    assert (logX_R.dim() == 256);
-    assert (logX_G.dim() == 256);
-    assert (logX_B.dim() == 256);
-    assert (weight.have_table());
-    //assert (weight.dim() == 256);
-
-    //  Init protocol stuff
-    const char*       fname = protocol_to_file ? BadPixelProtocol::default_fname() : 0;
-    BadPixelProtocol  protocol (fname, protocol_to_stdout);
-    bool              make_protocol = protocol.file() || protocol_to_stdout;
-    
-    cout << "\t(to_file=" << protocol_to_file 
-         << ",  to_stdout=" << protocol_to_stdout
-         << ",  make_protocol=" << make_protocol << ")\n";
-    
-    //  Init progress info
-    TheProgressInfo::start (1.0, _("Merging logarithmic HDR image..."));
-
-    //  "Marken-Werte" zur Markierung null-gewichteter Pixel. Sollten Werte
-    //   sein, die moeglichst nicht als (logarithm) HDR-Werte auftreten.
-    const float  mark_for_Min = 1e30;
-    const float  mark_for_Max = 1e31;
-    
-    int          nlayers = pack.size();
-    int          dim1    = pack.dim1();
-    int          dim2    = pack.dim2();
-    const uint8  z_max   = 255;
-    
-    const Array1D<double> & logtimes = pack.logtimeVec(); // short name
-
-    //  Determine min. threshold z-value, where weight fnct switches to != 0
-    uint8  z_threshold_min = 0;
-    while ((z_threshold_min < z_max) && (weight[z_threshold_min] == 0.0)) 
-      z_threshold_min ++;
-    cout << "\tz-threshold-min = " << (int)z_threshold_min << '\n';
-    
-    //==========
-    // 2D-Sicht
-    //==========
-    //  Alloc (untyped buffer for) HDR image (dim2==W, dim1==H)
-    Image  img (dim2, dim1, IMAGE_RGB_F32, "HDR: RGB 32-bit Float");
-    //  ...and create a typecasted 2D view on it
-    ImgScheme2DView< Rgb<float> >  hdr (img);
-
-    //  Smallest and largest resolvable log. HDR value for this series
-    Rgb<float> val_min (logX_R[0] - logtimes[nlayers-1],
-                        logX_G[0] - logtimes[nlayers-1],
-                        logX_B[0] - logtimes[nlayers-1]);
-
-    Rgb<float> val_max (logX_R[z_max] - logtimes[0],
-                        logX_G[z_max] - logtimes[0],
-                        logX_B[z_max] - logtimes[0]);
-
-    float max_float = std::numeric_limits<float>::max();
-    Rgb<float> h_min ( max_float);    // Init with largest possible value
-    Rgb<float> h_max (-max_float);    // Init with smallest possible value
-
-    Stopwatch uhr;  uhr.start();
-    float progress_add = 0.95 / dim1;  // progress forward per line
-
-    //  For all pixels
-    for (int y=0; y < dim1; y++) 
-    {
-      for (int x=0; x < dim2; x++) 
-      {
-        Rgb<double> sum_w (0.0);          // for summation of weights
-        Rgb<double> sum_e (0.0);          // for summation of radiance values
-      
-        for (int p=0; p < nlayers; p++)
-        {
-          Rgb<uint8>  z = pack [p] [y] [x];
-          Rgb<double>  w (weight[z.r], weight[z.g], weight[z.b]);
-        
-          sum_w += w;
-          //  sum_e += w * Rgb<double>(..., ..., ...)
-          sum_e.r += w.r * (logX_R[z.r] - logtimes[p]);
-          sum_e.g += w.g * (logX_G[z.g] - logtimes[p]);
-          sum_e.b += w.b * (logX_B[z.b] - logtimes[p]);
-        }
-      
-        Rgb<float>&  h = hdr [y] [x];     // short name
-
-        //  Compute "h = sum_e / sum_w", consider cases with sum_w==0!
-        //   Comment see: merge_Hdr_RGB_U8().
-
-        //  Kanaele bei Nullwichtung separat auf Grenzwerte setzen
-        if (sum_w.r != 0.0)
-          h.r = sum_e.r / sum_w.r;              // float <- double
-        else {
-          if (pack [0][y][x].r < z_threshold_min) // nehmen bspielhaft Bild 0
-               h.r = val_min.r;
-          else h.r = val_max.r;                 // also z > z_threshold_max
-        }
+        //  Kanaele bei Nullwichtung separat auf Grenzwerte setzen
+        if (sum_w.r != 0.0)
+          h.r = sum_e.r / sum_w.r;              // float <- double
+        else {
+          if (pack [0][y][x].r < z_threshold_min) // nehmen bspielhaft Bild 0
+               h.r = val_min.r;
+          else h.r = val_max.r;                 // also z > z_threshold_max
+        }
 
         if (sum_w.g != 0.0)
           h.g = sum_e.g / sum_w.g;              // float <- double
@@ -618,8 +481,8 @@ merge_LogHdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
         //  Protokoll-Ausgabe: VOR dem Markieren, da Letzteres HDR-Wert aendert
         //   und danach nur die Markierungswerte noch im Protokoll erschienen.
         //   Allerdings werden hier die *unskalierten* Werte ausgegeben!
-        if (make_protocol)  
-          protocol.out (x,y, sum_w, h, val_min, val_max);
+        if (protocol)  
+          protocol->out (x,y, sum_w, h, val_min, val_max);
              
         //  Mark "bad" (cropped, zero-weighted, unresolved) pixel. Weil wir anschliessend
         //   noch skalieren muessen, koennen nicht hier schon die Kontrastwerte gesetzt
@@ -634,8 +497,8 @@ merge_LogHdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
             else                   h.r = mark_for_Max;
           } 
           else {  //  MinMax feststellen
-            if (h.r < h_min.r) h_min.r = h.r; else
-            if (h.r > h_max.r) h_max.r = h.r;
+            if (h.r < mi.r) mi.r = h.r;
+            if (h.r > ma.r) ma.r = h.r;
           }
         
           if (sum_w.g == 0) {
@@ -643,8 +506,8 @@ merge_LogHdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
             else                   h.g = mark_for_Max;
           }
           else {  //  MinMax feststellen
-            if (h.g < h_min.g) h_min.g = h.g; else
-            if (h.g > h_max.g) h_max.g = h.g;
+            if (h.g < mi.g) mi.g = h.g;
+            if (h.g > ma.g) ma.g = h.g;
           }
 
           if (sum_w.b == 0) {
@@ -652,67 +515,314 @@ merge_LogHdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
             else                   h.b = mark_for_Max;
           }
           else {  //  MinMax feststellen
-            if (h.b < h_min.b) h_min.b = h.b; else
-            if (h.b > h_max.b) h_max.b = h.b;
+            if (h.b < mi.b) mi.b = h.b;
+            if (h.b > ma.b) ma.b = h.b;
           }
         }  
         else {    //  MinMax feststellen ohne Markieren (einfach)
-          if (h.r < h_min.r) h_min.r = h.r; else
-          if (h.r > h_max.r) h_max.r = h.r;
+          if (h.r < mi.r) mi.r = h.r;
+          if (h.r > ma.r) ma.r = h.r;
 
-          if (h.g < h_min.g) h_min.g = h.g; else
-          if (h.g > h_max.g) h_max.g = h.g;
+          if (h.g < mi.g) mi.g = h.g;
+          if (h.g > ma.g) ma.g = h.g;
 
-          if (h.b < h_min.b) h_min.b = h.b; else
-          if (h.b > h_max.b) h_max.b = h.b;
+          if (h.b < mi.b) mi.b = h.b;
+          if (h.b > ma.b) ma.b = h.b;
         }
       
       }  // for all x (columns)
+    }  // for all y (lines)
+}
+
+
+
+/**+*************************************************************************\n
+  merge_Hdr_RGB_U8() 
+  
+  Merging of a Pack of typed \a ImgScheme2D schemes of RGB_U8 image buffers 
+   into one single HDR(float) Rgb-image using three given response curves, a
+   (in the Pack) given vector of exposure times and a given weight function.
+   
+  @param pack: Pack of typed \a ImgScheme2D schemes of RGB_U8 image buffers.
+
+  @param logX_R|G|B: Logarithm. inverse of the response function <i>z=f(X)</i>. 
+     \a logX_R[z]: Logarithm exposure \a log(X) to the pixel value \a z in 
+     channel \a R accordingly to <pre>
+        z = f(X) = f(E*t) 
+        f^-1(z) = X = E*t  
+        g(z) = log(X) = log(E)+log(t)  
+     with
+        g(z) := log[f^-1(z)]. </pre>
+ 
+  @param weight: Weight function object; weight[z]: weight of value z.
+    Almost jene auch bei der logX_*-Berechnung verwendete. 
+
+  @param progressinfo: Pointer to a ProgressInfo instance. Default: 0.
+ 
+  @param protocol_to_file: A bad-pixel-protocol to a file? Default: false.
+     (Using default filename of BadPixelProtocol.)
+     
+  @param protocol_to_stdout: A bad-pixel-protocol to stdout? Default: false.
+  
+  @return HDR<float>-RGB-Bild: die aus <i>log(E)=log(X)-log(t)</i> resultierenden
+     E-Daten: logE(z) = logX(z) - logTimes, oder vielmehr delogarithmiert:
+     exp(logE).
+ 
+  
+  @note Beachte, dass die Scheme2D der Pack-Ausgangsdaten Sub-Arrays darstellen
+   koennen. Benutze fuer diese daher nur die "[][]"-Syntax oder linearisiere
+   allenfalls innerhalb einer Zeile. Fuer das hier erzeugte HDR-Bild dagegen ist
+   klar, dass es zusammenhaengend; da kann auch view1d() zur Anwendung kommen.
+
+  
+  <h3>Bemerkungen:</h3>
+  
+  <b>Unaufgeloeste HDR-Werte:</b>
+   Einfach gesagt: Pixelwerte z=255 im kuerzestbelichteten Bild oder z=0 im
+   laengstbelichteten sind unaufgeloest (nicht im Arbeitsbereich). Weil wir alle
+   z-Werte wichten und durch breitere Nullraender der Gewichtsfunktionen auch
+   mehr unaufgeloest sein koennen, machen wir es am Gewicht fest. Eine vereinfachte
+   Alternative zur Markierungsweise unten waere, zum Schluss das hellste und das
+   dunklelste Bild noch einmal durchzugehen und die Stellen mit z=0 bzw. z=255
+   zu markieren.
+  
+   Wenn ein Pixel bzgl. eines Kanals in ALLEN Bildern das Gewicht 0 erhaelt,
+   bekommen wir sum_w = sum_e = 0 und die Operation "sum_e / sum_w" kann nicht
+   ausgefuehrt werden ("0/0"). Der HDR-Wert (jenes Kanals) ist an dieser Stelle 
+   unbestimmt, er muss geeignet <i>gesetzt</i> werden. Weil Wichtungsfunktionen
+   gewoehnlich nur an den Raendern bei z=0 und z=zmax Null werden, wird aus sum_w=0
+   auf "z=0 oder z=max" (in allen Bildern) geschlossen und dass der unbekannte HDR-Wert 
+   (E) folglich  unterhalb bzw. oberhalb des durch diese Belichtungsreihe noch
+   Aufloesbaren liegt. Wir setzen ihn daher fuer z=0 auf die untere Aufloesungsgrenze 
+   (min. HDR-, sprich E-Wert) und fuer z=zmax auf die obere (max. HDR-, sprich E-Wert).
+   
+   Der kleinste reale E-Wert, den diese Belichtungsreihe erfassen koennte, ist
+   der zu <b>z=0</b> im Bild mit der <b>laengsten</b> Belichtungszeit, der groesste
+   noch erfassbare der zu <b>z=zmax</b> im Bild mit der <b>kuerzesten</b> 
+   Belichtungszeit. Gemaess <pre>
+            logE = logX - logtimes </pre>
+   und dem Umstand, dass die Bilder in aufsteigender Belichtungszeit geordnet, 
+   also <pre>
+            logE_min = logX[0] - logtimes[nlayers-1]
+            logE_max = logX[z_max] - logtimes[0]  </pre>
+   
+  <b>Nachtrag:</b>
+   Wir arbeiten unten mit der UNTERSTELLUNG, dass Wichtungsfunktionen w(z) nur von
+   den Raendern her und in zusammenhaengenden Bereichen Null liefern koennen, d.h.
+   dass es zwei Schwellwerte \a z_threshold_min und \a z_threshold_max gebe mit
+   <pre>
+      w(z) == 0 fuer  z .<. z_threshold_min (zu dunkel -> min. HDR-Wert)
+      w(z) == 0 fuer  z .>. z_threshold_max (zu hell -> max. HDR-Wert)
+      w(z) != 0 sonst. </pre>
+   
+   Stossen wir auf ein sum_w==0, wird anhand des z-Wertes entschieden, ob der 
+   HDR-Wert auf min. oder max. HDR-Wert gesetzt wird. Fuer Wichtungsfunktionen mit
+   Nullbereichen in der Mitte wuerde das nicht mehr funktionieren, der zweite else-
+   Zweig in der Abfrage unten verwiese nicht mehr notwendig auf z.>.z_threshold_max.
+
+   Die Klaerung, ob null-gewichtete Pixel auf Min- oder Max-HDR-Wert zu setzen
+   sind anhand der Abfrage
+   <pre>
+      if (sum_w.r != 0)  berechne sum_e.r/sum_w.r;
+      else if (pixel.r .<. z_threshold_min) set_to_min;
+      else                                  set_to_max;  </pre>
       
-      TheProgressInfo::forward (progress_add);
+   funktioniert auch fuer Wichtungsfunktionen, die gar nicht oder nur einseitig 
+   Null werden: Wenn gar nicht Null, kann sum_w==0 nicht auftreten, wenn einseitig
+   links Null, kann sum_w nur fuer linke z.<.z_threshold_min Null werden und das 
+   ist der erste else-Zweig, wenn einseitig rechts Null, ist z_threshold_min==0
+   und die Bedingung z.<.z_threshold_min kann fuer solche z nicht zutreffen, 
+   sprich, es wird richtigerweise im zweiten else-Zweig auf Max gesetzt. Wenn eine
+   Wichtungsfunktion komplett 0, ist z_threshold_min=255 und alle z-Werte ausser
+   z=255 sind kleiner als z_threshold_min und werden auf min-HDR gesetzt; z=255
+   auf max-HDR.
+   
+  <b>Kontrastierungen:</b>
+   Das Markieren null-gewichter Pixel (d.h. von HDR-Werten, die auf min-HDR oder
+   max-HDR gesetzt wuerden) durch Kontrastfarben geschieht wie folgt: Wuerde ein
+   HDR-Wert auf min-HDR gesetzt), bekommt er den Wert 1.0 (Kontrast zur angenommenen
+   dunklen Umgebung), wuerde er auf max-HDR gesetzt, bekommt er den Wert 0.0 (Kontrast
+   zur angenommenen hellen Umgebung. Schief (nicht in allen Kanaelen) abgeschnittene
+   HDR-Pixel erscheinen dadurch farbig:  <pre>
+    unten: nur R abgeschnitten --> RGB = (1, wenig, wenig)  (rot)
+           nur G abgeschnitten --> RGB = (wenig, 1, wenig)  (gruen)
+           R+G   abgeschnitten --> RGB = (1, 1, wenig)
+    oben:  nur R abgeschnitten --> RGB = (0, viel, viel)    (cyan)
+           R+G   abgeschnitten --> RGB = (0, 0, viel)       (blau) </pre>
+           
+  @todo Der Kontrastwert "1.0" hat den Nachteil, dass er in einem HDR-Bild, das z.B.
+   bis 10^3 reicht, bei entsprechender Skalierung nicht mehr auffaellt. Alternativ
+   koennte als Kontrast zum Dunklen auch max-HDR (val_max) oder der Bildmaximalwert
+   (h_max) genommen werden. Fuer letzteres muesste Kontrastieren in einem zweiten
+   Durchlauf erfolgen, da die Min-Max-Werte ja erst ermittelt werden muessen, was
+   wiederum verlangte, wie im log-Fall die "0/0"-Faelle aus der Min-Max-Ermittlung
+   zunaechst auszusparen. \n
+  hdr_max != h_max kann dann eintreten, wenn die wegen "0/0" irgendwie zu setzenden
+   Werte nicht in Min-Max-Berechnung eingehen, sondern wie im log-Fall zunaechst 
+   ausgespart werden und erst anschliessend auf endgueltigen Wert gesetzt werden, 
+   z.B. eben dann auf h_max.
+  
+  @todo Es koennte die Option angeboten werden, schief abgeschnittene Pixel (die
+   naemlich auffallen) komplett auf schwarzen min-HDR- bzw. komplett auf weissen
+   max-HDR-Wert zu setzen. Oder anhand der Umgebung korrigieren? Welches natuerlich
+   nur moeglich, wenn die Umgebung nicht selbst gestoert.
+
+******************************************************************************/
+br::Image    // IMAGE_RGB_F32
+merge_Hdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
+                  const TNT::Array1D<double> &   logX_R,
+                  const TNT::Array1D<double> &   logX_G,
+                  const TNT::Array1D<double> &   logX_B,
+                  const WeightFunc_U8 &          weight,
+                  bool                           mark_bad_pixel, 
+                  bool                           protocol_to_file,
+                  bool                           protocol_to_stdout )
+{
+    cout <<__func__<< "()...\n";
+    assert (logX_R.dim() == 256);
+    assert (logX_G.dim() == 256);
+    assert (logX_B.dim() == 256);
+    assert (weight.have_table());
+    //assert (weight.table.dim() == 256);
+    //list (weight);
+
+    //  Init protocol stuff
+    const char*       fname = protocol_to_file ? BadPixelProtocol::default_fname() : 0;
+    BadPixelProtocol  protocol (fname, protocol_to_stdout);
+    bool              make_protocol = protocol.file() || protocol_to_stdout;
     
-    }  // for all y (lines)
+    cout << "\t(make_protocol=" << make_protocol
+         << ",  to_file=" << protocol_to_file 
+         << ",  to_stdout=" << protocol_to_stdout << ")\n";
+
+    //  Init progress info
+    TheProgressInfo::start (1.0, _("Merging HDR image..."));
+        
+    int         dim1    = pack.dim1();
+    int         dim2    = pack.dim2();
+
+    //  Alloc (untyped buffer for) HDR image (dim2==W, dim1==H)
+    Image  img (dim2, dim1, IMAGE_RGB_F32, "HDR: RGB 32-bit Float");
+
+    Stopwatch uhr;  uhr.start();
+    float progress_add = 1.0 / dim1;  // progress forward per line
+
+    //  Merge bands of rows on several threads; the bad pixel protocol wants
+    //   pixel order though, so one thread then. The work determines the
+    //   z-threshold and the resolvable HDR values.
+    int  nslots = make_protocol ? 1 : row_band_slots (dim1);
+    HdrRows_RGB_U8  work (pack, logX_R, logX_G, logX_B, weight, nslots);
+    work.out             = (Rgb<float>*) img.buffer();
+    work.mark_bad_pixel  = mark_bad_pixel;
+    if (make_protocol)
+      work.protocol      = &protocol;
+    cout << "\tz-threshold-min = " << (int)work.z_threshold_min << '\n';
+
+    run_row_bands (work, 0, dim1, nslots, progress_add);
     
+    //  Min-max search above has no "else" between min and max test, so
+    //   h_max is set also for strictly falling sequences and bands.
+    Rgb<float>  h_min, h_max;
+    gather_min_max (work.h_min, work.h_max, nslots, h_min, h_max);
+
+    double zeit = uhr.stop();
+    printf ("\tTime for HDR merging: %f sec\n", zeit);
+
+    cout << "min. resolvable HDR value = " << work.val_min << '\n';
+    cout << "   image's min. HDR value = " << h_min   << '\n';
+    cout << "max. resolvable HDR value = " << work.val_max << '\n';
+    cout << "   image's max. HDR value = " << h_max   << '\n';
     
-    //  Weil bei streng fallenden Folgen obige else-Zweige nie erreicht wuerden,
-    //   pruefen, ob h_max geaendert wurde; wenn nicht, ist Maximalwert der
-    //   erste, denn wie gesagt: *streng fallend*.
-    //   Falls allerdings "bad pixel" markiert wurden, koennte erster Pixel einen
-    //   Markierungswert haben. In diesem Fall ist der erste nichtmarkierte zu
-    //   suchen, welcher naemlich auch der erste in die Min-Max-Suche eingegangene.
-    if (mark_bad_pixel) {
-      int i;
-      if (h_max.r == -max_float) {      // Suche ersten Nichtmarkierten
-        i = 0;
-        while ((hdr.view1d(i).r == mark_for_Min || 
-                hdr.view1d(i).r == mark_for_Max) && i < hdr.size())  i++;
-        h_max.r = hdr.view1d(i).r;
-      }                
-      if (h_max.g == -max_float) {      // Suche ersten Nichtmarkierten
-        i = 0;
-        while ((hdr.view1d(i).g == mark_for_Min || 
-                hdr.view1d(i).g == mark_for_Max) && i < hdr.size())  i++;
-        h_max.g = hdr.view1d(i).g;
-      }                
-      if (h_max.b == -max_float) {      // Suche ersten Nichtmarkierten
-        i = 0;
-        while ((hdr.view1d(i).b == mark_for_Min || 
-                hdr.view1d(i).b == mark_for_Max) && i < hdr.size())  i++;
-        h_max.b = hdr.view1d(i).b;
-      }                
-    }
-    else {  // !mark_bad_pixel
-      if (h_max.r == -max_float) h_max.r = hdr[0][0].r;
-      if (h_max.g == -max_float) h_max.g = hdr[0][0].g;
-      if (h_max.b == -max_float) h_max.b = hdr[0][0].b;
-    }
+    TheProgressInfo::finish();
+    return img;
+}
+
+
+/**+*************************************************************************\n
+  merge_LogHdr_RGB_U8()
+  
+  Merging of a Pack of typed \a ImgScheme2D schemes of RGB_U8 image buffers 
+   into one single <i>logarithmic</i> HDR(float) Rgb-image using three given
+   response curves, a (in the Pack) given vector of exposure times and a given
+   weight function.
+
+  Logarithm. HDR-Bild extra zu bauen deshalb interessant, weil beim gewoehnl.
+   fuer alle Werte ein `exp(z) auftritt, das hier gespart werden kann. Bei 
+   N Pixeln und P LDR-Bildern sind das 3*N*P exp()-Operationen.
+  
+  @param *: see: merge_Hdr_RGB_U8().
+     
+  @return logarithmiertes HDR<float>-Bild: die gemaess <i>log(E)=log(X)-log(t)</i>
+    resultierenden <i>log(E)</i>-Daten, skaliert auf [0,1].
+   
+  @note Beachte, dass die Scheme2D der Pack-Ausgangsdaten Sub-Arrays darstellen
+   koennen. Benutze fuer diese daher nur die "[][]"-Syntax oder linearisiere
+   allenfalls innerhalb einer Zeile. Fuer das hier erzeugte HDR-Bild dagegen ist
+   klar, dass es zusammenhaengend; da kann auch view1d() zur Anwendung kommen.
+
+******************************************************************************/
+br::Image    // IMAGE_RGB_F32
+merge_LogHdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
+                     const TNT::Array1D<double> &   logX_R,
+                     const TNT::Array1D<double> &   logX_G,
+                     const TNT::Array1D<double> &   logX_B,
+                     const WeightFunc_U8 &          weight,
+                     bool                           mark_bad_pixel, 
+                     bool                           protocol_to_file,
+                     bool                           protocol_to_stdout )
+{
+    cout <<__func__<< "()...\n";
+    assert (logX_R.dim() == 256);
+    assert (logX_G.dim() == 256);
+    assert (logX_B.dim() == 256);
+    assert (weight.have_table());
+    //assert (weight.dim() == 256);
+
+    //  Init protocol stuff
+    const char*       fname = protocol_to_file ? BadPixelProtocol::default_fname() : 0;
+    BadPixelProtocol  protocol (fname, protocol_to_stdout);
+    bool              make_protocol = protocol.file() || protocol_to_stdout;
+    
+    cout << "\t(to_file=" << protocol_to_file 
+         << ",  to_stdout=" << protocol_to_stdout
+         << ",  make_protocol=" << make_protocol << ")\n";
+    
+    //  Init progress info
+    TheProgressInfo::start (1.0, _("Merging logarithmic HDR image..."));
+
+    int          dim1    = pack.dim1();
+    int          dim2    = pack.dim2();
+    
+    //  Alloc (untyped buffer for) HDR image (dim2==W, dim1==H)
+    Image  img (dim2, dim1, IMAGE_RGB_F32, "HDR: RGB 32-bit Float");
+
+    Stopwatch uhr;  uhr.start();
+    float progress_add = 0.95 / dim1;  // progress forward per line
+
+    //  Merge bands of rows on several threads; the bad pixel protocol wants
+    //   pixel order though, so one thread then.
+    int  nslots = make_protocol ? 1 : row_band_slots (dim1);
+    LogHdrRows_RGB_U8  work (pack, logX_R, logX_G, logX_B, weight, nslots);
+    work.out             = (Rgb<float>*) img.buffer();
+    work.mark_bad_pixel  = mark_bad_pixel;
+    if (make_protocol)
+      work.protocol      = &protocol;
+    cout << "\tz-threshold-min = " << (int)work.z_threshold_min << '\n';
+
+    run_row_bands (work, 0, dim1, nslots, progress_add);
+    
+    //  Min-max search above has no "else" between min and max test, so
+    //   h_max is set also for strictly falling sequences and bands. Marked
+    //   "bad" pixels did not take part.
+    Rgb<float>  h_min, h_max;
+    gather_min_max (work.h_min, work.h_max, nslots, h_min, h_max);
 
     double zeit = uhr.stop();
     printf ("\tTime for Log-HDR merging: %f sec\n", zeit);
 
-    cout << "min. resolvable HDR value = " << val_min << '\n';
+    cout << "min. resolvable HDR value = " << work.val_min << '\n';
     cout << "   image's min. HDR value = " << h_min   << '\n';
-    cout << "max. resolvable HDR value = " << val_max << '\n';
+    cout << "max. resolvable HDR value = " << work.val_max << '\n';
     cout << "   image's max. HDR value = " << h_max   << '\n';
 
     //  Logarithm domain is (-infty, +infty). Normalize values to [0,1]:
@@ -723,6 +833,7 @@ merge_LogHdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
     //   Aber nicht mehr auf aktuellem Stand, Markierung unberuechsichtigt!
     // 
     Rgb<float> fac = Rgb<float>(1.0) / (h_max - h_min);
+    ImgScheme2DView< Rgb<float> >  hdr (img);
 
     for (int i=0; i < hdr.size(); i++)          // 1D-View 
       hdr.view1d(i) = fac * (hdr.view1d(i) - h_min);
@@ -738,26 +849,7 @@ merge_LogHdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
     
     //  Falls "bad pixel" markiert wurden, diese jetzt raussuchen und auf ihre
     //   Kontrastwerte setzen. Falls nicht markiert wurde, schlicht skalieren.
-    if (mark_bad_pixel)
-      for (int i=0; i < hdr.size(); i++)          // 1D-View
-      {
-        Rgb<float>& h = hdr.view1d(i);            // short name
-      
-        if (h.r == mark_for_Min)       h.r = 1.0;     // Kontrast zum Minimum
-        else if (h.r == mark_for_Max)  h.r = 0.0;     // Kontrast zum Maximum
-        else                           h.r = fac_all * (h.r - min_all);
-        
-        if (h.g == mark_for_Min)       h.g = 1.0;     // Kontrast zum Minimum
-        else if (h.g == mark_for_Max)  h.g = 0.0;     // Kontrast zum Maximum
-        else                           h.g = fac_all * (h.g - min_all);
-        
-        if (h.b == mark_for_Min)       h.b = 1.0;     // Kontrast zum Minimum
-        else if (h.b == mark_for_Max)  h.b = 0.0;     // Kontrast zum Maximum
-        else                           h.b = fac_all * (h.b - min_all);
-      }
-    else
-      for (int i=0; i < hdr.size(); i++)          // 1D-View
-        hdr.view1d(i) = fac_all * (hdr.view1d(i) - min_all);
+    scale_log_rows (work.out, (long)dim1 * dim2, min_all, fac_all, mark_bad_pixel);
 #endif
       
     TheProgressInfo::finish();
@@ -765,6 +857,191 @@ merge_LogHdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
 }
 
 
+/**+*************************************************************************\n
+  stream_Hdr_RGB_U8()  --  merge_Hdr_RGB_U8() without a full-size result.
+
+  Bands of \a band_rows rows are merged into one band buffer, each handed to
+   \a sink before the next one is merged. So besides the inputs only one band
+   of floats is held, whatever the image size. \a band_rows <= 0 means all
+   rows at once.
+
+  @returns false if the sink refused the image.
+******************************************************************************/
+bool
+stream_Hdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
+                   const TNT::Array1D<double> &   logX_R,
+                   const TNT::Array1D<double> &   logX_G,
+                   const TNT::Array1D<double> &   logX_B,
+                   const WeightFunc_U8 &          weight,
+                   HdrBandSink &                  sink,
+                   int                            band_rows,
+                   bool                           mark_bad_pixel, 
+                   bool                           protocol_to_file,
+                   bool                           protocol_to_stdout )
+{
+    cout <<__func__<< "()...\n";
+    assert (logX_R.dim() == 256);
+    assert (logX_G.dim() == 256);
+    assert (logX_B.dim() == 256);
+    assert (weight.have_table());
+
+    //  Init protocol stuff
+    const char*       fname = protocol_to_file ? BadPixelProtocol::default_fname() : 0;
+    BadPixelProtocol  protocol (fname, protocol_to_stdout);
+    bool              make_protocol = protocol.file() || protocol_to_stdout;
+    
+    int         dim1    = pack.dim1();
+    int         dim2    = pack.dim2();
+
+    if (band_rows <= 0 || band_rows > dim1)  band_rows = dim1;
+    cout << "\t(band_rows=" << band_rows << ",  make_protocol=" << make_protocol << ")\n";
+    
+    if (! sink.begin (dim2, dim1))
+      return false;
+    
+    //  Init progress info
+    TheProgressInfo::start (1.0, _("Merging HDR image..."));
+        
+    DynArray1D< Rgb<float> >  band (band_rows * dim2);
+
+    Stopwatch uhr;  uhr.start();
+    float progress_add = 1.0 / dim1;  // progress forward per line
+
+    int  nslots = make_protocol ? 1 : row_band_slots (band_rows);
+    HdrRows_RGB_U8  work (pack, logX_R, logX_G, logX_B, weight, nslots);
+    work.out             = band;
+    work.mark_bad_pixel  = mark_bad_pixel;
+    if (make_protocol)
+      work.protocol      = &protocol;
+
+    for (int y=0; y < dim1; y += band_rows)
+    {
+      int  n = min (band_rows, dim1 - y);
+      work.out_y0 = y;
+      run_row_bands (work, y, y + n, nslots, progress_add);
+      sink.put_rows (y, n, band);
+    }
+    sink.end();
+    
+    Rgb<float>  h_min, h_max;
+    gather_min_max (work.h_min, work.h_max, nslots, h_min, h_max);
+
+    double zeit = uhr.stop();
+    printf ("\tTime for HDR merging: %f sec\n", zeit);
+
+    cout << "min. resolvable HDR value = " << work.val_min << '\n';
+    cout << "   image's min. HDR value = " << h_min   << '\n';
+    cout << "max. resolvable HDR value = " << work.val_max << '\n';
+    cout << "   image's max. HDR value = " << h_max   << '\n';
+    
+    TheProgressInfo::finish();
+    return true;
+}
+
+
+/**+*************************************************************************\n
+  stream_LogHdr_RGB_U8()  --  merge_LogHdr_RGB_U8() without a full-size result.
+
+  The scaling to [0,1] needs the min-max values of the whole image before the
+   first band can be handed out. Without a full-size buffer to keep, the bands
+   are merged twice: a first pass only gathers the min-max values, the second
+   merges again, scales and hands each band to \a sink. A bad pixel protocol
+   is written in the first pass only. Channels are always scaled together,
+   SCALE_EACH_CHANNEL_INDEPENDENTLY is not regarded.
+
+  @returns false if the sink refused the image.
+******************************************************************************/
+bool
+stream_LogHdr_RGB_U8 (const PackImgScheme2D_RGB_U8 & pack,
+                      const TNT::Array1D<double> &   logX_R,
+                      const TNT::Array1D<double> &   logX_G,
+                      const TNT::Array1D<double> &   logX_B,
+                      const WeightFunc_U8 &          weight,
+                      HdrBandSink &                  sink,
+                      int                            band_rows,
+                      bool                           mark_bad_pixel, 
+                      bool                           protocol_to_file,
+                      bool                           protocol_to_stdout )
+{
+    cout <<__func__<< "()...\n";
+    assert (logX_R.dim() == 256);
+    assert (logX_G.dim() == 256);
+    assert (logX_B.dim() == 256);
+    assert (weight.have_table());
+
+    //  Init protocol stuff
+    const char*       fname = protocol_to_file ? BadPixelProtocol::default_fname() : 0;
+    BadPixelProtocol  protocol (fname, protocol_to_stdout);
+    bool              make_protocol = protocol.file() || protocol_to_stdout;
+    
+    int          dim1    = pack.dim1();
+    int          dim2    = pack.dim2();
+    
+    if (band_rows <= 0 || band_rows > dim1)  band_rows = dim1;
+    cout << "\t(band_rows=" << band_rows << ",  make_protocol=" << make_protocol << ")\n";
+    
+    if (! sink.begin (dim2, dim1))
+      return false;
+    
+    //  Init progress info
+    TheProgressInfo::start (1.0, _("Merging logarithmic HDR image..."));
+
+    DynArray1D< Rgb<float> >  band (band_rows * dim2);
+
+    Stopwatch uhr;  uhr.start();
+    float progress_add = 0.5 / dim1;  // progress forward per line and pass
+
+    //  Pass 1: min-max values only; one thread if a protocol is written
+    int  nslots = row_band_slots (band_rows);
+    LogHdrRows_RGB_U8  work (pack, logX_R, logX_G, logX_B, weight, nslots);
+    work.out             = band;
+    work.mark_bad_pixel  = mark_bad_pixel;
+    if (make_protocol)
+      work.protocol      = &protocol;
+
+    for (int y=0; y < dim1; y += band_rows)
+    {
+      int  n = min (band_rows, dim1 - y);
+      work.out_y0 = y;
+      run_row_bands (work, y, y + n, make_protocol ? 1 : nslots, progress_add);
+    }
+    
+    Rgb<float>  h_min, h_max;
+    gather_min_max (work.h_min, work.h_max, nslots, h_min, h_max);
+
+    cout << "min. resolvable HDR value = " << work.val_min << '\n';
+    cout << "   image's min. HDR value = " << h_min   << '\n';
+    cout << "max. resolvable HDR value = " << work.val_max << '\n';
+    cout << "   image's max. HDR value = " << h_max   << '\n';
+
+    //  Scale so, that overall-max -> 1, overall-min -> 0:
+    float max_all = max (max(h_max.r, h_max.g), max(h_max.g, h_max.b));  
+    float min_all = min (min(h_min.r, h_min.g), min(h_min.g, h_min.b));  
+    float fac_all = 1.0 / (max_all - min_all);
+
+    cout << "max_all=" << max_all << "  min_all=" << min_all << "  fac_all=" << fac_all << '\n'; 
+    
+    //  Pass 2: merge again, scale and hand out; no protocol twice
+    work.protocol = 0;
+    
+    for (int y=0; y < dim1; y += band_rows)
+    {
+      int  n = min (band_rows, dim1 - y);
+      work.out_y0 = y;
+      run_row_bands (work, y, y + n, nslots, progress_add);
+      scale_log_rows (band, (long)n * dim2, min_all, fac_all, mark_bad_pixel);
+      sink.put_rows (y, n, band);
+    }
+    sink.end();
+    
+    double zeit = uhr.stop();
+    printf ("\tTime for Log-HDR merging: %f sec\n", zeit);
+
+    TheProgressInfo::finish();
+    return true;
+}
+
+
 }  // namespace "br"
 
 // END OF FILE
@@ -34,6 +34,7 @@
 #include "br_PackImgScheme2D.hpp"       // PackImgScheme2D_RGB_U8
 #include "br_Image.hpp"                 // br::Image
 #include "WeightFunc_U8.hpp"            // WeightFunc_U8
+#include "HdrBandSink.hpp"              // HdrBandSink
 
 
 namespace br {
@@ -65,6 +66,38 @@ merge_LogHdr_RGB_U8 (   const br::PackImgScheme2D_RGB_U8 & pack,
                         bool                         protocol_to_file   = false, 
                         bool                         protocol_to_stdout = false );
 
+/****************************************************************************\n
+  stream_Hdr_RGB_U8(). merge_Hdr_RGB_U8() band by band into \a sink, without
+   a full-size result. Description see: ~.cpp file.
+******************************************************************************/
+bool
+stream_Hdr_RGB_U8 (     const br::PackImgScheme2D_RGB_U8 & pack,
+                        const TNT::Array1D<double> & logX_R,
+                        const TNT::Array1D<double> & logX_G,
+                        const TNT::Array1D<double> & logX_B,
+                        const WeightFunc_U8        & weight,
+                        HdrBandSink                & sink,
+                        int                          band_rows,
+                        bool                         mark_bad_pixel     = false,
+                        bool                         protocol_to_file   = false, 
+                        bool                         protocol_to_stdout = false );
+
+
+/****************************************************************************\n
+  stream_LogHdr_RGB_U8(). Description see: ~.cpp file.  
+******************************************************************************/
+bool
+stream_LogHdr_RGB_U8 (  const br::PackImgScheme2D_RGB_U8 & pack,
+                        const TNT::Array1D<double> & logX_R,
+                        const TNT::Array1D<double> & logX_G,
+                        const TNT::Array1D<double> & logX_B,
+                        const WeightFunc_U8        & weight,
+                        HdrBandSink                & sink,
+                        int                          band_rows,
+                        bool                         mark_bad_pixel     = false,
+                        bool                         protocol_to_file   = false, 
+                        bool                         protocol_to_stdout = false );
+
 
 }  // namespace "br"
 
@@ -49,6 +49,7 @@
    No idea why, anyhow, thus CPaint headers included behind those.
 */
 
+#include <cstdlib>                  // atoi()
 #include <FL/fl_ask.H>              // fl_alert(), fl_ask()
 #include <FL/filename.H>            // fl_filename_name()
 #include "br_core/br_version.hpp"   // BR_VERSION_LSTRING    
@@ -58,6 +59,7 @@
 #include "br_core/br_messages.hpp"  // br::msg_image_ignored(), e_printf()
 #include "br_core/readEXIF.hpp"     // readEXIF()
 #include "gui/AllWindows.hpp"       // object `allWins'
+#include "br_core/HdrBandSink.hpp"  // HdrBandSink
 #include "bracketing_to_hdr.hpp"    // cpaint_load_image(), cpaint_show_image()
 extern "C" {
 #include "lib/plugin_main.h"
@@ -95,6 +97,7 @@ br::BrImage     cpaint_get_BrImage_U16          (int W, int H, gint32 layer_ID);
 void            cpaint_show_rgb_imgbuf          (int W, int H, const uchar* imgbuf,
                                                  GPrecisionType );
 const char*     cpaint_precision_name           (GPrecisionType);
+int             cpaint_band_rows                (void);
 
 template<typename T> 
 void            copy_without_alpha              (br::Image &, GimpPixelRgn &);
@@ -728,6 +731,130 @@ cpaint_show_image (const br::Image & img)
 }
 
 
+/**===========================================================================
+  CPaintBandSink  --  HdrBandSink writing the merged bands straight into the
+   layer of a new FLOAT_RGB image through a pixel region. So besides one band
+   no float HDR image exists outside of CinePaint's tiles.
+=============================================================================*/
+class CPaintBandSink : public br::HdrBandSink
+{
+  gint32      image_ID_;
+  GDrawable * drawable_;
+  GPixelRgn   pixel_rgn_;
+  int         W_;
+
+public:
+  CPaintBandSink() : image_ID_(-1), drawable_(0), W_(0)  {}
+  ~CPaintBandSink()     {if (drawable_) gimp_drawable_detach (drawable_);}
+  
+  bool begin (int W, int H);
+  void put_rows (int y0, int nrows, const Rgb<float>* rows);
+  void end ();
+};
+
+bool
+CPaintBandSink::begin (int W, int H)
+{
+  image_ID_ = gimp_image_new ((guint)W, (guint)H, FLOAT_RGB);
+
+  if (image_ID_ == -1) 
+    {
+      const char* str_could_not = _("Could not create a new image");
+      br::v_alert ("%s\n%d x %d, image_type #%d", str_could_not, W, H, FLOAT_RGB);
+      return false;
+    }
+
+  gint32 layer_ID = gimp_layer_new (image_ID_, "Br2HDR",
+                                    (guint)W, (guint)H,
+                                    FLOAT_RGB_IMAGE,
+                                    100.0,             // opacity
+                                    NORMAL_MODE );
+  
+  gimp_image_add_layer (image_ID_, layer_ID, 0);
+
+  drawable_ = gimp_drawable_get (layer_ID);
+  gimp_pixel_rgn_init (&pixel_rgn_, drawable_, 0,0, W,H, false,false);
+  W_ = W;
+  return true;
+}
+
+void
+CPaintBandSink::put_rows (int y0, int nrows, const Rgb<float>* rows)
+{
+  gimp_pixel_rgn_set_rect (&pixel_rgn_, (guchar*)rows, 0,y0, W_,nrows);
+}
+
+void
+CPaintBandSink::end ()
+{
+  gimp_drawable_flush  (drawable_);
+  gimp_drawable_detach (drawable_);
+  drawable_ = 0;
+  gimp_display_new (image_ID_);
+}
+
+
+/**+*************************************************************************\n
+  cpaint_band_rows()  --  The "bracketing-to-hdr-band-rows" gimprc entry: rows
+   of the HDR image merged and handed to CinePaint at once, rounded up to whole
+   tile rows. 0 if unset or 0, then the HDR image is merged in full.
+******************************************************************************/
+int
+cpaint_band_rows (void)
+{
+  int         rows = 0;
+  int         n_retvals;
+  GimpParam * return_vals;
+  
+  return_vals = gimp_run_procedure ("gimp_gimprc_query",
+                                    & n_retvals,
+                                    GIMP_PDB_STRING, "bracketing-to-hdr-band-rows",
+                                    GIMP_PDB_END);
+  
+  if (return_vals[0].data.d_status == GIMP_PDB_SUCCESS &&
+      return_vals[1].data.d_string)
+    rows = atoi (return_vals[1].data.d_string);
+  
+  gimp_destroy_params (return_vals, n_retvals);
+  
+  if (rows <= 0)
+    return 0;
+  
+  int th = gimp_tile_height();
+  return (rows + th - 1) / th * th;
+}
+
+
+/**+*************************************************************************\n
+  cpaint_show_HDR()
+  
+  Completes the (logarithmic) HDR image by \a mBr2Hdr and shows it via
+   CinePaint. With a "bracketing-to-hdr-band-rows" gimprc entry the image is
+   merged band by band straight into the new drawable, so that no full-size
+   float image needs to be held in the plug-in, else merged in full and shown
+   by cpaint_show_image().
+******************************************************************************/
+void 
+cpaint_show_HDR (br::Br2HdrManager & mBr2Hdr, bool logarithmic)
+{
+  int band_rows = cpaint_band_rows();
+  
+  if (band_rows <= 0) 
+    {
+      cpaint_show_image (logarithmic ? mBr2Hdr.complete_LogHDR() 
+                                     : mBr2Hdr.complete_HDR());
+      return;
+    }
+  
+  CPaintBandSink  sink;
+  
+  if (logarithmic)
+    mBr2Hdr.complete_LogHDR (sink, band_rows);
+  else
+    mBr2Hdr.complete_HDR (sink, band_rows);
+}
+
+
 /**+*************************************************************************\n
   Returns a human readable name of the GPrecisionType enum value \a precis; 
    useful for messages and warnings.
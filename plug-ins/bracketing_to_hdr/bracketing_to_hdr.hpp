@@ -36,11 +36,14 @@
 
   inline bool cpaint_load_image   (const char* fname, br::Br2HdrManager &, bool=true) {return false;}
   inline void cpaint_show_image   (const br::Image &)                      {}
+  inline void cpaint_show_HDR     (br::Br2HdrManager & m, bool log=false)
+                                  {if (log) m.complete_LogHDR(); else m.complete_HDR();}
 
 #else
 
   bool cpaint_load_image          (const char* fname, br::Br2HdrManager &, bool interactive=true);
   void cpaint_show_image          (const br::Image &);
+  void cpaint_show_HDR            (br::Br2HdrManager &, bool logarithmic=false);
 
 #endif  // #else NO_CINEPAINT
 
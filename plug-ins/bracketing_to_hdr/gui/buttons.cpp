@@ -27,7 +27,7 @@
 #include "../br_core/Br2Hdr.hpp"            // br::Br2Hdr::Instance()
 #include "../br_core/br_defs.hpp"           // BR_DEBUG_RECEIVER
 #include "../br_core/Run_DisplcmFinder.hpp" // Run_DispclmFinder
-#include "../bracketing_to_hdr.hpp"         // cpaint_show_image()
+#include "../bracketing_to_hdr.hpp"         // cpaint_show_HDR()
 
 //#ifdef BR_DEBUG_RECEIVER
 #  include <iostream>
@@ -236,7 +236,7 @@ void HDRButton::handle_Event (Br2Hdr::Event e)
 
 void HDRButton::cb_fltk_(Fl_Widget*, void*) 
 {
-    cpaint_show_image (Br2Hdr::Instance().complete_HDR());
+    cpaint_show_HDR (Br2Hdr::Instance());
 }
 
 
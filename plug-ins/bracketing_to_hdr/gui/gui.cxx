@@ -57,14 +57,14 @@ void MainWinClass::cb_mbar_item_Compute_Response_(Fl_Menu_* o, void* v) {
 }
 
 void MainWinClass::cb_mbar_item_Compute_HDR__i(Fl_Menu_*, void*) {
-  cpaint_show_image (Br2Hdr::Instance().complete_HDR());
+  cpaint_show_HDR (Br2Hdr::Instance());
 }
 void MainWinClass::cb_mbar_item_Compute_HDR_(Fl_Menu_* o, void* v) {
   ((MainWinClass*)(o->parent()->user_data()))->cb_mbar_item_Compute_HDR__i(o,v);
 }
 
 void MainWinClass::cb_mbar_item_Compute_logHDR__i(Fl_Menu_*, void*) {
-  cpaint_show_image (Br2Hdr::Instance().complete_LogHDR());
+  cpaint_show_HDR (Br2Hdr::Instance(), true);
 }
 void MainWinClass::cb_mbar_item_Compute_logHDR_(Fl_Menu_* o, void* v) {
   ((MainWinClass*)(o->parent()->user_data()))->cb_mbar_item_Compute_logHDR__i(o,v);
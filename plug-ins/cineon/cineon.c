@@ -51,6 +51,7 @@
 #include <gtk/gtk.h>
 #include "lib/plugin_main.h"
 #include "lib/ui.h"
+#include "lib/float16.h"
 #include "../../lib/wire/iodebug.h"
 #include <libgimp/stdplugins-intl.h>
 
@@ -68,6 +69,10 @@
 #define DPX_LOADER_WITHARGS  "file_dpx_load_withargs"
 #define DPX_SAVER            "file_dpx_save"
 
+/* gimp_set_data keys for the linear load switch */
+#define CINEON_LINEAR_DATA   "file_cineon_load_linear"
+#define DPX_LINEAR_DATA      "file_dpx_load_linear"
+
 #define CINEON_PARASITE_NAME "cineon_file_header_block"
 #define DPX_PARASITE_NAME    "dpx_file_header_block"
 
@@ -78,7 +83,8 @@
 static void query(void);
 static void run(char*, int, GParam*, int*, GParam**);
 static int conversion_ok(LogImageByteConversionParameters*);
-static gint32 load_image(char*, LogImageByteConversionParameters*, int, int);
+static gint32 load_image(char*, LogImageByteConversionParameters*, int, int, int);
+static int linear_default(void);
 static gint save_image(char*, gint32, gint32, LogImageByteConversionParameters*, int, int);
 static void init_gtk(void);
 static int conversion_dialog(LogImageByteConversionParameters*);
@@ -107,7 +113,8 @@ query(void) {
   static GParamDef load_setargs_args[] = {
     { PARAM_FLOAT,      "gamma",        "Gamma value for Cineon file load" },
     { PARAM_INT32,      "black_point",  "Black point for Cineon file load" },
-    { PARAM_INT32,      "white_point",  "White point for Cineon file load" }
+    { PARAM_INT32,      "white_point",  "White point for Cineon file load" },
+    { PARAM_INT32,      "linear",       "(Optional) Load as scene-linear FLOAT16 through the conversion, not as 16 bit log codes" }
   };
   static GParamDef* load_setargs_return_vals = 0;
   static int nload_setargs_args = sizeof (load_setargs_args) / sizeof (load_setargs_args[0]);
@@ -153,7 +160,8 @@ query(void) {
 
   gimp_install_procedure(CINEON_LOADER_SETARGS,
       "Sets parameters for Cineon or DPX file loader",
-      "Sets gamma, black point, and white point for Cineon or DPX file loader.",
+      "Sets gamma, black point, and white point for Cineon or DPX file loader,"
+          " and whether it loads scene-linear FLOAT16 instead of log U16.",
       "David Hodson <hodsond@acm.org>",
       "Copyright 1999-2002 David Hodson",
       PLUG_IN_VERSION,
@@ -191,7 +199,8 @@ query(void) {
 
   gimp_install_procedure(DPX_LOADER_SETARGS,
       "Sets parameters for DPX file loader",
-      "Sets gamma, black point, and white point for DPX file loader.",
+      "Sets gamma, black point, and white point for DPX file loader,"
+          " and whether it loads scene-linear FLOAT16 instead of log U16.",
       "David Hodson <hodsond@acm.org>",
       "Copyright 1999-2002 David Hodson",
       PLUG_IN_VERSION,
@@ -256,6 +265,7 @@ run (char    *name,		/* I - Name of filter program. */
   int use_cineon = 0;
   int interactive = 0;
   int use_header = 0;
+  gint linear = 0;
 
   LogImageByteConversionParameters conversion;
   logImageGetByteConversionDefaults(&conversion);
@@ -281,10 +291,13 @@ run (char    *name,		/* I - Name of filter program. */
 
     /* Loading image */
 
+    linear = linear_default();
     if (use_cineon) {
       gimp_get_data(CINEON_LOADER, &conversion);
+      gimp_get_data(CINEON_LINEAR_DATA, &linear);
     } else {
       gimp_get_data(DPX_LOADER, &conversion);
+      gimp_get_data(DPX_LINEAR_DATA, &linear);
     }
 
     values = g_new(GParam, 2);
@@ -329,7 +342,7 @@ run (char    *name,		/* I - Name of filter program. */
     }
 #endif
 
-    image_ID = load_image(param[1].data.d_string, &conversion, use_cineon, use_header);
+    image_ID = load_image(param[1].data.d_string, &conversion, use_cineon, use_header, linear);
 
     if (image_ID != -1) {
       values[1].data.d_image = image_ID;
@@ -363,7 +376,7 @@ run (char    *name,		/* I - Name of filter program. */
 
     } else {
 
-      if (nparams != 3) {
+      if ((nparams < 3) || (nparams > 4)) {
         values[0].data.d_status = STATUS_CALLING_ERROR;
         return;
       }
@@ -379,6 +392,14 @@ run (char    *name,		/* I - Name of filter program. */
       } else {
         gimp_set_data(DPX_LOADER, &conversion, sizeof(conversion));
       }
+      if (nparams > 3) {
+        linear = (param[3].data.d_int32 != 0);
+        if (use_cineon) {
+          gimp_set_data(CINEON_LINEAR_DATA, &linear, sizeof(linear));
+        } else {
+          gimp_set_data(DPX_LINEAR_DATA, &linear, sizeof(linear));
+        }
+      }
     }
 
 
@@ -466,9 +487,48 @@ return
   (params->whitePoint < 1024);
 }
 
+/* the cineon-linear gimprc entry, for loads nobody set up */
+static int
+linear_default(void) {
+
+  GParam *return_vals;
+  gint nreturn_vals;
+  int linear = 0;
+
+  return_vals = gimp_run_procedure("gimp_gimprc_query",
+                                   &nreturn_vals,
+                                   PARAM_STRING, "cineon-linear",
+                                   PARAM_END);
+  if (return_vals[0].data.d_status == STATUS_SUCCESS &&
+      return_vals[1].data.d_string &&
+      (strcmp(return_vals[1].data.d_string, "yes") == 0 ||
+       strcmp(return_vals[1].data.d_string, "1") == 0))
+    linear = 1;
+  gimp_destroy_params(return_vals, nreturn_vals);
+
+  return linear;
+}
+
+/* 10 bit codes straight to half floats, so the unpack writes the
+   FLOAT16 drawable data without a separate conversion pass */
+static void
+set_linear_lut(LogImageFile* logImage) {
+
+  float linear[1024];
+  gushort half[1024];
+  ShortsFloat u;
+  int i;
+
+  logImageGetLinearLut(logImage, linear);
+  for (i = 0; i < 1024; ++i) {
+    half[i] = FLT16(linear[i], u);
+  }
+  logImageSetCodeLut(logImage, half);
+}
+
 static gint32
 load_image(char *filename, LogImageByteConversionParameters *conversion,
-    int use_cineon, int use_header) {
+    int use_cineon, int use_header, int linear) {
 
   int width, height, depth;
   int		i,		/* Looping var */
@@ -496,6 +556,9 @@ load_image(char *filename, LogImageByteConversionParameters *conversion,
   }
 
   logImageSetByteConversion(logImage, conversion);
+  if (linear) {
+    set_linear_lut(logImage);
+  }
 
   if (strrchr(filename, '/') != NULL) {
     sprintf(progress, "%s %s:", _("Loading"), strrchr(filename, '/') + 1);
@@ -514,13 +577,13 @@ load_image(char *filename, LogImageByteConversionParameters *conversion,
   switch (depth) {
 
   case 1: 
-    image_type = U16_GRAY;
-    layer_type = U16_GRAY_IMAGE;
+    image_type = linear ? FLOAT16_GRAY : U16_GRAY;
+    layer_type = linear ? FLOAT16_GRAY_IMAGE : U16_GRAY_IMAGE;
     break;
 
   case 3:
-    image_type = U16_RGB;
-    layer_type = U16_RGB_IMAGE;
+    image_type = linear ? FLOAT16_RGB : U16_RGB;
+    layer_type = linear ? FLOAT16_RGB_IMAGE : U16_RGB_IMAGE;
     break;
 
   default:
@@ -592,26 +655,20 @@ load_image(char *filename, LogImageByteConversionParameters *conversion,
   * Load the image...
   */
 
-  for (y = 0, count = 0;  y < height; ++y, ++count) {
-
-    /* filled the chunk yet? */
-    if (count >= tile_height) {
-      gimp_pixel_rgn_set_rect(&pixel_rgn, (guchar *) pixels[0], 0, y - count, drawable->width, count);
-      count = 0;
-      gimp_progress_update((double)y / (double)height);
-    }
+  /* a whole band of rows per read, unpacked on all processors */
 
-    if (logImageGetRowBytes(logImage, pixels[count], y) == 0) {
-      lastLineRead = y;
-    }
+  for (y = 0; y < height; y += count) {
 
-  }
+    count = height - y;
+    if (count > tile_height) count = tile_height;
 
- /*
-  * Do the last n rows (count always > 0)
-  */
+    if (logImageGetRows(logImage, pixels[0], y, count) != 0)
+      break;
+    lastLineRead = y + count - 1;
 
-  gimp_pixel_rgn_set_rect(&pixel_rgn, (guchar *) pixels[0], 0, y - count, drawable->width, count);
+    gimp_pixel_rgn_set_rect(&pixel_rgn, (guchar *) pixels[0], 0, y, drawable->width, count);
+    gimp_progress_update((double)(y + count) / (double)height);
+  }
 
  /*
   * Done with the file...
@@ -647,9 +704,8 @@ save_image(char* filename, gint32 image_ID, gint32 drawable_ID,
   GPixelRgn pixel_rgn;
   int tile_height;
   gushort* buffer;
-  gushort** line;
   int j;
-  int index;
+  int slab;
 
   /*
    * Get the drawable for the current image...
@@ -718,38 +774,30 @@ save_image(char* filename, gint32 image_ID, gint32 drawable_ID,
 
   tile_height = gimp_tile_height();
   buffer = g_new(gushort, tile_height * width * depth);
-  line = g_new(gushort*, tile_height);
-
-  for (j = 0; j < tile_height; ++j) {
-    line[j] = buffer + width * depth * j;
-  }
 
   /*
-   * Save the image...
+   * Save the image, a band of rows per write...
    */
 
   gimp_pixel_rgn_init(&pixel_rgn, drawable, 0, 0, width, height, FALSE, FALSE);
 
-  index = 0;
-  for (j = 0; j < height; ++j) {
-    if (index == 0) {
-      int slab = height - j;
-      if (slab > tile_height) slab = tile_height;
-      gimp_pixel_rgn_get_rect(&pixel_rgn, (guchar *) buffer, 0, j, width, slab);      
-    }
-
-    logImageSetRowBytes(logImage, line[index], j);
+  for (j = 0; j < height; j += slab) {
+    slab = height - j;
+    if (slab > tile_height) slab = tile_height;
+    gimp_pixel_rgn_get_rect(&pixel_rgn, (guchar *) buffer, 0, j, width, slab);
 
-    ++index;
-    if (index == tile_height) index = 0;
-
-    gimp_progress_update((double)j / (double)height);
+    if (logImageSetRows(logImage, buffer, j, slab) != 0) {
+      g_message("Cineon: Can't write image file\n");
+      logImageClose(logImage);
+      g_free(buffer);
+      return FALSE;
+    }
 
+    gimp_progress_update((double)(j + slab) / (double)height);
   }
   logImageClose(logImage);
 
   g_free(buffer);
-  g_free(line);
 
   return TRUE;
 }
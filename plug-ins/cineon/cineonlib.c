@@ -348,8 +348,11 @@ cineonGetRowBytes(CineonFile* cineon, unsigned short* row, int y) {
 
   /* extract required pixels */
   for (pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
-    /* row[pixelIndex] = cineon->lut10[cineon->pixelBuffer[pixelIndex]]; */
-    row[pixelIndex] = cineon->pixelBuffer[pixelIndex] << 6;
+    if (cineon->useCodeLut) {
+      row[pixelIndex] = cineon->codeLut[cineon->pixelBuffer[pixelIndex]];
+    } else {
+      row[pixelIndex] = cineon->pixelBuffer[pixelIndex] << 6;
+    }
   }
 
   return 0;
@@ -402,6 +405,61 @@ cineonSetRowBytes(CineonFile* cineon, const unsigned short* row, int y) {
   return 0;
 }
 
+int
+cineonGetRows(CineonFile* cineon, unsigned short* rows, int y, int n) {
+
+  const unsigned int* src;
+
+  src = logImageReadLongs(cineon, (long) y * cineon->lineBufferLength,
+      (long) n * cineon->lineBufferLength);
+  if (src == 0) {
+    if (verbose) d_printf("Couldn't read lines %d - %d\n", y, y + n - 1);
+    return 1;
+  }
+
+  logImageUnpackRows(src, 0, cineon->lineBufferLength,
+      rows, cineon->width * cineon->depth, n, LOG_PACK_HIGH,
+      cineon->useCodeLut ? cineon->codeLut : 0);
+
+  /* the row reader has to seek again */
+  cineon->fileYPos = -1;
+  return 0;
+}
+
+int
+cineonSetRows(CineonFile* cineon, const unsigned short* rows, int y, int n) {
+
+  long numLongs = (long) n * cineon->lineBufferLength;
+  unsigned int* buffer = logImageBandBuffer(cineon, numLongs);
+
+  if (buffer == 0) {
+    if (verbose) d_printf("Couldn't malloc band buffer of %ld longs\n", numLongs);
+    return 1;
+  }
+
+  logImagePackRows(rows, cineon->width * cineon->depth, n,
+      buffer, cineon->lineBufferLength, LOG_PACK_HIGH);
+
+  /* only seek if not writing consecutive lines */
+  if (y != cineon->fileYPos) {
+    long lineOffset = cineon->imageOffset + (long) y * cineon->lineBufferLength * 4;
+    if (fseek(cineon->file, lineOffset, SEEK_SET) != 0) {
+      if (verbose) d_printf("Couldn't seek to line %d at %ld\n", y, lineOffset);
+      return 1;
+    }
+    cineon->fileYPos = y;
+  }
+
+  if (fwrite(buffer, 4, numLongs, cineon->file) != (size_t) numLongs) {
+    if (verbose) d_printf("Couldn't write lines %d - %d\n", y, y + n - 1);
+    return 1;
+  }
+
+  cineon->fileYPos += n;
+
+  return 0;
+}
+
 int
 cineonGetRow(CineonFile* cineon, unsigned short* row, int y) {
 
@@ -502,6 +560,11 @@ cineonOpen(const char* filename) {
   cineon->file = 0;
   cineon->lineBuffer = 0;
   cineon->pixelBuffer = 0;
+  cineon->map = 0;
+  cineon->mapLength = 0;
+  cineon->bandBuffer = 0;
+  cineon->bandBufferLength = 0;
+  cineon->useCodeLut = 0;
 
   cineon->file = fopen(filename, "rb");
   if (cineon->file == 0) {
@@ -510,6 +573,7 @@ cineonOpen(const char* filename) {
     return 0;
   }
   cineon->reading = 1;
+  logImageMap(cineon);
 
   if (fread(&header, sizeof(CineonGenericHeader), 1, cineon->file) == 0) {
     if (verbose) d_printf("Not enough data for header in \"%s\".\n", filename);
@@ -567,6 +631,8 @@ cineonOpen(const char* filename) {
 
   cineon->getRow = &cineonGetRowBytes;
   cineon->setRow = 0;
+  cineon->getRows = &cineonGetRows;
+  cineon->setRows = 0;
   cineon->close = &cineonClose;
 
   if (verbose) {
@@ -605,6 +671,11 @@ cineonCreate(const char* filename, int width, int height, int depth) {
   cineon->file = 0;
   cineon->lineBuffer = 0;
   cineon->pixelBuffer = 0;
+  cineon->map = 0;
+  cineon->mapLength = 0;
+  cineon->bandBuffer = 0;
+  cineon->bandBufferLength = 0;
+  cineon->useCodeLut = 0;
 
   cineon->file = fopen(filename, "wb");
   if (cineon->file == 0) {
@@ -662,6 +733,8 @@ cineonCreate(const char* filename, int width, int height, int depth) {
 
   cineon->getRow = 0;
   cineon->setRow = &cineonSetRowBytes;
+  cineon->getRows = 0;
+  cineon->setRows = &cineonSetRows;
   cineon->close = &cineonClose;
 
   return cineon;
@@ -689,5 +762,11 @@ cineonClose(CineonFile* cineon) {
     cineon->pixelBuffer = 0;
   }
 
+  logImageUnmap(cineon);
+  if (cineon->bandBuffer) {
+    free(cineon->bandBuffer);
+    cineon->bandBuffer = 0;
+  }
+
   free(cineon);
 }
@@ -51,6 +51,10 @@ int cineonSetHeader(CineonFile*, int, void*);
 int cineonGetRowBytes(CineonFile* cineon, unsigned short* row, int y);
 int cineonSetRowBytes(CineonFile* cineon, const unsigned short* row, int y);
 
+/* get/set n scanlines from y on in one go */
+int cineonGetRows(CineonFile* cineon, unsigned short* rows, int y, int n);
+int cineonSetRows(CineonFile* cineon, const unsigned short* rows, int y, int n);
+
 /* get/set scanline of unconverted shorts */
 int cineonGetRow(CineonFile* cineon, unsigned short* row, int y);
 int cineonSetRow(CineonFile* cineon, const unsigned short* row, int y);
@@ -274,8 +274,11 @@ dpxGetRowBytes(DpxFile* dpx, unsigned short* row, int y) {
 
   /* extract required pixels */
   for (pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
-    /* row[pixelIndex] = dpx->lut10[dpx->pixelBuffer[pixelIndex]]; */
-    row[pixelIndex] = dpx->pixelBuffer[pixelIndex] << 6;
+    if (dpx->useCodeLut) {
+      row[pixelIndex] = dpx->codeLut[dpx->pixelBuffer[pixelIndex]];
+    } else {
+      row[pixelIndex] = dpx->pixelBuffer[pixelIndex] << 6;
+    }
   }
 
   /* save remaining pixels */
@@ -364,6 +367,102 @@ dpxSetRowBytes(DpxFile* dpx, const unsigned short* row, int y) {
   return 0;
 }
 
+int
+dpxGetRows(DpxFile* dpx, unsigned short* rows, int y, int n) {
+
+  /* the whole band is one run of samples, starting part way */
+  /* into a longword if the rows before it don't fill them out */
+
+  int rowSamples = dpx->width * dpx->depth;
+  long first = (long) y * rowSamples;
+  long firstLong = first / 3;
+  long numLongs = (first + (long) n * rowSamples + 2) / 3 - firstLong;
+  const unsigned int* src;
+
+  src = logImageReadLongs(dpx, firstLong, numLongs);
+  if (src == 0) {
+    if (verbose) d_printf("Couldn't read lines %d - %d\n", y, y + n - 1);
+    return 1;
+  }
+
+  logImageUnpackRows(src, first % 3, 0, rows, rowSamples, n,
+      dpx->depth == 1 ? LOG_PACK_LOW : LOG_PACK_HIGH,
+      dpx->useCodeLut ? dpx->codeLut : 0);
+
+  /* the row reader has to seek again */
+  dpx->fileYPos = -1;
+  dpx->pixelBufferUsed = 0;
+  return 0;
+}
+
+int
+dpxSetRows(DpxFile* dpx, const unsigned short* rows, int y, int n) {
+
+  /* bands go out in order, the samples that don't fill a */
+  /* longword wait in pixelBuffer for the next band */
+
+  int layout = dpx->depth == 1 ? LOG_PACK_LOW : LOG_PACK_HIGH;
+  int last = (y + n >= dpx->height);
+  long count = (long) n * dpx->width * dpx->depth;
+  long consumed = 0;
+  long headLongs = 0;
+  long bodyLongs, remaining;
+  unsigned int* buffer;
+  long pixelIndex;
+
+  if (y != dpx->fileYPos) {
+    if (verbose) d_printf("Lines must be written in order, got %d at %d\n", y, dpx->fileYPos);
+    return 1;
+  }
+
+  remaining = count;
+  if (dpx->pixelBufferUsed + remaining < 3 && !last) {
+    bodyLongs = 0;
+  } else {
+    if (dpx->pixelBufferUsed) {
+      consumed = 3 - dpx->pixelBufferUsed;
+      if (consumed > count) consumed = count;
+      headLongs = 1;
+    }
+    remaining = count - consumed;
+    bodyLongs = last ? pixelsToLongs(remaining) : remaining / 3;
+  }
+
+  buffer = logImageBandBuffer(dpx, headLongs + bodyLongs + 1);
+  if (buffer == 0) {
+    if (verbose) d_printf("Couldn't malloc band buffer of %ld longs\n", headLongs + bodyLongs);
+    return 1;
+  }
+
+  if (headLongs) {
+    unsigned short head[3] = { 0, 0, 0 };
+    for (pixelIndex = 0; pixelIndex < dpx->pixelBufferUsed; ++pixelIndex) {
+      head[pixelIndex] = dpx->pixelBuffer[pixelIndex] << 6;
+    }
+    memcpy(head + dpx->pixelBufferUsed, rows, consumed * sizeof(unsigned short));
+    logImagePack10(head, buffer, dpx->pixelBufferUsed + consumed, layout);
+    dpx->pixelBufferUsed = 0;
+  }
+
+  if (bodyLongs) {
+    logImagePackRows(rows + consumed, last ? remaining : bodyLongs * 3, 1,
+        buffer + headLongs, 0, layout);
+  }
+
+  /* keep the leftovers as 10 bit values, like dpxSetRowBytes */
+  for (pixelIndex = consumed + bodyLongs * 3; pixelIndex < count; ++pixelIndex) {
+    dpx->pixelBuffer[dpx->pixelBufferUsed++] = rows[pixelIndex] >> 6;
+  }
+
+  if (fwrite(buffer, 4, headLongs + bodyLongs, dpx->file) != (size_t)(headLongs + bodyLongs)) {
+    if (verbose) d_printf("Couldn't write lines %d - %d\n", y, y + n - 1);
+    return 1;
+  }
+  dpx->fileYPos += n;
+
+  return 0;
+}
+
 
 DpxFile* 
 dpxOpen(const char* filename) {
@@ -380,6 +479,11 @@ dpxOpen(const char* filename) {
   dpx->file = 0;
   dpx->lineBuffer = 0;
   dpx->pixelBuffer = 0;
+  dpx->map = 0;
+  dpx->mapLength = 0;
+  dpx->bandBuffer = 0;
+  dpx->bandBufferLength = 0;
+  dpx->useCodeLut = 0;
 
   dpx->file = fopen(filename, "rb");
   if (dpx->file == 0) {
@@ -388,6 +492,7 @@ dpxOpen(const char* filename) {
     return 0;
   }
   dpx->reading = 1;
+  logImageMap(dpx);
 
   if (fread(&header, sizeof(header), 1, dpx->file) == 0) {
     if (verbose) d_printf("Not enough data for header in \"%s\".\n", filename);
@@ -456,6 +561,8 @@ dpxOpen(const char* filename) {
 
   dpx->getRow = &dpxGetRowBytes;
   dpx->setRow = 0;
+  dpx->getRows = &dpxGetRows;
+  dpx->setRows = 0;
   dpx->close = &dpxClose;
 
   if (verbose) {
@@ -486,6 +593,11 @@ dpxCreate(const char* filename, int width, int height, int depth) {
   dpx->file = 0;
   dpx->lineBuffer = 0;
   dpx->pixelBuffer = 0;
+  dpx->map = 0;
+  dpx->mapLength = 0;
+  dpx->bandBuffer = 0;
+  dpx->bandBufferLength = 0;
+  dpx->useCodeLut = 0;
 
   dpx->file = fopen(filename, "wb");
   if (dpx->file == 0) {
@@ -539,6 +651,8 @@ dpxCreate(const char* filename, int width, int height, int depth) {
 
   dpx->getRow = 0;
   dpx->setRow = &dpxSetRowBytes;
+  dpx->getRows = 0;
+  dpx->setRows = &dpxSetRows;
   dpx->close = &dpxClose;
 
   return dpx;
@@ -566,6 +680,12 @@ dpxClose(DpxFile* dpx) {
     dpx->pixelBuffer = 0;
   }
 
+  logImageUnmap(dpx);
+  if (dpx->bandBuffer) {
+    free(dpx->bandBuffer);
+    dpx->bandBuffer = 0;
+  }
+
   free(dpx);
 }
 
@@ -41,6 +41,10 @@ DpxFile* dpxCreate(const char* filename, int xsize, int ysize, int channels);
 int dpxGetRowBytes(DpxFile* dpx, unsigned short* row, int y);
 int dpxSetRowBytes(DpxFile* dpx, const unsigned short* row, int y);
 
+/* get/set n scanlines from y on in one go, set in order only */
+int dpxGetRows(DpxFile* dpx, unsigned short* rows, int y, int n);
+int dpxSetRows(DpxFile* dpx, const unsigned short* rows, int y, int n);
+
 /* closes file and deletes data */
 void dpxClose(DpxFile* dpx);
 
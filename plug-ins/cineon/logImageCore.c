@@ -19,10 +19,13 @@
  *
  */
 
+#include "config.h"
 #include "logImageCore.h"
 
 #include <time.h>        /* strftime() */
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 /* Makes rint consistent in Windows and Linux: */
 #define rint(x) floor(x+0.5)
 
@@ -33,7 +36,21 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <sys/param.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#if defined(__GNUC__) && (__GNUC__ >= 5 || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define LOG_IMAGE_X86 1
+#include <tmmintrin.h>
+#endif
+
+#define LOG_IMAGE_MAX_THREADS 16
 
 #if defined(__hpux)
 /* These are macros in hpux */
@@ -93,12 +110,467 @@ setupLut(LogImageFile *logImage) {
   }
 }
 
+/* same curve as lut10, but unclipped: 0.0 at the black point, */
+/* 1.0 at the white point, highlights above white go past 1.0 */
+void
+logImageGetLinearLut(const LogImageFile* logImage, float* lut) {
+
+  int i;
+  double f_black;
+  double scale;
+
+  f_black = convertTo(logImage->params.blackPoint, logImage->params.whitePoint, logImage->params.gamma);
+  scale = 1.0 / (1.0 - f_black);
+
+  for (i = 0; i < 1024; ++i) {
+    double f_i = convertTo(i, logImage->params.whitePoint, logImage->params.gamma);
+    lut[i] = scale * (f_i - f_black);
+  }
+}
+
+int
+logImageSetCodeLut(LogImageFile* logImage, const unsigned short* lut) {
+  if (lut) {
+    memcpy(logImage->codeLut, lut, sizeof(logImage->codeLut));
+    logImage->useCodeLut = 1;
+  } else {
+    logImage->useCodeLut = 0;
+  }
+  return 0;
+}
+
 /* how many longwords to hold this many pixels? */
 int
 pixelsToLongs(int numPixels) {
   return (numPixels + 2) / 3;
 }
 
+/* 10 bit packing, three samples per big endian longword. */
+/* samples come out scaled to 16 bit by the shifts below */
+
+static void
+unpackLongs(const U32* src, unsigned short* dst, int numLongs, int layout) {
+  int i;
+  if (layout == LOG_PACK_HIGH) {
+    for (i = 0; i < numLongs; ++i) {
+      unsigned int t = ntohl(src[i]);
+      dst[0] = (t >> 16) & 0xffc0;
+      dst[1] = (t >> 6) & 0xffc0;
+      dst[2] = (t << 4) & 0xffc0;
+      dst += 3;
+    }
+  } else {
+    for (i = 0; i < numLongs; ++i) {
+      unsigned int t = ntohl(src[i]);
+      dst[0] = (t << 6) & 0xffc0;
+      dst[1] = (t >> 4) & 0xffc0;
+      dst[2] = (t >> 14) & 0xffc0;
+      dst += 3;
+    }
+  }
+}
+
+static void
+packLongs(const unsigned short* src, U32* dst, int numLongs, int layout) {
+  int i;
+  if (layout == LOG_PACK_HIGH) {
+    for (i = 0; i < numLongs; ++i) {
+      unsigned int t = ((src[0] & 0xffc0) << 16) |
+          ((src[1] & 0xffc0) << 6) |
+          ((src[2] & 0xffc0) >> 4);
+      dst[i] = htonl(t);
+      src += 3;
+    }
+  } else {
+    for (i = 0; i < numLongs; ++i) {
+      unsigned int t = ((src[0] & 0xffc0) >> 6) |
+          ((src[1] & 0xffc0) << 4) |
+          ((src[2] & 0xffc0) << 14);
+      dst[i] = htonl(t);
+      src += 3;
+    }
+  }
+}
+
+#ifdef LOG_IMAGE_X86
+/* four longwords <-> twelve samples per step: byte swap and spread
+   the longwords with shuffles, cut out the samples with shifts */
+
+#define Z 0x80
+__attribute__((target("ssse3")))
+static void
+unpackLongsSSSE3(const U32* src, unsigned short* dst, int numLongs, int layout) {
+  const __m128i bswap = _mm_setr_epi8(3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12);
+  const __m128i mask = _mm_set1_epi32(0xffc0);
+  /* a0 b0 c0 a1 b1 c1 a2 b2 | c2 a3 b3 c3 from ab = a0 b0 .. a3 b3 and c */
+  const __m128i ab1 = _mm_setr_epi8(0,1, 2,3, Z,Z, 4,5, 6,7, Z,Z, 8,9, 10,11);
+  const __m128i c1 = _mm_setr_epi8(Z,Z, Z,Z, 0,1, Z,Z, Z,Z, 4,5, Z,Z, Z,Z);
+  const __m128i ab2 = _mm_setr_epi8(Z,Z, 12,13, 14,15, Z,Z, Z,Z, Z,Z, Z,Z, Z,Z);
+  const __m128i c2 = _mm_setr_epi8(8,9, Z,Z, Z,Z, 12,13, Z,Z, Z,Z, Z,Z, Z,Z);
+  int i;
+
+  for (i = 0; i + 4 <= numLongs; i += 4) {
+    __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + i)), bswap);
+    __m128i a, b, c, ab;
+    if (layout == LOG_PACK_HIGH) {
+      a = _mm_srli_epi32(v, 16);
+      b = _mm_srli_epi32(v, 6);
+      c = _mm_slli_epi32(v, 4);
+    } else {
+      a = _mm_slli_epi32(v, 6);
+      b = _mm_srli_epi32(v, 4);
+      c = _mm_srli_epi32(v, 14);
+    }
+    a = _mm_and_si128(a, mask);
+    b = _mm_and_si128(b, mask);
+    c = _mm_and_si128(c, mask);
+    ab = _mm_or_si128(a, _mm_slli_epi32(b, 16));
+    _mm_storeu_si128((__m128i*) dst,
+        _mm_or_si128(_mm_shuffle_epi8(ab, ab1), _mm_shuffle_epi8(c, c1)));
+    _mm_storel_epi64((__m128i*)(dst + 8),
+        _mm_or_si128(_mm_shuffle_epi8(ab, ab2), _mm_shuffle_epi8(c, c2)));
+    dst += 12;
+  }
+  unpackLongs(src + i, dst, numLongs - i, layout);
+}
+
+__attribute__((target("ssse3")))
+static void
+packLongsSSSE3(const unsigned short* src, U32* dst, int numLongs, int layout) {
+  const __m128i bswap = _mm_setr_epi8(3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12);
+  const __m128i mask = _mm_set1_epi32(0xffc0);
+  /* samples 0 3 6 9, 1 4 7 10 and 2 5 8 11 into 32 bit lanes */
+  const __m128i ax = _mm_setr_epi8(0,1,Z,Z, 6,7,Z,Z, 12,13,Z,Z, Z,Z,Z,Z);
+  const __m128i ay = _mm_setr_epi8(Z,Z,Z,Z, Z,Z,Z,Z, Z,Z,Z,Z, 2,3,Z,Z);
+  const __m128i bx = _mm_setr_epi8(2,3,Z,Z, 8,9,Z,Z, 14,15,Z,Z, Z,Z,Z,Z);
+  const __m128i by = _mm_setr_epi8(Z,Z,Z,Z, Z,Z,Z,Z, Z,Z,Z,Z, 4,5,Z,Z);
+  const __m128i cx = _mm_setr_epi8(4,5,Z,Z, 10,11,Z,Z, Z,Z,Z,Z, Z,Z,Z,Z);
+  const __m128i cy = _mm_setr_epi8(Z,Z,Z,Z, Z,Z,Z,Z, 0,1,Z,Z, 6,7,Z,Z);
+  int i;
+
+  for (i = 0; i + 4 <= numLongs; i += 4) {
+    __m128i x = _mm_loadu_si128((const __m128i*) src);
+    __m128i y = _mm_loadl_epi64((const __m128i*)(src + 8));
+    __m128i a = _mm_or_si128(_mm_shuffle_epi8(x, ax), _mm_shuffle_epi8(y, ay));
+    __m128i b = _mm_or_si128(_mm_shuffle_epi8(x, bx), _mm_shuffle_epi8(y, by));
+    __m128i c = _mm_or_si128(_mm_shuffle_epi8(x, cx), _mm_shuffle_epi8(y, cy));
+    __m128i t;
+    a = _mm_and_si128(a, mask);
+    b = _mm_and_si128(b, mask);
+    c = _mm_and_si128(c, mask);
+    if (layout == LOG_PACK_HIGH) {
+      t = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(a, 16), _mm_slli_epi32(b, 6)),
+                       _mm_srli_epi32(c, 4));
+    } else {
+      t = _mm_or_si128(_mm_or_si128(_mm_srli_epi32(a, 6), _mm_slli_epi32(b, 4)),
+                       _mm_slli_epi32(c, 14));
+    }
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_shuffle_epi8(t, bswap));
+    src += 12;
+  }
+  packLongs(src, dst + i, numLongs - i, layout);
+}
+#undef Z
+
+static int
+haveSSSE3(void) {
+  static int have = -1;
+  if (have < 0) {
+    __builtin_cpu_init();
+    have = __builtin_cpu_supports("ssse3") ? 1 : 0;
+  }
+  return have;
+}
+#endif
+
+void
+logImageUnpack10(const U32* src, int skip, unsigned short* dst, int n, int layout) {
+
+  unsigned short tmp[3];
+  int whole;
+
+  /* finish a longword started on the previous line */
+  if (skip && n > 0) {
+    int k = 3 - skip;
+    if (k > n) k = n;
+    unpackLongs(src, tmp, 1, layout);
+    memcpy(dst, tmp + skip, k * sizeof(unsigned short));
+    dst += k;
+    n -= k;
+    ++src;
+  }
+
+  whole = n / 3;
+#ifdef LOG_IMAGE_X86
+  if (haveSSSE3())
+    unpackLongsSSSE3(src, dst, whole, layout);
+  else
+#endif
+    unpackLongs(src, dst, whole, layout);
+  src += whole;
+  dst += whole * 3;
+  n -= whole * 3;
+
+  if (n > 0) {
+    unpackLongs(src, tmp, 1, layout);
+    memcpy(dst, tmp, n * sizeof(unsigned short));
+  }
+}
+
+void
+logImagePack10(const unsigned short* src, U32* dst, int n, int layout) {
+
+  int whole = n / 3;
+
+#ifdef LOG_IMAGE_X86
+  if (haveSSSE3())
+    packLongsSSSE3(src, dst, whole, layout);
+  else
+#endif
+    packLongs(src, dst, whole, layout);
+
+  n -= whole * 3;
+  if (n > 0) {
+    unsigned short tmp[3] = { 0, 0, 0 };
+    memcpy(tmp, src + whole * 3, n * sizeof(unsigned short));
+    packLongs(tmp, dst + whole, 1, layout);
+  }
+}
+
+void
+logImageMap(LogImageFile* logImage) {
+#ifndef WIN32
+  struct stat st;
+  void* map;
+
+  logImage->map = 0;
+  logImage->mapLength = 0;
+  if (fstat(fileno(logImage->file), &st) != 0 || st.st_size <= 0) {
+    return;
+  }
+  map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fileno(logImage->file), 0);
+  if (map == MAP_FAILED) {
+    return;
+  }
+#ifdef MADV_SEQUENTIAL
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+#endif
+  logImage->map = map;
+  logImage->mapLength = st.st_size;
+#endif
+}
+
+void
+logImageUnmap(LogImageFile* logImage) {
+#ifndef WIN32
+  if (logImage->map) {
+    munmap(logImage->map, logImage->mapLength);
+  }
+#endif
+  logImage->map = 0;
+  logImage->mapLength = 0;
+}
+
+unsigned int*
+logImageBandBuffer(LogImageFile* logImage, long count) {
+  if (count > logImage->bandBufferLength) {
+    free(logImage->bandBuffer);
+    logImage->bandBuffer = malloc(count * 4);
+    logImage->bandBufferLength = logImage->bandBuffer ? count : 0;
+  }
+  return logImage->bandBuffer;
+}
+
+const unsigned int*
+logImageReadLongs(LogImageFile* logImage, long firstLong, long count) {
+
+  long offset = logImage->imageOffset + firstLong * 4;
+  unsigned int* buffer;
+
+  if (logImage->map) {
+    if (offset + count * 4 > (long) logImage->mapLength) {
+      return 0;
+    }
+    return (const unsigned int*)(logImage->map + offset);
+  }
+
+  buffer = logImageBandBuffer(logImage, count);
+  if (buffer == 0 ||
+      fseek(logImage->file, offset, SEEK_SET) != 0 ||
+      fread(buffer, 4, count, logImage->file) != (size_t) count) {
+    return 0;
+  }
+  return buffer;
+}
+
+#ifdef HAVE_PTHREAD
+typedef struct {
+  LogImageJobFn* fn;
+  void* data;
+  int first;
+  int count;
+} LogImageJob;
+
+static void*
+runJob(void* arg) {
+  LogImageJob* job = (LogImageJob*) arg;
+  job->fn(job->data, job->first, job->count);
+  return 0;
+}
+#endif
+
+void
+logImageParallel(int n, int grain, LogImageJobFn* fn, void* data) {
+#ifdef HAVE_PTHREAD
+  pthread_t threads[LOG_IMAGE_MAX_THREADS];
+  LogImageJob jobs[LOG_IMAGE_MAX_THREADS];
+  int numThreads = 1;
+  int started = 0;
+  int i;
+
+#ifdef _SC_NPROCESSORS_ONLN
+  numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  if (numThreads > LOG_IMAGE_MAX_THREADS) numThreads = LOG_IMAGE_MAX_THREADS;
+  if (grain < 1) grain = 1;
+  if (numThreads > n / grain) numThreads = n / grain;
+
+  if (numThreads > 1) {
+    for (i = 0; i < numThreads; ++i) {
+      jobs[i].fn = fn;
+      jobs[i].data = data;
+      jobs[i].first = (long) n * i / numThreads;
+      jobs[i].count = (long) n * (i + 1) / numThreads - jobs[i].first;
+    }
+    /* slice 0 runs here, the others on their own threads */
+    for (i = 1; i < numThreads; ++i) {
+      if (pthread_create(&threads[i], 0, runJob, &jobs[i]) != 0) {
+        break;
+      }
+      ++started;
+    }
+    fn(data, jobs[0].first, jobs[0].count);
+    /* slices whose thread could not be started */
+    for (i = started + 1; i < numThreads; ++i) {
+      fn(data, jobs[i].first, jobs[i].count);
+    }
+    for (i = 1; i <= started; ++i) {
+      pthread_join(threads[i], 0);
+    }
+    return;
+  }
+#endif
+  fn(data, 0, n);
+}
+
+/* rows of 10 bit samples, spread over the processors */
+
+typedef struct {
+  const U32* src;
+  int skip;
+  int rowLongs;
+  unsigned short* rows;
+  int rowSamples;
+  int layout;
+  const unsigned short* lut;
+} UnpackJob;
+
+static void
+lookupCodes(unsigned short* samples, long n, const unsigned short* lut) {
+  long i;
+  for (i = 0; i < n; ++i) {
+    samples[i] = lut[samples[i] >> 6];
+  }
+}
+
+static void
+unpackRowsJob(void* data, int first, int count) {
+  UnpackJob* job = (UnpackJob*) data;
+  int r;
+  if (job->rowLongs == 0) {
+    long off = job->skip + (long) first * job->rowSamples;
+    logImageUnpack10(job->src + off / 3, off % 3,
+        job->rows + (long) first * job->rowSamples,
+        count * job->rowSamples, job->layout);
+  } else {
+    for (r = first; r < first + count; ++r) {
+      logImageUnpack10(job->src + (long) r * job->rowLongs, 0,
+          job->rows + (long) r * job->rowSamples, job->rowSamples, job->layout);
+    }
+  }
+  /* map the slice while it is still in this processor's cache */
+  if (job->lut) {
+    lookupCodes(job->rows + (long) first * job->rowSamples,
+        (long) count * job->rowSamples, job->lut);
+  }
+}
+
+static int
+rowsGrain(int rowSamples) {
+  int grain = 32768 / (rowSamples > 0 ? rowSamples : 1);
+  return grain > 0 ? grain : 1;
+}
+
+void
+logImageUnpackRows(const U32* src, int skip, int rowLongs,
+                   unsigned short* rows, int rowSamples, int n, int layout,
+                   const unsigned short* lut) {
+  UnpackJob job;
+  job.src = src;
+  job.skip = skip;
+  job.rowLongs = rowLongs;
+  job.rows = rows;
+  job.rowSamples = rowSamples;
+  job.layout = layout;
+  job.lut = lut;
+  logImageParallel(n, rowsGrain(rowSamples), unpackRowsJob, &job);
+}
+
+typedef struct {
+  const unsigned short* rows;
+  int rowSamples;
+  U32* dst;
+  int rowLongs;
+  long samples;
+  int layout;
+} PackJob;
+
+static void
+packRowsJob(void* data, int first, int count) {
+  PackJob* job = (PackJob*) data;
+  int r;
+  if (job->rowLongs == 0) {
+    /* first and count are in longwords here */
+    long n = (long) count * 3;
+    if ((long) first * 3 + n > job->samples) {
+      n = job->samples - (long) first * 3;
+    }
+    logImagePack10(job->rows + (long) first * 3, job->dst + first, n, job->layout);
+    return;
+  }
+  for (r = first; r < first + count; ++r) {
+    logImagePack10(job->rows + (long) r * job->rowSamples,
+        job->dst + (long) r * job->rowLongs, job->rowSamples, job->layout);
+  }
+}
+
+void
+logImagePackRows(const unsigned short* rows, int rowSamples, int n,
+                 U32* dst, int rowLongs, int layout) {
+  PackJob job;
+  job.rows = rows;
+  job.rowSamples = rowSamples;
+  job.dst = dst;
+  job.rowLongs = rowLongs;
+  job.samples = (long) rowSamples * n;
+  job.layout = layout;
+  if (rowLongs == 0) {
+    logImageParallel(pixelsToLongs(job.samples), 8192, packRowsJob, &job);
+  } else {
+    logImageParallel(n, rowsGrain(rowSamples), packRowsJob, &job);
+  }
+}
+
 /* byte reversed float */
 
 typedef union {
@@ -38,6 +38,8 @@ extern "C" {
 typedef int (GetRowFn)(LogImageFile* logImage, unsigned short* row, int lineNum);
 typedef int (SetRowFn)(LogImageFile* logImage, const unsigned short* row, int lineNum);
 typedef void (CloseFn)(LogImageFile* logImage);
+typedef int (GetRowsFn)(LogImageFile* logImage, unsigned short* rows, int y, int n);
+typedef int (SetRowsFn)(LogImageFile* logImage, const unsigned short* rows, int y, int n);
 
 struct _Log_Image_File_t_
 {
@@ -61,6 +63,14 @@ struct _Log_Image_File_t_
   int reading;
   int fileYPos;
 
+  /* whole file mapped for reading, 0 if mmap is not available */
+  unsigned char* map;
+  size_t mapLength;
+
+  /* longwords of a band when the file is not mapped or written */
+  unsigned int* bandBuffer;
+  int bandBufferLength;
+
   /* byte conversion stuff */
   LogImageByteConversionParameters params;
 #if 0
@@ -71,9 +81,15 @@ struct _Log_Image_File_t_
   unsigned char lut10[1024];
   unsigned short lut8[256];
 
+  /* what 10 bit codes read as when useCodeLut is set */
+  unsigned short codeLut[1024];
+  int useCodeLut;
+
   /* pixel access functions */
   GetRowFn* getRow;
   SetRowFn* setRow;
+  GetRowsFn* getRows;
+  SetRowsFn* setRows;
   CloseFn* close;
 };
 
@@ -81,6 +97,40 @@ void setupLut(LogImageFile*);
 
 int pixelsToLongs(int numPixels);
 
+/* where the first of three 10 bit samples sits in a longword */
+#define LOG_PACK_HIGH 0   /* bits 22-31, Cineon and DPX filled method A */
+#define LOG_PACK_LOW  1   /* bits 0-9, single channel DPX */
+
+/* n samples starting skip samples into src, scaled to 16 bit */
+void logImageUnpack10(const unsigned int* src, int skip,
+                      unsigned short* dst, int n, int layout);
+/* n 16 bit samples into pixelsToLongs(n) longwords, zero padded */
+void logImagePack10(const unsigned short* src,
+                    unsigned int* dst, int n, int layout);
+
+/* map a file opened for reading, harmless if it fails */
+void logImageMap(LogImageFile* logImage);
+void logImageUnmap(LogImageFile* logImage);
+/* count longwords from firstLong on in the image data, from the map
+   or read into bandBuffer, 0 if the file is too short */
+const unsigned int* logImageReadLongs(LogImageFile* logImage,
+                                      long firstLong, long count);
+/* a bandBuffer of at least count longwords, 0 when out of memory */
+unsigned int* logImageBandBuffer(LogImageFile* logImage, long count);
+
+/* run fn over [0, n) in slices of at least grain on all processors */
+typedef void (LogImageJobFn)(void* data, int first, int count);
+void logImageParallel(int n, int grain, LogImageJobFn* fn, void* data);
+
+/* n rows of rowSamples each, rows rowLongs longwords apart; a
+   rowLongs of 0 means the samples run on across rows, as in DPX */
+/* with a lut, samples come out as lut[code] instead */
+void logImageUnpackRows(const unsigned int* src, int skip, int rowLongs,
+                        unsigned short* rows, int rowSamples, int n, int layout,
+                        const unsigned short* lut);
+void logImagePackRows(const unsigned short* rows, int rowSamples, int n,
+                      unsigned int* dst, int rowLongs, int layout);
+
 /* typedefs used in original docs */
 /* note size assumptions! */
 
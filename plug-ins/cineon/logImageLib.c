@@ -116,6 +116,34 @@ logImageSetRowBytes(LogImageFile* logImage, const unsigned short* row, int y) {
   return logImage->setRow(logImage, row, y);
 }
 
+int
+logImageGetRows(LogImageFile* logImage, unsigned short* rows, int y, int n) {
+  int i;
+  if (logImage->getRows) {
+    return logImage->getRows(logImage, rows, y, n);
+  }
+  for (i = 0; i < n; ++i) {
+    if (logImage->getRow(logImage, rows + i * logImage->width * logImage->depth, y + i)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int
+logImageSetRows(LogImageFile* logImage, const unsigned short* rows, int y, int n) {
+  int i;
+  if (logImage->setRows) {
+    return logImage->setRows(logImage, rows, y, n);
+  }
+  for (i = 0; i < n; ++i) {
+    if (logImage->setRow(logImage, rows + i * logImage->width * logImage->depth, y + i)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
 void
 logImageClose(LogImageFile* logImage) {
   logImage->close(logImage);
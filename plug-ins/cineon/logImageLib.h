@@ -68,10 +68,21 @@ int logImageGetByteConversionDefaults(LogImageByteConversionParameters* params);
 int logImageGetByteConversion(const LogImageFile* logImage, LogImageByteConversionParameters* params);
 int logImageSetByteConversion(LogImageFile* logImage, const LogImageByteConversionParameters* params);
 
+/* scene linear value of each of the 1024 codes for the current conversion */
+void logImageGetLinearLut(const LogImageFile* logImage, float* lut);
+/* read samples as lut[code] from a 1024 entry table instead of scaling */
+/* the codes to 16 bit, 0 goes back to scaling */
+int logImageSetCodeLut(LogImageFile* logImage, const unsigned short* lut);
+
 /* get/set scanline of converted bytes */
 int logImageGetRowBytes(LogImageFile* logImage, unsigned short* row, int y);
 int logImageSetRowBytes(LogImageFile* logImage, const unsigned short* row, int y);
 
+/* get/set n scanlines from y on, rows packed one after the other; */
+/* these read the whole band at once, DPX bands must be set in order */
+int logImageGetRows(LogImageFile* logImage, unsigned short* rows, int y, int n);
+int logImageSetRows(LogImageFile* logImage, const unsigned short* rows, int y, int n);
+
 /* closes file and deletes data */
 void logImageClose(LogImageFile* logImage);
 
@@ -127,21 +127,19 @@ unsigned int  len;
 }
 
 int
-fwritecolrs(scanline, len, fp)		/* write out a colr scanline */
+encodecolrs(scanline, len, out)		/* encode a colr scanline into out */
 register COLR  *scanline;
 int  len;
-register FILE  *fp;
+register unsigned char  *out;
 {
 	register int  i, j, beg, cnt = 1;
 	int  c2;
-	
-	if ((len < MINELEN) | (len > MAXELEN))	/* OOBs, write out flat */
-		return(fwrite((char *)scanline,sizeof(COLR),len,fp) - len);
+	unsigned char  *start = out;
 					/* put magic header */
-	putc(2, fp);
-	putc(2, fp);
-	putc(len>>8, fp);
-	putc(len&255, fp);
+	*out++ = 2;
+	*out++ = 2;
+	*out++ = len>>8;
+	*out++ = len&255;
 					/* put components seperately */
 	for (i = 0; i < 4; i++) {
 	    for (j = 0; j < len; j += cnt) {	/* find next run */
@@ -156,25 +154,53 @@ register FILE  *fp;
 		    c2 = j+1;
 		    while (scanline[c2++][i] == scanline[j][i])
 			if (c2 == beg) {	/* short run */
-			    putc(128+beg-j, fp);
-			    putc(scanline[j][i], fp);
+			    *out++ = 128+beg-j;
+			    *out++ = scanline[j][i];
 			    j = beg;
 			    break;
 			}
 		}
 		while (j < beg) {		/* write out non-run */
 		    if ((c2 = beg-j) > 128) c2 = 128;
-		    putc(c2, fp);
+		    *out++ = c2;
 		    while (c2--)
-			putc(scanline[j++][i], fp);
+			*out++ = scanline[j++][i];
 		}
 		if (cnt >= MINRUN) {		/* write out run */
-		    putc(128+cnt, fp);
-		    putc(scanline[beg][i], fp);
+		    *out++ = 128+cnt;
+		    *out++ = scanline[beg][i];
 		} else
 		    cnt = 0;
 	    }
 	}
+	return(out - start);
+}
+
+
+int
+fwritecolrs(scanline, len, fp)		/* write out a colr scanline */
+register COLR  *scanline;
+int  len;
+register FILE  *fp;
+{
+	static unsigned char  *rlebuf = NULL;
+	static int  rlebuflen = 0;
+	int  n;
+	
+	if ((len < MINELEN) | (len > MAXELEN))	/* OOBs, write out flat */
+		return(fwrite((char *)scanline,sizeof(COLR),len,fp) - len);
+					/* encode in memory, one fwrite */
+	if (RLEBUFLEN(len) > rlebuflen) {
+		free(rlebuf);
+		rlebuflen = RLEBUFLEN(len);
+		if ((rlebuf = (unsigned char *)malloc(rlebuflen)) == NULL) {
+			rlebuflen = 0;
+			return(-1);
+		}
+	}
+	n = encodecolrs(scanline, len, rlebuf);
+	if (fwrite(rlebuf, 1, n, fp) != n)
+		return(-1);
 	return(ferror(fp) ? -1 : 0);
 }
 
@@ -266,6 +292,200 @@ register FILE  *fp;
 }
 
 
+/*
+ * The same decoding from a large read buffer.  getc() per byte takes
+ * the stream lock and checks for EOF each time, which dominates the
+ * loading of wide images.
+ */
+
+RADBUF *
+radbuf_open(FILE *fp)		/* read the rest of fp through a buffer */
+{
+	RADBUF  *rb;
+
+	if ((rb = (RADBUF *)malloc(sizeof(RADBUF))) == NULL)
+		return(NULL);
+	if ((rb->buf = (unsigned char *)malloc(RADBUFSIZ)) == NULL) {
+		free(rb);
+		return(NULL);
+	}
+	rb->fp = fp;
+	rb->pos = rb->end = rb->buf;
+	return(rb);
+}
+
+
+void
+radbuf_close(RADBUF *rb)
+{
+	if (rb == NULL)
+		return;
+	free(rb->buf);
+	free(rb);
+}
+
+
+int
+radbuf_fill(RADBUF *rb)		/* refill an empty buffer, next byte */
+{
+	size_t  n;
+
+	n = fread(rb->buf, 1, RADBUFSIZ, rb->fp);
+	rb->pos = rb->buf;
+	rb->end = rb->buf + n;
+	if (n == 0)
+		return(EOF);
+	return(*rb->pos++);
+}
+
+
+static int
+boldreadcolrs(register COLR  *scanline, int  len, register RADBUF  *rb,
+		COLR  *start)		/* first pixel of the scanline */
+{
+	int  rshift, r, g, b, e;
+	register int  i;
+	
+	rshift = 0;
+	
+	while (len > 0) {
+		if ((r = rbgetc(rb)) == EOF || (g = rbgetc(rb)) == EOF ||
+				(b = rbgetc(rb)) == EOF || (e = rbgetc(rb)) == EOF)
+			return(-1);
+		scanline[0][RED] = r;
+		scanline[0][GRN] = g;
+		scanline[0][BLU] = b;
+		scanline[0][EXP] = e;
+		if (r == 1 && g == 1 && b == 1) {
+			if ((i = e << rshift) > len)
+				return(-1);	/* run past the end */
+			if (scanline == start)
+				return(-1);	/* run with no pixel to repeat */
+			for ( ; i > 0; i--) {
+				copycolr(scanline[0], scanline[-1]);
+				scanline++;
+				len--;
+			}
+			rshift += 8;
+		} else {
+			scanline++;
+			len--;
+			rshift = 0;
+		}
+	}
+	return(0);
+}
+
+
+int
+breadcolrs(register COLR  *scanline, int  len, register RADBUF  *rb)
+{
+	register int  i, j;
+	int  code, val;
+	register unsigned char  *p;
+					/* determine scanline type */
+	if ((len < MINELEN) | (len > MAXELEN))
+		return(boldreadcolrs(scanline, len, rb, scanline));
+	if ((i = rbgetc(rb)) == EOF)
+		return(-1);
+	if (i != 2) {
+		rb->pos--;		/* the byte is still in the buffer */
+		return(boldreadcolrs(scanline, len, rb, scanline));
+	}
+	if ((code = rbgetc(rb)) == EOF || (val = rbgetc(rb)) == EOF ||
+			(i = rbgetc(rb)) == EOF)
+		return(-1);
+	scanline[0][GRN] = code;
+	scanline[0][BLU] = val;
+	if (scanline[0][GRN] != 2 || scanline[0][BLU] & 128) {
+		scanline[0][RED] = 2;
+		scanline[0][EXP] = i;
+		return(boldreadcolrs(scanline+1, len-1, rb, scanline));
+	}
+	if ((scanline[0][BLU]<<8 | i) != len)
+		return(-1);		/* length mismatch! */
+					/* read each component */
+	for (i = 0; i < 4; i++)
+	    for (j = 0; j < len; ) {
+		if ((code = rbgetc(rb)) == EOF)
+		    return(-1);
+		if (code > 128) {	/* run */
+		    code &= 127;
+		    if ((val = rbgetc(rb)) == EOF || j + code > len)
+			return -1;
+		    while (code--)
+			scanline[j++][i] = val;
+		} else {		/* non-run */
+		    if (j + code > len)
+			return -1;
+		    if (rb->end - rb->pos >= code) {
+			p = rb->pos;	/* all in the buffer */
+			rb->pos += code;
+			while (code--)
+			    scanline[j++][i] = *p++;
+		    } else
+			while (code--) {
+			    if ((val = rbgetc(rb)) == EOF)
+				return -1;
+			    scanline[j++][i] = val;
+			}
+		}
+	    }
+	return(0);
+}
+
+
+static float  colr_scale[256];		/* 2^(e-COLXS-8), 0 for e == 0 */
+
+static void
+init_colr_scale()
+{
+	register int  e;
+
+	if (colr_scale[COLXS] != 0.0)
+		return;
+	colr_scale[0] = 0.0;
+	for (e = 1; e < 256; e++)
+		colr_scale[e] = ldexp(1.0, e-(COLXS+8));
+}
+
+
+void
+colrs_float(out, stride, scan, len)	/* convert a scanline to float */
+register float  *out;
+int  stride;
+register COLR  *scan;
+int  len;
+{
+	register int  i;
+	register float  f;
+
+	init_colr_scale();
+				/* a table for ldexp(), no calls in the loop */
+	for (i = 0; i < len; i++, out += stride) {
+		f = colr_scale[scan[i][EXP]];
+		out[0] = (scan[i][RED] + 0.5f) * f;
+		out[1] = (scan[i][GRN] + 0.5f) * f;
+		out[2] = (scan[i][BLU] + 0.5f) * f;
+	}
+}
+
+
+void
+colrs_alpha(out, stride, scan, len)	/* alpha from the red channel */
+register float  *out;
+int  stride;
+register COLR  *scan;
+int  len;
+{
+	register int  i;
+
+	init_colr_scale();
+	for (i = 0; i < len; i++, out += stride)
+		out[0] = scan[i][RED] * colr_scale[scan[i][EXP]];
+}
+
+
 int
 fwritescan_a(scanline, len, fp, afp)		/* write out a scanline */
 float *scanline;
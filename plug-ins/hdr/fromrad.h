@@ -56,6 +56,33 @@ extern int	bigdiff(COLOR c1, COLOR c2, double md);
 
 /* End of color.h defs */
 
+/* Buffered scanline input, in place of getc() on the file */
+
+typedef struct {
+	FILE		*fp;
+	unsigned char	*buf;		/* read buffer */
+	unsigned char	*pos, *end;	/* unread part of buf */
+} RADBUF;
+
+#define  RADBUFSIZ	(1L<<20)
+
+extern RADBUF	*radbuf_open(FILE *fp);
+extern void	radbuf_close(RADBUF *rb);
+extern int	radbuf_fill(RADBUF *rb);
+extern int	breadcolrs(COLR *scanline, int len, RADBUF *rb);
+
+#define  rbgetc(rb)	((rb)->pos < (rb)->end ? *(rb)->pos++ : radbuf_fill(rb))
+
+/* Whole scanlines of COLR to float, stride floats apart */
+
+extern void	colrs_float(float *out, int stride, COLR *scan, int len);
+extern void	colrs_alpha(float *out, int stride, COLR *scan, int len);
+
+/* RLE encode a scanline into out, at most RLEBUFLEN(len) bytes */
+
+#define  RLEBUFLEN(len)	(4 + 8*(len))
+extern int	encodecolrs(COLR *scanline, int len, unsigned char *out);
+
 /* The following was taken from resolu.h in ray/src/common of Radiance 2.2 */
 
 /*
@@ -42,13 +42,6 @@
 extern float image_render_get_expose() ;
 
 #define SCALE_WIDTH 125
-#define MAXWIDTH 8192
-COLR cbuf[MAXWIDTH];
-COLR abuf[MAXWIDTH];
-
-unsigned short rbuf[MAXWIDTH];
-unsigned short gbuf[MAXWIDTH];
-unsigned short bbuf[MAXWIDTH];
 
 typedef enum {
     RAW_RGB,			/* RGB Image */
@@ -234,7 +227,8 @@ run (char    *name,
 
 gint32 load_image(gchar * filename)
 {
-	int i,j,k;
+	int i;
+    gint32 image_ID;
     /* main struct with the image info in it */
     raw_gimp_data *data;
 
@@ -242,15 +236,15 @@ gint32 load_image(gchar * filename)
     gint32 layer_id = -1;
     GImageType itype = FLOAT_RGB;
     GDrawableType ltype = FLOAT_RGB_IMAGE;
-    unsigned char*  bufPtr = 0;
-    unsigned char* abufPtr = 0;
+    /* scanlines as read, any width */
+    COLR *cbuf = NULL, *abuf = NULL;
+    RADBUF *inb, *alpha_inb = NULL;
   
     gint bpp = 0;
     // radience handling 
     FILE *inf, *alpha_inf;
     int xsize, ysize, aysize, axsize;
-    float f;
-    float r,g,b,a;
+    int channels;
     gfloat *rowc=NULL;
     guchar *pixel =NULL;
     int begin,end,num;
@@ -267,10 +261,6 @@ gint32 load_image(gchar * filename)
     }
     alpha_inf = fopen(g_strconcat(filename,"_a",NULL),"rb");
     has_alpha = (alpha_inf==NULL) ? FALSE : TRUE;
-    
-    if (has_alpha) {
-        ltype = FLOAT_RGBA_IMAGE;
-    }    
 
     if (checkheader(inf,COLRFMT,(FILE *)NULL) < 0 ||
 		fgetresolu(&xsize, &ysize, inf) < 0) {
@@ -288,6 +278,10 @@ gint32 load_image(gchar * filename)
       }
     }
 
+    if (has_alpha) {
+        ltype = FLOAT_RGBA_IMAGE;
+    }    
+
 
 
 
@@ -326,6 +320,30 @@ gint32 load_image(gchar * filename)
     }
 
     rowc = (gfloat *)pixel; 
+    channels = has_alpha ? 4 : 3;
+
+    /* decode from large buffers instead of getc() per byte */
+    cbuf = g_new (COLR, xsize);
+    inb = radbuf_open(inf);
+    if (has_alpha) {
+        abuf = g_new (COLR, xsize);
+        alpha_inb = radbuf_open(alpha_inf);
+    }
+    if (inb == NULL || (has_alpha && alpha_inb == NULL)) {
+        fprintf(stderr,"Kein Speicher");
+        radbuf_close(inb);
+        radbuf_close(alpha_inb);
+        fclose(inf);
+        if (has_alpha)
+            fclose(alpha_inf);
+        g_free(cbuf);
+        g_free(abuf);
+        g_free(pixel);
+        gimp_drawable_detach(data->drawable);
+        gimp_image_delete(data->image_id);
+        g_free(data);
+        return -1;
+    }
 
 
     for (begin = 0, end = tile_height;
@@ -336,58 +354,19 @@ gint32 load_image(gchar * filename)
 	    end = ysize;
 
 	num = end - begin;
-	
-	k = 0;
 
         for(i=0;i<num;i++) 
 	{
-	    freadcolrs(cbuf,xsize,inf);
-    
-	    if (has_alpha)
-                freadcolrs(abuf,xsize,alpha_inf);
-           
-	    // Pointer to gimp framebuffer
-	    // unpack data for gimp
+	    // unpack data for gimp, whole scanlines at a time
+	    if (breadcolrs(cbuf,xsize,inb) < 0)
+	        memset(cbuf, 0, xsize * sizeof(COLR));
+	    colrs_float(rowc + i*xsize*channels, channels, cbuf, xsize);
 
-	    bufPtr = ((unsigned char*)cbuf);
-            abufPtr = ((unsigned char*)abuf);
- 
-	    for (j = 0; j < xsize; j++)
+	    if (has_alpha)
 	    {
-		if(bufPtr[3]) {
-		    f = ldexp(1.0, bufPtr[3]-(int)(128+8));
-                   
-		    r = (bufPtr[0]+0.5) * f;
-		    g = (bufPtr[1]+0.5) * f;
-		    b = (bufPtr[2]+0.5) * f;
-                 
-		    rowc[k++] = r;
-		    rowc[k++] = g;
-		    rowc[k++] = b;
- 
-		} else {     
-		    rowc[k++] = 0.0f;
-		    rowc[k++] = 0.0f;
-		    rowc[k++] = 0.0f;
-		}
-                if (has_alpha) 
-		{
-		    if(abufPtr[3]) 
-		    {
-			f = ldexp(1.0, abufPtr[3]-(int)(128+8));
-
-			a = abufPtr[0] * f;
-			
-			rowc[k++] = a;
-
-		    } else 
-		    {     
-			rowc[k++] = 0.0f;
-		    }
-                
-		}
-		bufPtr += 4;
-                abufPtr += 4;
+	        if (breadcolrs(abuf,xsize,alpha_inb) < 0)
+	            memset(abuf, 0, xsize * sizeof(COLR));
+	        colrs_alpha(rowc + i*xsize*channels + 3, channels, abuf, xsize);
 	    }
 	}
         gimp_pixel_rgn_set_rect (&data->region,pixel, 0, begin, xsize, num);
@@ -396,11 +375,21 @@ gint32 load_image(gchar * filename)
     
     gimp_drawable_flush(data->drawable);
     gimp_drawable_detach(data->drawable);
-    
+
+    radbuf_close(inb);
+    fclose(inf);
+    if (has_alpha) {
+        radbuf_close(alpha_inb);
+        fclose(alpha_inf);
+    }
+    g_free(cbuf);
+    g_free(abuf);
+
+    image_ID = data->image_id;
     g_free(data);
     g_free(pixel);
 
-    return data->image_id;
+    return image_ID;
 }
 
 
@@ -60,7 +60,10 @@ static void   run        (char    *name,
 			  GParam  *param,
 			  int     *nreturn_vals,
 			  GParam **return_vals);
-static gint32 load_image (char   *filename);
+static gint32 load_image (char   *filename,
+			  int     scale);
+static int    load_scale (int     scale,
+			  GRunModeType run_mode);
 static gint   save_image (char   *filename,
 			  gint32  image_ID,
 			  gint32  drawable_ID);
@@ -108,6 +111,7 @@ query ()
     { PARAM_INT32, "run_mode", "Interactive, non-interactive" },
     { PARAM_STRING, "filename", "The name of the file to load" },
     { PARAM_STRING, "raw_filename", "The name of the file to load" },
+    { PARAM_INT32, "scale", "Decode at 1/scale of the size: 1, 2, 4 or 8; 0 loads at full size, or non-interactively at the jpeg-load-scale gimprc entry" },
   };
   static GParamDef load_return_vals[] =
   {
@@ -180,7 +184,9 @@ run (char    *name,
 
   if (strcmp (name, "file_jpeg_load") == 0)
     {
-      image_ID = load_image (param[1].data.d_string);
+      image_ID = load_image (param[1].data.d_string,
+                             load_scale (nparams >= 4 ? param[3].data.d_int32 : 0,
+                                         run_mode));
 
       if (image_ID != -1)
 	{
@@ -305,8 +311,43 @@ my_error_exit (j_common_ptr cinfo)
   longjmp (myerr->setjmp_buffer, 1);
 }
 
+/* 1, 2, 4 or 8, the libjpeg scales below scale; 0 asks the
+ * jpeg-load-scale gimprc entry when the flipbook loads frames
+ * non-interactively.  the file dialog opens at full size, as the image
+ * keeps the file name and saving it must not overwrite the original
+ * with a reduced copy
+ */
+static int
+load_scale (int          scale,
+            GRunModeType run_mode)
+{
+  GParam *return_vals;
+  gint nreturn_vals;
+
+  if (scale <= 0 && run_mode == RUN_NONINTERACTIVE)
+    {
+      return_vals = gimp_run_procedure ("gimp_gimprc_query",
+                                        &nreturn_vals,
+                                        PARAM_STRING, "jpeg-load-scale",
+                                        PARAM_END);
+      if (return_vals[0].data.d_status == STATUS_SUCCESS &&
+          return_vals[1].data.d_string)
+        scale = atoi (return_vals[1].data.d_string);
+      gimp_destroy_params (return_vals, nreturn_vals);
+    }
+
+  if (scale >= 8)
+    return 8;
+  if (scale >= 4)
+    return 4;
+  if (scale >= 2)
+    return 2;
+  return 1;
+}
+
 static gint32
-load_image (char *filename)
+load_image (char *filename,
+	    int   scale)
 {
   GPixelRgn pixel_rgn;
   TileDrawable *drawable;
@@ -321,7 +362,7 @@ load_image (char *filename)
   int image_type;
   int layer_type;
   int tile_height;
-  int scanlines;
+  int scanlines, n;
   int i, start, end;
   int m;
   int depth = 8;
@@ -381,10 +422,18 @@ load_image (char *filename)
 
   /* Step 4: set parameters for decompression */
 
-  /* In this example, we don't need to change any of the defaults set by
-   * jpeg_read_header(), so we do nothing here.
+  /* Reduced loads let the IDCT produce the smaller image directly,
+   * which skips most of the decoding work.  jp4 holds Bayer data
+   * that can not be scaled this way.
    */
   prepareColour( &cinfo );
+  if (scale > 1 && depth == 8)
+    {
+      cinfo.scale_num = 1;
+      cinfo.scale_denom = scale;
+      cinfo.dct_method = JDCT_IFAST;
+      cinfo.do_fancy_upsampling = FALSE;
+    }
 
   /* Step 5: Start decompressor */
 
@@ -471,8 +520,10 @@ load_image (char *filename)
       end = MIN (end,CAST(int) cinfo.output_height);
       scanlines = end - start;
 
-      for (i = 0; i < scanlines; i++)
-	jpeg_read_scanlines (&cinfo, (JSAMPARRAY) &rowbuf[i], 1);
+      /* libjpeg returns at most one iMCU row of lines per call */
+      for (n = 0; n < scanlines; )
+	n += jpeg_read_scanlines (&cinfo, (JSAMPARRAY) &rowbuf[n],
+				  scanlines - n);
 
       /*
       for (i = start; i < end; i++)
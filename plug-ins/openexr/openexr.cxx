@@ -33,9 +33,11 @@
 #define PLUGIN_COMPLETENAME PLUGIN_NAME " " PLUGIN_VERSION
 
 #include <setjmp.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <ImfRgbaFile.h>
 #include <ImfChannelList.h>
@@ -43,6 +45,8 @@
 #include <ImfOutputFile.h>
 #include <ImfFrameBuffer.h>
 #include <ImfStandardAttributes.h>
+#include <ImfThreading.h>
+#include <OpenEXRConfig.h>
 #include <Iex.h>
 #include <ImathBox.h>
 #include <half.h>
@@ -66,7 +70,9 @@ static void   run        (char    *name,
 			  GParam  *param,
 			  int     *nreturn_vals,
 			  GParam **return_vals);
-static gint32 load_image (char    *filename);
+static gint32 load_image (char    *filename,
+                          const char *layers,
+                          gint    *region);
 static gint   save_image (char    *filename,
 			  gint32   image_ID,
 			  gint32   drawable_ID);
@@ -76,6 +82,13 @@ int    getChannelPos     (int channel_in_layer_pos,
                           int* chan_pos );
 char * getChannelName    (int position, const char *layer_name, int nlayers,
                           int max, int & exr_channels );
+static void   init_threads        (void);
+static char * gimprc_string       (const char *token);
+static int    layer_selected      (const char *lname, const char *layers);
+static gint   save_dialog         (void);
+static void   save_close_callback (GtkWidget *w, gpointer data);
+static void   save_ok_callback    (GtkWidget *w, gpointer data);
+static void   save_compression_callback (GtkWidget *w, gpointer data);
 
 GPlugInInfo PLUG_IN_INFO =
 {
@@ -89,6 +102,37 @@ GPlugInInfo PLUG_IN_INFO =
 } /* extern "C" */
 #endif
 
+/* DWA compression came with OpenEXR 2.2 */
+#if OPENEXR_VERSION_MAJOR > 2 || \
+    (OPENEXR_VERSION_MAJOR == 2 && OPENEXR_VERSION_MINOR >= 2)
+# define HAVE_EXR_DWA 1
+#endif
+
+typedef struct {
+  const char *label;
+  gint compression;
+} compression_s;
+
+static compression_s compressions[] =
+{
+  { N_("No compression"),                  Imf::NO_COMPRESSION },
+  { N_("RLE"),                             Imf::RLE_COMPRESSION },
+  { N_("ZIP, one scanline (fast)"),        Imf::ZIPS_COMPRESSION },
+  { N_("ZIP, 16 scanlines"),               Imf::ZIP_COMPRESSION },
+  { N_("PIZ wavelet"),                     Imf::PIZ_COMPRESSION },
+  { N_("PXR24 (lossy for float)"),         Imf::PXR24_COMPRESSION },
+  { N_("B44 (lossy)"),                     Imf::B44_COMPRESSION },
+  { N_("B44A (lossy)"),                    Imf::B44A_COMPRESSION },
+#ifdef HAVE_EXR_DWA
+  { N_("DWAA, 32 scanlines (lossy, fast)"), Imf::DWAA_COMPRESSION },
+  { N_("DWAB, 256 scanlines (lossy)"),     Imf::DWAB_COMPRESSION },
+#endif
+};
+#define NUM_COMPRESSIONS (sizeof (compressions) / sizeof (compressions[0]))
+
+static gint compression = Imf::PIZ_COMPRESSION;
+static gint runme = FALSE;
+
 MAIN()
 
 static void
@@ -99,6 +143,11 @@ query ()
     { PARAM_INT32, "run_mode", "Interactive, non-interactive" },
     { PARAM_STRING, "filename", "The name of the file to load" },
     { PARAM_STRING, "raw_filename", "The name of the file to load" },
+    { PARAM_STRING, "layers", "Comma separated layers or passes to load, a name also selects the passes below it, e.g. \"beauty\" or \"RenderLayer.Combined\"; empty loads all, or non-interactively the openexr-load-layers gimprc entry" },
+    { PARAM_INT32, "x", "Left edge of the region to load, in image coordinates" },
+    { PARAM_INT32, "y", "Top edge of the region to load" },
+    { PARAM_INT32, "width", "Width of the region to load, 0 loads the whole data window, or non-interactively the openexr-load-region gimprc entry" },
+    { PARAM_INT32, "height", "Height of the region to load, 0 loads the whole data window, or non-interactively the openexr-load-region gimprc entry" },
   };
   static GParamDef load_return_vals[] =
   {
@@ -113,7 +162,8 @@ query ()
     { PARAM_IMAGE, "image", "Input image" },
     { PARAM_DRAWABLE, "drawable", "Drawable to save" },
     { PARAM_STRING, "filename", "The name of the file to save the image in" },
-    { PARAM_STRING, "raw_filename", "The name of the file to save the image in" }
+    { PARAM_STRING, "raw_filename", "The name of the file to save the image in" },
+    { PARAM_INT32, "compression", "Compression type: { NONE (0), RLE (1), ZIPS (2), ZIP (3), PIZ (4), PXR24 (5), B44 (6), B44A (7), DWAA (8), DWAB (9) }" }
   };
   static int nsave_args = sizeof (save_args) / sizeof (save_args[0]);
 
@@ -162,9 +212,41 @@ run (char    *name,
 
   INIT_I18N_UI();
 
+  init_threads ();
+
   if (strcmp (name, "file_openexr_load") == 0)
     {
-      image_ID = load_image (param[1].data.d_string);
+      // empty selections fall back to the openexr-load-layers and
+      // openexr-load-region gimprc entries when the flipbook loads
+      // frames non-interactively.  an image opened from the file dialog
+      // keeps the file name, so saving a subset of the passes or a crop
+      // must not overwrite the original: the dialog loads everything
+      GRunModeType run_mode = (GRunModeType) param[0].data.d_int32;
+      char *layers = NULL;
+      gint region[4] = { 0, 0, 0, 0 };
+
+      if (nparams >= 8)
+        {
+          if (param[3].data.d_string && param[3].data.d_string[0])
+            layers = g_strdup (param[3].data.d_string);
+          for (int i = 0; i < 4; ++i)
+            region[i] = param[4 + i].data.d_int32;
+        }
+      if (!layers && run_mode == RUN_NONINTERACTIVE)
+        layers = gimprc_string ("openexr-load-layers");
+      if ((region[2] <= 0 || region[3] <= 0) &&
+          run_mode == RUN_NONINTERACTIVE)
+        {
+          char *value = gimprc_string ("openexr-load-region");
+          if (!value ||
+              sscanf (value, "%d %d %d %d",
+                      &region[0], &region[1], &region[2], &region[3]) != 4)
+            region[2] = region[3] = 0;
+          g_free (value);
+        }
+
+      image_ID = load_image (param[1].data.d_string, layers, region);
+      g_free (layers);
 
       if (image_ID != -1)
 	{
@@ -181,18 +263,121 @@ run (char    *name,
   else if (strcmp (name, "file_openexr_save") == 0)
     {
       *nreturn_vals = 1;
-      if (save_image (param[3].data.d_string, param[1].data.d_int32, param[2].data.d_int32))
-	  values[0].data.d_status = STATUS_SUCCESS;
-      else
-	  values[0].data.d_status = STATUS_EXECUTION_ERROR;
+      values[0].data.d_status = STATUS_SUCCESS;
+
+      switch (param[0].data.d_int32)
+        {
+        case RUN_INTERACTIVE:
+          gimp_get_data ("file_openexr_save", &compression);
+          if (!save_dialog ())
+            return;
+          break;
+
+        case RUN_NONINTERACTIVE:
+          // the compression argument is optional for older scripts
+          if (nparams >= 6)
+            compression = param[5].data.d_int32;
+          break;
+
+        case RUN_WITH_LAST_VALS:
+          gimp_get_data ("file_openexr_save", &compression);
+          break;
+
+        default:
+          break;
+        }
+
+      int valid = FALSE;
+      for (unsigned int i = 0; i < NUM_COMPRESSIONS; ++i)
+        if (compressions[i].compression == compression)
+          valid = TRUE;
+      if (!valid)
+        values[0].data.d_status = STATUS_CALLING_ERROR;
+
+      if (values[0].data.d_status == STATUS_SUCCESS)
+        {
+          if (save_image (param[3].data.d_string, param[1].data.d_int32, param[2].data.d_int32))
+            gimp_set_data ("file_openexr_save", &compression, sizeof (compression));
+          else
+            values[0].data.d_status = STATUS_EXECUTION_ERROR;
+        }
     }
 }
 
+/* a gimprc entry as newly allocated string, NULL if unset */
+static char *
+gimprc_string (const char *token)
+{
+  GParam *return_vals;
+  gint nreturn_vals;
+  char *value = NULL;
+
+  return_vals = gimp_run_procedure ("gimp_gimprc_query",
+                                    &nreturn_vals,
+                                    PARAM_STRING, token,
+                                    PARAM_END);
+  if (return_vals[0].data.d_status == STATUS_SUCCESS &&
+      return_vals[1].data.d_string && return_vals[1].data.d_string[0])
+    value = g_strdup (return_vals[1].data.d_string);
+  gimp_destroy_params (return_vals, nreturn_vals);
+
+  return value;
+}
+
+/* size OpenEXR's global thread pool from the openexr-threads gimprc
+   entry, 0 or unset uses one thread per processor and 1 decodes in
+   the plug-in's own thread */
+static void
+init_threads (void)
+{
+  char *value = gimprc_string ("openexr-threads");
+  int threads = 0;
+
+  if (value)
+    threads = atoi (value);
+  g_free (value);
+
+#ifdef _SC_NPROCESSORS_ONLN
+  if (threads <= 0)
+    threads = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+
+  Imf::setGlobalThreadCount (threads > 1 ? threads : 0);
+}
+
+/* whether one of the comma separated names in layers equals lname
+   or a leading part of it up to a dot */
+static int
+layer_selected (const char *lname, const char *layers)
+{
+  const char *start = layers;
+
+  while (start && *start)
+  {
+    const char *end = strchr (start, ',');
+    size_t len = end ? (size_t) (end - start) : strlen (start);
+
+    while (len && *start == ' ')
+      ++start, --len;
+    while (len && start[len - 1] == ' ')
+      --len;
+
+    if (len && strncmp (lname, start, len) == 0 &&
+        (lname[len] == '.' || lname[len] == '\0'))
+      return TRUE;
+
+    start = end ? end + 1 : NULL;
+  }
+
+  return FALSE;
+}
+
 static gint32
-load_image (char *filename)
+load_image (char       *filename,
+            const char *layers,
+            gint       *region)
 {
     float * scanline = 0;
-    guint16 * hscanline = 0;
     gfloat ** pixels = 0;
     guint16 ** hpixels = 0;
 
@@ -217,8 +402,25 @@ load_image (char *filename)
 	const Imath::Box2i & dataWindow = exr_full_header.dataWindow ();
 	const Imath::Box2i & displayWindow = exr_full_header.displayWindow ();
 
-	int width = dataWindow.max.x - dataWindow.min.x + 1;
-	int height = dataWindow.max.y - dataWindow.min.y + 1;
+        // the part of the data window to decode, region is given in
+        // image (display window) coordinates
+        Imath::Box2i roi = dataWindow;
+        if (region && region[2] > 0 && region[3] > 0)
+        {
+          Imath::Box2i r (Imath::V2i (displayWindow.min.x + region[0],
+                                      displayWindow.min.y + region[1]),
+                          Imath::V2i (displayWindow.min.x + region[0] + region[2] - 1,
+                                      displayWindow.min.y + region[1] + region[3] - 1));
+          roi.min.x = MAX (roi.min.x, r.min.x);
+          roi.min.y = MAX (roi.min.y, r.min.y);
+          roi.max.x = MIN (roi.max.x, r.max.x);
+          roi.max.y = MIN (roi.max.y, r.max.y);
+          if (roi.isEmpty ())
+            THROW (Iex::ArgExc, "The region lies outside of the data window");
+        }
+
+	int width = roi.max.x - roi.min.x + 1;
+	int height = roi.max.y - roi.min.y + 1;
 	int iwidth = displayWindow.max.x - displayWindow.min.x + 1;
 	int iheight = displayWindow.max.y - displayWindow.min.y + 1;
 	GImageType image_type = FLOAT_RGB;
@@ -327,6 +529,32 @@ load_image (char *filename)
           }
         }
 
+        // the layers to decode, all of them unless the selection matches
+        int *selected = (int*)calloc (sizeof(int), nlayers);
+        int nselected = 0;
+        if (nlayers > 1 && layers)
+          for( int i = 0; i < nlayers; ++i)
+            if (layer_selected (lnames[i], layers))
+            {
+              selected[i] = TRUE;
+              ++nselected;
+            }
+        if (nselected)
+        {
+          // size the buffers for the selected layers only
+          max_chan = 0;
+          for( int i = 0; i < nlayers; ++i)
+            if (selected[i] && chan_per_layer[i][0] > max_chan)
+              max_chan = chan_per_layer[i][0];
+        }
+        else
+        {
+          if (nlayers > 1 && layers)
+            fprintf(stderr, "no layer matches \"%s\", loading all\n", layers);
+          for( int i = 0; i < nlayers; ++i)
+            selected[i] = TRUE;
+        }
+
         str_attr =
           exr_full_header.findTypedAttribute <Imf::StringAttribute>("comments");
         if (str_attr)
@@ -339,8 +567,6 @@ load_image (char *filename)
         int cchan = 0; // channels in CinePaint
         if(nlayers > 1)
           chan = max_chan;
-	scanline = new float [( dataWindow.max.x + 1) * chan];
-        hscanline = (guint16*) scanline;
         char *n = "A";
         const char* cname = NULL;
         if(hasZ >= 0)
@@ -380,6 +606,24 @@ load_image (char *filename)
 					xstride, 0));*/
 
 	int tile_height = gimp_tile_height();
+        int tile_rows = 0;
+
+        // read whole rows of file tiles at once, so none is decoded twice
+        if (exr_full_header.hasTileDescription ())
+        {
+          tile_rows = exr_full_header.tileDescription ().ySize;
+          tile_height = ((tile_height + tile_rows - 1) / tile_rows) * tile_rows;
+        }
+
+        // readPixels() writes every column of the data window, so a
+        // region narrower than that is decoded at full width into a
+        // band of all file channels and its columns copied out.  the
+        // band also drops the extra channels
+        int dwidth = dataWindow.max.x - dataWindow.min.x + 1;
+        int x0 = roi.min.x - dataWindow.min.x;
+        bool direct = chan <= 4 && width == dwidth;
+        if (!direct)
+          scanline = new float [tile_height * dwidth * chan];
 
 	pixels = (gfloat**) malloc(tile_height*sizeof(gfloat*));
 	if (!pixels)
@@ -406,44 +650,11 @@ load_image (char *filename)
 	gimp_image_set_filename (image_ID, filename);
         for( int i = 0; i < nlayers; ++i )
         {
-# define InsertSlice_m( position ) \
-            pos = getChannelPos( position, c_names, chan_per_layer[i] ); \
-            if(pos >= 0) \
-            { \
-              cname = c_names[ pos ].c_str(); \
-              fb.insert (cname, Imf::Slice (etype, (char *) scanline \
-                         + position * type_size, xstride, 0)); \
-            }
-          int pos = -1;
-          size_t xstride = type_size * chan;
-          Imf::FrameBuffer fb;
-          if(chan_per_layer[i][0] == 1 || chan_per_layer[i][0] == 2)
-          {
-            InsertSlice_m( 0 )
-          }
-          if(chan_per_layer[i][0] == 2)
-          {
-            InsertSlice_m( 1 )
-          }
-          if(chan_per_layer[i][0] >= 3)
-          {
-            InsertSlice_m( 0 )
-            InsertSlice_m( 1 )
-            InsertSlice_m( 2 )
-          }
-          if(chan_per_layer[i][0] >= 4)
-          {
-            InsertSlice_m( 3 )
-          }
-          // ignoring all following channels; TODO copy them elsewhere
-# undef   InsertSlice_m
-          // possibly insert non existing slices
-          /*for( int j = chan_per_layer[i][0]; j < chan; ++j )
-            fb.insert ("NOT_AVAILABLE", Imf::Slice (Imf::FLOAT,
-                                        (char *) scanline + j * sizeof (float),
-                                        xstride, 0));*/
-          exr.setFrameBuffer (fb);
+          if (!selected[i])
+            continue;
 
+          size_t xstride = type_size * chan;
+          size_t ystride = xstride * (direct ? width : dwidth);
 
           char *ln = _("Background");
           // the technical layer.pass.channels name from our OpenEXR file
@@ -454,8 +665,8 @@ load_image (char *filename)
  							        width, height,
 							        layer_type, 100, NORMAL_MODE);
           gimp_image_add_layer(image_ID, layer_ID, 0);
-          gimp_layer_set_offsets( layer_ID, dataWindow.min.x - displayWindow.min.x,
-                                          dataWindow.min.y - displayWindow.min.y );
+          gimp_layer_set_offsets( layer_ID, roi.min.x - displayWindow.min.x,
+                                          roi.min.y - displayWindow.min.y );
           GDrawable * drawable = gimp_drawable_get (layer_ID);
 
 	  GPixelRgn pixel_rgn;
@@ -463,33 +674,71 @@ load_image (char *filename)
 	                       drawable->height, TRUE, FALSE);
 
 
-          int y = dataWindow.min.y;
-	  while (y < dataWindow.max.y)
+          int y = roi.min.y;
+	  while (y <= roi.max.y)
 	  {
 	    int start = y;
-	    int end = MIN (y + tile_height, dataWindow.max.y);
+	    int end = y + tile_height;
+            // a region may start inside a file tile, end bands on the grid
+            if (tile_rows)
+              end -= (end - dataWindow.min.y) % tile_rows;
+	    end = MIN (end, roi.max.y + 1);
 	    int scanlines = end - start;
+
+            // decode the whole band in one call, so the thread pool
+            // gets several line blocks to work on.  with up to four
+            // channels and the full width the file layout matches ours
+            // and the band lands directly in pixels
+            char *base = direct ? (char *) pixels[0] : (char *) scanline;
+            base -= dataWindow.min.x * xstride + start * ystride;
+
+# define InsertSlice_m( position ) \
+            pos = getChannelPos( position, c_names, chan_per_layer[i] ); \
+            if(pos >= 0) \
+            { \
+              cname = c_names[ pos ].c_str(); \
+              fb.insert (cname, Imf::Slice (etype, base \
+                         + position * type_size, xstride, ystride)); \
+            }
+            int pos = -1;
+            Imf::FrameBuffer fb;
+            if(chan_per_layer[i][0] == 1 || chan_per_layer[i][0] == 2)
+            {
+              InsertSlice_m( 0 )
+            }
+            if(chan_per_layer[i][0] == 2)
+            {
+              InsertSlice_m( 1 )
+            }
+            if(chan_per_layer[i][0] >= 3)
+            {
+              InsertSlice_m( 0 )
+              InsertSlice_m( 1 )
+              InsertSlice_m( 2 )
+            }
+            if(chan_per_layer[i][0] >= 4)
+            {
+              InsertSlice_m( 3 )
+            }
+            // ignoring all following channels; TODO copy them elsewhere
+# undef   InsertSlice_m
+            exr.setFrameBuffer (fb);
+            exr.readPixels (start, end - 1);
+
+            // the region's columns, the layouts match up to four channels
+            if(!direct && chan <= 4)
 	    for (int k = 0; k != scanlines; ++k)
-	    {
-              int line = y;
-              if(exr_full_header.lineOrder() == Imf::DECREASING_Y)
-                ;//line = dataWindow.min.y + dataWindow.max.y - y;
+              memcpy ((char *) pixels[0] + k * width * xstride,
+                      (char *) scanline + k * ystride + x0 * xstride,
+                      width * xstride);
 
-              exr.readPixels (line);
-              if(chan <= 4)
-              {
-                if(type_size == 2)
-                {
-                  memcpy( hpixels[k], hscanline + dataWindow.min.x*chan, type_size * width * cchan);
-                } else {
-                  memcpy( pixels[k], scanline + dataWindow.min.x*chan, type_size * width * cchan);
-                }
-              }
-              else
+            if(chan > 4)
+	    for (int k = 0; k != scanlines; ++k)
+	    {
               for (int x = 0; x != (width); ++x)
               {
 		    gfloat * floatPixel = pixels[0] + width*k*cchan + x * cchan;
-		    float * fl = scanline + (x + dataWindow.min.x)*chan;
+		    float * fl = scanline + (dwidth*k + x0 + x)*chan;
                     for(int c = 0; c < chan; ++c)
                       if( c < 4 )
                       {
@@ -506,11 +755,11 @@ load_image (char *filename)
                       } else
                         *floatPixel++;
 	      }
-	      ++y;
 	    }
-	    gimp_pixel_rgn_set_rect(&pixel_rgn, (guchar *)pixels[0], 0, start-dataWindow.min.y, 
+	    y = end;
+	    gimp_pixel_rgn_set_rect(&pixel_rgn, (guchar *)pixels[0], 0, start-roi.min.y, 
 				    drawable->width, scanlines);
-	    gimp_progress_update((double)(y-dataWindow.min.y) / (double)height);
+	    gimp_progress_update((double)(y-roi.min.y) / (double)height);
 	  }
 
           gimp_drawable_flush(drawable);
@@ -522,6 +771,7 @@ load_image (char *filename)
         g_free(pixels[0]);
         g_free(pixels);
         delete [] scanline;
+        free(selected);
 
         // colour space description -> ICC profile
 	Imf::Chromaticities image_prim;
@@ -684,9 +934,6 @@ typedef struct {
   int dtype;      // data type 0 - half, 1 - IEEE float, 2 - int32
   GPixelRgn pixel_rgn;
   gfloat * cp_pixels;
-  gfloat * pixels;
-  guint16 * hcp_pixels;
-  guint16 * hpixels;
 } clayer_s;
 
 static gint
@@ -789,8 +1036,7 @@ save_image (char   *filename,
 
   try
   {
-    // allow PIZ compression - taken from shake plug-in
-    Imf::Compression compress = Imf::PIZ_COMPRESSION;
+    Imf::Compression compress = (Imf::Compression) compression;
     Imath::Box2i dataWindow (Imath::V2i (0, 0), Imath::V2i (alayers[0].width - 1, alayers[0].height - 1));
     Imath::Box2i displayWindow (Imath::V2i (-alayers[0].dx, -alayers[0].dy),
                                 Imath::V2i (iwidth - alayers[0].dx - 1,
@@ -833,19 +1079,11 @@ save_image (char   *filename,
           g_message(_("Adding of colour primaries to EXR failed."));
     }
 
-    Imf::FrameBuffer fb;
-
     for( int l = 0; l < nlayers; ++l)
     {
       // Set up temp buffers
-      alayers[l].pixels = g_new(gfloat, alayers[l].width * alayers[l].cchan );
       alayers[l].cp_pixels = g_new(gfloat, tile_height * alayers[l].width *
                                            alayers[l].cchan );
-      alayers[l].hpixels = (guint16*) alayers[l].pixels;
-      alayers[l].hcp_pixels = (guint16*) alayers[l].cp_pixels;
-
-      size_t xstride = type_size * alayers[l].cchan;
-      size_t ystride = xstride * alayers[l].width;
 
       for( int position = 0; position < alayers[l].echan; ++position )
       {
@@ -857,18 +1095,10 @@ save_image (char   *filename,
         // set all the channel names in the OpenEXR header
         header.channels().insert (alayers[l].enames[position],
                                   Imf::Channel (etype));
-
-	// Write a bunch of scanlines at a time to save memory.  We do this by
-	// setting the frame buffer y stride to 0 if using one scanline.
-        fb.insert (alayers[l].enames[position],
-                   Imf::Slice (etype, (char *) alayers[l].pixels
-                               + position * type_size,
-                               xstride, 0));
       }
     }
 
     Imf::OutputFile exr (filename, header);
-    exr.setFrameBuffer (fb);
 
     char progress[PATH_MAX];
     if (strrchr (filename, '/') != NULL)
@@ -893,32 +1123,33 @@ save_image (char   *filename,
                                 0, start, alayers[l].width, scanlines);
       }
 
-      for( int i = 0; i < scanlines; ++i)
+      // point the slices at the band, so the whole band is encoded
+      // in one call and the thread pool can compress line blocks
+      // side by side
+      Imf::FrameBuffer fb;
+      for( int l = 0; l < nlayers; ++l)
       {
-        for( int l = 0; l < nlayers; ++l)
-        {
-          size_t ystride = alayers[l].width * alayers[l].cchan;
-          if(type_size == 2)
-            memcpy( alayers[l].pixels, &alayers[l].hcp_pixels[ystride * i],
-                    ystride * type_size);
-          else
-            memcpy( alayers[l].pixels, &alayers[l].cp_pixels[ystride * i],
-                    ystride * type_size);
-        }
-
-        exr.writePixels (1);
-
-        ++y;
-        gimp_progress_update((double)y / (double)alayers[0].height);
+        size_t xstride = type_size * alayers[l].cchan;
+        size_t ystride = xstride * alayers[l].width;
+        char *base = (char *) alayers[l].cp_pixels - start * ystride;
+
+        for( int position = 0; position < alayers[l].echan; ++position )
+          fb.insert (alayers[l].enames[position],
+                     Imf::Slice (etype, base + position * type_size,
+                                 xstride, ystride));
       }
+      exr.setFrameBuffer (fb);
+      exr.writePixels (scanlines);
+
+      y = end;
+      gimp_progress_update((double)y / (double)alayers[0].height);
     }
 
     // clean up
 
     for( int l = 0; l < nlayers; ++l)
     {
-      g_free (alayers[l].pixels);    alayers[l].pixels = NULL;
-      free (alayers[l].cp_pixels);   alayers[l].cp_pixels = NULL;
+      g_free (alayers[l].cp_pixels);   alayers[l].cp_pixels = NULL;
     }
   }
 
@@ -1018,3 +1249,98 @@ getChannelName    (int position, const char *layer_name, int nlayers,
   return name;
 }
 
+static void
+save_close_callback (GtkWidget *w,
+                     gpointer   data)
+{
+  gtk_main_quit ();
+}
+
+static void
+save_ok_callback (GtkWidget *w,
+                  gpointer   data)
+{
+  runme = TRUE;
+
+  gtk_widget_destroy (GTK_WIDGET (data));
+}
+
+static void
+save_compression_callback (GtkWidget *w,
+                           gpointer   data)
+{
+  if (GTK_TOGGLE_BUTTON (w)->active)
+    compression = (gint) (long) data;
+}
+
+static gint
+save_dialog (void)
+{
+  GtkWidget *dlg, *button, *frame, *vbox;
+  GSList *group = NULL;
+  gchar **argv;
+  gint argc;
+
+  argc    = 1;
+  argv    = g_new (gchar *, 1);
+  argv[0] = g_strdup ("openexr");
+
+  gtk_init (&argc, &argv);
+
+  signal (SIGBUS, SIG_DFL);
+  signal (SIGSEGV, SIG_DFL);
+
+  dlg = gtk_dialog_new ();
+  gtk_window_set_title (GTK_WINDOW (dlg), _("OpenEXR Options"));
+  gtk_window_position (GTK_WINDOW (dlg), GTK_WIN_POS_MOUSE);
+  gtk_signal_connect (GTK_OBJECT (dlg), "destroy",
+                      (GtkSignalFunc) save_close_callback, NULL);
+
+  button = gtk_button_new_with_label (_("OK"));
+  GTK_WIDGET_SET_FLAGS (button, GTK_CAN_DEFAULT);
+  gtk_signal_connect (GTK_OBJECT (button), "clicked",
+                      (GtkSignalFunc) save_ok_callback, dlg);
+  gtk_box_pack_start (GTK_BOX (GTK_DIALOG (dlg)->action_area), button, TRUE, TRUE, 0);
+  gtk_widget_grab_default (button);
+  gtk_widget_show (button);
+
+  button = gtk_button_new_with_label (_("Cancel"));
+  GTK_WIDGET_SET_FLAGS (button, GTK_CAN_DEFAULT);
+  gtk_signal_connect_object (GTK_OBJECT (button), "clicked",
+                             (GtkSignalFunc) gtk_widget_destroy, GTK_OBJECT (dlg));
+  gtk_box_pack_start (GTK_BOX (GTK_DIALOG (dlg)->action_area), button, TRUE, TRUE, 0);
+  gtk_widget_show (button);
+
+  frame = gtk_frame_new (_("Compression"));
+  gtk_frame_set_shadow_type (GTK_FRAME (frame), GTK_SHADOW_ETCHED_IN);
+  gtk_container_border_width (GTK_CONTAINER (frame), 10);
+  gtk_box_pack_start (GTK_BOX (GTK_DIALOG (dlg)->vbox), frame, TRUE, TRUE, 0);
+
+  vbox = gtk_vbox_new (FALSE, 0);
+  gtk_container_border_width (GTK_CONTAINER (vbox), 4);
+  gtk_container_add (GTK_CONTAINER (frame), vbox);
+  gtk_widget_show (vbox);
+
+  for (unsigned int i = 0; i < NUM_COMPRESSIONS; ++i)
+  {
+    button = gtk_radio_button_new_with_label (group, _(compressions[i].label));
+    group  = gtk_radio_button_group (GTK_RADIO_BUTTON (button));
+    if (compressions[i].compression == compression)
+      gtk_toggle_button_set_state (GTK_TOGGLE_BUTTON (button), TRUE);
+
+    gtk_signal_connect (GTK_OBJECT (button), "toggled",
+                        (GtkSignalFunc) save_compression_callback,
+                        (gpointer) (long) compressions[i].compression);
+    gtk_box_pack_start (GTK_BOX (vbox), button, FALSE, FALSE, 0);
+    gtk_widget_show (button);
+  }
+
+  gtk_widget_show (frame);
+  gtk_widget_show (dlg);
+
+  gtk_main ();
+  gdk_flush ();
+
+  return runme;
+}
+
@@ -87,6 +87,14 @@ typedef long long INT64;
 typedef unsigned long long UINT64;
 #endif
 
+#ifdef DCRAW_LIBRARY
+#include "config.h"
+#include "dcraw.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#endif
+
 #ifdef LJPEG_DECODE
 #error Please compile dcraw.c by itself.
 #error Do not link it with ljpeg_decode.
@@ -130,7 +138,7 @@ float bright=1, user_mul[4]={0,0,0,0}, threshold=0;
 int half_size=0, four_color_rgb=0, document_mode=0, highlight=0;
 int verbose=0, use_auto_wb=0, use_camera_wb=0, use_camera_matrix=-1;
 int output_color=1, output_bps=8, output_tiff=0, med_passes=0;
-int no_auto_bright=0;
+int no_auto_bright=0, nthreads=1;
 unsigned greybox[4] = { 0, 0, UINT_MAX, UINT_MAX };
 float cam_mul[4], pre_mul[4], cmatrix[3][4], rgb_cam[3][4];
 const double xyz_rgb[3][3] = {			/* XYZ from RGB */
@@ -3805,11 +3813,86 @@ void CLASS border_interpolate (int border)
     }
 }
 
+/*
+   Run fn over rows [0,n) split into bands, one per thread.  Only
+   the library build starts threads; fn must not call merror().
+ */
+#define MAX_THREADS 16
+
+int CLASS band_count (int n)
+{
+#if defined(DCRAW_LIBRARY) && defined(HAVE_PTHREAD)
+  return MAX (1, MIN (n, LIM (nthreads, 1, MAX_THREADS)));
+#else
+  return 1;
+#endif
+}
+
+struct band {
+  void (*fn)(int first, int count, int slot, void *data);
+  void *data;
+  int first, count, slot;
+};
+
+void * CLASS band_run (void *arg)
+{
+  struct band *b = (struct band *) arg;
+
+  (*b->fn) (b->first, b->count, b->slot, b->data);
+  return 0;
+}
+
+void CLASS parallel_rows (int n,
+	void (*fn)(int first, int count, int slot, void *data), void *data)
+{
+  struct band b[MAX_THREADS];
+  int i, nb = band_count (n), started=1;
+#if defined(DCRAW_LIBRARY) && defined(HAVE_PTHREAD)
+  pthread_t tid[MAX_THREADS];
+#endif
+
+  for (i=0; i < nb; i++) {
+    b[i].fn = fn;
+    b[i].data = data;
+    b[i].first = (INT64) n * i / nb;
+    b[i].count = (INT64) n * (i+1) / nb - b[i].first;
+    b[i].slot = i;
+  }
+#if defined(DCRAW_LIBRARY) && defined(HAVE_PTHREAD)
+  for (; started < nb; started++)
+    if (pthread_create (&tid[started], 0, band_run, &b[started])) break;
+#endif
+  band_run (&b[0]);
+  for (i=started; i < nb; i++)		/* bands no thread took */
+    band_run (&b[i]);
+#if defined(DCRAW_LIBRARY) && defined(HAVE_PTHREAD)
+  for (i=1; i < started; i++)
+    pthread_join (tid[i], 0);
+#endif
+}
+
+void CLASS lin_interpolate_rows (int first, int count, int slot, void *data)
+{
+  int (*code)[16][32] = (int (*)[16][32]) data, *ip, sum[4];
+  int i, row, col;
+  ushort *pix;
+
+  for (row=1+first; row < 1+first+count; row++)
+    for (col=1; col < width-1; col++) {
+      pix = image[row*width+col];
+      ip = code[row & 15][col & 15];
+      memset (sum, 0, sizeof sum);
+      for (i=8; i--; ip+=3)
+	sum[ip[2]] += pix[ip[0]] << ip[1];
+      for (i=colors; --i; ip+=2)
+	pix[ip[0]] = sum[ip[0]] * ip[1] >> 8;
+    }
+}
+
 void CLASS lin_interpolate()
 {
   int code[16][16][32], *ip, sum[4];
-  int c, i, x, y, row, col, shift, color;
-  ushort *pix;
+  int c, x, y, row, col, shift, color;
 
   if (verbose) fprintf (stderr,_("Bilinear interpolation...\n"));
 
@@ -3834,16 +3917,8 @@ void CLASS lin_interpolate()
 	  *ip++ = 256 / sum[c];
 	}
     }
-  for (row=1; row < height-1; row++)
-    for (col=1; col < width-1; col++) {
-      pix = image[row*width+col];
-      ip = code[row & 15][col & 15];
-      memset (sum, 0, sizeof sum);
-      for (i=8; i--; ip+=3)
-	sum[ip[2]] += pix[ip[0]] << ip[1];
-      for (i=colors; --i; ip+=2)
-	pix[ip[0]] = sum[ip[0]] * ip[1] >> 8;
-    }
+  /* each pixel only reads raw colors of its neighbours */
+  parallel_rows (height-2, lin_interpolate_rows, code);
 }
 
 /*
@@ -3984,18 +4059,18 @@ void CLASS vng_interpolate()
 
 /*
    Patterned Pixel Grouping Interpolation by Alain Desbiolles
+
+   Each pass writes only colors the same pass does not read, so
+   its rows can be done in any order.
 */
-void CLASS ppg_interpolate()
+void CLASS ppg_green_rows (int first, int count, int slot, void *data)
 {
   int dir[5] = { 1, width, -1, -width, 1 };
   int row, col, diff[2], guess[2], c, d, i;
   ushort (*pix)[4];
 
-  border_interpolate(3);
-  if (verbose) fprintf (stderr,_("PPG interpolation...\n"));
-
 /*  Fill in the green layer with gradients and pattern recognition: */
-  for (row=3; row < height-3; row++)
+  for (row=3+first; row < 3+first+count; row++)
     for (col=3+(FC(row,3) & 1), c=FC(row,col); col < width-3; col+=2) {
       pix = image + row*width+col;
       for (i=0; (d=dir[i]) > 0; i++) {
@@ -4010,16 +4085,32 @@ void CLASS ppg_interpolate()
       d = dir[i = diff[0] > diff[1]];
       pix[0][1] = ULIM(guess[i] >> 2, pix[d][1], pix[-d][1]);
     }
+}
+
+void CLASS ppg_green_pixel_rows (int first, int count, int slot, void *data)
+{
+  int dir[5] = { 1, width, -1, -width, 1 };
+  int row, col, c, d, i;
+  ushort (*pix)[4];
+
 /*  Calculate red and blue for each green pixel:		*/
-  for (row=1; row < height-1; row++)
+  for (row=1+first; row < 1+first+count; row++)
     for (col=1+(FC(row,2) & 1), c=FC(row,col+1); col < width-1; col+=2) {
       pix = image + row*width+col;
       for (i=0; (d=dir[i]) > 0; c=2-c, i++)
 	pix[0][c] = CLIP((pix[-d][c] + pix[d][c] + 2*pix[0][1]
 			- pix[-d][1] - pix[d][1]) >> 1);
     }
+}
+
+void CLASS ppg_red_blue_rows (int first, int count, int slot, void *data)
+{
+  int dir[5] = { 1, width, -1, -width, 1 };
+  int row, col, diff[2], guess[2], c, d, i;
+  ushort (*pix)[4];
+
 /*  Calculate blue for red pixels and vice versa:		*/
-  for (row=1; row < height-1; row++)
+  for (row=1+first; row < 1+first+count; row++)
     for (col=1+(FC(row,1) & 1), c=2-FC(row,col); col < width-1; col+=2) {
       pix = image + row*width+col;
       for (i=0; (d=dir[i]+dir[i+1]) > 0; i++) {
@@ -4036,42 +4127,48 @@ void CLASS ppg_interpolate()
     }
 }
 
+void CLASS ppg_interpolate()
+{
+  border_interpolate(3);
+  if (verbose) fprintf (stderr,_("PPG interpolation...\n"));
+
+  parallel_rows (height-6, ppg_green_rows, 0);
+  parallel_rows (height-2, ppg_green_pixel_rows, 0);
+  parallel_rows (height-2, ppg_red_blue_rows, 0);
+}
+
 /*
    Adaptive Homogeneity-Directed interpolation is based on
    the work of Keigo Hirakawa, Thomas Parks, and Paul Lee.
  */
 #define TS 256		/* Tile Size */
 
-void CLASS ahd_interpolate()
+struct ahd {
+  float *cbrt, (*xyz_cam)[4];
+  char **buffer;
+};
+
+/*
+   Tiles only read raw colors, and leave them alone when writing,
+   so rows of tiles can be done on several threads at once.
+ */
+void CLASS ahd_tile_rows (int first, int count, int slot, void *data)
 {
-  int i, j, k, top, left, row, col, tr, tc, c, d, val, hm[2];
+  struct ahd *ahd = (struct ahd *) data;
+  int i, j, top, left, row, col, tr, tc, c, d, val, hm[2];
   ushort (*pix)[4], (*rix)[3];
   static const int dir[4] = { -1, 1, -TS, TS };
   unsigned ldiff[2][4], abdiff[2][4], leps, abeps;
-  float r, cbrt[0x10000], xyz[3], xyz_cam[3][4];
+  float xyz[3], *cbrt = ahd->cbrt, (*xyz_cam)[4] = ahd->xyz_cam;
   ushort (*rgb)[TS][TS][3];
    short (*lab)[TS][TS][3], (*lix)[3];
-   char (*homo)[TS][TS], *buffer;
+   char (*homo)[TS][TS], *buffer = ahd->buffer[slot];
 
-  if (verbose) fprintf (stderr,_("AHD interpolation...\n"));
-
-  for (i=0; i < 0x10000; i++) {
-    r = i / 65535.0;
-    cbrt[i] = r > 0.008856 ? pow(r,1/3.0) : 7.787*r + 16/116.0;
-  }
-  for (i=0; i < 3; i++)
-    for (j=0; j < colors; j++)
-      for (xyz_cam[i][j] = k=0; k < 3; k++)
-	xyz_cam[i][j] += xyz_rgb[i][k] * rgb_cam[k][j] / d65_white[i];
-
-  border_interpolate(5);
-  buffer = (char *) malloc (26*TS*TS);		/* 1664 kB */
-  merror (buffer, "ahd_interpolate()");
   rgb  = (ushort(*)[TS][TS][3]) buffer;
   lab  = (short (*)[TS][TS][3])(buffer + 12*TS*TS);
   homo = (char  (*)[TS][TS])   (buffer + 24*TS*TS);
 
-  for (top=2; top < height-5; top += TS-6)
+  for (top=2+first*(TS-6); top < 2+(first+count)*(TS-6); top += TS-6)
     for (left=2; left < width-5; left += TS-6) {
 
 /*  Interpolate green horizontally and vertically:		*/
@@ -4155,15 +4252,49 @@ void CLASS ahd_interpolate()
 	    for (hm[d]=0, i=tr-1; i <= tr+1; i++)
 	      for (j=tc-1; j <= tc+1; j++)
 		hm[d] += homo[d][i][j];
+	  j = FC(row,col);		/* the raw color stays as it is */
 	  if (hm[0] != hm[1])
-	    FORC3 image[row*width+col][c] = rgb[hm[1] > hm[0]][tr][tc][c];
+	    FORC3 { if (c != j) image[row*width+col][c] =
+		rgb[hm[1] > hm[0]][tr][tc][c]; }
 	  else
-	    FORC3 image[row*width+col][c] =
-		(rgb[0][tr][tc][c] + rgb[1][tr][tc][c]) >> 1;
+	    FORC3 { if (c != j) image[row*width+col][c] =
+		(rgb[0][tr][tc][c] + rgb[1][tr][tc][c]) >> 1; }
 	}
       }
     }
-  free (buffer);
+}
+
+void CLASS ahd_interpolate()
+{
+  int i, j, k, nb, tiles;
+  float r, cbrt[0x10000], xyz_cam[3][4];
+  char *buffer[MAX_THREADS];
+  struct ahd ahd;
+
+  if (verbose) fprintf (stderr,_("AHD interpolation...\n"));
+
+  for (i=0; i < 0x10000; i++) {
+    r = i / 65535.0;
+    cbrt[i] = r > 0.008856 ? pow(r,1/3.0) : 7.787*r + 16/116.0;
+  }
+  for (i=0; i < 3; i++)
+    for (j=0; j < colors; j++)
+      for (xyz_cam[i][j] = k=0; k < 3; k++)
+	xyz_cam[i][j] += xyz_rgb[i][k] * rgb_cam[k][j] / d65_white[i];
+
+  border_interpolate(5);
+  tiles = (height-7 + TS-7) / (TS-6);	/* rows of tiles */
+  nb = band_count (tiles);
+  for (i=0; i < nb; i++) {
+    buffer[i] = (char *) malloc (26*TS*TS);	/* 1664 kB */
+    merror (buffer[i], "ahd_interpolate()");
+  }
+  ahd.cbrt = cbrt;
+  ahd.xyz_cam = xyz_cam;
+  ahd.buffer = buffer;
+  parallel_rows (tiles, ahd_tile_rows, &ahd);
+  for (i=0; i < nb; i++)
+    free (buffer[i]);
 }
 #undef TS
 
@@ -8006,12 +8137,41 @@ quit:
 }
 #endif
 
-void CLASS convert_to_rgb()
+struct convert {
+  float (*out_cam)[4];
+  int (*histogram)[4][0x2000];
+};
+
+void CLASS convert_rows (int first, int count, int slot, void *data)
 {
-  int row, col, c, i, j, k;
+  struct convert *cv = (struct convert *) data;
+  int row, col, c, (*hist)[0x2000] = cv->histogram[slot];
   ushort *img;
-  float out[3], out_cam[3][4];
+  float out[3], (*out_cam)[4] = cv->out_cam;
+
+  for (img=image[first*width], row=first; row < first+count; row++)
+    for (col=0; col < width; col++, img+=4) {
+      if (!raw_color) {
+	out[0] = out[1] = out[2] = 0;
+	FORCC {
+	  out[0] += out_cam[0][c] * img[c];
+	  out[1] += out_cam[1][c] * img[c];
+	  out[2] += out_cam[2][c] * img[c];
+	}
+	FORC3 img[c] = CLIP((int) out[c]);
+      }
+      else if (document_mode)
+	img[0] = img[FC(row,col)];
+      FORCC hist[c][img[c] >> 3]++;
+    }
+}
+
+void CLASS convert_to_rgb()
+{
+  int c, i, j, k, nb;
+  float out_cam[3][4];
   double num, inverse[3][3];
+  struct convert cv;
   static const double xyzd50_srgb[3][3] =
   { { 0.436083, 0.385083, 0.143055 },
     { 0.222507, 0.716888, 0.060608 },
@@ -8092,22 +8252,18 @@ void CLASS convert_to_rgb()
     fprintf (stderr, raw_color ? _("Building histograms...\n") :
 	_("Converting to %s colorspace...\n"), name[output_color-1]);
 
+  /* every thread counts into its own histogram */
+  nb = band_count (height);
+  cv.out_cam = out_cam;
+  cv.histogram = (int (*)[4][0x2000]) calloc (nb, sizeof histogram);
+  merror (cv.histogram, "convert_to_rgb()");
+  parallel_rows (height, convert_rows, &cv);
   memset (histogram, 0, sizeof histogram);
-  for (img=image[0], row=0; row < height; row++)
-    for (col=0; col < width; col++, img+=4) {
-      if (!raw_color) {
-	out[0] = out[1] = out[2] = 0;
-	FORCC {
-	  out[0] += out_cam[0][c] * img[c];
-	  out[1] += out_cam[1][c] * img[c];
-	  out[2] += out_cam[2][c] * img[c];
-	}
-	FORC3 img[c] = CLIP((int) out[c]);
-      }
-      else if (document_mode)
-	img[0] = img[FC(row,col)];
-      FORCC histogram[c][img[c] >> 3]++;
-    }
+  for (i=0; i < nb; i++)
+    for (c=0; c < 4; c++)
+      for (j=0; j < 0x2000; j++)
+	histogram[c][j] += cv.histogram[i][c][j];
+  free (cv.histogram);
   if (colors == 4 && output_color) colors = 3;
   if (document_mode && filters) colors = 1;
 }
@@ -8382,6 +8538,7 @@ void CLASS write_ppm_tiff()
   free (ppm);
 }
 
+#ifndef DCRAW_LIBRARY
 int CLASS main (int argc, const char **argv)
 {
   int arg, status=0;
@@ -8755,3 +8912,157 @@ cleanup:
   }
   return status;
 }
+#else /* DCRAW_LIBRARY */
+
+int CLASS dcraw_identify (const char *filename)
+{
+  int raw;
+
+  if (!(ifp = fopen (filename, "rb")))
+    return 0;
+  if (setjmp (failure)) {
+    fclose (ifp);
+    return 0;
+  }
+  ifname = filename;
+  identify();
+  raw = is_raw != 0;
+  fclose (ifp);
+  return raw;
+}
+
+/*
+   The steps of main() for one file, with the options of
+   "-4 -c" and the ones set in options.
+ */
+int CLASS dcraw_open (const char *filename, const DcrawOptions *options,
+	int *out_width, int *out_height, int *out_colors)
+{
+  int quality, i, white=0x2000;
+
+  image = 0;
+  oprof = 0;
+  meta_data = 0;
+  ifp = 0;
+  if (setjmp (failure)) {
+    if (ifp) fclose (ifp);
+    dcraw_close();
+    return -1;
+  }
+  half_size = options->half_size;
+  four_color_rgb = options->four_color_rgb || half_size;
+  document_mode = options->document_mode;
+  use_auto_wb = options->use_auto_wb;
+  use_camera_wb = use_camera_matrix = options->use_camera_wb;
+  output_color = options->output_color;
+  nthreads = options->threads;
+  gamm[0] = gamm[1] = no_auto_bright = 1;
+  output_bps = 16;
+
+  ifname = filename;
+  if (!(ifp = fopen (ifname, "rb")))
+    return -1;
+  identify();
+  switch ((flip+3600) % 360) {
+    case 270:  flip = 5;  break;
+    case 180:  flip = 3;  break;
+    case  90:  flip = 6;
+  }
+  if (!is_raw) {
+    fclose (ifp);
+    return -1;
+  }
+  if (load_raw == &CLASS kodak_ycbcr_load_raw) {
+    height += height & 1;
+    width  += width  & 1;
+  }
+  shrink = filters &&
+	(half_size || threshold || aber[0] != 1 || aber[2] != 1);
+  iheight = (height + shrink) >> shrink;
+  iwidth  = (width  + shrink) >> shrink;
+  if (use_camera_matrix && cmatrix[0][0] > 0.25) {
+    memcpy (rgb_cam, cmatrix, sizeof cmatrix);
+    raw_color = 0;
+  }
+  image = (ushort (*)[4]) calloc (iheight*iwidth, sizeof *image);
+  merror (image, "dcraw_open()");
+  if (meta_length) {
+    meta_data = (char *) malloc (meta_length);
+    merror (meta_data, "dcraw_open()");
+  }
+  fseeko (ifp, data_offset, SEEK_SET);
+  (*load_raw)();
+  fclose (ifp);
+  ifp = 0;
+  if (zero_is_bad) remove_zeroes();
+  bad_pixels (0);
+  quality = 2 + !fuji_width;
+  if (options->quality >= 0) quality = options->quality;
+  if (is_foveon && !document_mode) foveon_interpolate();
+  if (!is_foveon && document_mode < 2) scale_colors();
+  pre_interpolate();
+  if (filters && !document_mode) {
+    if (quality == 0)
+      lin_interpolate();
+    else if (quality == 1 || colors > 3)
+      vng_interpolate();
+    else if (quality == 2)
+      ppg_interpolate();
+    else ahd_interpolate();
+  }
+  if (mix_green)
+    for (colors=3, i=0; i < height*width; i++)
+      image[i][1] = (image[i][1] + image[i][3]) >> 1;
+  if (!is_foveon && colors == 3) median_filter();
+  if (!is_foveon && highlight == 2) blend_highlights();
+  if (!is_foveon && highlight > 2) recover_highlights();
+  fuji_rotate();
+  convert_to_rgb();
+  stretch();
+  if (colors != 1 && colors != 3) {
+    fprintf (stderr,_("%s: %d colors can not be read in-process.\n"),
+	ifname, colors);
+    dcraw_close();
+    return -1;
+  }
+
+  /* what write_ppm_tiff() does before writing rows */
+  gamma_curve (gamm[0], gamm[1], 2, (white << 3)/bright);
+  iheight = height;
+  iwidth  = width;
+  if (flip & 4) SWAP(height,width);
+  *out_width = width;
+  *out_height = height;
+  *out_colors = colors;
+  return 0;
+}
+
+void CLASS dcraw_read_rows (int row, int nrows, ushort *pixels)
+{
+  int col, c, soff, cstep;
+
+  cstep = flip_index (0, 1) - flip_index (0, 0);
+  for ( ; nrows--; row++) {
+    soff = flip_index (row, 0);
+    for (col=0; col < width; col++, soff += cstep, pixels += colors)
+      FORCC pixels[c] = curve[image[soff][c]];
+  }
+}
+
+const void * CLASS dcraw_profile (int *size)
+{
+  if (!oprof) return 0;
+  *size = ntohl(oprof[0]);
+  return oprof;
+}
+
+void CLASS dcraw_close()
+{
+  if (meta_data) free (meta_data);
+  if (oprof) free (oprof);
+  if (image) free (image);
+  meta_data = 0;
+  oprof = 0;
+  image = 0;
+}
+#endif /* DCRAW_LIBRARY */
@@ -0,0 +1,40 @@
+/*
+   dcraw.h -- in-process entry points of dcraw.c
+
+   dcraw.c built with DCRAW_LIBRARY defined (see dcraw_lib.c) drops
+   its main() and offers these instead, so a plug-in can decode a
+   raw photo without running dcraw and reading its output back.
+
+   Only one image can be open at a time; dcraw keeps its state in
+   globals.
+ */
+
+#ifndef __DCRAW_H__
+#define __DCRAW_H__
+
+typedef struct {
+  int quality;		/* -q: 0 bilinear, 1 VNG, 2 PPG, 3 AHD, -1 default */
+  int half_size;	/* -h: no interpolation, half width and height */
+  int four_color_rgb;	/* -f */
+  int document_mode;	/* -d */
+  int use_auto_wb;	/* -a */
+  int use_camera_wb;	/* -w */
+  int output_color;	/* -o: 0 raw, 1 sRGB, 2 Adobe, 3 Wide, 4 ProPhoto, 5 XYZ */
+  int threads;		/* workers for interpolation and color conversion */
+} DcrawOptions;
+
+/* non zero if filename is a raw photo dcraw can decode, like -i */
+int   dcraw_identify  (const char *filename);
+
+/* decode filename completely, like "-4" output.  returns 0 and the
+   output size and number of colors (1 or 3), or -1 */
+int   dcraw_open      (const char *filename, const DcrawOptions *options,
+		       int *width, int *height, int *colors);
+/* copy nrows output rows from row on as linear 16 bit samples,
+   colors per pixel, rotated like the written image would be */
+void  dcraw_read_rows (int row, int nrows, unsigned short *pixels);
+/* the generated output profile, or 0 for raw color */
+const void *dcraw_profile (int *size);
+void  dcraw_close     (void);
+
+#endif /* __DCRAW_H__ */
@@ -0,0 +1,9 @@
+/*
+   dcraw_lib.c -- dcraw.c as a library for the rawphoto plug-in
+
+   The same source builds the stand-alone dcraw program; here its
+   main() is left out and the entry points in dcraw.h are built.
+ */
+
+#define DCRAW_LIBRARY
+#include "dcraw.c"
@@ -7,8 +7,8 @@
    $Date: 2008/05/22 04:22:40 $
 
    This code is licensed under the same terms as The GIMP.
-   To simplify maintenance, it calls my command-line "dcraw"
-   program to do the actual decoding.
+   To simplify maintenance, the decoding is done by my "dcraw"
+   program, built into this plug-in from dcraw.c (see dcraw.h).
 
    To install locally:
 	gimptool --install rawphoto.c
@@ -17,13 +17,15 @@
 	gimptool --install-admin rawphoto.c
 
    To build without installing:
-	gcc -o rawphoto rawphoto.c `gtk-config --cflags --libs` -lgimp -lgimpui
+	gcc -o rawphoto rawphoto.c dcraw_lib.c `gtk-config --cflags --libs` -lgimp -lgimpui \
+	    -llcms -ljpeg -lz -lm -lpthread
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <unistd.h>
 
 #include <gtk/gtk.h>
 
@@ -37,6 +39,8 @@
 #include <lib/widgets.h>
 #endif
 
+#include "dcraw.h"
+
 #define PLUG_IN_VERSION  "1.1.5-dcr-8.37 - 19 April 2004 (cp 22. December 2006)"
 
 static void query(void);
@@ -148,22 +152,29 @@ static void query (void)
   }
 }
 
-char*
-getTempFileName( const char* fname, const char* extension)
+/* the rawphoto-threads gimprc entry, one per processor when unset or 0 */
+static int rawphoto_threads (void)
 {
-    char *tmpname = malloc(strlen(fname)+12);
-    char *ptr = strrchr( fname, '/');
-    sprintf(tmpname,"/tmp/%s", ptr ? ptr : fname);
-    ptr = strchr( tmpname, '.' );
-    if(ptr)
-      ptr[1] = 0;
-    strcpy( &tmpname[strlen(tmpname)], extension );
-    return tmpname;
+  GimpParam *return_vals;
+  gint nreturn_vals;
+  int threads = 0;
+
+  return_vals = gimp_run_procedure ("gimp_gimprc_query",
+                                    &nreturn_vals,
+                                    GIMP_PDB_STRING, "rawphoto-threads",
+                                    GIMP_PDB_END);
+  if (return_vals[0].data.d_status == GIMP_PDB_SUCCESS &&
+      return_vals[1].data.d_string)
+    threads = atoi (return_vals[1].data.d_string);
+  gimp_destroy_params (return_vals, nreturn_vals);
+
+#ifdef _SC_NPROCESSORS_ONLN
+  if (threads <= 0)
+    threads = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+  return threads < 1 ? 1 : threads;
 }
 
-static char *dcraw_name = "dcraw";
-static char *extra_path = NULL;
-
 static void run (gchar *name,
 		gint nparams,
 		GimpParam *param,
@@ -174,20 +185,7 @@ static void run (gchar *name,
   GimpRunModeType run_mode;
   GimpPDBStatusType status;
   gint32 image_id = -1;
-  gchar *command, *fname;
-  int stat;
-
-  if(strrchr(argv[0], G_DIR_SEPARATOR))
-  {
-    char *ptr = NULL;
-    extra_path = malloc(1024);
-    sprintf(extra_path, "%s", argv [0]);
-    ptr = strrchr(extra_path, G_DIR_SEPARATOR);
-    ptr[1] = 0;
-    sprintf( &extra_path[strlen(extra_path)], "..%sextra",
-             G_DIR_SEPARATOR_S );
-  } else
-    fprintf(stderr, "no CinePaint %s found. (%s)\n", dcraw_name, argv[0]);
+  gchar *fname;
 
   INIT_I18N_UI();
 
@@ -197,22 +195,12 @@ static void run (gchar *name,
   status = GIMP_PDB_CALLING_ERROR;
   if (strcmp (name, "file_rawphoto_load")) goto done;
 
-  status = GIMP_PDB_EXECUTION_ERROR;
   fname = param[1].data.d_string;
-  command = g_malloc (strlen(fname) + strlen(extra_path) + 128);
-  if (!command) goto done;
 /*
    Is the file really a raw photo?  If not, try loading it
    as a regular JPEG or TIFF.
  */
-  sprintf (command, "PATH=~/.cinepaint/extra:%s:$PATH ; %s -i '%s'\n", extra_path, dcraw_name, fname);
-  fputs (command, stderr); fputs ("\n", stderr);
-  stat = system (command);
-  g_free (command);
-  if (stat) {
-    if (stat > 0x200)
-      g_message (_("The \"rawphoto\" plugin won't work because "
-	"there is no \"%s\" executable in your path."), dcraw_name);
+  if (!dcraw_identify (fname)) {
     if (!strcasecmp (fname + strlen(fname) - 4, ".jpg"))
       *return_vals = gimp_run_procedure2
 	("file_jpeg_load", nreturn_vals, nparams, param);
@@ -225,36 +213,10 @@ static void run (gchar *name,
   status = GIMP_PDB_CANCEL;
   run_mode = param[0].data.d_int32;
   if (run_mode == GIMP_RUN_INTERACTIVE)
-    if (!load_dialog (param[1].data.d_string)) goto done;
+    if (!load_dialog (fname)) goto done;
 
   status = GIMP_PDB_EXECUTION_ERROR;
-  image_id = load_image (param[1].data.d_string);
-
-  if(cfg.check_val[6] || 1)
-  {
-    char *command = malloc(2048);
-    GimpParam *vals = *return_vals;
-
-
-    printf("%s %s\n", param[1].data.d_string, param[2].data.d_string);
-    param[1].data.d_string = getTempFileName( param[2].data.d_string, "tiff" );
-    printf("%s %s\n", param[1].data.d_string, param[2].data.d_string);
-    *return_vals = gimp_run_procedure2
-	("file_tiff_load", nreturn_vals, nparams, param);
-
-    vals = *return_vals;
-    if( vals[0].data.d_status == GIMP_PDB_SUCCESS )
-      gimp_image_set_filename( vals[1].data.d_image, fname );
-
-    sprintf(command, "rm -v \"%s\"", param[1].data.d_string);
-    fputs (command, stderr); fputs ("\n", stderr);
-    system( command );
-    if(command) free(command);
-
-    *nreturn_vals = 2;
-    gimp_set_data ("plug_in_rawphoto", &cfg, sizeof cfg);
-    return;
-  } 
+  image_id = load_image (fname);
 
   if (image_id == -1) goto done;
   *nreturn_vals = 2;
@@ -268,71 +230,39 @@ done:
   values[0].data.d_status = status;
 }
 
-#define byteswap(c) do { t=(c)[0]; (c)[0]=(c)[1]; (c)[1]=t; } while(0)
-
+/*
+   Decode in this process and copy the linear 16 bit rows
+   straight into the layer, one tile row at a time.
+ */
 static gint32 load_image (gchar *filename)
 {
-  int		tile_height, width, height, row, nrows, depth;
-  int           bpp_gimp, bpp_ppm, px;
-  FILE		*pfp;
+  int		tile_height, width, height, colors, row, nrows;
   gint32	image, layer;
   GimpDrawable	*drawable;
   GimpPixelRgn	pixel_region;
-  guchar	*pixel;
-  char		*command, nl;
-  guint16       *val;
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-  guchar        t;
-#endif
-
-  /*setlocale (LC_NUMERIC, "C");*/
-  command = g_malloc (strlen(filename)+200);
-  if (!command) return -1;
-  /* gamma now is handled internally - Kai-Uwe */
-  sprintf (command,
-	"PATH=~/.cinepaint/extra:%s:$PATH ;%s -4 -v -c%s%s%s%s%s%s%s "/*-g %0.2f -b %0.2f -r %0.2f -l %0.2f*/" '%s'\n",extra_path, dcraw_name,
-	cfg.check_val[0] ? " -q 0":"",
-	cfg.check_val[1] ? " -h":"",
-	cfg.check_val[2] ? " -f":"",
-	cfg.check_val[3] ? " -d":"",
-	cfg.check_val[4] ? " -a":"",
-	cfg.check_val[5] ? " -w":"",
-	cfg.check_val[6] ? " -o 3 -T":" -o 0 -T",
-	/*cfg.spin_val[0], cfg.spin_val[1], cfg.spin_val[2], cfg.spin_val[3],*/
-	filename );
-
-  if(cfg.check_val[6] || 1)
-  {
-    char *fn = strrchr(filename,'/');
-    char *ptr = getTempFileName( fn ? fn+1 : filename, "tiff" );
-
-    sprintf( &command[strlen(command)-1], " > \"%s\"", ptr );
-    fputs (command, stderr); fputs ("\n", stderr);
-    system( command );
-
-    if(ptr) free(ptr);
-    return -1;
-  }
-  
-  fputs (command, stderr); fputs ("\n", stderr);
-  pfp = popen (command, "r");
-  g_free (command);
-  if (!pfp) {
-    perror (dcraw_name);
+  guint16	*pixel;
+  DcrawOptions	options;
+  const void	*profile;
+  int		profile_size;
+
+  options.quality = cfg.check_val[0] ? 0 : -1;
+  options.half_size = cfg.check_val[1];
+  options.four_color_rgb = cfg.check_val[2];
+  options.document_mode = cfg.check_val[3];
+  options.use_auto_wb = cfg.check_val[4];
+  options.use_camera_wb = cfg.check_val[5];
+  options.output_color = cfg.check_val[6] ? 3 : 0;
+  options.threads = rawphoto_threads ();
+
+  gimp_progress_init (_("Decoding raw photo..."));
+  if (dcraw_open (filename, &options, &width, &height, &colors)) {
+    g_message (_("Can't decode %s as raw digital camera image.\n"), filename);
     return -1;
   }
 
-  if (fscanf (pfp, "P6 %d %d %d%c", &width, &height, &depth, &nl) != 4) {
-    pclose (pfp);
-    g_message ("Not a raw digital camera image.%d %d %d %d\n",width,height,depth,nl);
-    return -1;
-  }
- 
-  if(depth < 256) { bpp_ppm = 3; } else { bpp_ppm = 6; }
-
-  image = gimp_image_new (width, height, bpp_ppm == 3 ? RGB : U16_RGB);
+  image = gimp_image_new (width, height, colors == 3 ? U16_RGB : U16_GRAY);
   if (image == -1) {
-    pclose (pfp);
+    dcraw_close ();
     g_message ("Can't allocate new image.\n");
     return -1;
   }
@@ -341,7 +271,7 @@ static gint32 load_image (gchar *filename)
 
   /* Create the "background" layer to hold the image... */
   layer = gimp_layer_new (image, _("Background"), width, height,
-			  bpp_ppm == 3 ? RGB_IMAGE : U16_RGB_IMAGE,
+			  colors == 3 ? U16_RGB_IMAGE : U16_GRAY_IMAGE,
 			  100, GIMP_NORMAL_MODE);
   gimp_image_add_layer (image, layer, 0);
 
@@ -349,41 +279,28 @@ static gint32 load_image (gchar *filename)
   drawable = gimp_drawable_get (layer);
   gimp_pixel_rgn_init (&pixel_region, drawable, 0, 0, drawable->width,
 			drawable->height, TRUE, FALSE);
-  bpp_gimp = pixel_region.bpp;
-
-  if(bpp_gimp != bpp_ppm) {
-    pclose (pfp);
-    g_message ("Wrong depth for new image.\n");
-    return -1;
-  }
 
   /* Temporary buffers... */
   tile_height = get_lib_tile_height();
-  pixel = g_new (guchar, tile_height * width * bpp_gimp);
+  pixel = g_new (guint16, tile_height * width * colors);
 
   /* Load the image... */
   for (row = 0; row < height; row += tile_height) {
     nrows = height - row;
     if (nrows > tile_height)
 	nrows = tile_height;
-    fread (pixel, width * bpp_ppm, nrows, pfp);
-    if(bpp_ppm == 6) for(px = 0; px < width * nrows * 3; px++) {
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-	byteswap(pixel + 2*px);
-#endif
-        /* changed brightness / gamma handling - Kai-Uwe */
-        val = ((guint16*) &(pixel [2*px]));
-        /* doing an simple bitshift here is is better undoable */
-        if (cfg.used_bits < 16)
-          *val = *val << (16 - cfg.used_bits);
-        /* gamma */
-        *val = pow ((float)*val/65535.0, 1.0/cfg.spin_val[0]) * 65535.0;
-    }
-    printf (".");
-    gimp_pixel_rgn_set_rect (&pixel_region, pixel, 0, row, width, nrows);
+    dcraw_read_rows (row, nrows, pixel);
+    gimp_pixel_rgn_set_rect (&pixel_region, (guchar *) pixel,
+			     0, row, width, nrows);
+    gimp_progress_update ((double) (row + nrows) / height);
   }
 
-  pclose (pfp);
+  /* the WideRGB or raw color the rows are in */
+  if ((profile = dcraw_profile (&profile_size)))
+    gimp_image_set_icc_profile_by_mem (image, profile_size,
+				       (gchar *) profile, ICC_IMAGE_PROFILE);
+
+  dcraw_close ();
   g_free (pixel);
 
   gimp_drawable_flush (drawable);
@@ -0,0 +1,695 @@
+/*
+ *   TIFF plug-in for CinePaint
+ *
+ *   strips and tiles decoded and encoded on worker threads
+ *
+ *   libtiff handles are not thread safe, so each reading thread gets
+ *   its own handle on the same file and directory.  encoding happens
+ *   in a small in-memory TIFF per chunk, whose bytes are then written
+ *   raw into the real file in order.
+ *
+ *   This program is free software; you can redistribute it and/or modify it
+ *   under the terms of the GNU General Public License as published by the Free
+ *   Software Foundation; either version 2 of the License, or (at your option)
+ *   any later version.
+ *
+ *   This program is distributed in the hope that it will be useful, but
+ *   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *   for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tiff_plug_in.h"
+#include "codec.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#define TIFF_MAX_THREADS 16
+
+struct _TiffReader
+{
+  gint   n;                          /* handles, the first is the caller's */
+  TIFF  *tif[TIFF_MAX_THREADS];
+};
+
+struct _TiffWriter
+{
+  TIFF    *tif;
+  gint     direct;                   /* plain scanlines, nothing to gain */
+  gint     tiled;
+  gint     threads;
+  uint32   width, length;
+  uint32   unit;                     /* rows per strip or tile length */
+  uint32   band;                     /* rows per band, a multiple of unit */
+  uint32   band_row;                 /* first row of the band */
+  tsize_t  scanline;
+  guchar  *buf;                      /* band rows */
+  /* tiles only */
+  uint32   tile_width, across;
+  tsize_t  tile_size, tile_row_size, pixel_size;
+  guchar  *tiles;                    /* tiles cut out of buf */
+};
+
+typedef void (*TiffJobFunc) (gpointer data, gint slot,
+                             guint32 first, guint32 count);
+
+typedef struct
+{
+  TiffJobFunc func;
+  gpointer    data;
+  gint        slot;
+  guint32     first, count;
+} TiffJob;
+
+
+/*** threads ***/
+
+gint
+tiff_threads (void)
+{
+  static gint threads = 0;
+  GimpParam *return_vals;
+  gint nreturn_vals;
+
+  if (threads > 0)
+    return threads;
+
+  return_vals = gimp_run_procedure ("gimp_gimprc_query",
+                                    &nreturn_vals,
+                                    GIMP_PDB_STRING, "tiff-threads",
+                                    GIMP_PDB_END);
+  if (return_vals[0].data.d_status == GIMP_PDB_SUCCESS &&
+      return_vals[1].data.d_string)
+    threads = atoi (return_vals[1].data.d_string);
+  gimp_destroy_params (return_vals, nreturn_vals);
+
+#ifdef _SC_NPROCESSORS_ONLN
+  if (threads <= 0)
+    threads = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+  threads = CLAMP (threads, 1, TIFF_MAX_THREADS);
+#ifndef HAVE_PTHREAD
+  threads = 1;
+#endif
+
+  return threads;
+}
+
+#ifdef HAVE_PTHREAD
+static void *
+tiff_job_run (void *arg)
+{
+  TiffJob *job = (TiffJob *) arg;
+
+  (*job->func) (job->data, job->slot, job->first, job->count);
+  return NULL;
+}
+#endif
+
+/* split [0, n) over slots, slot 0 runs in the calling thread */
+static void
+tiff_parallel (gint        slots,
+               guint32     n,
+               TiffJobFunc func,
+               gpointer    data)
+{
+#ifdef HAVE_PTHREAD
+  pthread_t threads[TIFF_MAX_THREADS];
+  TiffJob   jobs[TIFF_MAX_THREADS];
+  gint      started = 0, i;
+
+  slots = MIN (slots, (gint) n);
+  if (slots > 1)
+    {
+      for (i = 0; i < slots; i++)
+        {
+          jobs[i].func  = func;
+          jobs[i].data  = data;
+          jobs[i].slot  = i;
+          jobs[i].first = (guint64) n * i / slots;
+          jobs[i].count = (guint64) n * (i + 1) / slots - jobs[i].first;
+        }
+      for (i = 1; i < slots; i++)
+        {
+          if (pthread_create (&threads[i], NULL, tiff_job_run, &jobs[i]) != 0)
+            break;
+          started++;
+        }
+      (*func) (data, 0, jobs[0].first, jobs[0].count);
+      /* slices whose thread could not be started */
+      for (i = started + 1; i < slots; i++)
+        (*func) (data, i, jobs[i].first, jobs[i].count);
+      for (i = 1; i <= started; i++)
+        pthread_join (threads[i], NULL);
+      return;
+    }
+#endif
+  (*func) (data, 0, 0, n);
+}
+
+
+/*** reading ***/
+
+TiffReader *
+tiff_reader_new (TIFF *tif,
+                 gint  threads)
+{
+  TiffReader *reader = g_new0 (TiffReader, 1);
+  TIFFErrorHandler warning, error;
+
+  reader->tif[0] = tif;
+  reader->n = 1;
+
+  /* the caller already saw any complaints about this directory */
+  warning = TIFFSetWarningHandler (NULL);
+  error = TIFFSetErrorHandler (NULL);
+  while (reader->n < MIN (threads, TIFF_MAX_THREADS))
+    {
+      TIFF *h = TIFFOpen (TIFFFileName (tif), "r");
+
+      if (!h)
+        break;
+      if (!TIFFSetDirectory (h, TIFFCurrentDirectory (tif)))
+        {
+          TIFFClose (h);
+          break;
+        }
+      reader->tif[reader->n++] = h;
+    }
+  TIFFSetWarningHandler (warning);
+  TIFFSetErrorHandler (error);
+
+  return reader;
+}
+
+void
+tiff_reader_free (TiffReader *reader)
+{
+  gint i;
+
+  for (i = 1; i < reader->n; i++)
+    TIFFClose (reader->tif[i]);
+  g_free (reader);
+}
+
+typedef struct
+{
+  TiffReader *reader;
+  guint32     first;
+  guchar     *buf;
+  tsize_t     chunk_size;
+  gint        tiled;
+  gint        failed[TIFF_MAX_THREADS];
+} ReadJob;
+
+static void
+read_job (gpointer data,
+          gint     slot,
+          guint32  first,
+          guint32  count)
+{
+  ReadJob *job = (ReadJob *) data;
+  TIFF    *h = job->reader->tif[slot];
+  guint32  i;
+
+  for (i = first; i < first + count; i++)
+    {
+      guchar *dest = job->buf + i * job->chunk_size;
+      tsize_t got;
+
+      if (job->tiled)
+        got = TIFFReadEncodedTile (h, job->first + i, dest, job->chunk_size);
+      else
+        got = TIFFReadEncodedStrip (h, job->first + i, dest, job->chunk_size);
+      if (got < 0)
+        job->failed[slot]++;
+    }
+}
+
+gint
+tiff_read_chunks (TiffReader *reader,
+                  guint32     first,
+                  guint32     n,
+                  guchar     *buf,
+                  tsize_t     chunk_size)
+{
+  TIFFErrorHandler warning = NULL, error = NULL;
+  ReadJob job;
+  gint    slots = MIN (reader->n, (gint) n);
+  gint    failed = 0, i;
+
+  memset (&job, 0, sizeof (job));
+  job.reader = reader;
+  job.first = first;
+  job.buf = buf;
+  job.chunk_size = chunk_size;
+  job.tiled = TIFFIsTiled (reader->tif[0]);
+
+  /* the handlers talk to the application, not from worker threads */
+  if (slots > 1)
+    {
+      warning = TIFFSetWarningHandler (NULL);
+      error = TIFFSetErrorHandler (NULL);
+    }
+  tiff_parallel (slots, n, read_job, &job);
+  if (slots > 1)
+    {
+      TIFFSetWarningHandler (warning);
+      TIFFSetErrorHandler (error);
+    }
+
+  for (i = 0; i < slots; i++)
+    failed += job.failed[i];
+  return failed;
+}
+
+
+/*** writing ***/
+
+/* codecs without pseudo tags or tables shared across chunks */
+gint
+tiff_parallel_compression (gint compression)
+{
+  switch (compression)
+    {
+    case COMPRESSION_NONE:
+    case COMPRESSION_LZW:
+    case COMPRESSION_PACKBITS:
+    case COMPRESSION_DEFLATE:
+    case COMPRESSION_ADOBE_DEFLATE:
+      return TRUE;
+    default:
+      return FALSE;
+    }
+}
+
+gint
+tiff_parallel_codec (TIFF *tif)
+{
+  uint16 compression = COMPRESSION_NONE;
+
+  TIFFGetFieldDefaulted (tif, TIFFTAG_COMPRESSION, &compression);
+  return tiff_parallel_compression (compression);
+}
+
+/* a growing memory file for TIFFClientOpen */
+typedef struct
+{
+  guchar *data;
+  toff_t  size, alloc, pos;
+} MemFile;
+
+static tsize_t
+mem_read (thandle_t handle, tdata_t buf, tsize_t size)
+{
+  MemFile *m = (MemFile *) handle;
+
+  if (m->pos >= m->size)
+    return 0;
+  if ((toff_t) size > m->size - m->pos)
+    size = m->size - m->pos;
+  memcpy (buf, m->data + m->pos, size);
+  m->pos += size;
+  return size;
+}
+
+static tsize_t
+mem_write (thandle_t handle, tdata_t buf, tsize_t size)
+{
+  MemFile *m = (MemFile *) handle;
+
+  if (m->pos + size > m->alloc)
+    {
+      m->alloc = MAX (m->pos + size, m->alloc * 2);
+      m->data = g_realloc (m->data, m->alloc);
+    }
+  if (m->pos > m->size)
+    memset (m->data + m->size, 0, m->pos - m->size);
+  memcpy (m->data + m->pos, buf, size);
+  m->pos += size;
+  m->size = MAX (m->size, m->pos);
+  return size;
+}
+
+static toff_t
+mem_seek (thandle_t handle, toff_t off, int whence)
+{
+  MemFile *m = (MemFile *) handle;
+
+  switch (whence)
+    {
+    case SEEK_SET: m->pos = off;           break;
+    case SEEK_CUR: m->pos += off;          break;
+    case SEEK_END: m->pos = m->size + off; break;
+    }
+  return m->pos;
+}
+
+static int
+mem_close (thandle_t handle)
+{
+  return 0;
+}
+
+static toff_t
+mem_size (thandle_t handle)
+{
+  return ((MemFile *) handle)->size;
+}
+
+static int
+mem_map (thandle_t handle, tdata_t *base, toff_t *size)
+{
+  return 0;
+}
+
+static void
+mem_unmap (thandle_t handle, tdata_t base, toff_t size)
+{
+}
+
+typedef struct
+{
+  TIFF    *tif;
+  guint32  first;
+  guchar  *buf;
+  tsize_t  chunk_size;
+  gint     tiled;
+  /* layout of the chunks */
+  uint32   width, length, rows_per_chunk, chunks_per_plane;
+  uint16   bps, spp, sampleformat, fillorder, compression, predictor;
+  tsize_t  row_size;
+  /* results */
+  guchar **encoded;
+  tsize_t *encoded_size;
+} WriteJob;
+
+/* bytes of raw data in chunk i, the last strip of a plane is shorter */
+static tsize_t
+chunk_bytes (WriteJob *job,
+             guint32   i)
+{
+  uint32 row, rows;
+
+  if (job->tiled)
+    return job->chunk_size;
+  row = ((job->first + i) % job->chunks_per_plane) * job->rows_per_chunk;
+  rows = MIN (job->rows_per_chunk, job->length - row);
+  return rows * job->row_size;
+}
+
+static void
+encode_job (gpointer data,
+            gint     slot,
+            guint32  first,
+            guint32  count)
+{
+  WriteJob *job = (WriteJob *) data;
+  guint32   i;
+
+  for (i = first; i < first + count; i++)
+    {
+      MemFile  mem = { NULL, 0, 0, 0 };
+      tsize_t  size = chunk_bytes (job, i);
+      toff_t  *offsets = NULL, *counts = NULL;
+      TIFF    *m;
+
+      m = TIFFClientOpen ("chunk", "w", (thandle_t) &mem,
+                          mem_read, mem_write, mem_seek, mem_close,
+                          mem_size, mem_map, mem_unmap);
+      if (!m)
+        continue;
+
+      /* a single strip shaped like the chunk, so the codec sees
+         the same rows as it would in the real file */
+      TIFFSetField (m, TIFFTAG_IMAGEWIDTH, job->width);
+      TIFFSetField (m, TIFFTAG_IMAGELENGTH, (uint32) (size / job->row_size));
+      TIFFSetField (m, TIFFTAG_ROWSPERSTRIP, (uint32) (size / job->row_size));
+      TIFFSetField (m, TIFFTAG_BITSPERSAMPLE, job->bps);
+      TIFFSetField (m, TIFFTAG_SAMPLESPERPIXEL, job->spp);
+      TIFFSetField (m, TIFFTAG_SAMPLEFORMAT, job->sampleformat);
+      TIFFSetField (m, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+      TIFFSetField (m, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+      TIFFSetField (m, TIFFTAG_FILLORDER, job->fillorder);
+      TIFFSetField (m, TIFFTAG_COMPRESSION, job->compression);
+      if (job->predictor > 1)
+        TIFFSetField (m, TIFFTAG_PREDICTOR, job->predictor);
+
+      if (TIFFWriteEncodedStrip (m, 0, job->buf + i * job->chunk_size, size) >= 0
+          && TIFFGetField (m, TIFFTAG_STRIPOFFSETS, &offsets)
+          && TIFFGetField (m, TIFFTAG_STRIPBYTECOUNTS, &counts)
+          && offsets[0] + counts[0] <= mem.size)
+        {
+          job->encoded[i] = g_malloc (MAX (counts[0], 1));
+          memcpy (job->encoded[i], mem.data + offsets[0], counts[0]);
+          job->encoded_size[i] = counts[0];
+        }
+
+      TIFFClose (m);
+      g_free (mem.data);
+    }
+}
+
+gint
+tiff_write_chunks (TIFF    *tif,
+                   guint32  first,
+                   guint32  n,
+                   guchar  *buf,
+                   tsize_t  chunk_size,
+                   gint     threads)
+{
+  TIFFErrorHandler warning, error;
+  WriteJob job;
+  uint16   planar = PLANARCONFIG_CONTIG;
+  gint     success = TRUE;
+  guint32  i;
+
+  memset (&job, 0, sizeof (job));
+  job.tif = tif;
+  job.first = first;
+  job.buf = buf;
+  job.chunk_size = chunk_size;
+  job.tiled = TIFFIsTiled (tif);
+
+  TIFFGetField (tif, TIFFTAG_IMAGELENGTH, &job.length);
+  TIFFGetFieldDefaulted (tif, TIFFTAG_BITSPERSAMPLE, &job.bps);
+  TIFFGetFieldDefaulted (tif, TIFFTAG_SAMPLESPERPIXEL, &job.spp);
+  TIFFGetFieldDefaulted (tif, TIFFTAG_SAMPLEFORMAT, &job.sampleformat);
+  TIFFGetFieldDefaulted (tif, TIFFTAG_FILLORDER, &job.fillorder);
+  TIFFGetFieldDefaulted (tif, TIFFTAG_COMPRESSION, &job.compression);
+  if (job.compression == COMPRESSION_LZW ||
+      job.compression == COMPRESSION_DEFLATE ||
+      job.compression == COMPRESSION_ADOBE_DEFLATE)
+    TIFFGetFieldDefaulted (tif, TIFFTAG_PREDICTOR, &job.predictor);
+  TIFFGetFieldDefaulted (tif, TIFFTAG_PLANARCONFIG, &planar);
+  if (planar == PLANARCONFIG_SEPARATE)
+    job.spp = 1;
+
+  if (job.tiled)
+    {
+      TIFFGetField (tif, TIFFTAG_TILEWIDTH, &job.width);
+      TIFFGetField (tif, TIFFTAG_TILELENGTH, &job.rows_per_chunk);
+    }
+  else
+    {
+      TIFFGetField (tif, TIFFTAG_IMAGEWIDTH, &job.width);
+      TIFFGetFieldDefaulted (tif, TIFFTAG_ROWSPERSTRIP, &job.rows_per_chunk);
+      job.rows_per_chunk = MIN (job.rows_per_chunk, job.length);
+      job.chunks_per_plane = (job.length + job.rows_per_chunk - 1)
+                             / job.rows_per_chunk;
+    }
+  job.row_size = chunk_size / job.rows_per_chunk;
+
+  if (threads < 2 || n < 2 || !tiff_parallel_codec (tif))
+    {
+      for (i = 0; i < n && success; i++)
+        {
+          if (job.tiled)
+            success = TIFFWriteEncodedTile (tif, first + i,
+                          buf + i * chunk_size, chunk_bytes (&job, i)) >= 0;
+          else
+            success = TIFFWriteEncodedStrip (tif, first + i,
+                          buf + i * chunk_size, chunk_bytes (&job, i)) >= 0;
+        }
+      return success;
+    }
+
+  job.encoded = g_new0 (guchar *, n);
+  job.encoded_size = g_new0 (tsize_t, n);
+
+  warning = TIFFSetWarningHandler (NULL);
+  error = TIFFSetErrorHandler (NULL);
+  tiff_parallel (threads, n, encode_job, &job);
+  TIFFSetWarningHandler (warning);
+  TIFFSetErrorHandler (error);
+
+  for (i = 0; i < n; i++)
+    {
+      if (success && job.encoded[i])
+        {
+          if (job.tiled)
+            success = TIFFWriteRawTile (tif, first + i, job.encoded[i],
+                                        job.encoded_size[i]) >= 0;
+          else
+            success = TIFFWriteRawStrip (tif, first + i, job.encoded[i],
+                                         job.encoded_size[i]) >= 0;
+        }
+      else if (success)
+        {
+          /* the memory encoder failed, let libtiff say why */
+          if (job.tiled)
+            success = TIFFWriteEncodedTile (tif, first + i,
+                          buf + i * chunk_size, chunk_bytes (&job, i)) >= 0;
+          else
+            success = TIFFWriteEncodedStrip (tif, first + i,
+                          buf + i * chunk_size, chunk_bytes (&job, i)) >= 0;
+        }
+      g_free (job.encoded[i]);
+    }
+  g_free (job.encoded);
+  g_free (job.encoded_size);
+
+  return success;
+}
+
+
+/*** band writer ***/
+
+TiffWriter *
+tiff_writer_new (TIFF    *tif,
+                 guint32  band_rows)
+{
+  TiffWriter *writer = g_new0 (TiffWriter, 1);
+  uint16      bps = 8, spp = 1, planar = PLANARCONFIG_CONTIG;
+
+  writer->tif = tif;
+  writer->tiled = TIFFIsTiled (tif);
+  writer->threads = tiff_threads ();
+  writer->scanline = TIFFScanlineSize (tif);
+  TIFFGetField (tif, TIFFTAG_IMAGEWIDTH, &writer->width);
+  TIFFGetField (tif, TIFFTAG_IMAGELENGTH, &writer->length);
+
+  /* strips of a serial codec gain nothing from a band */
+  if (!writer->tiled &&
+      (writer->threads < 2 || !tiff_parallel_codec (tif)))
+    {
+      writer->direct = TRUE;
+      return writer;
+    }
+
+  if (writer->tiled)
+    {
+      TIFFGetFieldDefaulted (tif, TIFFTAG_BITSPERSAMPLE, &bps);
+      TIFFGetFieldDefaulted (tif, TIFFTAG_SAMPLESPERPIXEL, &spp);
+      TIFFGetFieldDefaulted (tif, TIFFTAG_PLANARCONFIG, &planar);
+      if (planar == PLANARCONFIG_SEPARATE)
+        spp = 1;
+      TIFFGetField (tif, TIFFTAG_TILEWIDTH, &writer->tile_width);
+      TIFFGetField (tif, TIFFTAG_TILELENGTH, &writer->unit);
+      writer->across = (writer->width + writer->tile_width - 1)
+                       / writer->tile_width;
+      writer->tile_size = TIFFTileSize (tif);
+      writer->tile_row_size = TIFFTileRowSize (tif);
+      writer->pixel_size = bps * spp / 8;
+    }
+  else
+    {
+      TIFFGetFieldDefaulted (tif, TIFFTAG_ROWSPERSTRIP, &writer->unit);
+      writer->unit = MIN (writer->unit, writer->length);
+    }
+  writer->unit = MAX (writer->unit, 1);
+  writer->band = writer->unit * MAX (1, band_rows / writer->unit);
+
+  writer->buf = g_malloc ((size_t) writer->band * writer->scanline);
+  if (writer->tiled)
+    writer->tiles = g_malloc ((size_t) writer->tile_size * writer->across
+                              * (writer->band / writer->unit));
+
+  return writer;
+}
+
+static gint
+tiff_writer_flush (TiffWriter *writer,
+                   uint32      rows,
+                   tsample_t   sample)
+{
+  TIFF   *tif = writer->tif;
+  uint32  n, tx, ty, r, x0, bytes;
+  guchar *tile;
+
+  if (!writer->tiled)
+    return tiff_write_chunks (tif,
+                              TIFFComputeStrip (tif, writer->band_row, sample),
+                              (rows + writer->unit - 1) / writer->unit,
+                              writer->buf,
+                              writer->scanline * writer->unit,
+                              writer->threads);
+
+  /* cut the band into tiles, padding the right and bottom edges */
+  n = (rows + writer->unit - 1) / writer->unit;
+  memset (writer->tiles, 0, (size_t) writer->tile_size * writer->across * n);
+  for (ty = 0; ty < n; ty++)
+    for (tx = 0; tx < writer->across; tx++)
+      {
+        tile = writer->tiles + (ty * writer->across + tx) * writer->tile_size;
+        x0 = tx * writer->tile_width;
+        bytes = MIN (writer->tile_width, writer->width - x0)
+                * writer->pixel_size;
+        for (r = 0; r < writer->unit && ty * writer->unit + r < rows; r++)
+          memcpy (tile + r * writer->tile_row_size,
+                  writer->buf + (ty * writer->unit + r) * writer->scanline
+                  + x0 * writer->pixel_size,
+                  bytes);
+      }
+
+  return tiff_write_chunks (tif,
+                            TIFFComputeTile (tif, 0, writer->band_row, 0,
+                                             sample),
+                            n * writer->across,
+                            writer->tiles,
+                            writer->tile_size,
+                            writer->threads);
+}
+
+gint
+tiff_writer_row (TiffWriter *writer,
+                 tdata_t     data,
+                 guint32     row,
+                 tsample_t   sample)
+{
+  uint32 rows;
+
+  if (writer->direct)
+    return TIFFWriteScanline (writer->tif, data, row, sample);
+
+  if (row % writer->band == 0)
+    writer->band_row = row;
+  else if (row < writer->band_row || row >= writer->band_row + writer->band)
+    return -1;
+  rows = row - writer->band_row + 1;
+
+  memcpy (writer->buf + (rows - 1) * writer->scanline, data,
+          writer->scanline);
+
+  if (rows == writer->band || row == writer->length - 1)
+    return tiff_writer_flush (writer, rows, sample) ? 1 : -1;
+  return 1;
+}
+
+void
+tiff_writer_free (TiffWriter *writer)
+{
+  g_free (writer->buf);
+  g_free (writer->tiles);
+  g_free (writer);
+}
@@ -0,0 +1,79 @@
+/*
+ *   TIFF plug-in for CinePaint
+ *
+ *   strips and tiles decoded and encoded on worker threads
+ *
+ *   This program is free software; you can redistribute it and/or modify it
+ *   under the terms of the GNU General Public License as published by the Free
+ *   Software Foundation; either version 2 of the License, or (at your option)
+ *   any later version.
+ *
+ *   This program is distributed in the hope that it will be useful, but
+ *   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *   for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef _CODEC_H_
+#define _CODEC_H_
+
+#include <tiffio.h>
+#include <glib.h>
+
+/* tile size of tiled output, a multiple of 16 as TIFF wants */
+#define TIFF_TILE_SIZE 256
+
+typedef struct _TiffReader TiffReader;
+typedef struct _TiffWriter TiffWriter;
+
+/*** function definitions ***/
+
+  /* --- threads --- */
+
+/* the tiff-threads gimprc entry, one per processor when unset or 0 */
+gint        tiff_threads          (   void);
+
+  /* --- reading --- */
+
+/* extra handles on the file and directory of tif, one per thread */
+TiffReader* tiff_reader_new       (   TIFF            *tif,
+                                      gint             threads);
+void        tiff_reader_free      (   TiffReader      *reader);
+/* decode the n strips or tiles from first on into buf, each chunk_size
+   bytes apart; returns how many could not be read */
+gint        tiff_read_chunks      (   TiffReader      *reader,
+                                      guint32          first,
+                                      guint32          n,
+                                      guchar          *buf,
+                                      tsize_t          chunk_size);
+
+  /* --- writing --- */
+
+/* whether a compression can be decoded and encoded away from its handle */
+gint        tiff_parallel_compression ( gint           compression);
+gint        tiff_parallel_codec   (   TIFF            *tif);
+/* encode and write the n strips or tiles from first on out of buf,
+   each chunk_size bytes apart; returns FALSE on a write error */
+gint        tiff_write_chunks     (   TIFF            *tif,
+                                      guint32          first,
+                                      guint32          n,
+                                      guchar          *buf,
+                                      tsize_t          chunk_size,
+                                      gint             threads);
+
+/* collects rows into bands of about band_rows, written as whole strips
+   or tiles; rows must come in file order */
+TiffWriter* tiff_writer_new       (   TIFF            *tif,
+                                      guint32          band_rows);
+/* like TIFFWriteScanline */
+gint        tiff_writer_row       (   TiffWriter      *writer,
+                                      tdata_t          data,
+                                      guint32          row,
+                                      tsample_t        sample);
+void        tiff_writer_free      (   TiffWriter      *writer);
+
+#endif /*_CODEC_H_ */
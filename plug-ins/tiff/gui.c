@@ -259,6 +259,7 @@ save_dialog                  (  ImageInfo       *info)
   gint use_lsb2msb = (info->save_vals.fillorder == FILLORDER_LSB2MSB);
   gint use_msb2lsb = (info->save_vals.fillorder == FILLORDER_MSB2LSB);
   gint use_sep_planar = (info->planar == PLANARCONFIG_SEPARATE);
+  gint use_tiled = (info->save_vals.tiled == TRUE);
   gint use_premultiply =(info->save_vals.premultiply == EXTRASAMPLE_ASSOCALPHA);
   gint use_notpremultiply = (info->save_vals.premultiply == EXTRASAMPLE_UNASSALPHA
                     || info->save_vals.premultiply == EXTRASAMPLE_UNSPECIFIED );
@@ -390,6 +391,16 @@ save_dialog                  (  ImageInfo       *info)
 		      &use_sep_planar);
   gtk_toggle_button_set_state (GTK_TOGGLE_BUTTON (toggle), use_sep_planar);
 
+  /* tiles */
+  toggle = gtk_check_button_new_with_label (_("Write Tiles"));
+  gtk_box_pack_start (GTK_BOX (hbox), toggle, TRUE, TRUE, 0);
+  gtk_widget_show (toggle);
+
+  gtk_signal_connect (GTK_OBJECT (toggle), "toggled",
+		      GTK_SIGNAL_FUNC (gimp_toggle_button_update),
+		      &use_tiled);
+  gtk_toggle_button_set_state (GTK_TOGGLE_BUTTON (toggle), use_tiled);
+
   vbox = gtk_vbox_new (FALSE, 2);
   gtk_container_set_border_width (GTK_CONTAINER (vbox), 10);
   gtk_box_pack_start (GTK_BOX (GTK_DIALOG (dlg)->vbox), vbox, FALSE, TRUE, 0);
@@ -445,6 +456,8 @@ save_dialog                  (  ImageInfo       *info)
   else
     tsvals_.planar_separate = PLANARCONFIG_CONTIG;
 
+  tsvals_.tiled = use_tiled;
+
   if (use_premultiply
    && info->save_vals.premultiply != EXTRASAMPLE_UNSPECIFIED) {
     tsvals_.premultiply = EXTRASAMPLE_ASSOCALPHA;
@@ -475,6 +488,7 @@ save_dialog                  (  ImageInfo       *info)
         info->logDataFMT = PIXARLOGDATAFMT_FLOAT;
     }
     info->planar = tsvals_.planar_separate;
+    info->save_vals.tiled = tsvals_.tiled;
   }
 
   info = info->top;
@@ -165,6 +165,7 @@ static char Version_[] = "v1.5.1";
 
 #include "tiff_plug_in.h"
 #include "cmm_funcs.h"
+#include "codec.h"
 #include "info.h"
 #include "gui.h"
 
@@ -294,6 +295,8 @@ static gint   save_image    (   gchar           *filename,
 			        gint32           drawable_ID,
                                 ImageInfo       *info);
 #endif /* gimp-1.2 */
+static void   set_tiled     (   ImageInfo       *info,
+                                gint             tiled);
 
 
 
@@ -308,6 +311,8 @@ TiffSaveVals tsvals_ =
   COMPRESSION_NONE,    /*  compression  */
   FILLORDER_MSB2LSB,   /*  fillorder    */
   EXTRASAMPLE_ASSOCALPHA,  /*  premultiplying the alpha channel */
+  PLANARCONFIG_CONTIG, /*  planar_separate */
+  FALSE,               /*  tiled        */
 };
 
 TiffSaveInterface tsint =
@@ -380,7 +385,8 @@ query (void)
     { GIMP_PDB_STRING, "raw_filename", "The name of the file to save the image in" },
     { GIMP_PDB_INT32, "compression", "Compression type: { NONE (0), LZW (1), PACKBITS (2), DEFLATE (3), JPEG (4), JP2000 (5), Adobe (6)" },
     { GIMP_PDB_INT32, "fillorder", "Fill Order: { MSB to LSB (0), LSB to MSB (1)" },
-    { GIMP_PDB_INT32, "premultiply", "premultiply alpha: { unspecified (0), premultiply (1), NON premultiply (2)" }
+    { GIMP_PDB_INT32, "premultiply", "premultiply alpha: { unspecified (0), premultiply (1), NON premultiply (2)" },
+    { GIMP_PDB_INT32, "tiled", "Layout: { strips (0), tiles (1), optional" }
     /*{ GIMP_PDB_STRING, "profile_name", "The name of the profile to embed." }*/
   };
   static int nsave_args = (int)sizeof (save_args) / (int)sizeof (save_args[0]);
@@ -559,7 +565,7 @@ run                      (gchar     *name,
             INIT_I18N();
           #endif
 	  /*  Make sure all the arguments are there! */
-	  if (nparams != 8)
+	  if (nparams != 8 && nparams != 9)
 	    {
 	      status = GIMP_PDB_CALLING_ERROR;
 	    }
@@ -589,6 +595,7 @@ run                      (gchar     *name,
 		case 2: tsvals_.premultiply = EXTRASAMPLE_UNASSALPHA; break;
 		default: status = GIMP_PDB_CALLING_ERROR; break;
 		}
+	      tsvals_.tiled = (nparams > 8 && param[8].data.d_int32);
 	    }
 	  break;
 
@@ -614,6 +621,7 @@ run                      (gchar     *name,
 
       if (status == GIMP_PDB_SUCCESS)
 	{
+	  set_tiled (info, tsvals_.tiled);
 	  if (save_image (param[3].data.d_string, image_ID, drawable_ID,
                           orig_image_ID, info))
 	    {
@@ -677,7 +685,7 @@ run                      (gchar     *name,
 
 	case GIMP_RUN_NONINTERACTIVE:
 	  /*  Make sure all the arguments are there! */
-	  if (nparams != 9)
+	  if (nparams != 8 && nparams != 9)
 	    status = GIMP_PDB_CALLING_ERROR;
 	  if (status == GIMP_PDB_SUCCESS)
 	    {
@@ -705,6 +713,7 @@ run                      (gchar     *name,
 		case 2: tsvals_.premultiply = EXTRASAMPLE_UNASSALPHA; break;
 		default: status = GIMP_PDB_CALLING_ERROR; break;
 		}
+	      tsvals_.tiled = (nparams > 8 && param[8].data.d_int32);
 	    }
 	  break;
 
@@ -716,6 +725,7 @@ run                      (gchar     *name,
 	}
 
       *nreturn_vals = 1;
+      set_tiled (info, tsvals_.tiled);
       if (save_image (param[3].data.d_string, param[1].data.d_int32,
                       param[2].data.d_int32, info) == 1)
 	{
@@ -1387,62 +1397,74 @@ load_tiles (TIFF *tif,                /* the tiff data */
 {
   uint32 tileWidth=0, tileLength=0;
   uint32 x, y, rows, cols/*,  **tileoffsets */;
-  guchar *buffer=NULL;
+  uint32 across;        /* tiles in a row of tiles */
+  tsize_t tileSize;
+  guchar *buffer=NULL, *tile;
   double progress= 0.0, one_row;
   gushort i;
+  TiffReader *reader;
 
   TIFFGetField(tif, TIFFTAG_TILEWIDTH, &tileWidth);
   TIFFGetField(tif, TIFFTAG_TILELENGTH, &tileLength);
 
   one_row = (double) tileLength / (double) ci->rows;
-  m_new ( buffer, char, (size_t)TIFFTileSize(tif), return)
+  tileSize = TIFFTileSize(tif);
+  across = (ci->cols + tileWidth - 1) / tileWidth;
+  /* a whole row of tiles is decoded at once */
+  m_new ( buffer, char, (size_t)tileSize * across, return)
 
   for (i= 0; i <= ci->extra; ++i) {
     m_new (ci->channel[i].pixels, char, (size_t)
            (tileWidth * tileLength * ci->channel[i].drawable->bpp), return)
   }
 
+  reader = tiff_reader_new (tif, tiff_parallel_codec (tif) ?
+                                 tiff_threads () : 1);
+
   for (y = 0; y < (uint32)ci->rows; y += tileLength) {
+    if (tiff_read_chunks (reader, TIFFComputeTile (tif, 0, y, 0, 0),
+                          across, buffer, tileSize))
+      g_message("TIFFReadTile failed");
+
     for (x = 0; x < (uint32)ci->cols; x += tileWidth) {
       gimp_progress_update (progress + one_row *
                             ( (double) x / (double) ci->cols));
-      if (!TIFFReadTile(tif, buffer, x, y, 0, 0))
-	g_message("TIFFReadTile failed");
+      tile = buffer + (x / tileWidth) * tileSize;
 
       /* TODO set here an profile checking with conversion to color_type_ */
 
       cols= MIN(ci->cols - x, tileWidth);
       rows= MIN(ci->rows - y, tileLength);
       if          (ci->bps == 64) {
-        read_64bit(buffer, ci->channel, ci->photomet,
+        read_64bit(tile, ci->channel, ci->photomet,
 		 (gint)x, (gint)y, (gint)cols, (gint)rows, ci->alpha,
                   (gint)ci->extra, (gint)ci->assoc,
                   (gint)(tileWidth - cols));
       } else if   (ci->bps == 32) {
-        read_32bit(buffer, ci->channel, ci->photomet,
+        read_32bit(tile, ci->channel, ci->photomet,
 		 (gint)x, (gint)y, (gint)cols, (gint)rows, ci->alpha,
                   (gint)ci->extra, (gint)ci->assoc,
                   (gint)(tileWidth - cols), ci);
       } else if  ( ci->bps == 16
 	 && (ci->sampleformat == SAMPLEFORMAT_IEEEFP
 	  || ci->sampleformat == SAMPLEFORMAT_VOID) ) {
-        read_f16bit(buffer, ci->channel, ci->photomet,
+        read_f16bit(tile, ci->channel, ci->photomet,
 		  (gint)x, (gint)y, (gint)cols, (gint)rows, ci->alpha,
                   (gint)ci->extra, (gint)ci->assoc,
                   (gint)(tileWidth - cols));
       } else if  ( ci->bps == 16
 	 && (ci->sampleformat == SAMPLEFORMAT_UINT) ) {
-        read_u16bit(buffer, ci->channel, ci->photomet,
+        read_u16bit(tile, ci->channel, ci->photomet,
 		  (gint)x, (gint)y, (gint)cols, (gint)rows, ci->alpha,
                   (gint)ci->extra, (gint)ci->assoc,
                   (gint)(tileWidth - cols));
       } else if   (ci->bps == 8) {
-        read_8bit(buffer, ci->channel, ci->photomet,
+        read_8bit(tile, ci->channel, ci->photomet,
 		  (gint)x, (gint)y, (gint)cols, (gint)rows, ci->alpha,
                   (gint)ci->extra, (gint)ci->assoc,
                   (gint)(tileWidth - cols));
       } else {
-        read_default(buffer, ci->channel, ci->bps, ci->photomet,
+        read_default(tile, ci->channel, ci->bps, ci->photomet,
 		  (gint)x, (gint)y, (gint)cols, (gint)rows, ci->alpha,
                   (gint)ci->extra, (gint)ci->assoc,
                   (gint)(tileWidth - cols));
@@ -1454,6 +1476,7 @@ load_tiles (TIFF *tif,                /* the tiff data */
     m_free (ci->channel[i].pixels)
   }
 
+  tiff_reader_free (reader);
   m_free(buffer)
 }
 
@@ -1468,12 +1491,29 @@ load_lines( TIFF *tif,                /* the tiff data */
   guchar *buffer=NULL;
   gint32  g_row,        /* growing row */
           j_row,        /* jumping (tile-height) row */
-          i, tile_height = (gint32)gimp_tile_height ();
+          i, tile_height = (gint32)gimp_tile_height (),
+          band;        /* rows converted at once */
+  uint32  rps = 0;     /* rows per strip */
+  gint    threads = tiff_threads (),
+          failed;
+  TiffReader *reader = NULL;
   char   *text=NULL;
   
   cols = ci->cols;
     
   lineSize = TIFFScanlineSize(tif);
+
+  /* decode whole strips on several threads, when they are small
+     enough and the codec needs no setup beyond the file */
+  band = tile_height;
+  TIFFGetFieldDefaulted (tif, TIFFTAG_ROWSPERSTRIP, &rps);
+  rps = MIN (rps, (uint32)ci->rows);
+  if (threads > 1 && rps > 0 && tiff_parallel_codec (tif)
+      && rps <= (uint32)(tile_height * threads)
+      && TIFFStripSize (tif) == (tsize_t)rps * lineSize)
+    band = rps * MAX (1, tile_height * threads / (gint32)rps);
+  else
+    threads = 1;
 # ifdef DEBUG
   { char    dbg[64];
     snprintf(dbg,64, "lineSize %d",lineSize);
@@ -1483,10 +1523,12 @@ load_lines( TIFF *tif,                /* the tiff data */
 
   for (i= 0; i <= ci->extra; ++i) { 
     m_new (ci->channel[i].pixels, char,
-           tile_height * cols * ci->channel[i].drawable->bpp, return)
+           band * cols * ci->channel[i].drawable->bpp, return)
   }
 
-  m_new ( buffer, char, lineSize * tile_height, return)
+  m_new ( buffer, char, lineSize * band, return)
+  if (threads > 1)
+    reader = tiff_reader_new (tif, threads);
 
   if (ci->planar == PLANARCONFIG_CONTIG) {
     if (ci->channel->drawable->bpp !=
@@ -1496,14 +1538,21 @@ load_lines( TIFF *tif,                /* the tiff data */
             (float)ci->bps/8.0* (float)ci->spp,
             (float)ci->bps/8.0, (float)ci->spp);
 
-    for (j_row = 0; j_row < ci->rows; j_row+= tile_height ) { 
+    for (j_row = 0; j_row < ci->rows; j_row+= band ) { 
       /* jumping progress */
       gimp_progress_update ( (double) j_row / (double) ci->rows);
-      /* is the remainder smaller? - then not tile_height  */
-      rows = MIN(tile_height, ci->rows - j_row);
-      /* walking along the rows within tile_height */
+      /* is the remainder smaller? - then not band  */
+      rows = MIN(band, ci->rows - j_row);
+      if (reader) {
+        failed = tiff_read_chunks (reader, TIFFComputeStrip (tif, j_row, 0),
+                                   (rows + rps - 1) / rps, buffer,
+                                   (tsize_t)rps * lineSize);
+        if (failed)
+          g_message("%d strips not readable", failed);
+      } else
+      /* walking along the rows within band */
       for (g_row = 0; g_row < rows; ++g_row)
-        /* buffer is only for one tile-height (* bpp * cols)  */
+        /* buffer is only for one band (* bpp * cols)  */
 	if (!TIFFReadScanline(tif, buffer + g_row * lineSize,
                     (uint32)(j_row + g_row), 0))
 	  g_message("Scanline %d not readable", (int)g_row);
@@ -1559,10 +1608,18 @@ load_lines( TIFF *tif,                /* the tiff data */
 
       m_free (text)
 
-      for (j_row = 0; j_row < ci->rows; j_row += tile_height) {
+      for (j_row = 0; j_row < ci->rows; j_row += band) {
         gimp_progress_update ( (double) j_row / (double) ci->rows);
-        rows = MIN (tile_height, ci->rows - j_row);
-
+        rows = MIN (band, ci->rows - j_row);
+
+        if (reader) {
+          failed = tiff_read_chunks (reader,
+                                     TIFFComputeStrip (tif, j_row, sample),
+                                     (rows + rps - 1) / rps, buffer,
+                                     (tsize_t)rps * lineSize);
+          if (failed)
+            g_message("%d strips not readable", failed);
+        } else
         for (g_row = 0;  g_row < rows; ++g_row) {
           TIFFReadScanline(tif, buffer + g_row * lineSize,
                  (uint32)(j_row + g_row), sample);
@@ -1577,6 +1634,8 @@ load_lines( TIFF *tif,                /* the tiff data */
     m_free (ci->channel[i].pixels)
   }
 
+  if (reader)
+    tiff_reader_free (reader);
   m_free(buffer)
 }
 
@@ -2859,6 +2918,21 @@ read_separate               (   guchar          *source,
 ** other special, indirect and consequential damages.
 */
 
+/* the layout is chosen per save, not taken from the loaded pages */
+static void
+set_tiled (ImageInfo *info,
+           gint       tiled)
+{
+  long dircount;
+
+  info = info->top;
+  for (dircount = 0; dircount < info->pagecount; dircount++) {
+    if (dircount > 0)
+      info = info->next;
+    info->save_vals.tiled = tiled;
+  }
+}
+
 static gint
 save_image (char   *filename,
 	    gint32  image_ID,
@@ -2893,6 +2967,7 @@ save_image (char   *filename,
       planes;                   /* total number of planes to write */
 
   TIFF *tif;
+  TiffWriter *writer;
  
   g3options = 0;
   predictor = 0;
@@ -2973,6 +3048,9 @@ save_image (char   *filename,
       }
       if (info->planar == PLANARCONFIG_SEPARATE) {
         rowsperstrip = 1;
+      } else if (tiff_threads () > 1
+              && tiff_parallel_compression (info->save_vals.compression)) {
+        rowsperstrip = tile_height;  /* enough to split over threads */
       }
 
       /* Set TIFF parameters. */
@@ -3051,7 +3129,11 @@ save_image (char   *filename,
 
       TIFFSetField (tif, TIFFTAG_SAMPLESPERPIXEL, info->spp);
    /* TIFFSetField( tif, TIFFTAG_STRIPBYTECOUNTS, rows / rowsperstrip ); */
-      TIFFSetField (tif, TIFFTAG_ROWSPERSTRIP, rowsperstrip);
+      if (info->save_vals.tiled && info->bps >= 8) {
+        TIFFSetField (tif, TIFFTAG_TILEWIDTH, TIFF_TILE_SIZE);
+        TIFFSetField (tif, TIFFTAG_TILELENGTH, TIFF_TILE_SIZE);
+      } else
+        TIFFSetField (tif, TIFFTAG_ROWSPERSTRIP, rowsperstrip);
       TIFFSetField (tif, TIFFTAG_PLANARCONFIG, info->planar);
       if (gimp_drawable_type (drawable_ID) == INDEXED_IMAGE) {
         TIFFSetField (tif, TIFFTAG_COLORMAP, &info->red[0], &info->grn[0], &info->blu[0]);
@@ -3157,6 +3239,8 @@ save_image (char   *filename,
       /* array to rearrange data */
       m_new ( src, guint8, (size_t)bytesperrow * tile_height, return FALSE)
       m_new ( data, guint8, (size_t)bytesperrow, return FALSE)
+      /* rows go out in bands of whole strips or tiles */
+      writer = tiff_writer_new (tif, tile_height * tiff_threads ());
 
       if (info->planar == PLANARCONFIG_SEPARATE) {
         planes = (int)(info->spp);
@@ -3184,10 +3268,10 @@ save_image (char   *filename,
 	      switch (drawable_type)
 	        {
 	        case INDEXED_IMAGE:
-	          success = (TIFFWriteScanline (tif, t, row, 0) >= 0);
+	          success = (tiff_writer_row (writer, t, row, 0) >= 0);
 	          break;
 	        case GRAY_IMAGE:
-	          success = (TIFFWriteScanline (tif, t, row, 0) >= 0);
+	          success = (tiff_writer_row (writer, t, row, 0) >= 0);
 	          break;
 	        case GRAYA_IMAGE:
 	          for (col = 0; col < info->cols*info->spp; col+=info->spp)
@@ -3201,7 +3285,7 @@ save_image (char   *filename,
                       }
 		      data[col + 1] = t[col + 1];  /* alpha channel */
 		    }
-	          success = (TIFFWriteScanline (tif, data, row, 0) >= 0);
+	          success = (tiff_writer_row (writer, data, row, 0) >= 0);
 	          break;
 	        case RGB_IMAGE:
 	        case RGBA_IMAGE:
@@ -3250,14 +3334,14 @@ save_image (char   *filename,
 		              d[d_col + lsample] = s[s_col + 3]; /* alpha */
 		        }
 		    }
-	          success = (TIFFWriteScanline (tif, data, row, sample) >= 0);
-                  /* g_print("    TIFFWriteScanline = %d\n", success); */
+	          success = (tiff_writer_row (writer, data, row, sample) >= 0);
+                  /* g_print("    tiff_writer_row = %d\n", success); */
 	          break;
 #if GIMP_MAJOR_VERSION < 1
 	        case U16_INDEXED_IMAGE:
 	          break;
 	        case U16_GRAY_IMAGE:
-	          success = (TIFFWriteScanline (tif, t, row, 0) >= 0);
+	          success = (tiff_writer_row (writer, t, row, 0) >= 0);
 	          break;
 	        case U16_GRAYA_IMAGE:
 		    { 
@@ -3276,7 +3360,7 @@ save_image (char   *filename,
 		          d[col + 1] = s[col + 1];  /* alpha channel */
 		        }
 		    }
-	          success = (TIFFWriteScanline (tif, data, row, 0) >= 0);
+	          success = (tiff_writer_row (writer, data, row, 0) >= 0);
 	          break;
 	        case U16_RGB_IMAGE:
 	        case U16_RGBA_IMAGE:
@@ -3326,10 +3410,10 @@ save_image (char   *filename,
 		              d[d_col + lsample] = s[s_col + 3]; /* alpha */
 		        }
 		    }
-	          success = (TIFFWriteScanline (tif, data, row, sample) >= 0);
+	          success = (tiff_writer_row (writer, data, row, sample) >= 0);
 	          break;
 	        case FLOAT16_GRAY_IMAGE:
-	          success = (TIFFWriteScanline (tif, t, row, 0) >= 0);
+	          success = (tiff_writer_row (writer, t, row, 0) >= 0);
 	          break;
 	        case FLOAT16_GRAYA_IMAGE:
 		    { 
@@ -3349,10 +3433,10 @@ save_image (char   *filename,
 		          d[col + 1] = s[col + 1];  /* alpha channel */
 		        }
 		    }
-	          success = (TIFFWriteScanline (tif, data, row, 0) >= 0);
+	          success = (tiff_writer_row (writer, data, row, 0) >= 0);
 	          break;
 	        case FLOAT16_RGB_IMAGE:
-                  success = (TIFFWriteScanline (tif, t, row, 0) >= 0);
+                  success = (tiff_writer_row (writer, t, row, 0) >= 0);
 	          break;
 	        case FLOAT16_RGBA_IMAGE:
 		    {
@@ -3378,10 +3462,10 @@ save_image (char   *filename,
 		          d[col+3] = s[col + 3];  /* alpha channel */
 		        }
 		    }
-	          success = (TIFFWriteScanline (tif, data, row, 0) >= 0);
+	          success = (tiff_writer_row (writer, data, row, 0) >= 0);
 	          break;
 	        case FLOAT_GRAY_IMAGE:
-	          success = (TIFFWriteScanline (tif, t, row, 0) >= 0);
+	          success = (tiff_writer_row (writer, t, row, 0) >= 0);
 	          break;
 	        case FLOAT_GRAYA_IMAGE:
 		    {
@@ -3399,7 +3483,7 @@ save_image (char   *filename,
 		          d[col + 1] = s[col + 1];  /* alpha channel */
 		        }
 		    }
-	          success = (TIFFWriteScanline (tif, data, row, 0) >= 0);
+	          success = (tiff_writer_row (writer, data, row, 0) >= 0);
 	          break;
 	        case FLOAT_RGB_IMAGE:
 	        case FLOAT_RGBA_IMAGE:
@@ -3454,7 +3538,7 @@ save_image (char   *filename,
                     if (info->alpha)
                       d[col+3] = s[col + 3];  /* alpha channel */
                   }
-	          success = (TIFFWriteScanline (tif, data, row, 0) >= 0);
+	          success = (tiff_writer_row (writer, data, row, 0) >= 0);
 	          break;
                 }
 #endif /* cinepaint */
@@ -3473,6 +3557,7 @@ save_image (char   *filename,
         }
       }
 
+      tiff_writer_free (writer);
       TIFFWriteDirectory (tif); /* for multi-pages */
 
       TIFFFlushData (tif);
@@ -173,6 +173,7 @@ typedef struct
   gint  fillorder;		/* msb versus lsb */
   gint  premultiply;		/* assoc versus unassociated alpha */
   gint  planar_separate;        /* write separate planes per sample */
+  gint  tiled;                  /* write tiles instead of strips */
 } TiffSaveVals;
 
 typedef struct